@@ -53,8 +53,11 @@ void setup() {
   // running this sketch will share the first 3 bytes of their MAC addresses,
   // which may help with locating them.
   mcunet::OuiPrefix oui_prefix(0x53, 0x76, 0x77);
-  mcucore::EepromTlv eeprom_tlv = mcucore::EepromTlv::GetOrDie();
+  // ip_device keeps using eeprom_tlv (to save DHCP leases), so it must outlive
+  // setup().
+  static mcucore::EepromTlv eeprom_tlv = mcucore::EepromTlv::GetOrDie();
   MCU_CHECK_OK((ip_device.InitializeNetworking(eeprom_tlv, &oui_prefix)));
+  ip_device.AddServerSocket(echo_socket);
 
   Serial.println();
   mcunet::IpDevice::PrintNetworkAddresses();
@@ -62,6 +65,17 @@ void setup() {
 }
 
 void loop() {
+  // InitializeNetworking starts with the link-local address, and DHCP runs in
+  // the background, so the IP address may change while we're looping; when it
+  // does, echo_socket loses its hardware socket, and picks another below.
+  const int dhcp_check = ip_device.MaintainDhcpLease();
+  if (dhcp_check == DHCP_CHECK_REBIND_OK ||
+      dhcp_check == DHCP_CHECK_REBIND_FAIL) {
+    Serial.println();
+    mcunet::IpDevice::PrintNetworkAddresses();
+    Serial.println();
+  }
+
   if (!echo_socket.HasSocket()) {
     if (echo_socket.PickClosedSocket()) {
       MCU_VLOG(1) << MCU_PSD("Picked a hardware socket for echo_socket.");
@@ -31,8 +31,9 @@ void setup() {
   // Initialize networking.
   mcunet::Mega2560Eth::SetupW5500();
 
-  // Get an EepromTlv instance, to be used for persistence of settings.
-  auto eeprom_tlv = mcucore::EepromTlv::GetOrDie();
+  // Get an EepromTlv instance, to be used for persistence of settings. It is
+  // static because ip_device keeps using it (to save DHCP leases).
+  static auto eeprom_tlv = mcucore::EepromTlv::GetOrDie();
 
   // Initialize the pseudo-random number generator with a random number
   // generated based on clock jitter.
@@ -119,6 +120,7 @@ void loop() {
       return;
     case DHCP_CHECK_REBIND_FAIL:
       Serial.println("DHCP_CHECK_REBIND_FAIL: Unable to renew the DHCP lease.");
+      announceAddresses();
       delay(1000);
       return;
     case DHCP_CHECK_REBIND_OK:
@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+"""Packs static files into a C++ header for serving by HttpAssetHandler.
+
+Each file under the asset directory is gzipped (deterministically, so that the
+output only changes when the input does), and the compressed bytes are written
+as a PROGMEM array, along with the path by which it is served, its Content-Type,
+its length and an ETag derived from its contents. The header ends with a table,
+kHttpAssets, which is passed to the constructor of HttpAssetHandler.
+
+If gzip doesn't make a file smaller (e.g. it is a PNG), the uncompressed bytes
+are stored instead. If --identity is specified, the uncompressed bytes of every
+file are also stored, for clients that don't accept gzip.
+
+A file named index.html is also served as the path of its directory, e.g.
+www/index.html is served as both "/index.html" and "/".
+
+Usage:
+
+  pack_http_assets.py --output=src/generated_assets.h www
+"""
+
+import argparse
+import gzip
+import hashlib
+import mimetypes
+import os
+import re
+import sys
+
+
+def content_type_of(path):
+  content_type, _ = mimetypes.guess_type(path)
+  if content_type is None:
+    content_type = 'application/octet-stream'
+  if content_type.startswith('text/'):
+    content_type += '; charset=utf-8'
+  return content_type
+
+
+def etag_of(data):
+  """Returns a 32-bit entity tag for data, i.e. the start of its SHA-256."""
+  return int.from_bytes(hashlib.sha256(data).digest()[:4], 'big')
+
+
+def gzip_bytes(data):
+  # mtime=0 so that the output depends only on data.
+  return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def c_identifier(path):
+  return re.sub(r'[^A-Za-z0-9]', '_', path).strip('_')
+
+
+def format_bytes(data, indent='    '):
+  lines = []
+  for start in range(0, len(data), 12):
+    piece = data[start:start + 12]
+    lines.append(indent + ' '.join('0x%02x,' % b for b in piece))
+  return '\n'.join(lines)
+
+
+def c_string(text):
+  return '"' + text.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+
+class Asset(object):
+
+  def __init__(self, root, rel_path, always_identity):
+    with open(os.path.join(root, rel_path), 'rb') as f:
+      self.identity = f.read()
+    self.url_path = '/' + rel_path.replace(os.sep, '/')
+    self.name = 'kAsset_' + c_identifier(rel_path)
+    self.content_type = content_type_of(rel_path)
+    gzipped = gzip_bytes(self.identity)
+    self.gzip = gzipped if len(gzipped) < len(self.identity) else None
+    if self.gzip is not None and not always_identity:
+      self.identity = None
+
+  def identifiers(self):
+    """Returns the C++ identifiers declared for this asset."""
+    names = ['%sPath%d' % (self.name, ndx) for ndx in range(len(
+        self.url_paths()))]
+    return names + [self.name + suffix for suffix in ('Type', 'Gzip',
+                                                      'Identity')]
+
+  def url_paths(self):
+    paths = [self.url_path]
+    if os.path.basename(self.url_path) == 'index.html':
+      paths.append(os.path.dirname(self.url_path).rstrip('/') + '/')
+    return paths
+
+
+def find_assets(root, always_identity):
+  assets = []
+  for dir_path, dir_names, file_names in os.walk(root):
+    dir_names.sort()
+    for file_name in sorted(file_names):
+      rel_path = os.path.relpath(os.path.join(dir_path, file_name), root)
+      assets.append(Asset(root, rel_path, always_identity))
+  make_identifiers_unique(assets)
+  return assets
+
+
+def make_identifiers_unique(assets):
+  """Renames assets whose identifiers collide with those of an earlier asset.
+
+  c_identifier maps distinct paths to the same name (e.g. a-b.js and a_b.js),
+  so a numeric suffix is added to the name of the later asset.
+  """
+  used = set()
+  for asset in assets:
+    base_name = asset.name
+    suffix = 1
+    while used.intersection(asset.identifiers()):
+      suffix += 1
+      asset.name = '%s_%d' % (base_name, suffix)
+    used.update(asset.identifiers())
+
+
+def representation_fields(name, suffix, data):
+  if data is None:
+    return 'nullptr, 0, 0'
+  return '%s%s, %d, 0x%08xUL' % (name, suffix, len(data), etag_of(data))
+
+
+def generate(assets, input_dir):
+  out = []
+  out.append('// Generated by extras/dev_tools/pack_http_assets.py from %s; '
+             'DO NOT EDIT.' % input_dir)
+  out.append('//')
+  total_flash = 0
+  for asset in assets:
+    with_gzip = len(asset.gzip) if asset.gzip is not None else 0
+    with_identity = len(asset.identity) if asset.identity is not None else 0
+    total_flash += with_gzip + with_identity
+  out.append('// Total size of the stored representations: %d bytes.' %
+             total_flash)
+  out.append('')
+  out.append('#include <McuCore.h>')
+  out.append('#include <McuNet.h>')
+  out.append('')
+  out.append('namespace {')
+  out.append('')
+  for asset in assets:
+    for ndx, url_path in enumerate(asset.url_paths()):
+      out.append('constexpr char %sPath%d[] PROGMEM = %s;' %
+                 (asset.name, ndx, c_string(url_path)))
+    out.append('constexpr char %sType[] PROGMEM = %s;' %
+               (asset.name, c_string(asset.content_type)))
+    for suffix, data in (('Gzip', asset.gzip), ('Identity', asset.identity)):
+      if data is not None:
+        out.append('constexpr uint8_t %s%s[] PROGMEM = {' %
+                   (asset.name, suffix))
+        out.append(format_bytes(data))
+        out.append('};')
+    out.append('')
+  out.append('constexpr ::mcunet::HttpAsset kHttpAssets[] PROGMEM = {')
+  for asset in assets:
+    for ndx, _ in enumerate(asset.url_paths()):
+      out.append('    ::mcunet::MakeHttpAsset(')
+      out.append('        %sPath%d, %sType,' % (asset.name, ndx, asset.name))
+      out.append('        %s,' %
+                 representation_fields(asset.name, 'Gzip', asset.gzip))
+      out.append('        %s),' % representation_fields(
+          asset.name, 'Identity', asset.identity))
+  out.append('};')
+  out.append('')
+  out.append('}  // namespace')
+  out.append('')
+  return '\n'.join(out), total_flash
+
+
+def main(argv):
+  parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+  parser.add_argument('input_dir', help='Directory containing the assets.')
+  parser.add_argument('--output', required=True,
+                      help='Path of the header file to generate.')
+  parser.add_argument('--identity', action='store_true',
+                      help='Also store the uncompressed form of every file, '
+                      'for clients that do not accept gzip.')
+  args = parser.parse_args(argv[1:])
+
+  assets = find_assets(args.input_dir, args.identity)
+  if not assets:
+    sys.exit('No files found in %s' % args.input_dir)
+  # HttpAssetHandler and HttpAsset use a byte for these.
+  if sum(len(asset.url_paths()) for asset in assets) > 255:
+    sys.exit('Too many files in %s' % args.input_dir)
+  for asset in assets:
+    if len(asset.url_path) > 255:
+      sys.exit('Path is too long: %s' % asset.url_path)
+  text, total_flash = generate(assets, args.input_dir)
+  with open(args.output, 'w') as f:
+    f.write(text)
+  print('Packed %d files into %d bytes in %s' %
+        (len(assets), total_flash, args.output))
+
+
+if __name__ == '__main__':
+  main(sys.argv)
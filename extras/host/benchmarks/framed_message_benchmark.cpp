@@ -0,0 +1,176 @@
+// Measures the rate (messages/sec) at which framed messages can be encoded and
+// decoded over a Connection. The connection is in memory, so this measures the
+// cost of McuNet's framing code alone, not of the network. The connection
+// counts the calls to write and flush; on a device each flush of a
+// WriteBufferedConnection is at least one SPI transaction (and usually a
+// packet), so compare the flushes needed when each message is sent as it is
+// generated with those needed when messages are sent in a FramedMessageBatch.
+//
+// Decoding reads from the connection at most --read_size bytes at a time, as
+// the hardware would return a message split across reads when only part of it
+// has arrived; messages split that way are reassembled by the reader, while
+// the rest are passed to the handler without being copied.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "absl/flags/flag.h"
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "base/init_google.h"
+#include "connection.h"
+#include "framed_message.h"
+
+ABSL_FLAG(int, messages, 1000000, "Number of messages to encode and decode.");
+ABSL_FLAG(int, payload_size, 16, "Size of the payload of each message.");
+ABSL_FLAG(bool, crc, true, "Whether each message should have a CRC.");
+ABSL_FLAG(int, read_size, 61,
+          "Most bytes that a read from the connection returns.");
+
+namespace mcunet_host {
+namespace {
+
+using ::mcunet::FramedMessageBatch;
+using ::mcunet::FramedMessageHandler;
+using ::mcunet::FramedMessageReader;
+
+// A Connection that appends the data written to it to a string, and reads
+// from a string, counting the calls made.
+class MemoryConnection : public mcunet::Connection {
+ public:
+  explicit MemoryConnection(size_t read_size) : read_size_(read_size) {}
+
+  void set_input(const std::string& input) {
+    input_ = input;
+    input_pos_ = 0;
+  }
+  const std::string& output() const { return output_; }
+  int64_t writes() const { return writes_; }
+  int64_t flushes() const { return flushes_; }
+  int64_t reads() const { return reads_; }
+
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t* buf, size_t size) override {
+    ++writes_;
+    output_.append(reinterpret_cast<const char*>(buf), size);
+    return size;
+  }
+  void flush() override { ++flushes_; }
+
+  int available() override { return input_.size() - input_pos_; }
+  int read() override {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+  }
+  int read(uint8_t* buf, size_t size) override {
+    ++reads_;
+    size = std::min({size, read_size_, input_.size() - input_pos_});
+    std::memcpy(buf, input_.data() + input_pos_, size);
+    input_pos_ += size;
+    return size;
+  }
+  int peek() override {
+    return input_pos_ < input_.size()
+               ? static_cast<uint8_t>(input_[input_pos_])
+               : -1;
+  }
+  void close() override {}
+  uint8_t connected() override { return 1; }
+  mcunet::SocketNumber sock_num() const override { return 0; }
+
+ private:
+  const size_t read_size_;
+  std::string input_;
+  size_t input_pos_ = 0;
+  std::string output_;
+  int64_t writes_ = 0;
+  int64_t flushes_ = 0;
+  int64_t reads_ = 0;
+};
+
+class CountingHandler : public FramedMessageHandler {
+ public:
+  void OnFramedMessage(uint8_t type, const uint8_t* payload,
+                       size_t payload_size) override {
+    ++messages;
+    checksum += type + payload_size + (payload_size > 0 ? payload[0] : 0);
+  }
+
+  int64_t messages = 0;
+  int64_t checksum = 0;
+};
+
+void Report(const char* name, const int messages, const absl::Duration time,
+            const MemoryConnection& connection) {
+  LOG(INFO) << name << ": "
+            << messages / absl::ToDoubleSeconds(time) << " messages/sec, "
+            << connection.writes() << " writes, " << connection.flushes()
+            << " flushes, " << connection.reads() << " reads";
+}
+
+int RunBenchmark() {
+  const int messages = absl::GetFlag(FLAGS_messages);
+  const int payload_size = absl::GetFlag(FLAGS_payload_size);
+  const bool crc = absl::GetFlag(FLAGS_crc);
+  const int read_size = absl::GetFlag(FLAGS_read_size);
+  QCHECK_GT(messages, 0);
+  QCHECK_GE(payload_size, 0);
+  QCHECK_LE(payload_size, FramedMessageReader::kMaxPayloadSize);
+  QCHECK_GT(read_size, 0);
+  std::string payload(payload_size, 'p');
+  auto* const payload_data = reinterpret_cast<uint8_t*>(payload.data());
+
+  // Each message written, and flushed, as it is generated.
+  MemoryConnection unbatched(read_size);
+  absl::Time start = absl::Now();
+  for (int ndx = 0; ndx < messages; ++ndx) {
+    payload_data[0] = static_cast<uint8_t>(ndx);
+    CHECK(mcunet::WriteFramedMessage(unbatched, ndx & 0x7F, payload_data,
+                                     payload_size, crc));
+    unbatched.flush();
+  }
+  Report("Unbatched encode", messages, absl::Now() - start, unbatched);
+
+  // Messages accumulated in a batch, which is sent when full.
+  MemoryConnection batched(read_size);
+  FramedMessageBatch batch;
+  start = absl::Now();
+  for (int ndx = 0; ndx < messages; ++ndx) {
+    payload_data[0] = static_cast<uint8_t>(ndx);
+    if (!batch.Queue(ndx & 0x7F, payload_data, payload_size, crc)) {
+      CHECK(batch.Send(batched));
+      CHECK(batch.Queue(ndx & 0x7F, payload_data, payload_size, crc));
+    }
+  }
+  CHECK(batch.Send(batched));
+  Report("Batched encode", messages, absl::Now() - start, batched);
+  CHECK_EQ(batched.output(), unbatched.output());
+
+  MemoryConnection input(read_size);
+  input.set_input(batched.output());
+  CountingHandler handler;
+  FramedMessageReader reader(handler);
+  start = absl::Now();
+  CHECK(reader.ReadFrom(input));
+  Report("Decode", messages, absl::Now() - start, input);
+  CHECK_EQ(handler.messages, messages);
+  LOG(INFO) << "Encoded size: " << batched.output().size() << " bytes, "
+            << static_cast<double>(batched.output().size()) / messages -
+                   payload_size
+            << " bytes of framing per message";
+  return 0;
+}
+
+}  // namespace
+}  // namespace mcunet_host
+
+int main(int argc, char* argv[]) {
+  InitGoogle(argv[0], &argc, &argv, /*remove_flags=*/true);
+  return mcunet_host::RunBenchmark();
+}
@@ -0,0 +1,194 @@
+// Compares the cost of finding the route for a request using HttpRouter (i.e.
+// hashing the path, then looking in the bucket selected by the hash) with that
+// of a linear scan that compares the path with the path of each route, as a
+// handler might do with a chain of strcmp_P calls. Note that the relative cost
+// on an AVR, where a 32-bit multiply and a byte read from flash each take
+// several cycles, will differ from that measured on the host. The routes
+// resemble those of an ASCOM Alpaca server, which has many paths sharing long
+// prefixes.
+
+#include <stdint.h>
+
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "base/init_google.h"
+#include "http_request.h"
+#include "http_response.h"
+#include "http_router.h"
+
+ABSL_FLAG(int, iterations, 1000000,
+          "Number of times to match each request path.");
+
+namespace mcunet_host {
+namespace {
+
+using ::mcunet::HttpMethod;
+using ::mcunet::HttpRequest;
+using ::mcunet::HttpRoute;
+using ::mcunet::HttpRouter;
+using ::mcunet::HttpStatusCode;
+using ::mcunet::MakeHttpRoute;
+using ::mcunet::MakeHttpRouteBuckets;
+
+constexpr char kPath0[] PROGMEM = "/management/apiversions";
+constexpr char kPath1[] PROGMEM = "/management/v1/description";
+constexpr char kPath2[] PROGMEM = "/management/v1/configureddevices";
+constexpr char kPath3[] PROGMEM = "/api/v1/observingconditions/0/connected";
+constexpr char kPath4[] PROGMEM = "/api/v1/observingconditions/0/description";
+constexpr char kPath5[] PROGMEM = "/api/v1/observingconditions/0/name";
+constexpr char kPath6[] PROGMEM = "/api/v1/observingconditions/0/cloudcover";
+constexpr char kPath7[] PROGMEM = "/api/v1/observingconditions/0/dewpoint";
+constexpr char kPath8[] PROGMEM = "/api/v1/observingconditions/0/humidity";
+constexpr char kPath9[] PROGMEM = "/api/v1/observingconditions/0/pressure";
+constexpr char kPath10[] PROGMEM = "/api/v1/observingconditions/0/rainrate";
+constexpr char kPath11[] PROGMEM = "/api/v1/observingconditions/0/skybrightness";
+constexpr char kPath12[] PROGMEM = "/api/v1/observingconditions/0/temperature";
+constexpr char kPath13[] PROGMEM = "/api/v1/covercalibrator/0/connected";
+constexpr char kPath14[] PROGMEM = "/api/v1/covercalibrator/0/brightness";
+constexpr char kPath15[] PROGMEM = "/api/v1/covercalibrator/0/calibratoron";
+constexpr char kPath16[] PROGMEM = "/api/v1/covercalibrator/0/coverstate";
+constexpr char kPath17[] PROGMEM = "/api/v1/covercalibrator/0/opencover";
+
+constexpr HttpRoute kRoutes[] PROGMEM = {
+    MakeHttpRoute(HttpMethod::kGet, kPath0, 0),
+    MakeHttpRoute(HttpMethod::kGet, kPath1, 1),
+    MakeHttpRoute(HttpMethod::kGet, kPath2, 2),
+    MakeHttpRoute(HttpMethod::kGet, kPath3, 3),
+    MakeHttpRoute(HttpMethod::kPut, kPath3, 4),
+    MakeHttpRoute(HttpMethod::kGet, kPath4, 5),
+    MakeHttpRoute(HttpMethod::kGet, kPath5, 6),
+    MakeHttpRoute(HttpMethod::kGet, kPath6, 7),
+    MakeHttpRoute(HttpMethod::kGet, kPath7, 8),
+    MakeHttpRoute(HttpMethod::kGet, kPath8, 9),
+    MakeHttpRoute(HttpMethod::kGet, kPath9, 10),
+    MakeHttpRoute(HttpMethod::kGet, kPath10, 11),
+    MakeHttpRoute(HttpMethod::kGet, kPath11, 12),
+    MakeHttpRoute(HttpMethod::kGet, kPath12, 13),
+    MakeHttpRoute(HttpMethod::kGet, kPath13, 14),
+    MakeHttpRoute(HttpMethod::kPut, kPath13, 15),
+    MakeHttpRoute(HttpMethod::kGet, kPath14, 16),
+    MakeHttpRoute(HttpMethod::kPut, kPath15, 17),
+    MakeHttpRoute(HttpMethod::kGet, kPath16, 18),
+    MakeHttpRoute(HttpMethod::kPut, kPath17, 19),
+};
+static_assert(::mcunet::HttpRoutesAreValid(kRoutes), "Conflicting routes");
+constexpr auto kRouteBuckets PROGMEM = MakeHttpRouteBuckets(kRoutes);
+constexpr HttpRouter kRouter(kRoutes, kRouteBuckets);
+
+// Compares path with the NUL terminated string in PROGMEM one byte at a time,
+// as strcmp_P does on AVR. The host's strncmp compares many bytes at a time,
+// which would hide the cost of the long common prefixes of the routes.
+bool PathEqualsP(const mcucore::StringView& path, const char* progmem_path) {
+  const char* const end = path.data() + path.size();
+  for (const char* ptr = path.data(); ptr < end; ++ptr, ++progmem_path) {
+    if (*ptr != static_cast<char>(pgm_read_byte(progmem_path))) {
+      return false;
+    }
+  }
+  return pgm_read_byte(progmem_path) == 0;
+}
+
+// The naive approach: compare the path with each route's path in turn.
+HttpStatusCode LinearMatch(const HttpRequest& request, uint8_t& route_id) {
+  const mcucore::StringView path = request.path();
+  bool path_matched = false;
+  for (const HttpRoute& route : kRoutes) {
+    if (PathEqualsP(path, route.path)) {
+      path_matched = true;
+      if (route.method == request.method) {
+        route_id = route.id;
+        return HttpStatusCode::kOk;
+      }
+    }
+  }
+  return path_matched ? HttpStatusCode::kMethodNotAllowed
+                      : HttpStatusCode::kNotFound;
+}
+
+std::vector<HttpRequest> MakeRequests() {
+  std::vector<std::pair<HttpMethod, std::string>> targets;
+  for (const HttpRoute& route : kRoutes) {
+    targets.emplace_back(route.method, route.path);
+  }
+  // Some misses, of the kinds an MCU server sees.
+  targets.emplace_back(HttpMethod::kGet, "/favicon.ico");
+  targets.emplace_back(HttpMethod::kGet, "/api/v1/covercalibrator/0/opencove");
+  targets.emplace_back(HttpMethod::kPut, kPath0);
+  std::vector<HttpRequest> requests(targets.size());
+  for (size_t ndx = 0; ndx < targets.size(); ++ndx) {
+    const auto& [method, target] = targets[ndx];
+    QCHECK_LE(target.size(), HttpRequest::kMaxTargetLength);
+    requests[ndx].method = method;
+    std::strcpy(requests[ndx].target, target.c_str());
+    requests[ndx].target_size = target.size();
+  }
+  return requests;
+}
+
+template <typename MatchFunction>
+absl::Duration TimeMatches(const std::vector<HttpRequest>& requests,
+                           const int iterations, MatchFunction match,
+                           int64_t& checksum) {
+  const absl::Time start = absl::Now();
+  for (int iteration = 0; iteration < iterations; ++iteration) {
+    for (const HttpRequest& request : requests) {
+      uint8_t route_id = 0;
+      checksum += static_cast<int>(match(request, route_id)) + route_id;
+    }
+  }
+  return absl::Now() - start;
+}
+
+int RunBenchmark() {
+  const int iterations = absl::GetFlag(FLAGS_iterations);
+  QCHECK_GT(iterations, 0);
+  const std::vector<HttpRequest> requests = MakeRequests();
+
+  // Both approaches must agree.
+  for (const HttpRequest& request : requests) {
+    uint8_t router_id = 0, linear_id = 0;
+    CHECK_EQ(static_cast<int>(kRouter.Match(request, router_id)),
+              static_cast<int>(LinearMatch(request, linear_id)))
+        << request.target;
+    CHECK_EQ(router_id, linear_id) << request.target;
+  }
+
+  int64_t router_checksum = 0, linear_checksum = 0;
+  const absl::Duration router_time = TimeMatches(
+      requests, iterations,
+      [](const HttpRequest& request, uint8_t& route_id) {
+        return kRouter.Match(request, route_id);
+      },
+      router_checksum);
+  const absl::Duration linear_time =
+      TimeMatches(requests, iterations, LinearMatch, linear_checksum);
+  CHECK_EQ(router_checksum, linear_checksum);
+
+  const double matches = static_cast<double>(iterations) * requests.size();
+  LOG(INFO) << "Routes: " << std::size(kRoutes)
+            << ", request paths: " << requests.size();
+  LOG(INFO) << "HttpRouter:  "
+            << absl::ToDoubleNanoseconds(router_time) / matches
+            << " ns/match";
+  LOG(INFO) << "Linear scan: "
+            << absl::ToDoubleNanoseconds(linear_time) / matches
+            << " ns/match";
+  return 0;
+}
+
+}  // namespace
+}  // namespace mcunet_host
+
+int main(int argc, char* argv[]) {
+  InitGoogle(argv[0], &argc, &argv, /*remove_flags=*/true);
+  return mcunet_host::RunBenchmark();
+}
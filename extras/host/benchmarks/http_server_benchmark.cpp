@@ -0,0 +1,304 @@
+// Measures the rate at which HttpServer instances, running over HostNetwork,
+// can handle requests from clients running on other threads of this process.
+// The servers are serviced by the main thread, as they would be by loop() on
+// a device, so this measures the cost of McuNet's server code per request,
+// plus that of the loopback TCP connections.
+//
+// By default each request is sent on a new connection; compare with
+// --requests_per_connection > 1 (keep-alive) and with --pipeline_depth > 1
+// (requests sent without waiting for the preceding responses) to measure the
+// benefit of reusing connections.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "base/init_google.h"
+#include "extras/host/ethernet5500/host_network.h"
+#include "http_request.h"
+#include "http_response.h"
+#include "http_server.h"
+#include "platform_network_interface.h"
+
+ABSL_FLAG(int, num_servers, 4,
+          "Number of HttpServer instances (i.e. hardware sockets) to use.");
+ABSL_FLAG(int, num_clients, 2, "Number of client threads.");
+ABSL_FLAG(absl::Duration, duration, absl::Seconds(5),
+          "How long the clients should send requests for.");
+ABSL_FLAG(int, body_size, 100, "Size of the body of each response.");
+ABSL_FLAG(int, requests_per_connection, 1,
+          "Number of requests a client sends on a connection before closing "
+          "it; the last asks the server to close the connection. Should be "
+          "at most MCUNET_HTTP_MAX_REQUESTS_PER_CONNECTION.");
+ABSL_FLAG(int, pipeline_depth, 1,
+          "Number of requests a client sends before reading their responses.");
+
+namespace mcunet_host {
+namespace {
+
+using ::mcunet::HttpRequest;
+using ::mcunet::HttpRequestHandler;
+using ::mcunet::HttpResponse;
+using ::mcunet::HttpServer;
+using ::mcunet::HttpStatusCode;
+
+class FixedBodyHandler : public HttpRequestHandler {
+ public:
+  explicit FixedBodyHandler(int body_size) : body_(body_size, 'x') {}
+
+  void HandleRequest(const HttpRequest& request,
+                     HttpResponse& response) override {
+    response.StartHeaders(HttpStatusCode::kOk);
+    response.AddHeader(MCU_PSV("Content-Type"), MCU_PSV("text/plain"));
+    response.set_content_length(body_.size());
+    response.EndHeaders();
+    response.write(body_.data(), body_.size());
+  }
+
+ private:
+  const std::string body_;
+};
+
+struct ClientStats {
+  int64_t requests = 0;
+  // Connections refused or reset before a response was received, as happens
+  // when all of the server's sockets are busy. These are retried.
+  int64_t refused = 0;
+  // Responses that aren't as expected.
+  int64_t failures = 0;
+};
+
+enum class RequestResult { kOk, kRefused, kFailed };
+
+constexpr std::string_view kRequest =
+    "GET /benchmark HTTP/1.1\r\nHost: localhost\r\n\r\n";
+constexpr std::string_view kLastRequest =
+    "GET /benchmark HTTP/1.1\r\nHost: localhost\r\n"
+    "Connection: close\r\n\r\n";
+
+// A client's connection to the server, from which responses are read one at a
+// time.
+class ClientConnection {
+ public:
+  explicit ClientConnection(const int tcp_port)
+      : fd_(::socket(AF_INET, SOCK_STREAM, 0)) {
+    QCHECK_GE(fd_, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(tcp_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    connected_ =
+        ::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0;
+  }
+
+  ~ClientConnection() { ::close(fd_); }
+
+  bool connected() const { return connected_; }
+
+  bool Send(std::string_view data) {
+    return ::send(fd_, data.data(), data.size(), MSG_NOSIGNAL) ==
+           static_cast<ssize_t>(data.size());
+  }
+
+  // Reads the next response. Sets server_closes to true if the response says
+  // that the server will close the connection after it.
+  RequestResult ReadResponse(bool& server_closes) {
+    size_t headers_end;
+    while ((headers_end = buffer_.find("\r\n\r\n")) == std::string::npos) {
+      if (!Fill()) {
+        // Nothing received is what we see when the server had no free socket
+        // for the connection, or closed it after the preceding response.
+        return buffer_.empty() ? RequestResult::kRefused
+                               : RequestResult::kFailed;
+      }
+    }
+    const std::string_view headers(buffer_.data(), headers_end + 2);
+    constexpr std::string_view kContentLength = "\r\nContent-Length: ";
+    const auto pos = headers.find(kContentLength);
+    if (pos == std::string_view::npos) {
+      return RequestResult::kFailed;
+    }
+    const size_t content_length =
+        std::strtoul(headers.data() + pos + kContentLength.size(), nullptr, 10);
+    server_closes =
+        headers.find("\r\nConnection: close\r\n") != std::string_view::npos;
+    const bool ok = headers.rfind("HTTP/1.1 200 ", 0) == 0;
+    const size_t response_size = headers_end + 4 + content_length;
+    while (buffer_.size() < response_size) {
+      if (!Fill()) {
+        return RequestResult::kFailed;
+      }
+    }
+    buffer_.erase(0, response_size);
+    return ok ? RequestResult::kOk : RequestResult::kFailed;
+  }
+
+ private:
+  // Appends the next data from the server to buffer_. Returns false if the
+  // server has closed the connection.
+  bool Fill() {
+    char buffer[1024];
+    const ssize_t size = ::recv(fd_, buffer, sizeof buffer, 0);
+    if (size <= 0) {
+      return false;
+    }
+    buffer_.append(buffer, size);
+    return true;
+  }
+
+  const int fd_;
+  bool connected_;
+  std::string buffer_;
+};
+
+void RecordResult(const RequestResult result, ClientStats& stats) {
+  switch (result) {
+    case RequestResult::kOk:
+      ++stats.requests;
+      break;
+    case RequestResult::kRefused:
+      ++stats.refused;
+      break;
+    case RequestResult::kFailed:
+      ++stats.failures;
+      break;
+  }
+}
+
+// Sends requests on one connection, pipeline_depth at a time, until
+// requests_per_connection have been sent, the server closes the connection,
+// or end_time is reached.
+void RunConnection(const int tcp_port, const int requests_per_connection,
+                   const int pipeline_depth, const absl::Time end_time,
+                   ClientStats& stats) {
+  ClientConnection connection(tcp_port);
+  if (!connection.connected()) {
+    ++stats.refused;
+    return;
+  }
+  int sent = 0;
+  while (sent < requests_per_connection && absl::Now() < end_time) {
+    const int batch = std::min(pipeline_depth, requests_per_connection - sent);
+    std::string requests;
+    for (int ndx = 0; ndx < batch; ++ndx) {
+      ++sent;
+      requests += sent == requests_per_connection ? kLastRequest : kRequest;
+    }
+    if (!connection.Send(requests)) {
+      ++stats.refused;
+      return;
+    }
+    for (int ndx = 0; ndx < batch; ++ndx) {
+      bool server_closes = false;
+      const RequestResult result = connection.ReadResponse(server_closes);
+      RecordResult(result, stats);
+      if (result != RequestResult::kOk) {
+        return;
+      } else if (server_closes) {
+        // Any further requests in the batch won't get a response.
+        stats.refused += batch - ndx - 1;
+        return;
+      }
+    }
+  }
+}
+
+void RunClient(const int tcp_port, const absl::Time end_time,
+               ClientStats& stats) {
+  const int requests_per_connection =
+      absl::GetFlag(FLAGS_requests_per_connection);
+  const int pipeline_depth = absl::GetFlag(FLAGS_pipeline_depth);
+  while (absl::Now() < end_time) {
+    RunConnection(tcp_port, requests_per_connection, pipeline_depth, end_time,
+                  stats);
+  }
+}
+
+int RunBenchmark() {
+  const int num_servers = absl::GetFlag(FLAGS_num_servers);
+  const int num_clients = absl::GetFlag(FLAGS_num_clients);
+  const absl::Duration duration = absl::GetFlag(FLAGS_duration);
+  QCHECK_GT(num_servers, 0);
+  QCHECK_GT(num_clients, 0);
+  QCHECK_GT(absl::GetFlag(FLAGS_requests_per_connection), 0);
+  QCHECK_GT(absl::GetFlag(FLAGS_pipeline_depth), 0);
+
+  ::mcunet::PlatformNetworkLifetime<HostNetwork> holder(
+      std::make_unique<HostNetwork>(num_servers));
+  const int tcp_port = HostNetwork::FindFreeTcpPort();
+  QCHECK_GT(tcp_port, 0);
+
+  FixedBodyHandler handler(absl::GetFlag(FLAGS_body_size));
+  std::vector<std::unique_ptr<HttpServer>> servers;
+  for (int ndx = 0; ndx < num_servers; ++ndx) {
+    servers.push_back(std::make_unique<HttpServer>(tcp_port, handler));
+    QCHECK(servers.back()->PickClosedSocket());
+  }
+
+  const absl::Time start_time = absl::Now();
+  const absl::Time end_time = start_time + duration;
+  std::vector<ClientStats> stats(num_clients);
+  std::atomic<int> running_clients(num_clients);
+  std::vector<std::thread> clients;
+  for (int ndx = 0; ndx < num_clients; ++ndx) {
+    clients.emplace_back([&, ndx] {
+      RunClient(tcp_port, end_time, stats[ndx]);
+      --running_clients;
+    });
+  }
+
+  int64_t loops = 0;
+  while (running_clients > 0) {
+    for (auto& server : servers) {
+      server->PerformIO();
+    }
+    ++loops;
+  }
+  const absl::Duration elapsed = absl::Now() - start_time;
+  for (auto& client : clients) {
+    client.join();
+  }
+
+  ClientStats total;
+  for (const auto& client_stats : stats) {
+    total.requests += client_stats.requests;
+    total.refused += client_stats.refused;
+    total.failures += client_stats.failures;
+  }
+  const double seconds = absl::ToDoubleSeconds(elapsed);
+  LOG(INFO) << "Servers: " << num_servers << ", clients: " << num_clients
+            << ", requests/connection: "
+            << absl::GetFlag(FLAGS_requests_per_connection)
+            << ", pipeline depth: " << absl::GetFlag(FLAGS_pipeline_depth);
+  LOG(INFO) << "Requests: " << total.requests << ", refused: " << total.refused
+            << ", failures: " << total.failures << " in " << elapsed;
+  LOG(INFO) << "Requests/sec: " << total.requests / seconds;
+  LOG(INFO) << "Loops/request: "
+            << (total.requests > 0 ? loops / total.requests : 0);
+  return total.failures == 0 ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace mcunet_host
+
+int main(int argc, char* argv[]) {
+  InitGoogle(argv[0], &argc, &argv, /*remove_flags=*/true);
+  return mcunet_host::RunBenchmark();
+}
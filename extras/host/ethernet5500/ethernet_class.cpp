@@ -25,12 +25,19 @@ void CloseAllSockets() {
 
 EthernetClass::EthernetClass()
     : _maxSockNum(MAX_SOCK_NUM), _pinCS(255), _pinRST(255), _dhcp(nullptr) {
+  // Until begin is called, report a recognizable (if invalid) MAC address.
+  for (int ndx = 0; ndx < 6; ++ndx) {
+    auto nibble2 = ndx * 2 + 1;
+    auto nibble1 = ndx * 2;
+    _mac[ndx] = (nibble2 << 4) + nibble1;
+  }
   _customHostname[0] = 0;
 }
 
 void EthernetClass::init(uint8_t maxSockNum) {
   DCHECK_GE(maxSockNum, 1);
   DCHECK_LE(maxSockNum, 8);
+  _maxSockNum = maxSockNum;
 }
 
 uint8_t EthernetClass::softreset() {
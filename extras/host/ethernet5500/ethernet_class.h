@@ -45,10 +45,14 @@ class EthernetClass {
   // Declaring functions in the order called.
   void setHostname(const char* hostname);
 
-  // Pretend version of begin, does nothing.
+  // Pretend version of begin, just records the MAC address so that macAddress
+  // can return it, as if there were a W5500.
   // On embedded device, sets up the network chip, starts it running.
   template <class... T>
-  static int begin(T&&...) {
+  int begin(const uint8_t* mac, T&&...) {
+    for (int ndx = 0; ndx < 6; ++ndx) {
+      _mac[ndx] = mac[ndx];
+    }
     return 1;
   }
 
@@ -60,9 +64,7 @@ class EthernetClass {
 
   void macAddress(uint8_t mac[]) {
     for (int ndx = 0; ndx < 6; ++ndx) {
-      auto nibble2 = ndx * 2 + 1;
-      auto nibble1 = ndx * 2;
-      mac[ndx] = (nibble2 << 4) + nibble1;
+      mac[ndx] = _mac[ndx];
     }
   }
 
@@ -82,6 +84,7 @@ class EthernetClass {
   static uint16_t _server_port[MAX_SOCK_NUM];  // NOLINT
 
  private:
+  uint8_t _mac[6];              // NOLINT
   IPAddress _dnsServerAddress;  // NOLINT
   DhcpClass* _dhcp;             // NOLINT
   char _customHostname[32];     // NOLINT
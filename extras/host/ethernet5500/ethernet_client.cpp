@@ -8,7 +8,7 @@
 
 using ::mcunet::PlatformNetworkInterface;
 
-EthernetClient::EthernetClient(uint8_t sock) : sock_(sock) {}
+EthernetClient::EthernetClient(uint16_t sock) : sock_(sock) {}
 
 int EthernetClient::connect(IPAddress ip, uint16_t port) {
   CHECK(false) << "EthernetClient::connect Unimplemented";
@@ -15,7 +15,9 @@
 
 class EthernetClient : public Client {
  public:
-  explicit EthernetClient(uint8_t sock);
+  // Unlike the Ethernet5500 library, the socket number is 16 bits wide, so that
+  // HostNetwork can provide many more sockets than the W5500 has.
+  explicit EthernetClient(uint16_t sock);
 
   int connect(IPAddress ip, uint16_t port) override;
   int connect(const char *host, uint16_t port) override;
@@ -51,10 +53,10 @@ class EthernetClient : public Client {
   // Returns the status of the socket, from the Socket n Status Register.
   virtual uint8_t status();
 
-  virtual uint8_t getSocketNumber() const { return sock_; }
+  virtual uint16_t getSocketNumber() const { return sock_; }
 
  private:
-  uint8_t sock_;
+  uint16_t sock_;
 };
 
 #endif  // MCUNET_EXTRAS_HOST_ETHERNET5500_ETHERNET_CLIENT_H_
@@ -17,6 +17,9 @@ class EthernetUDP : public Stream {
   // successful, 0 if there are no sockets available to use
   virtual uint8_t begin(uint16_t udp_port);
 
+  // Finish with the UDP socket.
+  virtual void stop() {}
+
   // Sending UDP packets
 
   // Start building up a packet to send to the remote host specific in ip and
@@ -9,50 +9,132 @@
 #include <sys/types.h>
 #include <unistd.h>
 
-#include <map>
+#include <limits>
 #include <memory>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
+#include "absl/flags/flag.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "absl/strings/str_cat.h"
 #include "extras/host/ethernet5500/host_socket_info.h"
+#include "extras/host/ethernet5500/pcap_writer.h"
+
+// The default matches the number of hardware sockets of the W5500.
+ABSL_FLAG(int, host_network_num_sockets, 8,
+          "Number of sockets provided by HostNetwork. May be larger than the "
+          "number supported by the W5500 (8) for the purpose of stress "
+          "testing.");
+
+ABSL_FLAG(bool, emulate_w5500_buffers, false,
+          "If true, HostNetwork limits the TX and RX buffering of each socket "
+          "to that of a W5500 socket, so that the server sees similar "
+          "backpressure to that on the device.");
+
+ABSL_FLAG(int, w5500_socket_count, 8,
+          "Number of hardware sockets (1, 2, 4 or 8) the emulated W5500 is "
+          "configured for, which determines the buffer sizes applied by "
+          "--emulate_w5500_buffers. Should match the value passed to "
+          "Ethernet.init.");
+
+ABSL_FLAG(std::string, host_network_pcap_file, "",
+          "If not empty, the connections, and the bytes sent and received, of "
+          "each HostNetwork socket are recorded in this pcap file, with "
+          "synthesized TCP/IPv4 framing.");
 
 namespace mcunet_host {
-
-static constexpr int kMaxSockets = 8;
+namespace {
+// Total size of the W5500's TX buffers, and also of its RX buffers.
+constexpr size_t kW5500BufferBytes = 16 * 1024;
+}  // namespace
 
 struct HostNetworkImpl {
-  HostSocketInfo *GetHostSocketInfo(const uint8_t sock_num) {
-    if (!(0 <= sock_num && sock_num <= kMaxSockets)) {
-      LOG(ERROR) << "Invalid socket number: " << static_cast<int>(sock_num);
+  HostSocketInfo *GetHostSocketInfo(const HostNetwork::SocketNumber sock_num) {
+    if (!(sock_num < sockets.size())) {
+      LOG(ERROR) << "Invalid socket number: " << sock_num;
       return nullptr;
     }
-    CHECK(sockets.find(sock_num) != sockets.end())
-        << "Socket " << static_cast<int>(sock_num) << " is missing";
-    CHECK(sockets[sock_num].get() != nullptr)
-        << "Socket " << static_cast<int>(sock_num) << " is missing";
     return sockets[sock_num].get();
   }
 
-  std::map<uint8_t, std::unique_ptr<HostSocketInfo>> sockets;
+  // Declared before sockets so that it outlives them, as they record their
+  // closing in the capture.
+  std::unique_ptr<PcapWriter> pcap_writer;
+
+  // Indexed by socket number.
+  std::vector<std::unique_ptr<HostSocketInfo>> sockets;
+
+  const bool emulate_w5500_buffers =
+      absl::GetFlag(FLAGS_emulate_w5500_buffers);
 };
 
-HostNetwork::HostNetwork() : impl_(std::make_unique<HostNetworkImpl>()) {
-  for (int sock_num = 0; sock_num < kMaxSockets; ++sock_num) {
-    impl_->sockets[sock_num] = std::make_unique<HostSocketInfo>(sock_num);
+HostNetwork::HostNetwork()
+    : HostNetwork(absl::GetFlag(FLAGS_host_network_num_sockets)) {}
+
+HostNetwork::HostNetwork(const int num_sockets)
+    : impl_(std::make_unique<HostNetworkImpl>()) {
+  CHECK_GT(num_sockets, 0);
+  CHECK_LT(num_sockets, std::numeric_limits<SocketNumber>::max())
+      << "Too many sockets requested";
+  impl_->sockets.reserve(num_sockets);
+  for (int sock_num = 0; sock_num < num_sockets; ++sock_num) {
+    impl_->sockets.push_back(std::make_unique<HostSocketInfo>(sock_num));
+  }
+  SetW5500SocketCount(absl::GetFlag(FLAGS_w5500_socket_count));
+  const auto pcap_file = absl::GetFlag(FLAGS_host_network_pcap_file);
+  if (!pcap_file.empty()) {
+    StartPcapCapture(pcap_file);
   }
 }
 
 HostNetwork::~HostNetwork() {}
 
+int HostNetwork::num_sockets() const { return impl_->sockets.size(); }
+
+void HostNetwork::SetW5500SocketCount(const int max_sock_num) {
+  CHECK(max_sock_num == 1 || max_sock_num == 2 || max_sock_num == 4 ||
+        max_sock_num == 8)
+      << "Invalid max_sock_num: " << max_sock_num;
+  if (!impl_->emulate_w5500_buffers) {
+    return;
+  }
+  // We apply the capacity to all of the sockets, even if there are more than
+  // max_sock_num of them, so that stress tests with many sockets still see the
+  // per-socket limits of the device.
+  const size_t capacity = kW5500BufferBytes / max_sock_num;
+  for (auto &info : impl_->sockets) {
+    info->SetBufferCapacities(capacity, capacity);
+  }
+}
+
+void HostNetwork::SetListenAddress(const uint32_t address) {
+  for (auto &info : impl_->sockets) {
+    info->set_listen_address(address);
+  }
+}
+
+bool HostNetwork::StartPcapCapture(const std::string &path) {
+  auto writer = std::make_unique<PcapWriter>(path);
+  if (!writer->ok()) {
+    return false;
+  }
+  for (auto &info : impl_->sockets) {
+    info->set_pcap_writer(writer.get());
+  }
+  impl_->pcap_writer = std::move(writer);
+  return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Methods getting the status of a socket.
 
 int HostNetwork::FindUnusedSocket() {
-  for (int sock_num = 0; sock_num < kMaxSockets; ++sock_num) {
-    auto *info = impl_->GetHostSocketInfo(sock_num);
-    if (info != nullptr && info->IsUnused()) {
+  for (int sock_num = 0; sock_num < num_sockets(); ++sock_num) {
+    auto *info = impl_->sockets[sock_num].get();
+    if (info->IsUnused()) {
       VLOG(2) << "HostNetwork::FindUnusedSocket found " << sock_num;
       return sock_num;
     }
@@ -61,7 +143,7 @@ int HostNetwork::FindUnusedSocket() {
   return -1;
 }
 
-uint16_t HostNetwork::SocketIsTcpListener(uint8_t sock_num) {
+uint16_t HostNetwork::SocketIsTcpListener(SocketNumber sock_num) {
   uint16_t port = 0;
   auto *info = impl_->GetHostSocketInfo(sock_num);
   if (info != nullptr) {
@@ -71,7 +153,7 @@ uint16_t HostNetwork::SocketIsTcpListener(uint8_t sock_num) {
   return port;
 }
 
-bool HostNetwork::SocketIsInTcpConnectionLifecycle(uint8_t sock_num) {
+bool HostNetwork::SocketIsInTcpConnectionLifecycle(SocketNumber sock_num) {
   auto *info = impl_->GetHostSocketInfo(sock_num);
   // This doesn't quite cover the case where the socket is either being
   // established or is being closed (i.e. in TIME_WAIT state).
@@ -81,7 +163,7 @@ bool HostNetwork::SocketIsInTcpConnectionLifecycle(uint8_t sock_num) {
   return result;
 }
 
-bool HostNetwork::SocketIsHalfClosed(uint8_t sock_num) {
+bool HostNetwork::SocketIsHalfClosed(SocketNumber sock_num) {
   auto *info = impl_->GetHostSocketInfo(sock_num);
   bool result = info != nullptr && info->IsConnectionHalfClosed();
   VLOG(2) << "HostNetwork::SocketIsHalfClosed -> "
@@ -89,14 +171,14 @@ bool HostNetwork::SocketIsHalfClosed(uint8_t sock_num) {
   return result;
 }
 
-bool HostNetwork::SocketIsClosed(uint8_t sock_num) {
+bool HostNetwork::SocketIsClosed(SocketNumber sock_num) {
   auto *info = impl_->GetHostSocketInfo(sock_num);
   bool result = info != nullptr && info->IsClosed();
   VLOG(2) << "HostNetwork::SocketIsClosed -> " << (result ? "true" : "false");
   return result;
 }
 
-uint8_t HostNetwork::SocketStatus(uint8_t sock_num) {
+uint8_t HostNetwork::SocketStatus(SocketNumber sock_num) {
   // For convenience, I'm returning values matching those used by the W5500
   // chip, but long term I want to eliminate this method, or define my own
   // status *mask*.
@@ -108,26 +190,40 @@ uint8_t HostNetwork::SocketStatus(uint8_t sock_num) {
   }
 }
 
+IPAddress HostNetwork::RemoteAddress(SocketNumber sock_num) {
+  auto *info = impl_->GetHostSocketInfo(sock_num);
+  if (info == nullptr) {
+    return IPAddress();
+  }
+  const uint32_t address = info->RemoteAddress();
+  return IPAddress(address >> 24, address >> 16, address >> 8, address);
+}
+
+uint16_t HostNetwork::RemotePort(SocketNumber sock_num) {
+  auto *info = impl_->GetHostSocketInfo(sock_num);
+  return info != nullptr ? info->RemotePort() : 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Methods modifying sockets.
 
-bool HostNetwork::InitializeTcpListenerSocket(uint8_t sock_num,
+bool HostNetwork::InitializeTcpListenerSocket(SocketNumber sock_num,
                                               uint16_t tcp_port) {
   auto *info = impl_->GetHostSocketInfo(sock_num);
   return info != nullptr && info->InitializeTcpListener(tcp_port);
 }
 
-bool HostNetwork::AcceptConnection(uint8_t sock_num) {
+bool HostNetwork::AcceptConnection(SocketNumber sock_num) {
   auto *info = impl_->GetHostSocketInfo(sock_num);
   return info != nullptr && info->AcceptConnection();
 }
 
-bool HostNetwork::DisconnectSocket(uint8_t sock_num) {
+bool HostNetwork::DisconnectSocket(SocketNumber sock_num) {
   auto *info = impl_->GetHostSocketInfo(sock_num);
   return info != nullptr && info->DisconnectConnectionSocket();
 }
 
-bool HostNetwork::CloseSocket(uint8_t sock_num) {
+bool HostNetwork::CloseSocket(SocketNumber sock_num) {
   auto *info = impl_->GetHostSocketInfo(sock_num);
   if (info != nullptr) {
     info->CloseConnectionSocket();
@@ -140,7 +236,8 @@ bool HostNetwork::CloseSocket(uint8_t sock_num) {
 ////////////////////////////////////////////////////////////////////////////////
 // Methods using open sockets.
 
-ssize_t HostNetwork::Send(uint8_t sock_num, const uint8_t *buf, size_t len) {
+ssize_t HostNetwork::Send(SocketNumber sock_num, const uint8_t *buf,
+                          size_t len) {
   auto *info = impl_->GetHostSocketInfo(sock_num);
   if (info != nullptr) {
     return info->Send(buf, len);
@@ -149,14 +246,33 @@ ssize_t HostNetwork::Send(uint8_t sock_num, const uint8_t *buf, size_t len) {
   }
 }
 
-void HostNetwork::Flush(uint8_t sock_num) {
+ssize_t HostNetwork::TxFreeBytes(SocketNumber sock_num) {
+  auto *info = impl_->GetHostSocketInfo(sock_num);
+  if (info != nullptr) {
+    return info->TxFreeBytes();
+  } else {
+    return -1;
+  }
+}
+
+ssize_t HostNetwork::TrySend(SocketNumber sock_num, const uint8_t *buf,
+                             size_t len) {
+  auto *info = impl_->GetHostSocketInfo(sock_num);
+  if (info != nullptr) {
+    return info->TrySend(buf, len);
+  } else {
+    return -1;
+  }
+}
+
+void HostNetwork::Flush(SocketNumber sock_num) {
   auto *info = impl_->GetHostSocketInfo(sock_num);
   if (info != nullptr) {
     return info->Flush();
   }
 }
 
-ssize_t HostNetwork::AvailableBytes(uint8_t sock_num) {
+ssize_t HostNetwork::AvailableBytes(SocketNumber sock_num) {
   auto *info = impl_->GetHostSocketInfo(sock_num);
   if (info != nullptr) {
     return info->AvailableBytes();
@@ -165,7 +281,7 @@ ssize_t HostNetwork::AvailableBytes(uint8_t sock_num) {
   }
 }
 
-int HostNetwork::Peek(uint8_t sock_num) {
+int HostNetwork::Peek(SocketNumber sock_num) {
   auto *info = impl_->GetHostSocketInfo(sock_num);
   if (info != nullptr) {
     return info->Peek();
@@ -174,7 +290,7 @@ int HostNetwork::Peek(uint8_t sock_num) {
   }
 }
 
-ssize_t HostNetwork::Recv(uint8_t sock_num, uint8_t *buf, size_t len) {
+ssize_t HostNetwork::Recv(SocketNumber sock_num, uint8_t *buf, size_t len) {
   auto *info = impl_->GetHostSocketInfo(sock_num);
   if (info != nullptr) {
     return info->Recv(buf, len);
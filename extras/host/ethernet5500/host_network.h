@@ -6,7 +6,10 @@
 //
 // Author: james.synge@gmail.com
 
+#include <stdint.h>
+
 #include <memory>
+#include <string>
 
 #include "platform_network_interface.h"
 
@@ -17,7 +20,13 @@ struct HostNetworkImpl;
 
 class HostNetwork : public mcunet::PlatformNetworkInterface {
  public:
+  using SocketNumber = ::mcunet::SocketNumber;
+
+  // Provides the number of sockets specified by --host_network_num_sockets.
   HostNetwork();
+  // Provides num_sockets sockets, which may be many more than a W5500 has, for
+  // the purpose of stress testing server code at higher concurrency.
+  explicit HostNetwork(int num_sockets);
   HostNetwork(const HostNetwork&) = delete;
   HostNetwork(HostNetwork&&) = delete;
   ~HostNetwork() override;
@@ -29,7 +38,8 @@ class HostNetwork : public mcunet::PlatformNetworkInterface {
 #error "MCUNET_PNAPI_METHOD should not be defined!!"
 #endif
 
-#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS) TYPE NAME ARGS override
+#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS, ARG_NAMES) \
+  TYPE NAME ARGS override
 #include "platform_network_api.cc.inc"  // IWYU pragma: export
 #undef MCUNET_PNAPI_METHOD
 
@@ -40,6 +50,27 @@ class HostNetwork : public mcunet::PlatformNetworkInterface {
   // told that the same port is free.
   static int FindFreeTcpPort();
 
+  // Returns the number of sockets provided by this instance.
+  int num_sockets() const;
+
+  // Sets the number of hardware sockets the emulated W5500 is configured for
+  // (1, 2, 4 or 8), which should match the value that the code under test
+  // passes to Ethernet.init; the constructor uses --w5500_socket_count. If
+  // --emulate_w5500_buffers is true, each socket is given the TX and RX buffer
+  // capacities that a W5500 socket would have in that configuration (i.e.
+  // 16KB / max_sock_num); otherwise this does nothing.
+  void SetW5500SocketCount(int max_sock_num);
+
+  // Sets the IPv4 address (in host byte order) to which listener sockets are
+  // bound; see HostSocketInfo::set_listen_address.
+  void SetListenAddress(uint32_t address);
+
+  // Starts recording the traffic of all sockets into a pcap file at path
+  // (see PcapWriter), replacing any capture already in progress. Called by the
+  // constructor if --host_network_pcap_file is set. Returns false if unable to
+  // create the file.
+  bool StartPcapCapture(const std::string& path);
+
  private:
   const std::unique_ptr<HostNetworkImpl> impl_;
 };
@@ -6,13 +6,18 @@
 #include <asm-generic/errno.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/sockios.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <strings.h>
+#include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstring>
 #include <map>
 #include <set>
@@ -26,6 +31,9 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "extras/host/ethernet5500/pcap_writer.h"
 #include "mcucore/extras/host/posix_errno.h"
 
 namespace {
@@ -74,6 +82,17 @@ std::string PortsToString(uint16_t tcp_port, uint16_t mapped_tcp_port) {
 
 bool HaveFd(int fd) { return fd >= 0; }
 
+std::string AddressToString(uint32_t address) {
+  if (address == INADDR_ANY) {
+    return "INADDR_ANY";
+  }
+  return absl::StrCat((address >> 24) & 255, ".", (address >> 16) & 255, ".",
+                      (address >> 8) & 255, ".", address & 255);
+}
+
+// How long Send sleeps between checks for room in an emulated TX buffer.
+constexpr absl::Duration kTxDrainPollInterval = absl::Microseconds(100);
+
 }  // namespace
 
 ABSL_FLAG(PortMap, tcp_server_port_map, (PortMap{}),
@@ -82,10 +101,18 @@ ABSL_FLAG(PortMap, tcp_server_port_map, (PortMap{}),
           "port and the second is the port to which it is mapped. This helps "
           "avoid issues with privileged ports, e.g. those below 1024.");
 
+ABSL_FLAG(int, host_socket_receive_cache_size, 2048,
+          "Size of the user-space receive cache of each HostSocketInfo, used "
+          "to serve Peek and small Recv calls without a system call per call. "
+          "Zero disables the cache.");
+
 namespace mcunet_host {
 
-HostSocketInfo::HostSocketInfo(uint8_t sock_num) : sock_num_(sock_num) {
+HostSocketInfo::HostSocketInfo(int sock_num) : sock_num_(sock_num) {
   VLOG(1) << "Create HostSocketInfo for socket " << sock_num_;
+  const int cache_size = absl::GetFlag(FLAGS_host_socket_receive_cache_size);
+  CHECK_GE(cache_size, 0);
+  rx_cache_.resize(cache_size);
 }
 
 HostSocketInfo::~HostSocketInfo() {
@@ -98,6 +125,9 @@ std::string HostSocketInfo::ToString() const {
   if (HaveFd(connection_socket_fd_)) {
     absl::StrAppend(&result, ", connection_fd=", connection_socket_fd_);
   }
+  if (rx_cache_size_ > 0) {
+    absl::StrAppend(&result, ", cached=", rx_cache_size_);
+  }
   if (HaveFd(listener_socket_fd_)) {
     absl::StrAppend(&result, ", listener_fd=", listener_socket_fd_);
   }
@@ -143,6 +173,11 @@ bool HostSocketInfo::IsConnectionHalfClosed() {
                  << " isn't even open, can't be half closed.";
     return false;
   }
+  if (rx_cache_size_ > 0) {
+    // There is data available to read right now, so not half-closed from our
+    // perspective.
+    return false;
+  }
   if (!can_read_from_connection_) {
     return true;
   }
@@ -164,12 +199,16 @@ bool HostSocketInfo::IsConnectionHalfClosed() {
     // The connection may be half-closed, may be shutdown or disconnected.
     can_read_from_connection_ = false;
     return true;
+  } else if (error_number == EAGAIN || error_number == EWOULDBLOCK ||
+             error_number == EINTR) {
+    // Still open, but the peer hasn't sent anything more yet.
+    return false;
   }
-  CHECK(false) << "recv from " << ToString() << " -> " << size
-               << (size >= 0 ? std::string()
-                             : absl::StrCat(
-                                   "\nWith ",
-                                   mcucore_host::ErrnoToString(error_number)));
+  // E.g. the peer has reset the connection; either way, there is nothing more
+  // to read from it.
+  VLOG(1) << "recv from " << ToString() << " -> " << size << "\nWith "
+          << mcucore_host::ErrnoToString(error_number);
+  can_read_from_connection_ = false;
   return true;
 }
 
@@ -198,6 +237,12 @@ uint8_t HostSocketInfo::SocketStatus() {
     return kStatusListening;
   } else if (IsConnected()) {
     if (IsConnectionHalfClosed()) {
+      if (local_shutdown_) {
+        // Both sides have closed the connection, at which point the W5500
+        // releases the socket.
+        CloseConnectionSocket();
+        return kStatusClosed;
+      }
       return kStatusCloseWait;
     }
     return kStatusEstablished;
@@ -236,14 +281,17 @@ bool HostSocketInfo::InitializeTcpListener(const uint16_t new_tcp_port) {
     CloseListenerSocket();
     return false;
   }
+  // Accepted connections inherit the receive buffer size of the listener.
+  ApplyRxCapacity(listener_socket_fd_);
   sockaddr_in addr;
   addr.sin_family = AF_INET;
-  addr.sin_addr.s_addr = INADDR_ANY;
+  addr.sin_addr.s_addr = htonl(listen_address_);
   addr.sin_port = htons(mapped_tcp_port);
   if (::bind(listener_socket_fd_, reinterpret_cast<sockaddr*>(&addr),
              sizeof addr) < 0) {
     const auto error_number = errno;
-    LOG(ERROR) << "Unable to set bind socket " << sock_num_ << " to INADDR_ANY:"
+    LOG(ERROR) << "Unable to set bind socket " << sock_num_ << " to "
+               << AddressToString(listen_address_) << ":"
                << PortsToString(new_tcp_port, mapped_tcp_port) << ", "
                << mcucore_host::ErrnoToString(error_number);
     CloseListenerSocket();
@@ -275,8 +323,13 @@ bool HostSocketInfo::AcceptConnection() {
     connection_socket_fd_ = ::accept(
         listener_socket_fd_, reinterpret_cast<sockaddr*>(&addr), &addrlen);
     if (HaveFd(connection_socket_fd_)) {
+      // accept provides the same address that getpeername would; keep it so
+      // that RemoteAddress and RemotePort don't need a system call.
+      remote_address_ = ntohl(addr.sin_addr.s_addr);
+      remote_port_ = ntohs(addr.sin_port);
       VLOG(1) << "Accepted a connection for socket " << sock_num_ << " with fd "
-              << connection_socket_fd_;
+              << connection_socket_fd_ << " from "
+              << AddressToString(remote_address_) << ":" << remote_port_;
 
       // We leave the connection as blocking so that Send can be blocking, while
       // Recv can be non-blocking by passing MSG_DONTWAIT.
@@ -288,7 +341,27 @@ bool HostSocketInfo::AcceptConnection() {
       // listening, so to be a better emulation of its behavior, we now close
       // the listener socket, and will re-open it later if requested.
       CloseListenerSocket();
+      // The W5500 transmits as soon as it is told to send, rather than
+      // delaying small segments as Nagle's algorithm does; without this a
+      // server that writes several responses at once (e.g. to pipelined
+      // requests) waits for the client's delayed ACKs.
+      int one = 1;
+      if (::setsockopt(connection_socket_fd_, IPPROTO_TCP, TCP_NODELAY, &one,
+                       sizeof one) < 0) {
+        const auto error_number = errno;
+        LOG(WARNING) << "Unable to set TCP_NODELAY for socket " << sock_num_
+                     << ", " << mcucore_host::ErrnoToString(error_number);
+      }
       can_write_to_connection_ = can_read_from_connection_ = true;
+      if (pcap_writer_ != nullptr) {
+        sockaddr_in local_addr;
+        socklen_t local_addrlen = sizeof local_addr;
+        if (::getsockname(connection_socket_fd_,
+                          reinterpret_cast<sockaddr*>(&local_addr),
+                          &local_addrlen) == 0) {
+          pcap_writer_->RecordAccept(sock_num_, local_addr, addr);
+        }
+      }
       return true;
     }
     const int error_number = errno;
@@ -303,6 +376,10 @@ bool HostSocketInfo::DisconnectConnectionSocket() {
     VLOG(1) << "Disconnecting connection (" << connection_socket_fd_
             << ") for socket " << sock_num_;
     if (::shutdown(connection_socket_fd_, SHUT_WR) == 0) {
+      local_shutdown_ = true;
+      if (pcap_writer_ != nullptr) {
+        pcap_writer_->RecordLocalShutdown(sock_num_);
+      }
       return true;
     }
   }
@@ -314,10 +391,18 @@ void HostSocketInfo::CloseConnectionSocket() {
     VLOG(1) << "Closing connection (" << connection_socket_fd_
             << ") for socket " << sock_num_;
     ::close(connection_socket_fd_);
+    if (pcap_writer_ != nullptr) {
+      pcap_writer_->RecordClose(sock_num_);
+    }
   }
   connection_socket_fd_ = -1;
+  remote_address_ = 0;
+  remote_port_ = 0;
   can_read_from_connection_ = false;
   can_write_to_connection_ = false;
+  local_shutdown_ = false;
+  rx_cache_start_ = 0;
+  rx_cache_size_ = 0;
 }
 
 void HostSocketInfo::CloseListenerSocket() {
@@ -353,6 +438,32 @@ bool HostSocketInfo::SetNonBlocking(int fd) {
   return true;
 }
 
+void HostSocketInfo::SetBufferCapacities(const size_t tx_capacity,
+                                         const size_t rx_capacity) {
+  VLOG(1) << "Socket " << sock_num_ << " TX capacity " << tx_capacity
+          << ", RX capacity " << rx_capacity;
+  tx_capacity_ = tx_capacity;
+  rx_capacity_ = rx_capacity;
+  if (HaveFd(listener_socket_fd_)) {
+    ApplyRxCapacity(listener_socket_fd_);
+  }
+}
+
+void HostSocketInfo::ApplyRxCapacity(const int fd) {
+  if (rx_capacity_ == 0) {
+    return;
+  }
+  // The kernel doubles this value to allow for its own bookkeeping, and
+  // imposes a minimum, so the advertised window only approximates the
+  // capacity.
+  int value = rx_capacity_;
+  if (::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &value, sizeof value) < 0) {
+    const auto error_number = errno;
+    LOG(WARNING) << "Unable to set SO_RCVBUF for socket " << sock_num_ << ", "
+                 << mcucore_host::ErrnoToString(error_number);
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Methods using open sockets.
 
@@ -361,7 +472,77 @@ ssize_t HostSocketInfo::Send(const uint8_t* buf, size_t len) {
     LOG(WARNING) << "Socket doesn't have an open connection.";
     return -1;
   }
-  return ::send(connection_socket_fd_, buf, len, 0);
+  if (tx_capacity_ == 0) {
+    return CaptureSent(buf, ::send(connection_socket_fd_, buf, len, 0));
+  }
+  // Like the W5500 library, wait until there is room in the TX buffer, which
+  // drains as the peer acknowledges the data; unlike that library, we then
+  // send as much as fits rather than waiting for room for all of it.
+  ssize_t free_bytes;
+  while ((free_bytes = TxFreeBytes()) == 0) {
+    pollfd pfd{connection_socket_fd_, POLLOUT, 0};
+    if (::poll(&pfd, 1, 0) < 0 || (pfd.revents & (POLLERR | POLLHUP)) != 0) {
+      VLOG(2) << "HostSocketInfo::Send from " << ToString()
+              << " lost the connection while waiting for TX room";
+      return -1;
+    }
+    absl::SleepFor(kTxDrainPollInterval);
+  }
+  if (free_bytes < 0) {
+    return -1;
+  }
+  return CaptureSent(
+      buf, ::send(connection_socket_fd_, buf,
+                  std::min(len, static_cast<size_t>(free_bytes)), 0));
+}
+
+ssize_t HostSocketInfo::TrySend(const uint8_t* buf, size_t len) {
+  const ssize_t free_bytes = TxFreeBytes();
+  if (free_bytes <= 0) {
+    return free_bytes;
+  }
+  len = std::min(len, static_cast<size_t>(free_bytes));
+  const ssize_t size =
+      ::send(connection_socket_fd_, buf, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (size < 0) {
+    const auto error_number = errno;
+    if (error_number == EAGAIN || error_number == EWOULDBLOCK ||
+        error_number == EINTR) {
+      return 0;
+    }
+    VLOG(2) << "HostSocketInfo::TrySend from " << ToString() << " failed with "
+            << mcucore_host::ErrnoToString(error_number);
+    return -1;
+  }
+  return CaptureSent(buf, size);
+}
+
+ssize_t HostSocketInfo::TxFreeBytes() {
+  if (!HaveFd(connection_socket_fd_)) {
+    LOG(WARNING) << "Socket doesn't have an open connection.";
+    return -1;
+  }
+  int capacity = tx_capacity_;
+  if (capacity == 0) {
+    socklen_t len = sizeof capacity;
+    if (::getsockopt(connection_socket_fd_, SOL_SOCKET, SO_SNDBUF, &capacity,
+                     &len) < 0) {
+      const auto error_number = errno;
+      VLOG(2) << "HostSocketInfo::TxFreeBytes from " << ToString()
+              << " failed with " << mcucore_host::ErrnoToString(error_number);
+      return -1;
+    }
+  }
+  // SIOCOUTQ reports the bytes not yet acknowledged by the peer, which is how
+  // long the W5500 holds onto bytes in its TX buffer.
+  int queued = 0;
+  if (::ioctl(connection_socket_fd_, SIOCOUTQ, &queued) < 0) {
+    const auto error_number = errno;
+    VLOG(2) << "HostSocketInfo::TxFreeBytes from " << ToString()
+            << " failed with " << mcucore_host::ErrnoToString(error_number);
+    return -1;
+  }
+  return queued < capacity ? capacity - queued : 0;
 }
 
 void HostSocketInfo::Flush() {
@@ -372,33 +553,64 @@ void HostSocketInfo::Flush() {
 }
 
 ssize_t HostSocketInfo::AvailableBytes() {
-  // There isn't a portable way to determine the number bytes available for
-  // reading, so we peek and see if we can read at least a fixed number of
-  // bytes, a number that is larger than a small embedded system is likely to
-  // have available in a single buffer.
-  uint8_t buffer[1000];
-  const ssize_t size = RecvInternal(buffer, sizeof(buffer), /*peek=*/true);
-  if (size >= 0) {
-    return size;
+  if (!HaveFd(connection_socket_fd_)) {
+    LOG(WARNING) << "Socket doesn't have an open connection.";
+    return -1;
   }
-  if (can_read_from_connection_ || can_write_to_connection_) {
-    return 0;
+  ssize_t available = rx_cache_size_;
+  if (can_read_from_connection_) {
+    // FIONREAD reports the number of bytes queued in the kernel for reading,
+    // without copying them as peeking would.
+    int queued = 0;
+    if (::ioctl(connection_socket_fd_, FIONREAD, &queued) == 0) {
+      available += queued;
+    } else {
+      const auto error_number = errno;
+      VLOG(2) << "HostSocketInfo::AvailableBytes from " << ToString()
+              << " failed with " << mcucore_host::ErrnoToString(error_number);
+    }
   }
-  return -1;
+  if (rx_capacity_ > 0 && available > static_cast<ssize_t>(rx_capacity_)) {
+    // The W5500 can't hold more than this.
+    available = rx_capacity_;
+  }
+  return available;
 }
 
 int HostSocketInfo::Peek() {
-  uint8_t b;
-  const ssize_t size = RecvInternal(&b, 1, /*peek=*/false);
-  if (size == 1) {
-    return b;
-  } else {
-    return -1;
+  if (rx_cache_size_ == 0) {
+    if (!ReceiveCacheEnabled()) {
+      uint8_t b;
+      if (RecvInternal(&b, 1, /*peek=*/true) == 1) {
+        return b;
+      }
+      return -1;
+    }
+    if (FillReceiveCache() <= 0) {
+      return -1;
+    }
   }
+  return rx_cache_[rx_cache_start_];
 }
 
 ssize_t HostSocketInfo::Recv(uint8_t* buf, size_t len) {
-  return RecvInternal(buf, len, /*peek=*/false);
+  if (rx_capacity_ > 0 && len > rx_capacity_) {
+    len = rx_capacity_;
+  }
+  if (rx_cache_size_ > 0) {
+    // Serve the request from the cache, even if that is fewer than len bytes,
+    // rather than making a system call to find out if there is more.
+    return CopyFromReceiveCache(buf, len);
+  } else if (!ReceiveCacheEnabled() || len >= rx_cache_.size()) {
+    // Large reads (and all reads if the cache is disabled) go straight to the
+    // caller's buffer.
+    return RecvInternal(buf, len, /*peek=*/false);
+  }
+  const ssize_t size = FillReceiveCache();
+  if (size <= 0) {
+    return size;
+  }
+  return CopyFromReceiveCache(buf, len);
 }
 
 ssize_t HostSocketInfo::RecvInternal(uint8_t* buf, size_t len, bool peek) {
@@ -412,15 +624,61 @@ ssize_t HostSocketInfo::RecvInternal(uint8_t* buf, size_t len, bool peek) {
 
   const ssize_t size = recv(connection_socket_fd_, buf, len,
                             MSG_DONTWAIT | (peek ? MSG_PEEK : 0));
-  const auto error_number = errno;
+  const ssize_t result = HandleRecvResult(size, errno, "RecvInternal");
+  return peek ? result : CaptureReceived(buf, result);
+}
+
+ssize_t HostSocketInfo::FillReceiveCache() {
+  DCHECK_EQ(rx_cache_size_, 0);
+  DCHECK(ReceiveCacheEnabled());
+  rx_cache_start_ = 0;
+  const ssize_t size =
+      RecvInternal(rx_cache_.data(), rx_cache_.size(), /*peek=*/false);
+  if (size > 0) {
+    rx_cache_size_ = size;
+  }
+  return size;
+}
+
+ssize_t HostSocketInfo::CaptureSent(const uint8_t* buf, const ssize_t size) {
+  if (pcap_writer_ != nullptr && size > 0) {
+    pcap_writer_->RecordSend(sock_num_, buf, size);
+  }
+  return size;
+}
+
+ssize_t HostSocketInfo::CaptureReceived(const uint8_t* buf,
+                                        const ssize_t size) {
+  if (pcap_writer_ != nullptr && size > 0) {
+    pcap_writer_->RecordRecv(sock_num_, buf, size);
+  }
+  return size;
+}
+
+size_t HostSocketInfo::CopyFromReceiveCache(uint8_t* buf, size_t len) {
+  const size_t size = std::min(len, rx_cache_size_);
+  std::memcpy(buf, rx_cache_.data() + rx_cache_start_, size);
+  rx_cache_start_ += size;
+  rx_cache_size_ -= size;
+  if (rx_cache_size_ == 0) {
+    rx_cache_start_ = 0;
+  }
+  return size;
+}
+
+ssize_t HostSocketInfo::HandleRecvResult(const ssize_t size,
+                                         const int error_number,
+                                         const char* const caller) {
   if (size > 0) {
     return size;
   }
   if (size == 0) {
-    VLOG(2)
-        << "Detected unreadable socket in HostSocketInfo::RecvInternal from "
-        << ToString();
+    VLOG(2) << "Detected unreadable socket in HostSocketInfo::" << caller
+            << " from " << ToString();
     can_read_from_connection_ = false;
+    if (pcap_writer_ != nullptr) {
+      pcap_writer_->RecordPeerShutdown(sock_num_);
+    }
     return 0;
   }
 
@@ -433,24 +691,27 @@ ssize_t HostSocketInfo::RecvInternal(uint8_t* buf, size_t len, bool peek) {
 #endif
     case EINTR:
       // Try again later.
-      VLOG(2) << "HostSocketInfo::RecvInternal from " << ToString()
+      VLOG(2) << "HostSocketInfo::" << caller << " from " << ToString()
               << " need to try again later; "
-              << mcucore_host::ErrnoToString(errno);
+              << mcucore_host::ErrnoToString(error_number);
       return -1;
 
     case ECONNRESET:
     case ECONNABORTED:
     case ENOTCONN:
       // Seems the connection is broken.
-      VLOG(2) << "HostSocketInfo::RecvInternal from " << ToString()
-              << " failed with " << mcucore_host::ErrnoToString(errno);
+      VLOG(2) << "HostSocketInfo::" << caller << " from " << ToString()
+              << " failed with " << mcucore_host::ErrnoToString(error_number);
+      if (pcap_writer_ != nullptr) {
+        pcap_writer_->RecordReset(sock_num_);
+      }
       CloseConnectionSocket();
       return -1;
 
     default:
-      CHECK(false) << "HostSocketInfo::RecvInternal from " << ToString()
+      CHECK(false) << "HostSocketInfo::" << caller << " from " << ToString()
                    << " failed with unexpected error; "
-                   << mcucore_host::ErrnoToString(errno);
+                   << mcucore_host::ErrnoToString(error_number);
   }
   return -1;
 }
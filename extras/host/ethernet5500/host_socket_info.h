@@ -17,9 +17,12 @@
 #include <sys/types.h>
 
 #include <string>
+#include <vector>
 
 namespace mcunet_host {
 
+class PcapWriter;
+
 class HostSocketInfo {
  public:
   // These values match the values of the W5500 socket status register.
@@ -28,7 +31,9 @@ class HostSocketInfo {
   static constexpr uint8_t kStatusCloseWait = 0x1C;
   static constexpr uint8_t kStatusEstablished = 0x17;
 
-  explicit HostSocketInfo(uint8_t sock_num);
+  // The size of the receive cache is determined by the flag
+  // --host_socket_receive_cache_size; zero disables the cache.
+  explicit HostSocketInfo(int sock_num);
   // Closes any open host socket (i.e. listener or connection).
   ~HostSocketInfo();
 
@@ -72,6 +77,12 @@ class HostSocketInfo {
   // PlatformNetworkInterface, at which point it can be removed here.
   uint8_t SocketStatus();
 
+  // Returns the IPv4 address (in host byte order) and the port of the peer of
+  // the connection socket, or zero if there is no connection socket. Recorded
+  // when the connection is accepted, so these don't make a system call.
+  uint32_t RemoteAddress() const { return remote_address_; }
+  uint16_t RemotePort() const { return remote_port_; }
+
   //////////////////////////////////////////////////////////////////////////////
   // Methods modifying sockets. So far these are all related to being a TCP
   // server, but eventually there should be methods for being a client, for UDP,
@@ -81,6 +92,12 @@ class HostSocketInfo {
   // if currently connected to a peer, disconnect. Returns true if successful.
   bool InitializeTcpListener(uint16_t new_tcp_port);
 
+  // Sets the IPv4 address (in host byte order) to which the listener socket
+  // is bound by later calls to InitializeTcpListener. The default is
+  // INADDR_ANY. Binding to distinct loopback addresses (e.g. 127.1.0.1 and
+  // 127.1.0.2) allows several simulated devices to listen to the same port.
+  void set_listen_address(uint32_t address) { listen_address_ = address; }
+
   // If there is a new connection from a peer available to be accepted, do so
   // and return true; else returns false.
   bool AcceptConnection();
@@ -104,13 +121,41 @@ class HostSocketInfo {
   // if successful.
   static bool SetNonBlocking(int fd);
 
+  // Emulate the fixed size TX and RX buffers of a W5500 socket, so that the
+  // host sees the same backpressure as the device: Send writes at most as many
+  // bytes as are free in the TX buffer, waiting until some are free, where the
+  // bytes are considered to be in use until acknowledged by the peer; the
+  // receive window advertised to the peer is limited (approximately) to the RX
+  // capacity, and AvailableBytes and Recv report no more than that capacity.
+  // A capacity of zero means unlimited (i.e. the kernel's behavior), which is
+  // the default. The receive cache isn't used while an RX capacity is set, as
+  // the bytes it holds would be in addition to those the kernel buffers.
+  void SetBufferCapacities(size_t tx_capacity, size_t rx_capacity);
+  size_t tx_capacity() const { return tx_capacity_; }
+  size_t rx_capacity() const { return rx_capacity_; }
+
+  // Records connection events and the bytes sent and received using writer,
+  // or stops recording if writer is nullptr. The writer must outlive this
+  // instance (or until replaced).
+  void set_pcap_writer(PcapWriter *writer) { pcap_writer_ = writer; }
+
   //////////////////////////////////////////////////////////////////////////////
   // Methods using open sockets.
 
   // Sends on an open connection. Returns the number of bytes sent, or -1 if an
-  // error is encountered.
+  // error is encountered. If a TX capacity has been set, fewer than len bytes
+  // may be sent.
   ssize_t Send(const uint8_t *buf, size_t len);
 
+  // Returns the number of bytes that can currently be sent without waiting, or
+  // -1 if there is no open connection. If no TX capacity has been set, this is
+  // the room remaining in the kernel's send buffer.
+  ssize_t TxFreeBytes();
+
+  // Like Send, but never waits: sends at most TxFreeBytes bytes, possibly zero.
+  // Returns the number of bytes sent, or -1 if an error is encountered.
+  ssize_t TrySend(const uint8_t *buf, size_t len);
+
   // Flush any bytes queued in the socket for sending.
   void Flush();
 
@@ -118,34 +163,92 @@ class HostSocketInfo {
   // error occurred, -1 is returned; if all bytes written by the peer have been
   // read, and the peer has performed an orderly shutdown of writing, then 0 is
   // returned, indicating EOF; however, 0 will also be returned if that is the
-  // number of bytes available to read from a fully open connection.
+  // number of bytes available to read from a fully open connection. This is the
+  // sum of the bytes in the receive cache and those queued in the kernel (as
+  // reported by FIONREAD), so no data is copied to compute it.
   ssize_t AvailableBytes();
 
   // Returns the first available byte from the socket, or -1 if there is no byte
-  // available, including if the connection is not open.
+  // available, including if the connection is not open. Doesn't consume the
+  // byte.
   int Peek();
 
   // Receives from an open connection. Returns the number of bytes received and
   // copied into the buffer; if an error occurred, -1 is returned; if the peer
   // has performed an orderly shutdown of writing, then 0 is returned,
-  // indicating EOF.
+  // indicating EOF. Bytes already in the receive cache are returned without
+  // making a system call; reads at least as large as the cache bypass it.
   ssize_t Recv(uint8_t *buf, size_t len);
 
+  // Returns the number of bytes held in the receive cache. Exposed for testing.
+  size_t receive_cache_size() const { return rx_cache_size_; }
+
  private:
   ssize_t RecvInternal(uint8_t *buf, size_t len, bool peek);
 
+  // Interprets the value returned by recv (and the errno value if the size is
+  // negative), updating the state of the connection as appropriate. Returns the
+  // value that RecvInternal and similar methods should return.
+  ssize_t HandleRecvResult(ssize_t size, int error_number, const char *caller);
+
+  // Applies rx_capacity_ (if set) to the receive buffer of the host socket.
+  void ApplyRxCapacity(int fd);
+
+  // Returns true if reads are to be made via the receive cache.
+  bool ReceiveCacheEnabled() const {
+    return !rx_cache_.empty() && rx_capacity_ == 0;
+  }
+
+  // Reads as much as is immediately available (without blocking) from the
+  // connection socket into the (empty) receive cache. Returns the value
+  // returned by HandleRecvResult.
+  ssize_t FillReceiveCache();
+
+  // Copies up to len bytes from the receive cache into buf, removing them from
+  // the cache. Returns the number of bytes copied.
+  size_t CopyFromReceiveCache(uint8_t *buf, size_t len);
+
+  // Passes the size bytes just sent or received (if size > 0) to pcap_writer_,
+  // if set. Returns size.
+  ssize_t CaptureSent(const uint8_t *buf, ssize_t size);
+  ssize_t CaptureReceived(const uint8_t *buf, ssize_t size);
+
   const int sock_num_;
 
   // IFF listening, these three are at non-default values.
   int listener_socket_fd_{-1};
   uint16_t tcp_port_{0};
+  uint32_t listen_address_{0};
   // Port number to which the requested port has been mapped.
   uint16_t mapped_tcp_port_{0};
 
   // IFF a connection has been accepted, set to a non-default value (>= 0).
   int connection_socket_fd_{-1};
+  // Address (in host byte order) and port of the peer of the connection.
+  uint32_t remote_address_{0};
+  uint16_t remote_port_{0};
   bool can_write_to_connection_{false};
   bool can_read_from_connection_{false};
+  // True once DisconnectConnectionSocket has shut down our side of the
+  // connection.
+  bool local_shutdown_{false};
+
+  // Optional user-space receive cache, used to serve Peek and small Recv calls
+  // without making a system call each time. rx_cache_ is sized at construction
+  // (and is empty if the cache is disabled); rx_cache_start_ is the offset of
+  // the first unread byte, and rx_cache_size_ is the number of unread bytes.
+  // The cache is only refilled once it has been drained, so the unread bytes
+  // are always contiguous.
+  std::vector<uint8_t> rx_cache_;
+  size_t rx_cache_start_{0};
+  size_t rx_cache_size_{0};
+
+  // Emulated W5500 buffer sizes; zero if not emulating.
+  size_t tx_capacity_{0};
+  size_t rx_capacity_{0};
+
+  // Not owned; nullptr if not capturing.
+  PcapWriter *pcap_writer_{nullptr};
 };
 
 }  // namespace mcunet_host
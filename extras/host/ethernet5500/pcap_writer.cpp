@@ -0,0 +1,335 @@
+#include "extras/host/ethernet5500/pcap_writer.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "mcucore/extras/host/posix_errno.h"
+
+namespace mcunet_host {
+namespace {
+
+// pcap file header magic number indicating nanosecond resolution timestamps.
+constexpr uint32_t kPcapMagicNanos = 0xA1B23C4D;
+constexpr uint16_t kPcapVersionMajor = 2;
+constexpr uint16_t kPcapVersionMinor = 4;
+constexpr uint32_t kPcapSnapLen = 65535;
+// The packets start with an IPv4 header; there is no link-layer header.
+constexpr uint32_t kLinkTypeRaw = 101;
+
+constexpr size_t kIpHeaderSize = 20;
+constexpr size_t kTcpHeaderSize = 20;
+constexpr uint8_t kIpProtocolTcp = 6;
+constexpr uint8_t kIpTtl = 64;
+
+// The largest payload placed in a single segment, matching that of a W5500 on
+// an Ethernet network.
+constexpr size_t kMaxSegmentSize = 1460;
+
+// The window advertised in the synthesized segments; it isn't meaningful, but
+// a zero window would confuse the tools reading the file.
+constexpr uint16_t kTcpWindow = 65535;
+
+constexpr uint8_t kTcpFin = 0x01;
+constexpr uint8_t kTcpSyn = 0x02;
+constexpr uint8_t kTcpRst = 0x04;
+constexpr uint8_t kTcpPsh = 0x08;
+constexpr uint8_t kTcpAck = 0x10;
+
+// Arbitrary initial sequence numbers, distinct so that the two directions are
+// easy to tell apart when looking at absolute sequence numbers.
+constexpr uint32_t kLocalInitialSeq = 0x10000000;
+constexpr uint32_t kPeerInitialSeq = 0x20000000;
+
+void PutBE16(uint8_t* p, uint16_t v) {
+  p[0] = v >> 8;
+  p[1] = v;
+}
+
+void PutBE32(uint8_t* p, uint32_t v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+// Adds the 16-bit big-endian words of [p, p+len) to sum; if len is odd, the
+// last byte is padded with zero.
+uint32_t ChecksumAdd(uint32_t sum, const uint8_t* p, size_t len) {
+  for (; len > 1; p += 2, len -= 2) {
+    sum += (p[0] << 8) | p[1];
+  }
+  if (len > 0) {
+    sum += p[0] << 8;
+  }
+  return sum;
+}
+
+// Returns the Internet checksum (RFC 1071) given the sum of the words.
+uint16_t ChecksumFinish(uint32_t sum) {
+  while (sum >> 16) {
+    sum = (sum & 0xFFFF) + (sum >> 16);
+  }
+  return ~sum;
+}
+
+}  // namespace
+
+PcapWriter::PcapWriter(const std::string& path)
+    : file_(fopen(path.c_str(), "wb")) {
+  if (file_ == nullptr) {
+    const auto error_number = errno;
+    LOG(ERROR) << "Unable to open pcap file " << path << ": "
+               << mcucore_host::ErrnoToString(error_number);
+    return;
+  }
+  uint8_t header[24];
+  // The file header is written in host byte order; readers detect the order
+  // from the magic number.
+  const uint32_t magic = kPcapMagicNanos;
+  const uint16_t major = kPcapVersionMajor;
+  const uint16_t minor = kPcapVersionMinor;
+  const uint32_t zero = 0;
+  const uint32_t snap_len = kPcapSnapLen;
+  const uint32_t link_type = kLinkTypeRaw;
+  memcpy(header, &magic, 4);
+  memcpy(header + 4, &major, 2);
+  memcpy(header + 6, &minor, 2);
+  memcpy(header + 8, &zero, 4);  // Timezone offset.
+  memcpy(header + 12, &zero, 4);  // Timestamp accuracy.
+  memcpy(header + 16, &snap_len, 4);
+  memcpy(header + 20, &link_type, 4);
+  fwrite(header, sizeof header, 1, file_);
+  writer_thread_ = std::thread(&PcapWriter::WriterMain, this);
+  LOG(INFO) << "Capturing HostNetwork traffic to " << path;
+}
+
+PcapWriter::~PcapWriter() {
+  if (file_ == nullptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  writer_thread_.join();
+  fclose(file_);
+}
+
+void PcapWriter::RecordAccept(int sock_num, const sockaddr_in& local,
+                              const sockaddr_in& peer) {
+  Event event(absl::Now(), sock_num, EventType::kAccept);
+  event.local = local;
+  event.peer = peer;
+  Enqueue(std::move(event));
+}
+
+void PcapWriter::RecordSend(int sock_num, const uint8_t* buf, size_t len) {
+  Event event(absl::Now(), sock_num, EventType::kSend);
+  event.data.assign(reinterpret_cast<const char*>(buf), len);
+  Enqueue(std::move(event));
+}
+
+void PcapWriter::RecordRecv(int sock_num, const uint8_t* buf, size_t len) {
+  Event event(absl::Now(), sock_num, EventType::kRecv);
+  event.data.assign(reinterpret_cast<const char*>(buf), len);
+  Enqueue(std::move(event));
+}
+
+void PcapWriter::RecordLocalShutdown(int sock_num) {
+  Enqueue(Event(absl::Now(), sock_num, EventType::kLocalShutdown));
+}
+
+void PcapWriter::RecordPeerShutdown(int sock_num) {
+  Enqueue(Event(absl::Now(), sock_num, EventType::kPeerShutdown));
+}
+
+void PcapWriter::RecordReset(int sock_num) {
+  Enqueue(Event(absl::Now(), sock_num, EventType::kReset));
+}
+
+void PcapWriter::RecordClose(int sock_num) {
+  Enqueue(Event(absl::Now(), sock_num, EventType::kClose));
+}
+
+void PcapWriter::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const uint64_t target = enqueued_;
+  cv_.wait(lock, [this, target] { return written_ >= target || !ok(); });
+}
+
+void PcapWriter::Enqueue(Event event) {
+  if (file_ == nullptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.push_back(std::move(event));
+    ++enqueued_;
+  }
+  cv_.notify_all();
+}
+
+void PcapWriter::WriterMain() {
+  std::vector<Event> events;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+    if (pending_.empty()) {
+      // Must be stopping, and there is nothing left to write.
+      break;
+    }
+    events.swap(pending_);
+    lock.unlock();
+    for (const auto& event : events) {
+      WriteEvent(event);
+    }
+    fflush(file_);
+    const auto count = events.size();
+    events.clear();
+    lock.lock();
+    written_ += count;
+    cv_.notify_all();
+  }
+}
+
+void PcapWriter::WriteEvent(const Event& event) {
+  if (event.type == EventType::kAccept) {
+    Flow& flow = flows_[event.sock_num];
+    flow = Flow{event.local, event.peer, kLocalInitialSeq, kPeerInitialSeq,
+                false, false};
+    WriteSegment(event.time, flow, /*from_local=*/false, kTcpSyn, nullptr, 0);
+    WriteSegment(event.time, flow, /*from_local=*/true, kTcpSyn | kTcpAck,
+                 nullptr, 0);
+    WriteSegment(event.time, flow, /*from_local=*/false, kTcpAck, nullptr, 0);
+    return;
+  }
+  auto it = flows_.find(event.sock_num);
+  if (it == flows_.end()) {
+    // The connection was accepted before capturing started, or has already
+    // been reset.
+    return;
+  }
+  Flow& flow = it->second;
+  switch (event.type) {
+    case EventType::kAccept:
+      break;
+
+    case EventType::kSend:
+    case EventType::kRecv: {
+      const bool from_local = event.type == EventType::kSend;
+      const char* data = event.data.data();
+      size_t remaining = event.data.size();
+      while (remaining > 0) {
+        const size_t len = std::min(remaining, kMaxSegmentSize);
+        remaining -= len;
+        // Like a typical TCP stack, push at the end of each write.
+        const uint8_t flags = kTcpAck | (remaining == 0 ? kTcpPsh : 0);
+        WriteSegment(event.time, flow, from_local, flags, data, len);
+        data += len;
+      }
+      break;
+    }
+
+    case EventType::kLocalShutdown:
+      if (!flow.local_fin) {
+        WriteSegment(event.time, flow, /*from_local=*/true, kTcpFin | kTcpAck,
+                     nullptr, 0);
+        flow.local_fin = true;
+      }
+      break;
+
+    case EventType::kPeerShutdown:
+      if (!flow.peer_fin) {
+        WriteSegment(event.time, flow, /*from_local=*/false, kTcpFin | kTcpAck,
+                     nullptr, 0);
+        flow.peer_fin = true;
+      }
+      break;
+
+    case EventType::kReset:
+      WriteSegment(event.time, flow, /*from_local=*/false, kTcpRst | kTcpAck,
+                   nullptr, 0);
+      flows_.erase(it);
+      break;
+
+    case EventType::kClose:
+      if (!flow.local_fin) {
+        WriteSegment(event.time, flow, /*from_local=*/true, kTcpFin | kTcpAck,
+                     nullptr, 0);
+      }
+      flows_.erase(it);
+      break;
+  }
+}
+
+void PcapWriter::WriteSegment(absl::Time time, Flow& flow, bool from_local,
+                              uint8_t flags, const char* payload, size_t len) {
+  const sockaddr_in& src = from_local ? flow.local : flow.peer;
+  const sockaddr_in& dst = from_local ? flow.peer : flow.local;
+  uint32_t& seq = from_local ? flow.local_seq : flow.peer_seq;
+  const uint32_t ack = from_local ? flow.peer_seq : flow.local_seq;
+
+  const size_t total_len = kIpHeaderSize + kTcpHeaderSize + len;
+  packet_.assign(total_len, 0);
+  uint8_t* ip = packet_.data();
+  uint8_t* tcp = ip + kIpHeaderSize;
+
+  ip[0] = 0x45;  // IPv4, 5 word header.
+  PutBE16(ip + 2, total_len);
+  PutBE16(ip + 4, next_ip_id_++);
+  PutBE16(ip + 6, 0x4000);  // Don't fragment.
+  ip[8] = kIpTtl;
+  ip[9] = kIpProtocolTcp;
+  // The addresses and ports are already in network byte order.
+  memcpy(ip + 12, &src.sin_addr.s_addr, 4);
+  memcpy(ip + 16, &dst.sin_addr.s_addr, 4);
+  PutBE16(ip + 10, ChecksumFinish(ChecksumAdd(0, ip, kIpHeaderSize)));
+
+  memcpy(tcp, &src.sin_port, 2);
+  memcpy(tcp + 2, &dst.sin_port, 2);
+  PutBE32(tcp + 4, seq);
+  PutBE32(tcp + 8, (flags & kTcpAck) ? ack : 0);
+  tcp[12] = (kTcpHeaderSize / 4) << 4;
+  tcp[13] = flags;
+  PutBE16(tcp + 14, kTcpWindow);
+  if (len > 0) {
+    memcpy(tcp + kTcpHeaderSize, payload, len);
+  }
+  // The TCP checksum covers a pseudo-header of the addresses, protocol and TCP
+  // length, followed by the TCP header and payload.
+  uint8_t pseudo_header[12] = {0};
+  memcpy(pseudo_header, ip + 12, 8);
+  pseudo_header[9] = kIpProtocolTcp;
+  PutBE16(pseudo_header + 10, kTcpHeaderSize + len);
+  uint32_t sum = ChecksumAdd(0, pseudo_header, sizeof pseudo_header);
+  sum = ChecksumAdd(sum, tcp, kTcpHeaderSize + len);
+  PutBE16(tcp + 16, ChecksumFinish(sum));
+
+  // SYN and FIN each consume a sequence number.
+  seq += len + ((flags & (kTcpSyn | kTcpFin)) ? 1 : 0);
+
+  const int64_t nanos = absl::ToUnixNanos(time);
+  const uint32_t record_header[4] = {
+      static_cast<uint32_t>(nanos / 1000000000),
+      static_cast<uint32_t>(nanos % 1000000000),
+      static_cast<uint32_t>(total_len), static_cast<uint32_t>(total_len)};
+  fwrite(record_header, sizeof record_header, 1, file_);
+  fwrite(packet_.data(), total_len, 1, file_);
+}
+
+}  // namespace mcunet_host
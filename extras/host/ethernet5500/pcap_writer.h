@@ -0,0 +1,141 @@
+#ifndef MCUNET_EXTRAS_HOST_ETHERNET5500_PCAP_WRITER_H_
+#define MCUNET_EXTRAS_HOST_ETHERNET5500_PCAP_WRITER_H_
+
+// PcapWriter records the traffic of HostSocketInfo connections into a pcap
+// file (with nanosecond timestamps and LINKTYPE_RAW, i.e. IPv4 packets), so
+// that the exchange can be examined with tools such as Wireshark or tcpdump.
+//
+// We don't see the packets which the kernel exchanges with the peer, only the
+// bytes passed to and from the socket API, so the TCP framing is synthesized:
+// a three-way handshake when a connection is accepted, a segment (or several,
+// if large) for each send and receive, a FIN for each half-close, and a RST if
+// the connection is reset. Sequence and acknowledgement numbers are consistent
+// with the bytes recorded, and the IPv4 and TCP checksums are valid.
+//
+// The Record methods just enqueue an event with a timestamp; the packets are
+// synthesized and written by a separate thread, so that capturing has little
+// effect on the latencies of the code being observed.
+//
+// Author: james.synge@gmail.com
+
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <condition_variable>  // NOLINT
+#include <map>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/time/time.h"
+
+namespace mcunet_host {
+
+class PcapWriter {
+ public:
+  // Creates (or truncates) the file at path and starts the writer thread. If
+  // the file can't be opened, an error is logged, ok() returns false and the
+  // Record methods do nothing.
+  explicit PcapWriter(const std::string& path);
+
+  // Writes any events not yet written, then closes the file.
+  ~PcapWriter();
+
+  PcapWriter(const PcapWriter&) = delete;
+  PcapWriter& operator=(const PcapWriter&) = delete;
+
+  bool ok() const { return file_ != nullptr; }
+
+  // A connection has been accepted by socket sock_num; local is the address of
+  // the host socket, and peer is that of the client.
+  void RecordAccept(int sock_num, const sockaddr_in& local,
+                    const sockaddr_in& peer);
+
+  // Bytes have been sent to, or received from, the peer.
+  void RecordSend(int sock_num, const uint8_t* buf, size_t len);
+  void RecordRecv(int sock_num, const uint8_t* buf, size_t len);
+
+  // The connection has been half-closed by the local side or by the peer.
+  void RecordLocalShutdown(int sock_num);
+  void RecordPeerShutdown(int sock_num);
+
+  // The connection has been reset by the peer.
+  void RecordReset(int sock_num);
+
+  // The connection socket has been closed; a FIN is recorded if the local side
+  // hadn't already half-closed the connection.
+  void RecordClose(int sock_num);
+
+  // Blocks until all of the events recorded so far have been written to the
+  // file.
+  void Flush();
+
+ private:
+  enum class EventType {
+    kAccept,
+    kSend,
+    kRecv,
+    kLocalShutdown,
+    kPeerShutdown,
+    kReset,
+    kClose
+  };
+
+  struct Event {
+    Event(absl::Time time, int sock_num, EventType type)
+        : time(time), sock_num(sock_num), type(type), local(), peer() {}
+
+    absl::Time time;
+    int sock_num;
+    EventType type;
+    std::string data;
+    // Only set for kAccept.
+    sockaddr_in local;
+    sockaddr_in peer;
+  };
+
+  // The synthesized TCP state of a connection, maintained by the writer
+  // thread.
+  struct Flow {
+    sockaddr_in local;
+    sockaddr_in peer;
+    // Sequence numbers of the next byte to be sent by each side.
+    uint32_t local_seq;
+    uint32_t peer_seq;
+    bool local_fin;
+    bool peer_fin;
+  };
+
+  void Enqueue(Event event);
+  void WriterMain();
+  void WriteEvent(const Event& event);
+
+  // Writes one packet from the local side (if from_local) or from the peer,
+  // then advances that side's sequence number.
+  void WriteSegment(absl::Time time, Flow& flow, bool from_local, uint8_t flags,
+                    const char* payload, size_t len);
+
+  FILE* file_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<Event> pending_;
+  // Counts of events enqueued and written, for Flush.
+  uint64_t enqueued_{0};
+  uint64_t written_{0};
+  bool stopping_{false};
+
+  // Only used by the writer thread.
+  std::map<int, Flow> flows_;
+  uint16_t next_ip_id_{0};
+  std::vector<uint8_t> packet_;
+
+  std::thread writer_thread_;
+};
+
+}  // namespace mcunet_host
+
+#endif  // MCUNET_EXTRAS_HOST_ETHERNET5500_PCAP_WRITER_H_
@@ -1,55 +1,158 @@
 #include "extras/host/ethernet5500/host_network.h"
 
-// TODO(jamessynge): Trim down the includes after writing tests.
-#include "gmock/gmock.h"
+#include <netinet/in.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/reflection.h"
+#include "extras/host/ethernet5500/host_socket_info.h"
 #include "gtest/gtest.h"
-#include "mcucore/extras/test_tools/print_to_std_string.h"
-#include "mcucore/extras/test_tools/print_value_to_std_string.h"
-#include "mcucore/extras/test_tools/sample_printable.h"
+
+ABSL_DECLARE_FLAG(bool, emulate_w5500_buffers);
+ABSL_DECLARE_FLAG(int, host_network_num_sockets);
+ABSL_DECLARE_FLAG(int, w5500_socket_count);
 
 namespace mcunet_host {
 namespace test {
 namespace {
 
-// TODO(jamessynge): Trim down the using declarations after writing tests.
-using ::mcucore::PrintValueToStdString;
-using ::mcucore::test::PrintToStdString;
-using ::mcucore::test::SamplePrintable;
-using ::testing::AllOf;
-using ::testing::AnyNumber;
-using ::testing::AnyOf;
-using ::testing::Contains;
-using ::testing::ContainsRegex;
-using ::testing::ElementsAre;
-using ::testing::EndsWith;
-using ::testing::Eq;
-using ::testing::HasSubstr;
-using ::testing::InSequence;
-using ::testing::IsEmpty;
-using ::testing::Mock;
-using ::testing::NiceMock;
-using ::testing::Not;
-using ::testing::Ref;
-using ::testing::Return;
-using ::testing::ReturnRef;
-using ::testing::SizeIs;
-using ::testing::StartsWith;
-using ::testing::StrictMock;
-
-TEST(NoFixture_HostNetworkTest, NoFixtureTest) {
-  // TODO(jamessynge): Describe if not really obvious.
-  EXPECT_EQ(1, 1);
-}
-
-class HostNetworkTest : public testing::Test {
- protected:
-  HostNetworkTest() {}
-  void SetUp() override {}
-};
-
-TEST_F(HostNetworkTest, FixturedTest) {
-  // TODO(jamessynge): Describe if not really obvious.
-  EXPECT_EQ(1, 1);
+TEST(HostNetworkTest, DefaultNumSocketsMatchesW5500) {
+  HostNetwork host_network;
+  EXPECT_EQ(host_network.num_sockets(), 8);
+}
+
+TEST(HostNetworkTest, NumSocketsFromFlag) {
+  absl::FlagSaver flag_saver;
+  absl::SetFlag(&FLAGS_host_network_num_sockets, 3);
+  HostNetwork host_network;
+  EXPECT_EQ(host_network.num_sockets(), 3);
+}
+
+TEST(HostNetworkTest, InvalidSocketNumbers) {
+  HostNetwork host_network(4);
+  EXPECT_TRUE(host_network.SocketIsClosed(3));
+  EXPECT_FALSE(host_network.SocketIsClosed(4));
+  EXPECT_EQ(host_network.SocketStatus(4), HostSocketInfo::kStatusClosed);
+  EXPECT_EQ(host_network.AvailableBytes(4), -1);
+  EXPECT_EQ(host_network.Peek(4), -1);
+  EXPECT_FALSE(host_network.InitializeTcpListenerSocket(4, 80));
+}
+
+TEST(HostNetworkTest, ManySockets) {
+  constexpr int kNumSockets = 300;
+  HostNetwork host_network(kNumSockets);
+  EXPECT_EQ(host_network.num_sockets(), kNumSockets);
+  EXPECT_EQ(host_network.FindUnusedSocket(), 0);
+
+  const auto tcp_port = HostNetwork::FindFreeTcpPort();
+  ASSERT_GT(tcp_port, 0);
+
+  // Several sockets may listen to the same port (SO_REUSEPORT), including those
+  // whose numbers don't fit in a uint8_t.
+  for (int sock_num = 0; sock_num < kNumSockets; sock_num += 50) {
+    EXPECT_TRUE(host_network.InitializeTcpListenerSocket(sock_num, tcp_port));
+    EXPECT_EQ(host_network.SocketIsTcpListener(sock_num), tcp_port);
+    EXPECT_EQ(host_network.SocketStatus(sock_num),
+              HostSocketInfo::kStatusListening);
+  }
+  EXPECT_EQ(host_network.FindUnusedSocket(), 1);
+  EXPECT_EQ(host_network.SocketIsTcpListener(299), 0);
+
+  for (int sock_num = 0; sock_num < kNumSockets; sock_num += 50) {
+    EXPECT_TRUE(host_network.CloseSocket(sock_num));
+  }
+}
+
+// Returns the number of bytes that HostNetwork::Send writes in a single call
+// when asked to send 10000 bytes on a new connection.
+ssize_t SizeOfFirstSend(HostNetwork& host_network) {
+  const auto tcp_port = HostNetwork::FindFreeTcpPort();
+  EXPECT_GT(tcp_port, 0);
+  EXPECT_TRUE(host_network.InitializeTcpListenerSocket(1, tcp_port));
+
+  const int peer_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  EXPECT_GE(peer_fd, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(tcp_port);
+  EXPECT_EQ(
+      ::connect(peer_fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr), 0);
+  EXPECT_TRUE(host_network.AcceptConnection(1));
+
+  const std::string data(10000, 'z');
+  const auto result = host_network.Send(
+      1, reinterpret_cast<const uint8_t*>(data.data()), data.size());
+  EXPECT_TRUE(host_network.CloseSocket(1));
+  ::close(peer_fd);
+  return result;
+}
+
+TEST(HostNetworkTest, W5500BufferEmulationDisabledByDefault) {
+  HostNetwork host_network(2);
+  host_network.SetW5500SocketCount(4);
+  EXPECT_EQ(SizeOfFirstSend(host_network), 10000);
+}
+
+TEST(HostNetworkTest, W5500BufferEmulation) {
+  absl::FlagSaver flag_saver;
+  absl::SetFlag(&FLAGS_emulate_w5500_buffers, true);
+  HostNetwork host_network(2);
+  // Default is 8 sockets, hence 2KB per socket.
+  EXPECT_EQ(SizeOfFirstSend(host_network), 2048);
+  host_network.SetW5500SocketCount(4);
+  EXPECT_EQ(SizeOfFirstSend(host_network), 4096);
+}
+
+TEST(HostNetworkTest, W5500SocketCountFromFlag) {
+  absl::FlagSaver flag_saver;
+  absl::SetFlag(&FLAGS_emulate_w5500_buffers, true);
+  absl::SetFlag(&FLAGS_w5500_socket_count, 2);
+  HostNetwork host_network(2);
+  EXPECT_EQ(SizeOfFirstSend(host_network), 8192);
+}
+
+TEST(HostNetworkTest, PcapCapture) {
+  const std::string path = testing::TempDir() + "/host_network_test.pcap";
+  const std::string reply = "captured reply";
+  {
+    HostNetwork host_network(2);
+    ASSERT_TRUE(host_network.StartPcapCapture(path));
+    const auto tcp_port = HostNetwork::FindFreeTcpPort();
+    ASSERT_TRUE(host_network.InitializeTcpListenerSocket(1, tcp_port));
+
+    const int peer_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(peer_fd, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(tcp_port);
+    ASSERT_EQ(
+        ::connect(peer_fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr),
+        0);
+    ASSERT_TRUE(host_network.AcceptConnection(1));
+    EXPECT_EQ(host_network.Send(
+                  1, reinterpret_cast<const uint8_t*>(reply.data()),
+                  reply.size()),
+              reply.size());
+    EXPECT_TRUE(host_network.CloseSocket(1));
+    ::close(peer_fd);
+  }
+  // Destroying the HostNetwork finishes writing the file.
+  std::ifstream file(path, std::ios::binary);
+  const std::string contents((std::istreambuf_iterator<char>(file)),
+                             std::istreambuf_iterator<char>());
+  // File header, 3 handshake packets, 1 data packet and a FIN.
+  EXPECT_EQ(contents.size(), 24 + 5 * (16 + 40) + reply.size());
+  EXPECT_NE(contents.find(reply), std::string::npos);
 }
 
 }  // namespace
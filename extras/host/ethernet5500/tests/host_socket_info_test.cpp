@@ -1,57 +1,289 @@
 #include "extras/host/ethernet5500/host_socket_info.h"
 
-// TODO(jamessynge): Write tests of HostSocketInfo.
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
-// TODO(jamessynge): Trim down the includes after writing tests.
-#include "gmock/gmock.h"
+#include <string>
+#include <string_view>
+
+#include "absl/flags/declare.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/reflection.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "gtest/gtest.h"
-#include "mcucore/extras/test_tools/print_to_std_string.h"
-#include "mcucore/extras/test_tools/print_value_to_std_string.h"
-#include "mcucore/extras/test_tools/sample_printable.h"
+
+ABSL_DECLARE_FLAG(int, host_socket_receive_cache_size);
 
 namespace mcunet_host {
 namespace test {
 namespace {
 
-// TODO(jamessynge): Trim down the using declarations after writing tests.
-using ::mcucore::PrintValueToStdString;
-using ::mcucore::test::PrintToStdString;
-using ::mcucore::test::SamplePrintable;
-using ::testing::AllOf;
-using ::testing::AnyNumber;
-using ::testing::AnyOf;
-using ::testing::Contains;
-using ::testing::ContainsRegex;
-using ::testing::ElementsAre;
-using ::testing::EndsWith;
-using ::testing::Eq;
-using ::testing::HasSubstr;
-using ::testing::InSequence;
-using ::testing::IsEmpty;
-using ::testing::Mock;
-using ::testing::NiceMock;
-using ::testing::Not;
-using ::testing::Ref;
-using ::testing::Return;
-using ::testing::ReturnRef;
-using ::testing::SizeIs;
-using ::testing::StartsWith;
-using ::testing::StrictMock;
-
-TEST(NoFixture_HostSocketInfoTest, NoFixtureTest) {
-  // TODO(jamessynge): Describe if not really obvious.
-  EXPECT_EQ(1, 1);
+// Returns a TCP port that is free at the time of the call.
+uint16_t FindFreeTcpPort() {
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  EXPECT_GE(fd, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  EXPECT_EQ(::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr), 0);
+  socklen_t len = sizeof addr;
+  EXPECT_EQ(::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+  ::close(fd);
+  return ntohs(addr.sin_port);
 }
 
 class HostSocketInfoTest : public testing::Test {
  protected:
-  HostSocketInfoTest() {}
-  void SetUp() override {}
+  ~HostSocketInfoTest() override {
+    if (peer_fd_ >= 0) {
+      ::close(peer_fd_);
+    }
+  }
+
+  // Starts listening with info, connects to it from peer_fd_, and accepts the
+  // connection.
+  void Connect(HostSocketInfo& info) {
+    const uint16_t port = FindFreeTcpPort();
+    ASSERT_TRUE(info.InitializeTcpListener(port));
+    EXPECT_EQ(info.SocketStatus(), HostSocketInfo::kStatusListening);
+
+    peer_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(peer_fd_, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    ASSERT_EQ(
+        ::connect(peer_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof addr),
+        0);
+    ASSERT_TRUE(info.AcceptConnection());
+    EXPECT_TRUE(info.IsConnected());
+  }
+
+  void PeerSend(std::string_view data) {
+    ASSERT_EQ(::send(peer_fd_, data.data(), data.size(), 0),
+              static_cast<ssize_t>(data.size()));
+  }
+
+  // Waits (briefly) until info reports that at least `size` bytes are
+  // available for reading.
+  void WaitForAvailableBytes(HostSocketInfo& info, ssize_t size) {
+    const auto deadline = absl::Now() + absl::Seconds(5);
+    while (info.AvailableBytes() < size && absl::Now() < deadline) {
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+    ASSERT_GE(info.AvailableBytes(), size);
+  }
+
+  std::string Recv(HostSocketInfo& info, size_t len) {
+    std::string result(len, '\0');
+    const auto size =
+        info.Recv(reinterpret_cast<uint8_t*>(result.data()), result.size());
+    result.resize(size < 0 ? 0 : size);
+    return result;
+  }
+
+  int peer_fd_{-1};
 };
 
-TEST_F(HostSocketInfoTest, FixturedTest) {
-  // TODO(jamessynge): Describe if not really obvious.
-  EXPECT_EQ(1, 1);
+TEST_F(HostSocketInfoTest, NewInstanceIsUnused) {
+  HostSocketInfo info(1);
+  EXPECT_TRUE(info.IsUnused());
+  EXPECT_TRUE(info.IsClosed());
+  EXPECT_EQ(info.SocketStatus(), HostSocketInfo::kStatusClosed);
+  EXPECT_EQ(info.AvailableBytes(), -1);
+  EXPECT_EQ(info.Peek(), -1);
+}
+
+TEST_F(HostSocketInfoTest, RemoteAddressAndPort) {
+  HostSocketInfo info(1);
+  EXPECT_EQ(info.RemoteAddress(), 0);
+  EXPECT_EQ(info.RemotePort(), 0);
+  Connect(info);
+
+  sockaddr_in peer_addr{};
+  socklen_t len = sizeof peer_addr;
+  ASSERT_EQ(::getsockname(peer_fd_, reinterpret_cast<sockaddr*>(&peer_addr),
+                          &len),
+            0);
+  EXPECT_EQ(info.RemoteAddress(), INADDR_LOOPBACK);
+  EXPECT_EQ(info.RemotePort(), ntohs(peer_addr.sin_port));
+
+  info.CloseConnectionSocket();
+  EXPECT_EQ(info.RemoteAddress(), 0);
+  EXPECT_EQ(info.RemotePort(), 0);
+}
+
+TEST_F(HostSocketInfoTest, SmallReadsAreServedFromCache) {
+  HostSocketInfo info(1);
+  Connect(info);
+  EXPECT_EQ(info.AvailableBytes(), 0);
+  EXPECT_EQ(info.Peek(), -1);
+
+  PeerSend("Hello, world!");
+  WaitForAvailableBytes(info, 13);
+  EXPECT_EQ(info.receive_cache_size(), 0);
+
+  // Peek doesn't consume the byte, but does fill the cache.
+  EXPECT_EQ(info.Peek(), 'H');
+  EXPECT_EQ(info.Peek(), 'H');
+  EXPECT_EQ(info.receive_cache_size(), 13);
+  EXPECT_EQ(info.AvailableBytes(), 13);
+  EXPECT_EQ(info.SocketStatus(), HostSocketInfo::kStatusEstablished);
+
+  EXPECT_EQ(Recv(info, 5), "Hello");
+  EXPECT_EQ(info.receive_cache_size(), 8);
+  EXPECT_EQ(info.AvailableBytes(), 8);
+  EXPECT_EQ(info.Peek(), ',');
+
+  // Only the cached bytes are returned.
+  PeerSend("!!");
+  WaitForAvailableBytes(info, 10);
+  EXPECT_EQ(Recv(info, 100), ", world!");
+  EXPECT_EQ(info.receive_cache_size(), 0);
+  EXPECT_EQ(Recv(info, 100), "!!");
+}
+
+TEST_F(HostSocketInfoTest, LargeReadsBypassCache) {
+  HostSocketInfo info(1);
+  Connect(info);
+
+  const size_t size = absl::GetFlag(FLAGS_host_socket_receive_cache_size) * 2;
+  const std::string data(size, 'x');
+  PeerSend(data);
+  WaitForAvailableBytes(info, size);
+
+  EXPECT_EQ(Recv(info, size), data);
+  EXPECT_EQ(info.receive_cache_size(), 0);
+  EXPECT_EQ(info.AvailableBytes(), 0);
+}
+
+TEST_F(HostSocketInfoTest, CacheDisabled) {
+  absl::FlagSaver flag_saver;
+  absl::SetFlag(&FLAGS_host_socket_receive_cache_size, 0);
+  HostSocketInfo info(1);
+  Connect(info);
+
+  PeerSend("abc");
+  WaitForAvailableBytes(info, 3);
+  EXPECT_EQ(info.Peek(), 'a');
+  EXPECT_EQ(info.receive_cache_size(), 0);
+  EXPECT_EQ(Recv(info, 1), "a");
+  EXPECT_EQ(info.AvailableBytes(), 2);
+  EXPECT_EQ(Recv(info, 10), "bc");
+}
+
+TEST_F(HostSocketInfoTest, DetectsHalfClose) {
+  HostSocketInfo info(1);
+  Connect(info);
+
+  PeerSend("bye");
+  ASSERT_EQ(::shutdown(peer_fd_, SHUT_WR), 0);
+  WaitForAvailableBytes(info, 3);
+  EXPECT_EQ(info.Peek(), 'b');
+
+  // Not half-closed from our perspective until we've read the cached data.
+  EXPECT_EQ(info.SocketStatus(), HostSocketInfo::kStatusEstablished);
+  EXPECT_EQ(Recv(info, 3), "bye");
+  EXPECT_EQ(info.SocketStatus(), HostSocketInfo::kStatusCloseWait);
+  EXPECT_EQ(info.Recv(nullptr, 0), -1);
+
+  info.CloseConnectionSocket();
+  EXPECT_TRUE(info.IsClosed());
+}
+
+TEST_F(HostSocketInfoTest, IdleConnectionIsEstablished) {
+  HostSocketInfo info(1);
+  Connect(info);
+  EXPECT_EQ(info.SocketStatus(), HostSocketInfo::kStatusEstablished);
+}
+
+TEST_F(HostSocketInfoTest, ClosedOnceBothSidesHaveClosed) {
+  HostSocketInfo info(1);
+  Connect(info);
+
+  ASSERT_TRUE(info.DisconnectConnectionSocket());
+  EXPECT_EQ(info.SocketStatus(), HostSocketInfo::kStatusEstablished);
+
+  // The peer reads EOF, then closes its side.
+  char c;
+  EXPECT_EQ(::recv(peer_fd_, &c, 1, 0), 0);
+  ASSERT_EQ(::shutdown(peer_fd_, SHUT_WR), 0);
+  const auto deadline = absl::Now() + absl::Seconds(5);
+  while (info.IsConnected() && absl::Now() < deadline) {
+    EXPECT_NE(info.SocketStatus(), HostSocketInfo::kStatusCloseWait);
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_TRUE(info.IsClosed());
+  EXPECT_EQ(info.SocketStatus(), HostSocketInfo::kStatusClosed);
+}
+
+TEST_F(HostSocketInfoTest, EmulatedTxCapacityLimitsSend) {
+  HostSocketInfo info(1);
+  info.SetBufferCapacities(100, 0);
+  Connect(info);
+  EXPECT_EQ(info.TxFreeBytes(), 100);
+
+  const std::string data(300, 'x');
+  const auto sent =
+      info.Send(reinterpret_cast<const uint8_t*>(data.data()), data.size());
+  EXPECT_GT(sent, 0);
+  EXPECT_LE(sent, 100);
+  EXPECT_LE(info.TxFreeBytes(), 100);
+}
+
+TEST_F(HostSocketInfoTest, TrySendDoesNotWait) {
+  HostSocketInfo info(1);
+  info.SetBufferCapacities(100, 0);
+  EXPECT_EQ(info.TrySend(nullptr, 0), -1);
+  Connect(info);
+
+  const std::string data(300, 'x');
+  const auto* const buf = reinterpret_cast<const uint8_t*>(data.data());
+  const auto free_bytes = info.TxFreeBytes();
+  ASSERT_GT(free_bytes, 0);
+  EXPECT_EQ(info.TrySend(buf, data.size()), free_bytes);
+
+  // The peer isn't reading, so the buffer will (eventually) fill up, at which
+  // point TrySend returns zero rather than waiting.
+  info.SetBufferCapacities(0, 0);
+  ssize_t sent;
+  do {
+    sent = info.TrySend(buf, data.size());
+  } while (sent > 0);
+  EXPECT_EQ(sent, 0);
+}
+
+TEST_F(HostSocketInfoTest, EmulatedRxCapacityLimitsAvailableAndRecv) {
+  HostSocketInfo info(1);
+  info.SetBufferCapacities(0, 200);
+  Connect(info);
+
+  PeerSend(std::string(500, 'y'));
+  WaitForAvailableBytes(info, 200);
+  EXPECT_EQ(info.AvailableBytes(), 200);
+  EXPECT_EQ(Recv(info, 500), std::string(200, 'y'));
+}
+
+TEST_F(HostSocketInfoTest, EmulatedRxCapacityBypassesReceiveCache) {
+  HostSocketInfo info(1);
+  info.SetBufferCapacities(0, 200);
+  Connect(info);
+
+  PeerSend("Hello");
+  WaitForAvailableBytes(info, 5);
+  // Small reads leave the bytes in the kernel's (limited) buffer.
+  EXPECT_EQ(info.Peek(), 'H');
+  EXPECT_EQ(info.receive_cache_size(), 0);
+  EXPECT_EQ(Recv(info, 2), "He");
+  EXPECT_EQ(info.receive_cache_size(), 0);
+  EXPECT_EQ(info.AvailableBytes(), 3);
+  EXPECT_EQ(Recv(info, 100), "llo");
 }
 
 }  // namespace
@@ -0,0 +1,217 @@
+#include "extras/host/ethernet5500/pcap_writer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace mcunet_host {
+namespace test {
+namespace {
+
+constexpr uint8_t kFin = 0x01;
+constexpr uint8_t kSyn = 0x02;
+constexpr uint8_t kRst = 0x04;
+constexpr uint8_t kPsh = 0x08;
+constexpr uint8_t kAck = 0x10;
+
+uint16_t GetBE16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+uint32_t GetBE32(const uint8_t* p) {
+  return (static_cast<uint32_t>(GetBE16(p)) << 16) | GetBE16(p + 2);
+}
+
+// Returns the sum of the 16-bit words, folded; the Internet checksum of data
+// including a valid checksum field sums to 0xFFFF.
+uint16_t FoldedSum(const uint8_t* p, size_t len, uint32_t sum = 0) {
+  for (; len > 1; p += 2, len -= 2) {
+    sum += GetBE16(p);
+  }
+  if (len > 0) {
+    sum += p[0] << 8;
+  }
+  while (sum >> 16) {
+    sum = (sum & 0xFFFF) + (sum >> 16);
+  }
+  return sum;
+}
+
+struct Segment {
+  uint32_t src_addr;
+  uint16_t src_port;
+  uint32_t dst_addr;
+  uint16_t dst_port;
+  uint32_t seq;
+  uint32_t ack;
+  uint8_t flags;
+  std::string payload;
+};
+
+// Parses the pcap file, checking the headers and checksums along the way.
+std::vector<Segment> ReadSegments(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  const std::string contents((std::istreambuf_iterator<char>(file)),
+                             std::istreambuf_iterator<char>());
+  std::vector<Segment> segments;
+  EXPECT_GE(contents.size(), 24);
+  if (contents.size() < 24) {
+    return segments;
+  }
+  const auto* data = reinterpret_cast<const uint8_t*>(contents.data());
+  uint32_t magic, link_type;
+  std::memcpy(&magic, data, 4);
+  std::memcpy(&link_type, data + 20, 4);
+  EXPECT_EQ(magic, 0xA1B23C4D);
+  EXPECT_EQ(link_type, 101);
+
+  size_t offset = 24;
+  while (offset < contents.size()) {
+    uint32_t record_header[4];
+    EXPECT_LE(offset + sizeof record_header, contents.size());
+    std::memcpy(record_header, data + offset, sizeof record_header);
+    offset += sizeof record_header;
+    EXPECT_LT(record_header[1], 1000000000);
+    const size_t len = record_header[2];
+    EXPECT_EQ(record_header[3], len);
+    EXPECT_LE(offset + len, contents.size());
+    const uint8_t* ip = data + offset;
+    offset += len;
+
+    EXPECT_EQ(ip[0], 0x45);
+    EXPECT_EQ(GetBE16(ip + 2), len);
+    EXPECT_EQ(ip[9], 6);
+    EXPECT_EQ(FoldedSum(ip, 20), 0xFFFF);
+    const uint8_t* tcp = ip + 20;
+    uint8_t pseudo_header[12] = {0};
+    std::memcpy(pseudo_header, ip + 12, 8);
+    pseudo_header[9] = 6;
+    pseudo_header[10] = (len - 20) >> 8;
+    pseudo_header[11] = (len - 20);
+    EXPECT_EQ(FoldedSum(tcp, len - 20,
+                        FoldedSum(pseudo_header, sizeof pseudo_header)),
+              0xFFFF);
+
+    Segment segment;
+    segment.src_addr = GetBE32(ip + 12);
+    segment.dst_addr = GetBE32(ip + 16);
+    segment.src_port = GetBE16(tcp);
+    segment.dst_port = GetBE16(tcp + 2);
+    segment.seq = GetBE32(tcp + 4);
+    segment.ack = GetBE32(tcp + 8);
+    segment.flags = tcp[13];
+    segment.payload.assign(reinterpret_cast<const char*>(tcp + 20), len - 40);
+    segments.push_back(segment);
+  }
+  return segments;
+}
+
+sockaddr_in MakeAddr(uint32_t addr, uint16_t port) {
+  sockaddr_in result{};
+  result.sin_family = AF_INET;
+  result.sin_addr.s_addr = htonl(addr);
+  result.sin_port = htons(port);
+  return result;
+}
+
+class PcapWriterTest : public testing::Test {
+ protected:
+  std::string path_ = testing::TempDir() + "/pcap_writer_test.pcap";
+  const sockaddr_in local_ = MakeAddr(0x7F000001, 80);
+  const sockaddr_in peer_ = MakeAddr(0x7F000002, 40000);
+};
+
+TEST_F(PcapWriterTest, SynthesizesTcpConversation) {
+  PcapWriter writer(path_);
+  ASSERT_TRUE(writer.ok());
+  writer.RecordAccept(3, local_, peer_);
+  writer.RecordRecv(3, reinterpret_cast<const uint8_t*>("GET"), 3);
+  writer.RecordSend(3, reinterpret_cast<const uint8_t*>("OK!!"), 4);
+  writer.RecordPeerShutdown(3);
+  writer.RecordClose(3);
+  // Events for unknown sockets are ignored.
+  writer.RecordSend(4, reinterpret_cast<const uint8_t*>("x"), 1);
+  writer.Flush();
+
+  const auto segments = ReadSegments(path_);
+  ASSERT_EQ(segments.size(), 7);
+  EXPECT_EQ(segments[0].flags, kSyn);
+  EXPECT_EQ(segments[0].src_addr, 0x7F000002);
+  EXPECT_EQ(segments[0].src_port, 40000);
+  EXPECT_EQ(segments[0].dst_addr, 0x7F000001);
+  EXPECT_EQ(segments[0].dst_port, 80);
+  EXPECT_EQ(segments[1].flags, kSyn | kAck);
+  EXPECT_EQ(segments[1].src_port, 80);
+  EXPECT_EQ(segments[1].ack, segments[0].seq + 1);
+  EXPECT_EQ(segments[2].flags, kAck);
+  EXPECT_EQ(segments[2].ack, segments[1].seq + 1);
+
+  const uint32_t peer_seq = segments[0].seq + 1;
+  const uint32_t local_seq = segments[1].seq + 1;
+  EXPECT_EQ(segments[3].flags, kPsh | kAck);
+  EXPECT_EQ(segments[3].src_port, 40000);
+  EXPECT_EQ(segments[3].payload, "GET");
+  EXPECT_EQ(segments[3].seq, peer_seq);
+  EXPECT_EQ(segments[3].ack, local_seq);
+
+  EXPECT_EQ(segments[4].src_port, 80);
+  EXPECT_EQ(segments[4].payload, "OK!!");
+  EXPECT_EQ(segments[4].seq, local_seq);
+  EXPECT_EQ(segments[4].ack, peer_seq + 3);
+
+  EXPECT_EQ(segments[5].flags, kFin | kAck);
+  EXPECT_EQ(segments[5].src_port, 40000);
+  EXPECT_EQ(segments[5].seq, peer_seq + 3);
+  EXPECT_EQ(segments[6].flags, kFin | kAck);
+  EXPECT_EQ(segments[6].src_port, 80);
+  EXPECT_EQ(segments[6].seq, local_seq + 4);
+  EXPECT_EQ(segments[6].ack, peer_seq + 4);
+}
+
+TEST_F(PcapWriterTest, SplitsLargeWritesIntoSegments) {
+  PcapWriter writer(path_);
+  writer.RecordAccept(0, local_, peer_);
+  const std::string data(4000, 'd');
+  writer.RecordSend(0, reinterpret_cast<const uint8_t*>(data.data()),
+                    data.size());
+  writer.Flush();
+
+  const auto segments = ReadSegments(path_);
+  ASSERT_EQ(segments.size(), 6);
+  EXPECT_EQ(segments[3].payload.size(), 1460);
+  EXPECT_EQ(segments[3].flags, kAck);
+  EXPECT_EQ(segments[4].payload.size(), 1460);
+  EXPECT_EQ(segments[4].seq, segments[3].seq + 1460);
+  EXPECT_EQ(segments[5].payload.size(), 1080);
+  EXPECT_EQ(segments[5].flags, kPsh | kAck);
+}
+
+TEST_F(PcapWriterTest, ResetEndsTheFlow) {
+  PcapWriter writer(path_);
+  writer.RecordAccept(0, local_, peer_);
+  writer.RecordReset(0);
+  writer.RecordClose(0);
+  writer.Flush();
+
+  const auto segments = ReadSegments(path_);
+  ASSERT_EQ(segments.size(), 4);
+  EXPECT_EQ(segments[3].flags, kRst | kAck);
+  EXPECT_EQ(segments[3].src_port, 40000);
+}
+
+TEST_F(PcapWriterTest, UnableToOpenFile) {
+  PcapWriter writer(testing::TempDir() + "/no/such/dir/file.pcap");
+  EXPECT_FALSE(writer.ok());
+  writer.RecordAccept(0, local_, peer_);
+  writer.Flush();
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet_host
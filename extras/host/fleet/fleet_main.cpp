@@ -0,0 +1,94 @@
+// Runs a fleet of simulated boards, each with a TCP echo server listening on
+// --fleet_tcp_port, then reports the CPU cost per simulated loop iteration.
+// By default each board listens on its own loopback address (127.1.x.y), so a
+// load generator can address each board separately.
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "absl/flags/flag.h"
+#include "absl/log/log.h"
+#include "absl/time/time.h"
+#include "base/init_google.h"
+#include "extras/host/fleet/fleet_runner.h"
+#include "extras/host/fleet/simulated_board.h"
+#include "server_socket.h"
+#include "socket_listener.h"
+
+ABSL_FLAG(int, fleet_num_boards, 500, "Number of boards to simulate.");
+ABSL_FLAG(int, fleet_num_threads, 0,
+          "Number of worker threads; zero means one per CPU.");
+ABSL_FLAG(int, fleet_loops_per_slice, 10,
+          "Number of calls to a board's loop each time it is scheduled.");
+ABSL_FLAG(absl::Duration, fleet_run_duration, absl::Seconds(10),
+          "How long to run the fleet for.");
+ABSL_FLAG(uint16_t, fleet_tcp_port, 8080,
+          "TCP port on which each board's echo server listens.");
+ABSL_FLAG(bool, fleet_distinct_listen_addresses, true,
+          "Whether each board should listen on its own loopback address.");
+
+namespace mcunet_host {
+namespace {
+
+class EchoListener : public ::mcunet::ServerSocketListener {
+ public:
+  void OnConnect(::mcunet::Connection& connection) override {}
+  void OnCanRead(::mcunet::Connection& connection) override {
+    uint8_t buffer[128];
+    int size = connection.read(buffer, sizeof(buffer));
+    if (size > 0) {
+      connection.write(buffer, size);
+    }
+  }
+  void OnDisconnect() override {}
+};
+
+class EchoBoard : public SimulatedBoard {
+ public:
+  explicit EchoBoard(uint16_t tcp_port) : echo_socket_(tcp_port, listener_) {}
+
+  void Setup(BoardContext& context) override {
+    if (!echo_socket_.PickClosedSocket()) {
+      LOG(ERROR) << "Board " << context.board_index()
+                 << " unable to pick a socket";
+    }
+  }
+
+  void Loop(BoardContext& context) override { echo_socket_.PerformIO(); }
+
+ private:
+  EchoListener listener_;
+  ::mcunet::ServerSocket echo_socket_;
+};
+
+}  // namespace
+}  // namespace mcunet_host
+
+int main(int argc, char* argv[]) {
+  InitGoogle(argv[0], &argc, &argv, /*remove_flags=*/true);
+
+  mcunet_host::FleetOptions options;
+  options.num_boards = absl::GetFlag(FLAGS_fleet_num_boards);
+  options.num_threads = absl::GetFlag(FLAGS_fleet_num_threads);
+  options.loops_per_slice = absl::GetFlag(FLAGS_fleet_loops_per_slice);
+  options.run_duration = absl::GetFlag(FLAGS_fleet_run_duration);
+  options.distinct_listen_addresses =
+      absl::GetFlag(FLAGS_fleet_distinct_listen_addresses);
+  const uint16_t tcp_port = absl::GetFlag(FLAGS_fleet_tcp_port);
+
+  mcunet_host::FleetRunner runner(options, [tcp_port](int board_index) {
+    return std::make_unique<mcunet_host::EchoBoard>(tcp_port);
+  });
+  const auto stats = runner.Run();
+
+  LOG(INFO) << "Boards: " << runner.num_boards();
+  LOG(INFO) << "Loops: " << stats.total_loops << " in " << stats.wall_time;
+  LOG(INFO) << "Loop CPU time: " << stats.loop_cpu_time
+            << ", per loop: " << stats.CpuTimePerLoop()
+            << ", max: " << stats.max_loop_cpu_time;
+  LOG(INFO) << "Setup CPU time: " << stats.setup_cpu_time;
+  LOG(INFO) << "Process CPU time: " << stats.process_cpu_time;
+  LOG(INFO) << "Slices: " << stats.slices << ", stolen: " << stats.steals;
+  return 0;
+}
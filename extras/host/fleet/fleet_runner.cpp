@@ -0,0 +1,236 @@
+#include "extras/host/fleet/fleet_runner.h"
+
+#include <netinet/in.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/log/log.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "extras/host/ethernet5500/host_network.h"
+#include "extras/host/fleet/simulated_board.h"
+#include "mcucore/extras/host/eeprom/eeprom.h"
+#include "platform_network_interface.h"
+
+namespace mcunet_host {
+namespace {
+
+// Base of the loopback addresses used when distinct_listen_addresses is true.
+constexpr uint32_t kListenAddressBase = 0x7F010000;  // 127.1.0.0
+
+absl::Duration CpuTime(clockid_t clock_id) {
+  timespec ts;
+  CHECK_EQ(clock_gettime(clock_id, &ts), 0);
+  return absl::DurationFromTimespec(ts);
+}
+
+absl::Duration ThreadCpuTime() { return CpuTime(CLOCK_THREAD_CPUTIME_ID); }
+
+void MergeStats(const FleetStats& from, FleetStats& to) {
+  to.total_loops += from.total_loops;
+  to.loop_cpu_time += from.loop_cpu_time;
+  to.max_loop_cpu_time = std::max(to.max_loop_cpu_time, from.max_loop_cpu_time);
+  to.setup_cpu_time += from.setup_cpu_time;
+  to.slices += from.slices;
+  to.steals += from.steals;
+}
+
+}  // namespace
+
+struct FleetRunner::Board {
+  Board(int board_index, std::unique_ptr<SimulatedBoard> sketch)
+      : network(std::make_unique<HostNetwork>()),
+        eeprom(std::make_unique<EEPROMClass>()),
+        context(board_index, *network, *eeprom),
+        sketch(std::move(sketch)) {}
+
+  std::unique_ptr<HostNetwork> network;
+  std::unique_ptr<EEPROMClass> eeprom;
+  BoardContext context;
+  std::unique_ptr<SimulatedBoard> sketch;
+  bool setup_done{false};
+  int64_t loops{0};
+};
+
+namespace {
+
+// The queue of boards owned by one worker thread. The owner takes boards from
+// the front and returns them to the back; thieves take from the back, which is
+// the board least likely to be needed soon by the owner.
+template <typename T>
+class WorkQueue {
+ public:
+  void PushBack(T* item) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    items_.push_back(item);
+  }
+
+  T* PopFront() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (items_.empty()) {
+      return nullptr;
+    }
+    T* item = items_.front();
+    items_.pop_front();
+    return item;
+  }
+
+  T* StealBack() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (items_.empty()) {
+      return nullptr;
+    }
+    T* item = items_.back();
+    items_.pop_back();
+    return item;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::deque<T*> items_;
+};
+
+}  // namespace
+
+FleetRunner::FleetRunner(const FleetOptions& options,
+                         const BoardFactory& factory)
+    : options_(options) {
+  CHECK_GT(options_.num_boards, 0);
+  CHECK_GT(options_.loops_per_slice, 0);
+  CHECK(options_.loops_per_board > 0 ||
+        options_.run_duration > absl::ZeroDuration())
+      << "Either loops_per_board or run_duration must be specified";
+  for (int board_index = 0; board_index < options_.num_boards; ++board_index) {
+    auto sketch = factory(board_index);
+    CHECK(sketch != nullptr) << "No board created for index " << board_index;
+    boards_.push_back(std::make_unique<Board>(board_index, std::move(sketch)));
+    boards_.back()->network->SetListenAddress(listen_address(board_index));
+  }
+}
+
+FleetRunner::~FleetRunner() = default;
+
+int FleetRunner::num_boards() const { return boards_.size(); }
+
+uint32_t FleetRunner::listen_address(int board_index) const {
+  CHECK_GE(board_index, 0);
+  CHECK_LT(board_index, options_.num_boards);
+  if (!options_.distinct_listen_addresses) {
+    return INADDR_ANY;
+  }
+  // All of 127.0.0.0/8 is loopback, so there is no need to avoid host parts
+  // ending in .0 or .255.
+  CHECK_LT(board_index, 0xFFFF);
+  return kListenAddressBase + board_index + 1;
+}
+
+HostNetwork& FleetRunner::network(int board_index) {
+  CHECK_GE(board_index, 0);
+  CHECK_LT(board_index, num_boards());
+  return *boards_[board_index]->network;
+}
+
+FleetStats FleetRunner::Run() {
+  CHECK(!has_run_) << "FleetRunner::Run may only be called once";
+  has_run_ = true;
+
+  int num_threads = options_.num_threads;
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = std::min(num_threads, num_boards());
+
+  // Deal the boards out round-robin to the workers' queues.
+  std::vector<WorkQueue<Board>> queues(num_threads);
+  for (int board_index = 0; board_index < num_boards(); ++board_index) {
+    queues[board_index % num_threads].PushBack(boards_[board_index].get());
+  }
+  std::atomic<int> remaining_boards(num_boards());
+  std::vector<FleetStats> worker_stats(num_threads);
+
+  const auto start_time = absl::Now();
+  const auto start_cpu = CpuTime(CLOCK_PROCESS_CPUTIME_ID);
+  if (options_.run_duration > absl::ZeroDuration()) {
+    deadline_ = start_time + options_.run_duration;
+  } else {
+    deadline_ = absl::InfiniteFuture();
+  }
+
+  auto worker_fn = [&](const int worker_index) {
+    auto& own_queue = queues[worker_index];
+    auto& stats = worker_stats[worker_index];
+    while (remaining_boards.load() > 0) {
+      Board* board = own_queue.PopFront();
+      for (int offset = 1; board == nullptr && offset < num_threads;
+           ++offset) {
+        board = queues[(worker_index + offset) % num_threads].StealBack();
+        if (board != nullptr) {
+          ++stats.steals;
+        }
+      }
+      if (board == nullptr) {
+        // All of the remaining boards are being run by other workers.
+        std::this_thread::yield();
+        continue;
+      }
+      if (RunSlice(*board, stats)) {
+        own_queue.PushBack(board);
+      } else {
+        remaining_boards.fetch_sub(1);
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int worker_index = 0; worker_index < num_threads; ++worker_index) {
+    threads.emplace_back(worker_fn, worker_index);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  FleetStats result;
+  for (const auto& stats : worker_stats) {
+    MergeStats(stats, result);
+  }
+  result.wall_time = absl::Now() - start_time;
+  result.process_cpu_time = CpuTime(CLOCK_PROCESS_CPUTIME_ID) - start_cpu;
+  return result;
+}
+
+bool FleetRunner::RunSlice(Board& board, FleetStats& stats) {
+  ::mcunet::PlatformNetworkThreadBinding binding(board.network.get());
+  ++stats.slices;
+  if (!board.setup_done) {
+    const auto before = ThreadCpuTime();
+    board.sketch->Setup(board.context);
+    stats.setup_cpu_time += ThreadCpuTime() - before;
+    board.setup_done = true;
+  }
+  for (int n = 0; n < options_.loops_per_slice; ++n) {
+    const auto before = ThreadCpuTime();
+    board.sketch->Loop(board.context);
+    const auto elapsed = ThreadCpuTime() - before;
+    stats.loop_cpu_time += elapsed;
+    stats.max_loop_cpu_time = std::max(stats.max_loop_cpu_time, elapsed);
+    ++stats.total_loops;
+    ++board.loops;
+    if (options_.loops_per_board > 0 &&
+        board.loops >= options_.loops_per_board) {
+      return false;
+    }
+  }
+  return absl::Now() < deadline_;
+}
+
+}  // namespace mcunet_host
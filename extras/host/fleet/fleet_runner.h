@@ -0,0 +1,109 @@
+#ifndef MCUNET_EXTRAS_HOST_FLEET_FLEET_RUNNER_H_
+#define MCUNET_EXTRAS_HOST_FLEET_FLEET_RUNNER_H_
+
+// FleetRunner runs many SimulatedBoards concurrently on a small pool of
+// threads, for load testing the servers which the real devices talk to.
+//
+// Boards are scheduled cooperatively: a worker thread runs a slice of a board
+// (several calls to Loop), then moves on to the next board in its queue. Each
+// worker has its own queue of boards; when a worker's queue is empty, it
+// steals a board from the back of another worker's queue.
+//
+// The CPU time of each call to Loop is measured, allowing the aggregate cost
+// per simulated loop iteration to be reported.
+//
+// Author: james.synge@gmail.com
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "extras/host/ethernet5500/host_network.h"
+#include "extras/host/fleet/simulated_board.h"
+
+namespace mcunet_host {
+
+struct FleetOptions {
+  // Number of boards to simulate.
+  int num_boards = 1;
+
+  // Number of worker threads; if zero, std::thread::hardware_concurrency().
+  int num_threads = 0;
+
+  // Number of calls to Loop made each time a board is scheduled.
+  int loops_per_slice = 10;
+
+  // The run ends when each board has made this many calls to Loop, or
+  // run_duration has elapsed, whichever comes first. At least one of them must
+  // be set (i.e. positive).
+  int64_t loops_per_board = 0;
+  absl::Duration run_duration = absl::ZeroDuration();
+
+  // If true, board N listens on the loopback address 127.1.x.y, where x.y is
+  // N+1, so that all of the boards can listen to the same TCP port, yet be
+  // individually addressed. Otherwise boards listen on INADDR_ANY.
+  bool distinct_listen_addresses = true;
+};
+
+struct FleetStats {
+  int64_t total_loops = 0;
+
+  // Sum of the thread CPU time spent in calls to Loop.
+  absl::Duration loop_cpu_time;
+
+  // The most CPU time spent in a single call to Loop.
+  absl::Duration max_loop_cpu_time;
+
+  // Sum of the thread CPU time spent in calls to Setup.
+  absl::Duration setup_cpu_time;
+
+  // CPU time of the process during Run, including scheduling overhead.
+  absl::Duration process_cpu_time;
+
+  absl::Duration wall_time;
+
+  // Number of times a slice was run, and how many of those were of a board
+  // stolen from another worker's queue.
+  int64_t slices = 0;
+  int64_t steals = 0;
+
+  absl::Duration CpuTimePerLoop() const {
+    return total_loops > 0 ? loop_cpu_time / total_loops
+                           : absl::ZeroDuration();
+  }
+};
+
+class FleetRunner {
+ public:
+  FleetRunner(const FleetOptions& options, const BoardFactory& factory);
+  ~FleetRunner();
+
+  // Runs the boards until the end condition specified by the options is met.
+  // May only be called once.
+  FleetStats Run();
+
+  int num_boards() const;
+
+  // Returns the IPv4 address (in host byte order) on which the board listens,
+  // or INADDR_ANY if FleetOptions::distinct_listen_addresses is false.
+  uint32_t listen_address(int board_index) const;
+
+  HostNetwork& network(int board_index);
+
+ private:
+  struct Board;
+
+  // Runs one slice of the board; returns true if the board has more to do.
+  bool RunSlice(Board& board, FleetStats& stats);
+
+  const FleetOptions options_;
+  absl::Time deadline_;
+  std::vector<std::unique_ptr<Board>> boards_;
+  bool has_run_{false};
+};
+
+}  // namespace mcunet_host
+
+#endif  // MCUNET_EXTRAS_HOST_FLEET_FLEET_RUNNER_H_
@@ -0,0 +1,78 @@
+#ifndef MCUNET_EXTRAS_HOST_FLEET_SIMULATED_BOARD_H_
+#define MCUNET_EXTRAS_HOST_FLEET_SIMULATED_BOARD_H_
+
+// SimulatedBoard is the host equivalent of the setup() and loop() functions of
+// a sketch, but as an object so that FleetRunner can run many instances of it
+// in one process. Each instance is given a BoardContext with its own network
+// stack (HostNetwork), EEPROM and clock.
+//
+// Note that sketches which keep their state in global variables can't be
+// instanced in this way; the state needs to be moved into the SimulatedBoard
+// subclass.
+//
+// Author: james.synge@gmail.com
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "extras/host/ethernet5500/host_network.h"
+#include "mcucore/extras/host/eeprom/eeprom.h"
+
+namespace mcunet_host {
+
+class BoardContext {
+ public:
+  BoardContext(int board_index, HostNetwork& network, EEPROMClass& eeprom)
+      : board_index_(board_index),
+        network_(network),
+        eeprom_(eeprom),
+        start_time_(absl::Now()) {}
+
+  // Index of the board in the fleet, in the range [0, num_boards).
+  int board_index() const { return board_index_; }
+
+  // The network implementation used by this board. FleetRunner binds it to
+  // the current thread (see PlatformNetworkThreadBinding) while calling the
+  // board's Setup and Loop methods, so PlatformNetwork, ServerSocket, etc.
+  // use it without the board needing to pass it around.
+  HostNetwork& network() { return network_; }
+
+  EEPROMClass& eeprom() { return eeprom_; }
+
+  // Milliseconds since the board was created, the equivalent of millis() for
+  // this board.
+  uint32_t millis() const {
+    return static_cast<uint32_t>(
+        absl::ToInt64Milliseconds(absl::Now() - start_time_));
+  }
+
+ private:
+  const int board_index_;
+  HostNetwork& network_;
+  EEPROMClass& eeprom_;
+  const absl::Time start_time_;
+};
+
+class SimulatedBoard {
+ public:
+  virtual ~SimulatedBoard() = default;
+
+  // Called once, before the first call to Loop.
+  virtual void Setup(BoardContext& context) = 0;
+
+  // Called repeatedly. Like loop() in a sketch, it should return promptly
+  // because other boards are waiting for their turn on the same thread.
+  virtual void Loop(BoardContext& context) = 0;
+};
+
+// Creates the SimulatedBoard with the specified index.
+using BoardFactory =
+    std::function<std::unique_ptr<SimulatedBoard>(int board_index)>;
+
+}  // namespace mcunet_host
+
+#endif  // MCUNET_EXTRAS_HOST_FLEET_SIMULATED_BOARD_H_
@@ -0,0 +1,154 @@
+#include "extras/host/fleet/fleet_runner.h"
+
+#include <netinet/in.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "extras/host/ethernet5500/host_network.h"
+#include "extras/host/fleet/simulated_board.h"
+#include "gtest/gtest.h"
+#include "platform_network_interface.h"
+
+namespace mcunet_host {
+namespace test {
+namespace {
+
+struct BoardRecord {
+  std::atomic<int> setup_calls{0};
+  std::atomic<int> loop_calls{0};
+  std::atomic<bool> wrong_network{false};
+};
+
+// Records the calls made to it, and whether the board's network was the
+// implementation bound to the thread at the time.
+class RecordingBoard : public SimulatedBoard {
+ public:
+  explicit RecordingBoard(BoardRecord& record) : record_(record) {}
+
+  void Setup(BoardContext& context) override {
+    EXPECT_EQ(record_.loop_calls.load(), 0);
+    ++record_.setup_calls;
+    CheckNetwork(context);
+  }
+
+  void Loop(BoardContext& context) override {
+    EXPECT_EQ(record_.setup_calls.load(), 1);
+    ++record_.loop_calls;
+    CheckNetwork(context);
+  }
+
+ private:
+  void CheckNetwork(BoardContext& context) {
+    if (::mcunet::PlatformNetworkInterface::GetImplementation() !=
+        &context.network()) {
+      record_.wrong_network = true;
+    }
+  }
+
+  BoardRecord& record_;
+};
+
+TEST(FleetRunnerTest, RunsEachBoardForLoopsPerBoard) {
+  constexpr int kNumBoards = 37;
+  std::vector<BoardRecord> records(kNumBoards);
+  FleetOptions options;
+  options.num_boards = kNumBoards;
+  options.num_threads = 4;
+  options.loops_per_slice = 3;
+  options.loops_per_board = 20;
+  FleetRunner runner(options, [&](int board_index) {
+    return std::make_unique<RecordingBoard>(records[board_index]);
+  });
+  EXPECT_EQ(runner.num_boards(), kNumBoards);
+
+  const auto stats = runner.Run();
+  EXPECT_EQ(stats.total_loops, kNumBoards * 20);
+  // Each board needs 7 slices to complete 20 loops, 3 at a time.
+  EXPECT_EQ(stats.slices, kNumBoards * 7);
+  EXPECT_GT(stats.loop_cpu_time, absl::ZeroDuration());
+  EXPECT_GE(stats.max_loop_cpu_time, stats.CpuTimePerLoop());
+  EXPECT_GE(stats.process_cpu_time, stats.loop_cpu_time);
+
+  for (const auto& record : records) {
+    EXPECT_EQ(record.setup_calls.load(), 1);
+    EXPECT_EQ(record.loop_calls.load(), 20);
+    EXPECT_FALSE(record.wrong_network.load());
+  }
+  // The binding is only in effect while a board is running.
+  EXPECT_EQ(::mcunet::PlatformNetworkInterface::GetImplementation(), nullptr);
+}
+
+TEST(FleetRunnerTest, StopsAfterRunDuration) {
+  constexpr int kNumBoards = 5;
+  std::vector<BoardRecord> records(kNumBoards);
+  FleetOptions options;
+  options.num_boards = kNumBoards;
+  options.num_threads = 2;
+  options.run_duration = absl::Milliseconds(50);
+  FleetRunner runner(options, [&](int board_index) {
+    return std::make_unique<RecordingBoard>(records[board_index]);
+  });
+
+  const auto stats = runner.Run();
+  EXPECT_GE(stats.wall_time, absl::Milliseconds(50));
+  EXPECT_LT(stats.wall_time, absl::Seconds(10));
+  for (const auto& record : records) {
+    EXPECT_GT(record.loop_calls.load(), 0);
+  }
+}
+
+// Starts listening for connections in Setup.
+class ListeningBoard : public SimulatedBoard {
+ public:
+  explicit ListeningBoard(uint16_t tcp_port) : tcp_port_(tcp_port) {}
+
+  void Setup(BoardContext& context) override {
+    EXPECT_TRUE(context.network().InitializeTcpListenerSocket(0, tcp_port_));
+  }
+
+  void Loop(BoardContext& context) override {}
+
+ private:
+  const uint16_t tcp_port_;
+};
+
+TEST(FleetRunnerTest, BoardsListenOnDistinctAddresses) {
+  const auto tcp_port = HostNetwork::FindFreeTcpPort();
+  ASSERT_GT(tcp_port, 0);
+  FleetOptions options;
+  options.num_boards = 2;
+  options.num_threads = 1;
+  options.loops_per_board = 1;
+  FleetRunner runner(options, [&](int board_index) {
+    return std::make_unique<ListeningBoard>(tcp_port);
+  });
+  EXPECT_EQ(runner.listen_address(0), 0x7F010001);
+  EXPECT_EQ(runner.listen_address(1), 0x7F010002);
+
+  // Run Setup (and one Loop) of each board, so that they start listening.
+  runner.Run();
+
+  // Connect to the second board only.
+  const int peer_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(peer_fd, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(runner.listen_address(1));
+  addr.sin_port = htons(tcp_port);
+  ASSERT_EQ(
+      ::connect(peer_fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr), 0);
+
+  EXPECT_FALSE(runner.network(0).AcceptConnection(0));
+  EXPECT_TRUE(runner.network(1).AcceptConnection(0));
+  ::close(peer_fd);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet_host
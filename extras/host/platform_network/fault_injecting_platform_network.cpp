@@ -0,0 +1,159 @@
+#include "extras/host/platform_network/fault_injecting_platform_network.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <random>
+
+#include "absl/log/log.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "extras/host/platform_network/forwarding_platform_network.h"
+#include "platform_network_interface.h"
+
+namespace mcunet_host {
+
+FaultInjectingPlatformNetwork::FaultInjectingPlatformNetwork(
+    ::mcunet::PlatformNetworkInterface& wrapped,
+    const FaultInjectionOptions& options)
+    : ForwardingPlatformNetwork(wrapped),
+      options_(options),
+      rng_(options.seed) {
+  if (!options_.clock) {
+    options_.clock = absl::Now;
+  }
+  if (!options_.sleep) {
+    options_.sleep = absl::SleepFor;
+  }
+}
+
+uint8_t FaultInjectingPlatformNetwork::SocketStatus(
+    const SocketNumber sock_num) {
+  const uint8_t status = wrapped().SocketStatus(sock_num);
+  if (options_.spurious_status_probability > 0 &&
+      (!options_.spurious_status_only_when_listening ||
+       wrapped().SocketIsTcpListener(sock_num) != 0) &&
+      Chance(options_.spurious_status_probability)) {
+    VLOG(2) << "Injecting spurious status "
+            << static_cast<int>(options_.spurious_status) << " for socket "
+            << sock_num << " instead of " << static_cast<int>(status);
+    ++counts_.spurious_statuses;
+    return options_.spurious_status;
+  }
+  return status;
+}
+
+bool FaultInjectingPlatformNetwork::DisconnectSocket(
+    const SocketNumber sock_num) {
+  const auto now = options_.clock();
+  auto it = stall_until_.find(sock_num);
+  if (it != stall_until_.end()) {
+    if (now < it->second) {
+      VLOG(3) << "Socket " << sock_num << " is stalled in CLOSE_WAIT";
+      return true;
+    }
+    stall_until_.erase(it);
+  } else if (options_.close_wait_stall_probability > 0 &&
+             wrapped().SocketIsHalfClosed(sock_num) &&
+             Chance(options_.close_wait_stall_probability)) {
+    VLOG(2) << "Injecting a stall in CLOSE_WAIT for socket " << sock_num;
+    ++counts_.close_wait_stalls;
+    stall_until_[sock_num] = now + options_.close_wait_stall_duration;
+    return true;
+  }
+  return wrapped().DisconnectSocket(sock_num);
+}
+
+bool FaultInjectingPlatformNetwork::CloseSocket(const SocketNumber sock_num) {
+  stall_until_.erase(sock_num);
+  return wrapped().CloseSocket(sock_num);
+}
+
+ssize_t FaultInjectingPlatformNetwork::Send(const SocketNumber sock_num,
+                                            const uint8_t* buf,
+                                            const size_t len) {
+  MaybeDelay();
+  if (MaybeReset(sock_num)) {
+    return -1;
+  }
+  return wrapped().Send(
+      sock_num, buf,
+      MaybeShorten(len, options_.partial_send_probability,
+                   counts_.partial_sends));
+}
+
+ssize_t FaultInjectingPlatformNetwork::TrySend(const SocketNumber sock_num,
+                                               const uint8_t* buf,
+                                               const size_t len) {
+  MaybeDelay();
+  if (MaybeReset(sock_num)) {
+    return -1;
+  }
+  return wrapped().TrySend(
+      sock_num, buf,
+      MaybeShorten(len, options_.partial_send_probability,
+                   counts_.partial_sends));
+}
+
+void FaultInjectingPlatformNetwork::Flush(const SocketNumber sock_num) {
+  MaybeDelay();
+  wrapped().Flush(sock_num);
+}
+
+ssize_t FaultInjectingPlatformNetwork::Recv(const SocketNumber sock_num,
+                                            uint8_t* buf, const size_t len) {
+  MaybeDelay();
+  if (MaybeReset(sock_num)) {
+    return -1;
+  }
+  return wrapped().Recv(
+      sock_num, buf,
+      MaybeShorten(len, options_.partial_recv_probability,
+                   counts_.partial_recvs));
+}
+
+bool FaultInjectingPlatformNetwork::Chance(const double probability) {
+  if (probability <= 0) {
+    return false;
+  }
+  return std::bernoulli_distribution(probability)(rng_);
+}
+
+void FaultInjectingPlatformNetwork::MaybeDelay() {
+  if (!Chance(options_.delay_probability)) {
+    return;
+  }
+  auto delay = options_.min_delay;
+  if (options_.max_delay > options_.min_delay) {
+    const auto range_nanos =
+        absl::ToInt64Nanoseconds(options_.max_delay - options_.min_delay);
+    delay += absl::Nanoseconds(
+        std::uniform_int_distribution<int64_t>(0, range_nanos)(rng_));
+  }
+  ++counts_.delays;
+  options_.sleep(delay);
+}
+
+bool FaultInjectingPlatformNetwork::MaybeReset(const SocketNumber sock_num) {
+  if (!Chance(options_.reset_probability) ||
+      !wrapped().StatusIsOpen(wrapped().SocketStatus(sock_num))) {
+    return false;
+  }
+  VLOG(2) << "Injecting a reset of socket " << sock_num;
+  ++counts_.resets;
+  CloseSocket(sock_num);
+  return true;
+}
+
+size_t FaultInjectingPlatformNetwork::MaybeShorten(const size_t len,
+                                                   const double probability,
+                                                   int64_t& counter) {
+  if (len <= 1 || !Chance(probability)) {
+    return len;
+  }
+  ++counter;
+  return std::uniform_int_distribution<size_t>(1, len - 1)(rng_);
+}
+
+}  // namespace mcunet_host
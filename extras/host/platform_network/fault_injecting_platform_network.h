@@ -0,0 +1,114 @@
+#ifndef MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_FAULT_INJECTING_NETWORK_H_
+#define MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_FAULT_INJECTING_NETWORK_H_
+
+// FaultInjectingPlatformNetwork wraps another PlatformNetworkInterface (e.g.
+// HostNetwork) and injects the kinds of misbehavior seen on slow or lossy
+// links, and from the W5500 itself, so that we can check how listeners and
+// ServerSocket cope with them:
+//
+// * Delays in the I/O methods (Send, TrySend, Flush and Recv).
+// * Partial Send, TrySend and Recv results, i.e. fewer bytes than requested.
+// * Spurious undocumented status values, such as the 0x11 which the W5500
+//   sometimes reports after LISTEN.
+// * Resets of open connections, i.e. the socket abruptly becomes CLOSED.
+// * Stalls in CLOSE_WAIT, where DisconnectSocket has no effect for a while.
+//
+// The faults are chosen pseudo-randomly, from a seeded generator, so that a
+// failing run can be reproduced.
+//
+// Author: james.synge@gmail.com
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <functional>
+#include <map>
+#include <random>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "extras/host/platform_network/forwarding_platform_network.h"
+#include "platform_network_interface.h"
+
+namespace mcunet_host {
+
+struct FaultInjectionOptions {
+  uint32_t seed = 1;
+
+  // Probability of delaying a call to one of the I/O methods, and the range
+  // from which the delay is chosen.
+  double delay_probability = 0;
+  absl::Duration min_delay = absl::ZeroDuration();
+  absl::Duration max_delay = absl::ZeroDuration();
+
+  // Probability of passing a smaller length (but at least 1) to the wrapped
+  // Send, TrySend or Recv.
+  double partial_send_probability = 0;
+  double partial_recv_probability = 0;
+
+  // Probability of SocketStatus returning spurious_status instead of the real
+  // status. If spurious_status_only_when_listening is true, this only happens
+  // when the socket is a TCP listener, which is where it has been observed.
+  double spurious_status_probability = 0;
+  uint8_t spurious_status = 0x11;
+  bool spurious_status_only_when_listening = true;
+
+  // Probability of a Send, TrySend or Recv call resetting the connection: the
+  // wrapped socket is closed, and the call returns -1.
+  double reset_probability = 0;
+
+  // Probability of DisconnectSocket, when called on a half-closed connection,
+  // starting a stall of close_wait_stall_duration during which calls to
+  // DisconnectSocket report success but do nothing.
+  double close_wait_stall_probability = 0;
+  absl::Duration close_wait_stall_duration = absl::Seconds(1);
+
+  // Replaceable for testing.
+  std::function<absl::Time()> clock = absl::Now;
+  std::function<void(absl::Duration)> sleep = absl::SleepFor;
+};
+
+// Counts of the faults injected so far.
+struct FaultInjectionCounts {
+  int64_t delays = 0;
+  int64_t partial_sends = 0;
+  int64_t partial_recvs = 0;
+  int64_t spurious_statuses = 0;
+  int64_t resets = 0;
+  int64_t close_wait_stalls = 0;
+};
+
+class FaultInjectingPlatformNetwork : public ForwardingPlatformNetwork {
+ public:
+  FaultInjectingPlatformNetwork(::mcunet::PlatformNetworkInterface& wrapped,
+                                const FaultInjectionOptions& options);
+
+  uint8_t SocketStatus(SocketNumber sock_num) override;
+  bool DisconnectSocket(SocketNumber sock_num) override;
+  bool CloseSocket(SocketNumber sock_num) override;
+  ssize_t Send(SocketNumber sock_num, const uint8_t* buf, size_t len) override;
+  ssize_t TrySend(SocketNumber sock_num, const uint8_t* buf,
+                  size_t len) override;
+  void Flush(SocketNumber sock_num) override;
+  ssize_t Recv(SocketNumber sock_num, uint8_t* buf, size_t len) override;
+
+  const FaultInjectionCounts& counts() const { return counts_; }
+
+ private:
+  bool Chance(double probability);
+  void MaybeDelay();
+  // Returns true (after closing the wrapped socket) if a reset is injected.
+  bool MaybeReset(SocketNumber sock_num);
+  size_t MaybeShorten(size_t len, double probability, int64_t& counter);
+
+  FaultInjectionOptions options_;
+  FaultInjectionCounts counts_;
+  std::mt19937 rng_;
+  // The time until which DisconnectSocket is ignored, by socket.
+  std::map<SocketNumber, absl::Time> stall_until_;
+};
+
+}  // namespace mcunet_host
+
+#endif  // MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_FAULT_INJECTING_NETWORK_H_
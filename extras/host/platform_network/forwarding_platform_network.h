@@ -0,0 +1,41 @@
+#ifndef MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_FORWARDING_PLATFORM_NETWORK_H_
+#define MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_FORWARDING_PLATFORM_NETWORK_H_
+
+// ForwardingPlatformNetwork implements PlatformNetworkInterface by forwarding
+// every call to another implementation. It is a base class for decorators
+// which only need to override some of the methods (e.g. to inject faults, or
+// to record the calls).
+//
+// Author: james.synge@gmail.com
+
+#include "platform_network_interface.h"
+
+namespace mcunet_host {
+
+class ForwardingPlatformNetwork : public ::mcunet::PlatformNetworkInterface {
+ public:
+  using SocketNumber = ::mcunet::SocketNumber;
+
+  // The wrapped implementation must outlive this instance.
+  explicit ForwardingPlatformNetwork(
+      ::mcunet::PlatformNetworkInterface& wrapped)
+      : wrapped_(wrapped) {}
+
+#ifdef MCUNET_PNAPI_METHOD
+#error "MCUNET_PNAPI_METHOD should not be defined!!"
+#endif
+
+#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS, ARG_NAMES) \
+  TYPE NAME ARGS override { return wrapped_.NAME ARG_NAMES; }
+#include "platform_network_api.cc.inc"  // IWYU pragma: export
+#undef MCUNET_PNAPI_METHOD
+
+  ::mcunet::PlatformNetworkInterface& wrapped() { return wrapped_; }
+
+ private:
+  ::mcunet::PlatformNetworkInterface& wrapped_;
+};
+
+}  // namespace mcunet_host
+
+#endif  // MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_FORWARDING_PLATFORM_NETWORK_H_
@@ -0,0 +1,103 @@
+#include "extras/host/platform_network/instrumented_platform_network.h"
+
+#include <stddef.h>
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/time.h"
+
+namespace mcunet_host {
+namespace {
+
+void AppendStatsLine(std::string_view label, const PnapiCallStats& stats,
+                     std::string& out) {
+  absl::StrAppendFormat(&out, "%-34s calls=%-8d", label, stats.calls);
+  if (stats.bytes_sent > 0) {
+    absl::StrAppend(&out, " bytes_sent=", stats.bytes_sent);
+  }
+  if (stats.bytes_received > 0) {
+    absl::StrAppend(&out, " bytes_received=", stats.bytes_received);
+  }
+  absl::StrAppend(&out, " time=", absl::FormatDuration(stats.time), "\n");
+}
+
+}  // namespace
+
+PnapiCallStats& PnapiCallStats::operator+=(const PnapiCallStats& other) {
+  calls += other.calls;
+  bytes_sent += other.bytes_sent;
+  bytes_received += other.bytes_received;
+  time += other.time;
+  return *this;
+}
+
+InstrumentedPlatformNetwork::InstrumentedPlatformNetwork(
+    ::mcunet::PlatformNetworkInterface& wrapped,
+    std::function<absl::Time()> clock)
+    : wrapped_(wrapped), clock_(std::move(clock)) {
+#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS, ARG_NAMES) \
+  method_names_[offsetof(MethodIndex, NAME)] = #NAME
+#include "platform_network_api.cc.inc"
+#undef MCUNET_PNAPI_METHOD
+}
+
+PnapiCallStats InstrumentedPlatformNetwork::MethodStats(
+    std::string_view method_name) const {
+  for (size_t method = 0; method < kNumMethods; ++method) {
+    if (method_name == method_names_[method]) {
+      return method_stats_[method];
+    }
+  }
+  return PnapiCallStats();
+}
+
+PnapiCallStats InstrumentedPlatformNetwork::SocketStats(
+    SocketNumber sock_num) const {
+  auto iter = socket_stats_.find(sock_num);
+  if (iter == socket_stats_.end()) {
+    return PnapiCallStats();
+  }
+  return iter->second;
+}
+
+PnapiCallStats InstrumentedPlatformNetwork::TotalStats() const {
+  PnapiCallStats total;
+  for (const auto& stats : method_stats_) {
+    total += stats;
+  }
+  return total;
+}
+
+void InstrumentedPlatformNetwork::Reset() {
+  method_stats_.fill(PnapiCallStats());
+  socket_stats_.clear();
+}
+
+std::string InstrumentedPlatformNetwork::ToString() const {
+  std::string out;
+  for (size_t method = 0; method < kNumMethods; ++method) {
+    if (method_stats_[method].calls > 0) {
+      AppendStatsLine(method_names_[method], method_stats_[method], out);
+    }
+  }
+  for (const auto& [sock_num, stats] : socket_stats_) {
+    AppendStatsLine(absl::StrCat("socket ", sock_num), stats, out);
+  }
+  AppendStatsLine("total", TotalStats(), out);
+  return out;
+}
+
+void InstrumentedPlatformNetwork::Count(size_t method, int sock_num,
+                                        const PnapiCallStats& call) {
+  method_stats_[method] += call;
+  if (sock_num >= 0) {
+    socket_stats_[sock_num] += call;
+  }
+}
+
+}  // namespace mcunet_host
@@ -0,0 +1,154 @@
+#ifndef MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_INSTRUMENTED_PLATFORM_NETWORK_H_
+#define MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_INSTRUMENTED_PLATFORM_NETWORK_H_
+
+// InstrumentedPlatformNetwork implements PlatformNetworkInterface by forwarding
+// every call to another implementation (e.g. HostNetwork), counting the calls,
+// the bytes sent and received, and the time spent in the wrapped
+// implementation, per method and per socket. For example, to learn how many
+// calls to SocketStatus a typical HTTP request costs.
+//
+// The overrides are generated from platform_network_api.cc.inc, so new methods
+// are instrumented automatically. Bytes are counted for methods with a
+// (sock_num, buf, len) signature: as sent if buf is const, else as received.
+//
+// Not thread-safe; if the wrapped implementation is shared by several threads,
+// give each thread its own InstrumentedPlatformNetwork (see
+// PlatformNetworkThreadBinding).
+//
+// Author: james.synge@gmail.com
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "platform_network_interface.h"
+
+namespace mcunet_host {
+
+struct PnapiCallStats {
+  int64_t calls = 0;
+  int64_t bytes_sent = 0;
+  int64_t bytes_received = 0;
+  absl::Duration time;
+
+  PnapiCallStats& operator+=(const PnapiCallStats& other);
+};
+
+class InstrumentedPlatformNetwork : public ::mcunet::PlatformNetworkInterface {
+ public:
+  using SocketNumber = ::mcunet::SocketNumber;
+
+  // The wrapped implementation must outlive this instance. clock is used to
+  // measure the time spent in each call.
+  explicit InstrumentedPlatformNetwork(
+      ::mcunet::PlatformNetworkInterface& wrapped,
+      std::function<absl::Time()> clock = absl::Now);
+
+#ifdef MCUNET_PNAPI_METHOD
+#error "MCUNET_PNAPI_METHOD should not be defined!!"
+#endif
+
+#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS, ARG_NAMES)        \
+  TYPE NAME ARGS override {                                     \
+    return Invoke(offsetof(MethodIndex, NAME),                  \
+                  [&]() { return wrapped_.NAME ARG_NAMES; },    \
+                  std::make_tuple ARG_NAMES);                   \
+  }
+#include "platform_network_api.cc.inc"  // IWYU pragma: export
+#undef MCUNET_PNAPI_METHOD
+
+  // Returns the stats of the named method (e.g. "SocketStatus"); all zero if
+  // there is no such method, or it hasn't been called.
+  PnapiCallStats MethodStats(std::string_view method_name) const;
+
+  // Returns the stats of the calls of methods with a SocketNumber argument,
+  // for the specified socket.
+  PnapiCallStats SocketStats(SocketNumber sock_num) const;
+
+  // Returns the stats summed over all methods.
+  PnapiCallStats TotalStats() const;
+
+  // Zeroes all of the stats, e.g. after setup, so that just the calls of
+  // interest are counted.
+  void Reset();
+
+  // Returns a table of the stats of the methods and sockets which have been
+  // called, one per line.
+  std::string ToString() const;
+
+  ::mcunet::PlatformNetworkInterface& wrapped() { return wrapped_; }
+
+ private:
+  // A member per method, each a byte, so that offsetof(MethodIndex, NAME) is
+  // the index of the method in declaration order.
+  struct MethodIndex {
+#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS, ARG_NAMES) char NAME
+#include "platform_network_api.cc.inc"
+#undef MCUNET_PNAPI_METHOD
+  };
+  static constexpr size_t kNumMethods = sizeof(MethodIndex);
+
+  // Returns the socket number of a call, or -1 if the method doesn't have a
+  // SocketNumber as its first argument.
+  static int SocketOf(const std::tuple<>&) { return -1; }
+  static int SocketOf(const std::tuple<uint8_t>&) { return -1; }
+  template <typename... Rest>
+  static int SocketOf(const std::tuple<SocketNumber, Rest...>& args) {
+    return std::get<0>(args);
+  }
+
+  template <typename Args>
+  static void CountBytes(const Args&, int64_t, PnapiCallStats&) {}
+  static void CountBytes(
+      const std::tuple<SocketNumber, const uint8_t*, size_t>&, int64_t result,
+      PnapiCallStats& stats) {
+    stats.bytes_sent += result > 0 ? result : 0;
+  }
+  static void CountBytes(const std::tuple<SocketNumber, uint8_t*, size_t>&,
+                         int64_t result, PnapiCallStats& stats) {
+    stats.bytes_received += result > 0 ? result : 0;
+  }
+
+  template <typename Fn, typename Args>
+  auto Invoke(size_t method, Fn fn, const Args& args) -> decltype(fn()) {
+    PnapiCallStats call;
+    call.calls = 1;
+    const absl::Time start = clock_();
+    if constexpr (std::is_void_v<decltype(fn())>) {
+      fn();
+      call.time = clock_() - start;
+      Count(method, SocketOf(args), call);
+    } else {
+      auto result = fn();
+      call.time = clock_() - start;
+      if constexpr (std::is_arithmetic_v<decltype(result)>) {
+        CountBytes(args, static_cast<int64_t>(result), call);
+      }
+      Count(method, SocketOf(args), call);
+      return result;
+    }
+  }
+
+  void Count(size_t method, int sock_num, const PnapiCallStats& call);
+
+  ::mcunet::PlatformNetworkInterface& wrapped_;
+  std::function<absl::Time()> clock_;
+  std::array<const char*, kNumMethods> method_names_;
+  std::array<PnapiCallStats, kNumMethods> method_stats_;
+  std::map<SocketNumber, PnapiCallStats> socket_stats_;
+};
+
+}  // namespace mcunet_host
+
+#endif  // MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_INSTRUMENTED_PLATFORM_NETWORK_H_
@@ -0,0 +1,235 @@
+#include "extras/host/platform_network/pnapi_trace.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+#include "absl/log/log.h"
+#include "absl/time/time.h"
+
+namespace mcunet_host {
+namespace {
+
+constexpr std::string_view kMagic = "PNTR";
+constexpr uint8_t kVersion = 1;
+
+bool HasSocket(PnapiMethod method) {
+  return method != PnapiMethod::kFindUnusedSocket &&
+         !PnapiMethodIsStatusPredicate(method);
+}
+
+bool HasLen(PnapiMethod method) {
+  return method == PnapiMethod::kSend || method == PnapiMethod::kTrySend ||
+         method == PnapiMethod::kRecv;
+}
+
+void AppendVarint(uint64_t value, std::string& trace) {
+  while (value >= 0x80) {
+    trace.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  trace.push_back(static_cast<char>(value));
+}
+
+uint64_t ZigZagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ (value < 0 ? ~0ULL : 0ULL);
+}
+
+int64_t ZigZagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+}  // namespace
+
+const char* PnapiMethodName(PnapiMethod method) {
+  switch (method) {
+    case PnapiMethod::kFindUnusedSocket:
+      return "FindUnusedSocket";
+    case PnapiMethod::kSocketIsTcpListener:
+      return "SocketIsTcpListener";
+    case PnapiMethod::kSocketIsInTcpConnectionLifecycle:
+      return "SocketIsInTcpConnectionLifecycle";
+    case PnapiMethod::kSocketIsHalfClosed:
+      return "SocketIsHalfClosed";
+    case PnapiMethod::kSocketIsClosed:
+      return "SocketIsClosed";
+    case PnapiMethod::kSocketStatus:
+      return "SocketStatus";
+    case PnapiMethod::kRemoteAddress:
+      return "RemoteAddress";
+    case PnapiMethod::kRemotePort:
+      return "RemotePort";
+    case PnapiMethod::kInitializeTcpListenerSocket:
+      return "InitializeTcpListenerSocket";
+    case PnapiMethod::kAcceptConnection:
+      return "AcceptConnection";
+    case PnapiMethod::kDisconnectSocket:
+      return "DisconnectSocket";
+    case PnapiMethod::kCloseSocket:
+      return "CloseSocket";
+    case PnapiMethod::kSend:
+      return "Send";
+    case PnapiMethod::kFlush:
+      return "Flush";
+    case PnapiMethod::kTxFreeBytes:
+      return "TxFreeBytes";
+    case PnapiMethod::kTrySend:
+      return "TrySend";
+    case PnapiMethod::kAvailableBytes:
+      return "AvailableBytes";
+    case PnapiMethod::kPeek:
+      return "Peek";
+    case PnapiMethod::kRecv:
+      return "Recv";
+    case PnapiMethod::kStatusIsOpen:
+      return "StatusIsOpen";
+    case PnapiMethod::kStatusIsHalfClosed:
+      return "StatusIsHalfClosed";
+    case PnapiMethod::kStatusIsClosing:
+      return "StatusIsClosing";
+  }
+  return "Unknown";
+}
+
+bool PnapiMethodIsStatusPredicate(PnapiMethod method) {
+  return method == PnapiMethod::kStatusIsOpen ||
+         method == PnapiMethod::kStatusIsHalfClosed ||
+         method == PnapiMethod::kStatusIsClosing;
+}
+
+void AppendPnapiTraceHeader(std::string& trace) {
+  trace.append(kMagic.data(), kMagic.size());
+  trace.push_back(static_cast<char>(kVersion));
+}
+
+void AppendPnapiTraceRecord(const PnapiTraceRecord& record,
+                            std::string& trace) {
+  trace.push_back(static_cast<char>(record.method));
+  AppendVarint(absl::ToInt64Microseconds(record.elapsed), trace);
+  if (HasSocket(record.method)) {
+    AppendVarint(record.sock_num, trace);
+  }
+  if (record.method == PnapiMethod::kInitializeTcpListenerSocket) {
+    AppendVarint(record.tcp_port, trace);
+  }
+  if (PnapiMethodIsStatusPredicate(record.method)) {
+    trace.push_back(static_cast<char>(record.status));
+  }
+  if (HasLen(record.method)) {
+    AppendVarint(record.len, trace);
+  }
+  AppendVarint(ZigZagEncode(record.result), trace);
+  if (record.method == PnapiMethod::kRecv && record.result > 0) {
+    trace.append(record.data, 0, record.result);
+  }
+}
+
+bool ReadPnapiTraceFile(const std::string& path, std::string& trace) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    LOG(ERROR) << "Unable to open PlatformNetwork trace " << path;
+    return false;
+  }
+  trace.assign(std::istreambuf_iterator<char>(file),
+               std::istreambuf_iterator<char>());
+  return true;
+}
+
+PnapiTraceReader::PnapiTraceReader(std::string_view trace)
+    : remaining_(trace), ok_(false) {
+  if (remaining_.size() < kMagic.size() + 1 ||
+      remaining_.substr(0, kMagic.size()) != kMagic) {
+    LOG(ERROR) << "Not a PlatformNetwork trace";
+    return;
+  }
+  const uint8_t version = remaining_[kMagic.size()];
+  if (version != kVersion) {
+    LOG(ERROR) << "Unsupported PlatformNetwork trace version: "
+               << static_cast<int>(version);
+    return;
+  }
+  remaining_.remove_prefix(kMagic.size() + 1);
+  ok_ = true;
+}
+
+bool PnapiTraceReader::Next(PnapiTraceRecord& record) {
+  if (!ok_ || remaining_.empty()) {
+    return false;
+  }
+  record = PnapiTraceRecord{};
+  record.method = static_cast<PnapiMethod>(remaining_[0]);
+  remaining_.remove_prefix(1);
+  if (std::string_view(PnapiMethodName(record.method)) == "Unknown") {
+    LOG(ERROR) << "Unknown method id in trace: "
+               << static_cast<int>(record.method);
+    ok_ = false;
+    return false;
+  }
+  uint64_t value;
+  if (!ReadVarint(value)) {
+    return false;
+  }
+  record.elapsed = absl::Microseconds(value);
+  if (HasSocket(record.method)) {
+    if (!ReadVarint(value)) {
+      return false;
+    }
+    record.sock_num = value;
+  }
+  if (record.method == PnapiMethod::kInitializeTcpListenerSocket) {
+    if (!ReadVarint(value)) {
+      return false;
+    }
+    record.tcp_port = value;
+  }
+  if (PnapiMethodIsStatusPredicate(record.method)) {
+    if (remaining_.empty()) {
+      ok_ = false;
+      return false;
+    }
+    record.status = remaining_[0];
+    remaining_.remove_prefix(1);
+  }
+  if (HasLen(record.method)) {
+    if (!ReadVarint(record.len)) {
+      return false;
+    }
+  }
+  if (!ReadVarint(value)) {
+    return false;
+  }
+  record.result = ZigZagDecode(value);
+  if (record.method == PnapiMethod::kRecv && record.result > 0) {
+    if (remaining_.size() < static_cast<size_t>(record.result)) {
+      ok_ = false;
+      return false;
+    }
+    record.data = std::string(remaining_.substr(0, record.result));
+    remaining_.remove_prefix(record.result);
+  }
+  return true;
+}
+
+bool PnapiTraceReader::ReadVarint(uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (remaining_.empty()) {
+      break;
+    }
+    const uint8_t b = remaining_[0];
+    remaining_.remove_prefix(1);
+    value |= static_cast<uint64_t>(b & 0x7F) << shift;
+    if ((b & 0x80) == 0) {
+      return true;
+    }
+  }
+  LOG(ERROR) << "Truncated or malformed varint in trace";
+  ok_ = false;
+  return false;
+}
+
+}  // namespace mcunet_host
@@ -0,0 +1,115 @@
+#ifndef MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_PNAPI_TRACE_H_
+#define MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_PNAPI_TRACE_H_
+
+// A compact binary format for traces of the calls made to the methods of
+// PlatformNetworkInterface (PNAPI), with the arguments, the results, and the
+// time between calls. Written by RecordingPlatformNetwork, and read by
+// ReplayPlatformNetwork.
+//
+// A trace starts with the 4 byte magic "PNTR" and a version byte, followed by
+// a sequence of records. Each record starts with the method id (one byte) and
+// the microseconds since the start of the previous call (varint), followed by
+// those of these fields which the method has:
+//
+// * sock_num (varint)
+// * tcp_port (varint), for InitializeTcpListenerSocket
+// * status (one byte), for StatusIsOpen, etc.
+// * len (varint), the requested length for Send, TrySend and Recv
+// * result (zigzag varint); always present, zero for Flush; for RemoteAddress
+//   the address, with the first octet in the most significant byte
+// * the received bytes, for Recv with a positive result (their number is
+//   given by the result)
+//
+// The bytes sent aren't recorded, only their number, as they are produced by
+// the code under test rather than by the network.
+//
+// Author: james.synge@gmail.com
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+
+#include "absl/time/time.h"
+#include "platform_network_interface.h"
+
+namespace mcunet_host {
+
+// The values are part of the trace format, so must not be changed.
+enum class PnapiMethod : uint8_t {
+  kFindUnusedSocket = 1,
+  kSocketIsTcpListener = 2,
+  kSocketIsInTcpConnectionLifecycle = 3,
+  kSocketIsHalfClosed = 4,
+  kSocketIsClosed = 5,
+  kSocketStatus = 6,
+  kInitializeTcpListenerSocket = 7,
+  kAcceptConnection = 8,
+  kDisconnectSocket = 9,
+  kCloseSocket = 10,
+  kSend = 11,
+  kFlush = 12,
+  kTxFreeBytes = 13,
+  kTrySend = 14,
+  kAvailableBytes = 15,
+  kPeek = 16,
+  kRecv = 17,
+  kStatusIsOpen = 18,
+  kStatusIsHalfClosed = 19,
+  kStatusIsClosing = 20,
+  kRemoteAddress = 21,
+  kRemotePort = 22,
+};
+
+// Returns the name of the method (e.g. "SocketStatus"), or "Unknown".
+const char* PnapiMethodName(PnapiMethod method);
+
+// Returns true if the method is one of StatusIsOpen, StatusIsHalfClosed or
+// StatusIsClosing, whose results depend only on their argument.
+bool PnapiMethodIsStatusPredicate(PnapiMethod method);
+
+struct PnapiTraceRecord {
+  PnapiMethod method;
+  // Time from the start of the previous call to the start of this call.
+  absl::Duration elapsed;
+  ::mcunet::SocketNumber sock_num = 0;
+  uint16_t tcp_port = 0;
+  uint8_t status = 0;
+  uint64_t len = 0;
+  int64_t result = 0;
+  std::string data;
+};
+
+// Appends the header that starts a trace.
+void AppendPnapiTraceHeader(std::string& trace);
+
+// Appends the encoding of the record.
+void AppendPnapiTraceRecord(const PnapiTraceRecord& record,
+                            std::string& trace);
+
+// Reads the trace file at path into trace. Returns true if successful.
+bool ReadPnapiTraceFile(const std::string& path, std::string& trace);
+
+// Decodes the records of a trace, which must outlive the reader.
+class PnapiTraceReader {
+ public:
+  explicit PnapiTraceReader(std::string_view trace);
+
+  // Returns false if the trace is malformed (e.g. truncated).
+  bool ok() const { return ok_; }
+
+  // Decodes the next record into *record. Returns false at the end of the
+  // trace, or if the trace is malformed.
+  bool Next(PnapiTraceRecord& record);
+
+ private:
+  bool ReadVarint(uint64_t& value);
+
+  std::string_view remaining_;
+  bool ok_;
+};
+
+}  // namespace mcunet_host
+
+#endif  // MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_PNAPI_TRACE_H_
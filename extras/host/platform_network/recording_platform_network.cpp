@@ -0,0 +1,249 @@
+#include "extras/host/platform_network/recording_platform_network.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <fstream>
+#include <string>
+#include <utility>
+
+#include "absl/log/log.h"
+#include "absl/time/time.h"
+#include "extras/host/platform_network/pnapi_trace.h"
+
+namespace mcunet_host {
+
+RecordingPlatformNetwork::RecordingPlatformNetwork(
+    ::mcunet::PlatformNetworkInterface& wrapped,
+    std::function<absl::Time()> clock)
+    : ForwardingPlatformNetwork(wrapped),
+      clock_(std::move(clock)),
+      last_call_time_(clock_()) {
+  AppendPnapiTraceHeader(trace_);
+}
+
+bool RecordingPlatformNetwork::WriteTraceToFile(const std::string& path) const {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(trace_.data(), trace_.size());
+  file.close();
+  if (!file) {
+    LOG(ERROR) << "Unable to write PlatformNetwork trace to " << path;
+    return false;
+  }
+  return true;
+}
+
+PnapiTraceRecord RecordingPlatformNetwork::StartRecord(
+    const PnapiMethod method, const SocketNumber sock_num) {
+  const auto now = clock_();
+  PnapiTraceRecord record;
+  record.method = method;
+  record.elapsed = now - last_call_time_;
+  record.sock_num = sock_num;
+  last_call_time_ = now;
+  return record;
+}
+
+void RecordingPlatformNetwork::AppendRecord(const PnapiTraceRecord& record) {
+  AppendPnapiTraceRecord(record, trace_);
+  ++num_records_;
+}
+
+int RecordingPlatformNetwork::FindUnusedSocket() {
+  auto record = StartRecord(PnapiMethod::kFindUnusedSocket);
+  const auto result = wrapped().FindUnusedSocket();
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+uint16_t RecordingPlatformNetwork::SocketIsTcpListener(
+    const SocketNumber sock_num) {
+  auto record = StartRecord(PnapiMethod::kSocketIsTcpListener, sock_num);
+  const auto result = wrapped().SocketIsTcpListener(sock_num);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+bool RecordingPlatformNetwork::SocketIsInTcpConnectionLifecycle(
+    const SocketNumber sock_num) {
+  auto record =
+      StartRecord(PnapiMethod::kSocketIsInTcpConnectionLifecycle, sock_num);
+  const auto result = wrapped().SocketIsInTcpConnectionLifecycle(sock_num);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+bool RecordingPlatformNetwork::SocketIsHalfClosed(
+    const SocketNumber sock_num) {
+  auto record = StartRecord(PnapiMethod::kSocketIsHalfClosed, sock_num);
+  const auto result = wrapped().SocketIsHalfClosed(sock_num);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+bool RecordingPlatformNetwork::SocketIsClosed(const SocketNumber sock_num) {
+  auto record = StartRecord(PnapiMethod::kSocketIsClosed, sock_num);
+  const auto result = wrapped().SocketIsClosed(sock_num);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+uint8_t RecordingPlatformNetwork::SocketStatus(const SocketNumber sock_num) {
+  auto record = StartRecord(PnapiMethod::kSocketStatus, sock_num);
+  const auto result = wrapped().SocketStatus(sock_num);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+IPAddress RecordingPlatformNetwork::RemoteAddress(const SocketNumber sock_num) {
+  auto record = StartRecord(PnapiMethod::kRemoteAddress, sock_num);
+  const auto result = wrapped().RemoteAddress(sock_num);
+  record.result = (static_cast<uint32_t>(result[0]) << 24) |
+                  (static_cast<uint32_t>(result[1]) << 16) |
+                  (static_cast<uint32_t>(result[2]) << 8) | result[3];
+  AppendRecord(record);
+  return result;
+}
+
+uint16_t RecordingPlatformNetwork::RemotePort(const SocketNumber sock_num) {
+  auto record = StartRecord(PnapiMethod::kRemotePort, sock_num);
+  const auto result = wrapped().RemotePort(sock_num);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+bool RecordingPlatformNetwork::InitializeTcpListenerSocket(
+    const SocketNumber sock_num, const uint16_t tcp_port) {
+  auto record =
+      StartRecord(PnapiMethod::kInitializeTcpListenerSocket, sock_num);
+  record.tcp_port = tcp_port;
+  const auto result = wrapped().InitializeTcpListenerSocket(sock_num, tcp_port);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+bool RecordingPlatformNetwork::AcceptConnection(const SocketNumber sock_num) {
+  auto record = StartRecord(PnapiMethod::kAcceptConnection, sock_num);
+  const auto result = wrapped().AcceptConnection(sock_num);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+bool RecordingPlatformNetwork::DisconnectSocket(const SocketNumber sock_num) {
+  auto record = StartRecord(PnapiMethod::kDisconnectSocket, sock_num);
+  const auto result = wrapped().DisconnectSocket(sock_num);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+bool RecordingPlatformNetwork::CloseSocket(const SocketNumber sock_num) {
+  auto record = StartRecord(PnapiMethod::kCloseSocket, sock_num);
+  const auto result = wrapped().CloseSocket(sock_num);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+ssize_t RecordingPlatformNetwork::Send(const SocketNumber sock_num,
+                                       const uint8_t* buf, const size_t len) {
+  auto record = StartRecord(PnapiMethod::kSend, sock_num);
+  record.len = len;
+  const auto result = wrapped().Send(sock_num, buf, len);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+void RecordingPlatformNetwork::Flush(const SocketNumber sock_num) {
+  auto record = StartRecord(PnapiMethod::kFlush, sock_num);
+  wrapped().Flush(sock_num);
+  AppendRecord(record);
+}
+
+ssize_t RecordingPlatformNetwork::TxFreeBytes(const SocketNumber sock_num) {
+  auto record = StartRecord(PnapiMethod::kTxFreeBytes, sock_num);
+  const auto result = wrapped().TxFreeBytes(sock_num);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+ssize_t RecordingPlatformNetwork::TrySend(const SocketNumber sock_num,
+                                          const uint8_t* buf,
+                                          const size_t len) {
+  auto record = StartRecord(PnapiMethod::kTrySend, sock_num);
+  record.len = len;
+  const auto result = wrapped().TrySend(sock_num, buf, len);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+ssize_t RecordingPlatformNetwork::AvailableBytes(const SocketNumber sock_num) {
+  auto record = StartRecord(PnapiMethod::kAvailableBytes, sock_num);
+  const auto result = wrapped().AvailableBytes(sock_num);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+int RecordingPlatformNetwork::Peek(const SocketNumber sock_num) {
+  auto record = StartRecord(PnapiMethod::kPeek, sock_num);
+  const auto result = wrapped().Peek(sock_num);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+ssize_t RecordingPlatformNetwork::Recv(const SocketNumber sock_num,
+                                       uint8_t* buf, const size_t len) {
+  auto record = StartRecord(PnapiMethod::kRecv, sock_num);
+  record.len = len;
+  const auto result = wrapped().Recv(sock_num, buf, len);
+  record.result = result;
+  if (result > 0) {
+    record.data.assign(reinterpret_cast<const char*>(buf), result);
+  }
+  AppendRecord(record);
+  return result;
+}
+
+bool RecordingPlatformNetwork::StatusIsOpen(const uint8_t status) {
+  auto record = StartRecord(PnapiMethod::kStatusIsOpen);
+  record.status = status;
+  const auto result = wrapped().StatusIsOpen(status);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+bool RecordingPlatformNetwork::StatusIsHalfClosed(const uint8_t status) {
+  auto record = StartRecord(PnapiMethod::kStatusIsHalfClosed);
+  record.status = status;
+  const auto result = wrapped().StatusIsHalfClosed(status);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+bool RecordingPlatformNetwork::StatusIsClosing(const uint8_t status) {
+  auto record = StartRecord(PnapiMethod::kStatusIsClosing);
+  record.status = status;
+  const auto result = wrapped().StatusIsClosing(status);
+  record.result = result;
+  AppendRecord(record);
+  return result;
+}
+
+}  // namespace mcunet_host
@@ -0,0 +1,77 @@
+#ifndef MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_RECORDING_PLATFORM_NETWORK_H_
+#define MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_RECORDING_PLATFORM_NETWORK_H_
+
+// RecordingPlatformNetwork wraps another PlatformNetworkInterface (e.g.
+// HostNetwork), forwarding each call and appending a record of it (arguments,
+// result and timing) to a trace in the format described in pnapi_trace.h. The
+// trace can later be replayed with ReplayPlatformNetwork.
+//
+// Author: james.synge@gmail.com
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <functional>
+#include <string>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "extras/host/platform_network/forwarding_platform_network.h"
+#include "extras/host/platform_network/pnapi_trace.h"
+#include "platform_network_interface.h"
+
+namespace mcunet_host {
+
+class RecordingPlatformNetwork : public ForwardingPlatformNetwork {
+ public:
+  explicit RecordingPlatformNetwork(
+      ::mcunet::PlatformNetworkInterface& wrapped,
+      std::function<absl::Time()> clock = absl::Now);
+
+  int FindUnusedSocket() override;
+  uint16_t SocketIsTcpListener(SocketNumber sock_num) override;
+  bool SocketIsInTcpConnectionLifecycle(SocketNumber sock_num) override;
+  bool SocketIsHalfClosed(SocketNumber sock_num) override;
+  bool SocketIsClosed(SocketNumber sock_num) override;
+  uint8_t SocketStatus(SocketNumber sock_num) override;
+  IPAddress RemoteAddress(SocketNumber sock_num) override;
+  uint16_t RemotePort(SocketNumber sock_num) override;
+  bool InitializeTcpListenerSocket(SocketNumber sock_num,
+                                   uint16_t tcp_port) override;
+  bool AcceptConnection(SocketNumber sock_num) override;
+  bool DisconnectSocket(SocketNumber sock_num) override;
+  bool CloseSocket(SocketNumber sock_num) override;
+  ssize_t Send(SocketNumber sock_num, const uint8_t* buf, size_t len) override;
+  void Flush(SocketNumber sock_num) override;
+  ssize_t TxFreeBytes(SocketNumber sock_num) override;
+  ssize_t TrySend(SocketNumber sock_num, const uint8_t* buf,
+                  size_t len) override;
+  ssize_t AvailableBytes(SocketNumber sock_num) override;
+  int Peek(SocketNumber sock_num) override;
+  ssize_t Recv(SocketNumber sock_num, uint8_t* buf, size_t len) override;
+  bool StatusIsOpen(uint8_t status) override;
+  bool StatusIsHalfClosed(uint8_t status) override;
+  bool StatusIsClosing(uint8_t status) override;
+
+  // The trace recorded so far.
+  const std::string& trace() const { return trace_; }
+  size_t num_records() const { return num_records_; }
+
+  // Writes the trace to the file at path. Returns true if successful.
+  bool WriteTraceToFile(const std::string& path) const;
+
+ private:
+  // Returns a record for a call starting now.
+  PnapiTraceRecord StartRecord(PnapiMethod method, SocketNumber sock_num = 0);
+  void AppendRecord(const PnapiTraceRecord& record);
+
+  std::function<absl::Time()> clock_;
+  absl::Time last_call_time_;
+  std::string trace_;
+  size_t num_records_{0};
+};
+
+}  // namespace mcunet_host
+
+#endif  // MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_RECORDING_PLATFORM_NETWORK_H_
@@ -0,0 +1,333 @@
+#include "extras/host/platform_network/replay_platform_network.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/log/log.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "extras/host/platform_network/pnapi_trace.h"
+
+namespace mcunet_host {
+
+std::string ReplayReport::ToString() const {
+  std::string result = absl::StrCat(
+      "calls=", calls, " matched=", matched_calls, " unmatched=",
+      unmatched_calls, " skipped_records=", skipped_records,
+      " remaining_records=", remaining_records, " bytes_sent=", bytes_sent,
+      " bytes_received=", bytes_received,
+      " simulated_time=", absl::FormatDuration(simulated_time));
+  for (const auto& connection : connections) {
+    absl::StrAppend(&result, "\n  socket ", connection.sock_num,
+                    ": calls=", connection.calls,
+                    " bytes_sent=", connection.bytes_sent,
+                    " bytes_received=", connection.bytes_received,
+                    " simulated_time=",
+                    absl::FormatDuration(connection.simulated_time));
+  }
+  return result;
+}
+
+ReplayPlatformNetwork::ReplayPlatformNetwork(std::string_view trace,
+                                             const size_t resync_window)
+    : ok_(false), resync_window_(resync_window) {
+  PnapiTraceReader reader(trace);
+  PnapiTraceRecord record;
+  // Time of the predicate records, which are removed from the sequence, is
+  // carried forward to the next record.
+  absl::Duration carried_time;
+  while (reader.Next(record)) {
+    if (PnapiMethodIsStatusPredicate(record.method)) {
+      predicates_[{record.method, record.status}] = record.result != 0;
+      carried_time += record.elapsed;
+    } else {
+      record.elapsed += carried_time;
+      carried_time = absl::ZeroDuration();
+      records_.push_back(std::move(record));
+    }
+  }
+  ok_ = reader.ok();
+  VLOG(1) << "ReplayPlatformNetwork loaded " << records_.size() << " records";
+}
+
+ReplayReport ReplayPlatformNetwork::Report() const {
+  ReplayReport report = report_;
+  report.remaining_records = records_.size() - next_record_;
+  for (const auto& [sock_num, open] : open_connections_) {
+    report.connections.push_back(open.report);
+    report.connections.back().simulated_time =
+        report_.simulated_time - open.start_time;
+  }
+  return report;
+}
+
+const PnapiTraceRecord* ReplayPlatformNetwork::Match(
+    const PnapiMethod method, const SocketNumber sock_num,
+    const uint16_t tcp_port) {
+  ++report_.calls;
+  const size_t limit =
+      std::min(records_.size(), next_record_ + resync_window_ + 1);
+  for (size_t ndx = next_record_; ndx < limit; ++ndx) {
+    const auto& record = records_[ndx];
+    if (record.method == method && record.sock_num == sock_num &&
+        record.tcp_port == tcp_port) {
+      for (size_t consumed = next_record_; consumed <= ndx; ++consumed) {
+        report_.simulated_time += records_[consumed].elapsed;
+      }
+      report_.skipped_records += ndx - next_record_;
+      next_record_ = ndx + 1;
+      ++report_.matched_calls;
+      return &record;
+    }
+  }
+  VLOG(2) << "No match for " << PnapiMethodName(method) << " on socket "
+          << sock_num;
+  ++report_.unmatched_calls;
+  return nullptr;
+}
+
+bool ReplayPlatformNetwork::Predicate(const PnapiMethod method,
+                                      const uint8_t status) const {
+  const auto it = predicates_.find({method, status});
+  return it != predicates_.end() && it->second;
+}
+
+void ReplayPlatformNetwork::CountCall(const SocketNumber sock_num,
+                                      const int64_t bytes_sent,
+                                      const int64_t bytes_received) {
+  report_.bytes_sent += bytes_sent;
+  report_.bytes_received += bytes_received;
+  auto it = open_connections_.find(sock_num);
+  if (it != open_connections_.end()) {
+    ++it->second.report.calls;
+    it->second.report.bytes_sent += bytes_sent;
+    it->second.report.bytes_received += bytes_received;
+  }
+}
+
+void ReplayPlatformNetwork::NoteStatus(const SocketNumber sock_num,
+                                       const uint8_t status) {
+  last_status_[sock_num] = status;
+  const bool is_open = Predicate(PnapiMethod::kStatusIsOpen, status);
+  const bool was_open = open_connections_.count(sock_num) > 0;
+  if (is_open && !was_open) {
+    OpenConnection& open = open_connections_[sock_num];
+    open.report.sock_num = sock_num;
+    open.start_time = report_.simulated_time;
+  } else if (!is_open && was_open) {
+    EndConnection(sock_num);
+  }
+}
+
+void ReplayPlatformNetwork::EndConnection(const SocketNumber sock_num) {
+  auto it = open_connections_.find(sock_num);
+  if (it == open_connections_.end()) {
+    return;
+  }
+  ReplayConnectionReport report = it->second.report;
+  report.simulated_time = report_.simulated_time - it->second.start_time;
+  report_.connections.push_back(report);
+  open_connections_.erase(it);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Methods getting the status of a socket.
+
+int ReplayPlatformNetwork::FindUnusedSocket() {
+  const auto* record = Match(PnapiMethod::kFindUnusedSocket, 0);
+  return record != nullptr ? record->result : -1;
+}
+
+uint16_t ReplayPlatformNetwork::SocketIsTcpListener(SocketNumber sock_num) {
+  const auto* record = Match(PnapiMethod::kSocketIsTcpListener, sock_num);
+  CountCall(sock_num);
+  return record != nullptr ? record->result : 0;
+}
+
+bool ReplayPlatformNetwork::SocketIsInTcpConnectionLifecycle(
+    SocketNumber sock_num) {
+  const auto* record =
+      Match(PnapiMethod::kSocketIsInTcpConnectionLifecycle, sock_num);
+  CountCall(sock_num);
+  return record != nullptr ? record->result != 0
+                           : open_connections_.count(sock_num) > 0;
+}
+
+bool ReplayPlatformNetwork::SocketIsHalfClosed(SocketNumber sock_num) {
+  const auto* record = Match(PnapiMethod::kSocketIsHalfClosed, sock_num);
+  CountCall(sock_num);
+  return record != nullptr && record->result != 0;
+}
+
+bool ReplayPlatformNetwork::SocketIsClosed(SocketNumber sock_num) {
+  const auto* record = Match(PnapiMethod::kSocketIsClosed, sock_num);
+  CountCall(sock_num);
+  return record != nullptr ? record->result != 0
+                           : last_status_[sock_num] == 0;
+}
+
+uint8_t ReplayPlatformNetwork::SocketStatus(SocketNumber sock_num) {
+  const auto* record = Match(PnapiMethod::kSocketStatus, sock_num);
+  const uint8_t status =
+      record != nullptr ? record->result : last_status_[sock_num];
+  NoteStatus(sock_num, status);
+  CountCall(sock_num);
+  return status;
+}
+
+IPAddress ReplayPlatformNetwork::RemoteAddress(SocketNumber sock_num) {
+  const auto* record = Match(PnapiMethod::kRemoteAddress, sock_num);
+  CountCall(sock_num);
+  if (record == nullptr) {
+    return IPAddress();
+  }
+  const auto address = static_cast<uint32_t>(record->result);
+  return IPAddress(address >> 24, address >> 16, address >> 8, address);
+}
+
+uint16_t ReplayPlatformNetwork::RemotePort(SocketNumber sock_num) {
+  const auto* record = Match(PnapiMethod::kRemotePort, sock_num);
+  CountCall(sock_num);
+  return record != nullptr ? record->result : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Methods modifying sockets.
+
+bool ReplayPlatformNetwork::InitializeTcpListenerSocket(SocketNumber sock_num,
+                                                        uint16_t tcp_port) {
+  const auto* record =
+      Match(PnapiMethod::kInitializeTcpListenerSocket, sock_num, tcp_port);
+  return record != nullptr && record->result != 0;
+}
+
+bool ReplayPlatformNetwork::AcceptConnection(SocketNumber sock_num) {
+  const auto* record = Match(PnapiMethod::kAcceptConnection, sock_num);
+  CountCall(sock_num);
+  return record != nullptr && record->result != 0;
+}
+
+bool ReplayPlatformNetwork::DisconnectSocket(SocketNumber sock_num) {
+  const auto* record = Match(PnapiMethod::kDisconnectSocket, sock_num);
+  CountCall(sock_num);
+  return record == nullptr || record->result != 0;
+}
+
+bool ReplayPlatformNetwork::CloseSocket(SocketNumber sock_num) {
+  const auto* record = Match(PnapiMethod::kCloseSocket, sock_num);
+  CountCall(sock_num);
+  EndConnection(sock_num);
+  pending_recv_.erase(sock_num);
+  return record == nullptr || record->result != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Methods using open sockets.
+
+ssize_t ReplayPlatformNetwork::Send(SocketNumber sock_num, const uint8_t* buf,
+                                    size_t len) {
+  const auto* record = Match(PnapiMethod::kSend, sock_num);
+  ssize_t result = len;
+  if (record != nullptr && record->result < result) {
+    result = record->result;
+  }
+  CountCall(sock_num, std::max<ssize_t>(result, 0));
+  return result;
+}
+
+void ReplayPlatformNetwork::Flush(SocketNumber sock_num) {
+  Match(PnapiMethod::kFlush, sock_num);
+  CountCall(sock_num);
+}
+
+ssize_t ReplayPlatformNetwork::TxFreeBytes(SocketNumber sock_num) {
+  const auto* record = Match(PnapiMethod::kTxFreeBytes, sock_num);
+  CountCall(sock_num);
+  return record != nullptr ? record->result : -1;
+}
+
+ssize_t ReplayPlatformNetwork::TrySend(SocketNumber sock_num,
+                                       const uint8_t* buf, size_t len) {
+  const auto* record = Match(PnapiMethod::kTrySend, sock_num);
+  ssize_t result = len;
+  if (record != nullptr && record->result < result) {
+    result = record->result;
+  }
+  CountCall(sock_num, std::max<ssize_t>(result, 0));
+  return result;
+}
+
+ssize_t ReplayPlatformNetwork::AvailableBytes(SocketNumber sock_num) {
+  const auto it = pending_recv_.find(sock_num);
+  if (it != pending_recv_.end()) {
+    // The recorded code had already read these bytes, so didn't make this
+    // call.
+    return it->second.size();
+  }
+  const auto* record = Match(PnapiMethod::kAvailableBytes, sock_num);
+  CountCall(sock_num);
+  return record != nullptr ? record->result : 0;
+}
+
+int ReplayPlatformNetwork::Peek(SocketNumber sock_num) {
+  const auto it = pending_recv_.find(sock_num);
+  if (it != pending_recv_.end()) {
+    return static_cast<uint8_t>(it->second.front());
+  }
+  const auto* record = Match(PnapiMethod::kPeek, sock_num);
+  CountCall(sock_num);
+  return record != nullptr ? record->result : -1;
+}
+
+ssize_t ReplayPlatformNetwork::Recv(SocketNumber sock_num, uint8_t* buf,
+                                    size_t len) {
+  auto it = pending_recv_.find(sock_num);
+  if (it == pending_recv_.end()) {
+    const auto* record = Match(PnapiMethod::kRecv, sock_num);
+    if (record == nullptr) {
+      CountCall(sock_num);
+      return -1;
+    } else if (record->result <= 0) {
+      CountCall(sock_num);
+      return record->result;
+    }
+    it = pending_recv_.emplace(sock_num, record->data).first;
+  } else {
+    // Served from bytes which the recorded code read with a single call.
+    ++report_.calls;
+    ++report_.matched_calls;
+  }
+  std::string& pending = it->second;
+  const size_t size = std::min(pending.size(), len);
+  std::memcpy(buf, pending.data(), size);
+  pending.erase(0, size);
+  if (pending.empty()) {
+    pending_recv_.erase(it);
+  }
+  CountCall(sock_num, 0, size);
+  return size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Methods for checking the interpretation of the status value.
+
+bool ReplayPlatformNetwork::StatusIsOpen(uint8_t status) {
+  return Predicate(PnapiMethod::kStatusIsOpen, status);
+}
+
+bool ReplayPlatformNetwork::StatusIsHalfClosed(uint8_t status) {
+  return Predicate(PnapiMethod::kStatusIsHalfClosed, status);
+}
+
+bool ReplayPlatformNetwork::StatusIsClosing(uint8_t status) {
+  return Predicate(PnapiMethod::kStatusIsClosing, status);
+}
+
+}  // namespace mcunet_host
@@ -0,0 +1,144 @@
+#ifndef MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_REPLAY_PLATFORM_NETWORK_H_
+#define MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_REPLAY_PLATFORM_NETWORK_H_
+
+// ReplayPlatformNetwork implements PlatformNetworkInterface by replaying a
+// trace recorded by RecordingPlatformNetwork, for the purpose of running the
+// same session against a new build of the code which uses PlatformNetwork
+// (e.g. ServerSocket and WriteBufferedConnection), and comparing the cost.
+//
+// Each call is matched against the next record of the trace for the same
+// method and socket (and tcp_port for InitializeTcpListenerSocket), and the
+// recorded result is returned; for Recv, the recorded bytes are copied into
+// the caller's buffer. Results of Send and TrySend are limited to the length
+// requested by the caller. If a recorded Recv returned more bytes than the
+// caller now asks for, the rest are returned by the following Recv calls
+// (before matching another record), and are reported by AvailableBytes and
+// Peek.
+//
+// The new code may not make exactly the same calls as the recorded code (e.g.
+// it may check SocketStatus less often), so if the next record doesn't match,
+// the following records (up to resync_window of them) are searched for a
+// match, and those before the match are skipped. If there is no match, the
+// call is counted as unmatched, and a neutral result is returned (e.g. the
+// last status returned for the socket, or zero bytes available).
+//
+// Calls to StatusIsOpen, StatusIsHalfClosed and StatusIsClosing are answered
+// from a table built from all of the records of those methods, as their
+// results depend only on their argument.
+//
+// The trace also provides the simulated time, i.e. the recorded time between
+// calls, summed over the records consumed.
+//
+// Author: james.synge@gmail.com
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "extras/host/platform_network/pnapi_trace.h"
+#include "platform_network_interface.h"
+
+namespace mcunet_host {
+
+// Costs attributed to one connection, from the call which first reported it
+// as open, until it was reported as not open or was closed. For HTTP/1.0
+// style clients that is one request.
+struct ReplayConnectionReport {
+  ::mcunet::SocketNumber sock_num = 0;
+  int64_t calls = 0;
+  int64_t bytes_sent = 0;
+  int64_t bytes_received = 0;
+  absl::Duration simulated_time;
+};
+
+struct ReplayReport {
+  // Calls made to the ReplayPlatformNetwork (excluding StatusIsOpen, etc.).
+  int64_t calls = 0;
+  int64_t matched_calls = 0;
+  int64_t unmatched_calls = 0;
+  // Records skipped while searching for a match.
+  int64_t skipped_records = 0;
+  // Records not yet consumed.
+  int64_t remaining_records = 0;
+
+  int64_t bytes_sent = 0;
+  int64_t bytes_received = 0;
+  absl::Duration simulated_time;
+
+  std::vector<ReplayConnectionReport> connections;
+
+  std::string ToString() const;
+};
+
+class ReplayPlatformNetwork : public ::mcunet::PlatformNetworkInterface {
+ public:
+  using SocketNumber = ::mcunet::SocketNumber;
+
+  static constexpr size_t kDefaultResyncWindow = 64;
+
+  explicit ReplayPlatformNetwork(std::string_view trace,
+                                 size_t resync_window = kDefaultResyncWindow);
+
+  // Returns false if the trace couldn't be decoded.
+  bool ok() const { return ok_; }
+
+  // Returns true if all of the records have been consumed.
+  bool AtEnd() const { return next_record_ >= records_.size(); }
+
+  // Returns the report of the replay so far; connections still open are
+  // included.
+  ReplayReport Report() const;
+
+#ifdef MCUNET_PNAPI_METHOD
+#error "MCUNET_PNAPI_METHOD should not be defined!!"
+#endif
+
+#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS, ARG_NAMES) \
+  TYPE NAME ARGS override
+#include "platform_network_api.cc.inc"  // IWYU pragma: export
+#undef MCUNET_PNAPI_METHOD
+
+ private:
+  struct OpenConnection {
+    ReplayConnectionReport report;
+    absl::Duration start_time;
+  };
+
+  // Finds the next record for the call, consuming it and those skipped to
+  // reach it. Returns nullptr if there is no match within the window.
+  const PnapiTraceRecord* Match(PnapiMethod method, SocketNumber sock_num,
+                                uint16_t tcp_port = 0);
+
+  bool Predicate(PnapiMethod method, uint8_t status) const;
+
+  // Attributes the call (and bytes) to the open connection of the socket, if
+  // there is one.
+  void CountCall(SocketNumber sock_num, int64_t bytes_sent = 0,
+                 int64_t bytes_received = 0);
+
+  // Tracks the start and end of connections based on the status returned.
+  void NoteStatus(SocketNumber sock_num, uint8_t status);
+  void EndConnection(SocketNumber sock_num);
+
+  bool ok_;
+  const size_t resync_window_;
+  std::vector<PnapiTraceRecord> records_;
+  size_t next_record_{0};
+  std::map<std::pair<PnapiMethod, uint8_t>, bool> predicates_;
+  std::map<SocketNumber, uint8_t> last_status_;
+  std::map<SocketNumber, OpenConnection> open_connections_;
+  // Bytes of recorded Recv results not yet read by the caller.
+  std::map<SocketNumber, std::string> pending_recv_;
+  ReplayReport report_;
+};
+
+}  // namespace mcunet_host
+
+#endif  // MCUNET_EXTRAS_HOST_PLATFORM_NETWORK_REPLAY_PLATFORM_NETWORK_H_
@@ -0,0 +1,181 @@
+#include "extras/host/platform_network/fault_injecting_platform_network.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "absl/time/time.h"
+#include "extras/test_tools/mock_platform_network.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace mcunet_host {
+namespace test {
+namespace {
+
+using ::mcunet::test::MockPlatformNetwork;
+using ::testing::_;
+using ::testing::AnyNumber;
+using ::testing::Return;
+
+constexpr uint8_t kListen = 0x14;
+constexpr uint8_t kEstablished = 0x17;
+constexpr uint8_t kCloseWait = 0x1C;
+
+class FaultInjectingPlatformNetworkTest : public testing::Test {
+ protected:
+  FaultInjectingPlatformNetworkTest() {
+    options_.sleep = [this](absl::Duration delay) { delays_.push_back(delay); };
+    options_.clock = [this]() { return now_; };
+  }
+
+  MockPlatformNetwork mock_;
+  FaultInjectionOptions options_;
+  std::vector<absl::Duration> delays_;
+  absl::Time now_ = absl::UnixEpoch();
+};
+
+TEST_F(FaultInjectingPlatformNetworkTest, NoFaultsByDefault) {
+  FaultInjectingPlatformNetwork network(mock_, options_);
+  uint8_t buf[100];
+  EXPECT_CALL(mock_, Send(1, buf, 100)).WillOnce(Return(100));
+  EXPECT_CALL(mock_, Recv(1, buf, 100)).WillOnce(Return(50));
+  EXPECT_CALL(mock_, SocketStatus(1)).WillOnce(Return(kListen));
+  EXPECT_EQ(network.Send(1, buf, 100), 100);
+  EXPECT_EQ(network.Recv(1, buf, 100), 50);
+  EXPECT_EQ(network.SocketStatus(1), kListen);
+  EXPECT_TRUE(delays_.empty());
+}
+
+TEST_F(FaultInjectingPlatformNetworkTest, Delays) {
+  options_.delay_probability = 1;
+  options_.min_delay = absl::Milliseconds(5);
+  options_.max_delay = absl::Milliseconds(10);
+  FaultInjectingPlatformNetwork network(mock_, options_);
+  uint8_t buf[10];
+  EXPECT_CALL(mock_, Recv(2, buf, 10)).Times(20).WillRepeatedly(Return(0));
+  for (int i = 0; i < 20; ++i) {
+    network.Recv(2, buf, 10);
+  }
+  ASSERT_EQ(delays_.size(), 20);
+  for (const auto delay : delays_) {
+    EXPECT_GE(delay, options_.min_delay);
+    EXPECT_LE(delay, options_.max_delay);
+  }
+  EXPECT_EQ(network.counts().delays, 20);
+}
+
+TEST_F(FaultInjectingPlatformNetworkTest, PartialSendsAndRecvs) {
+  options_.partial_send_probability = 1;
+  options_.partial_recv_probability = 1;
+  FaultInjectingPlatformNetwork network(mock_, options_);
+  uint8_t buf[100];
+  size_t send_len = 0, recv_len = 0;
+  EXPECT_CALL(mock_, Send(1, buf, _))
+      .WillOnce([&](auto, auto, size_t len) {
+        send_len = len;
+        return len;
+      });
+  EXPECT_CALL(mock_, Recv(1, buf, _))
+      .WillOnce([&](auto, auto, size_t len) {
+        recv_len = len;
+        return len;
+      });
+  EXPECT_EQ(network.Send(1, buf, 100), send_len);
+  EXPECT_EQ(network.Recv(1, buf, 100), recv_len);
+  EXPECT_GE(send_len, 1);
+  EXPECT_LT(send_len, 100);
+  EXPECT_GE(recv_len, 1);
+  EXPECT_LT(recv_len, 100);
+
+  // A single byte can't be split.
+  EXPECT_CALL(mock_, TrySend(1, buf, 1)).WillOnce(Return(1));
+  EXPECT_EQ(network.TrySend(1, buf, 1), 1);
+  EXPECT_EQ(network.counts().partial_sends, 1);
+  EXPECT_EQ(network.counts().partial_recvs, 1);
+}
+
+TEST_F(FaultInjectingPlatformNetworkTest, SpuriousStatusOnlyWhenListening) {
+  options_.spurious_status_probability = 1;
+  FaultInjectingPlatformNetwork network(mock_, options_);
+  EXPECT_CALL(mock_, SocketStatus(1)).WillRepeatedly(Return(kListen));
+  EXPECT_CALL(mock_, SocketIsTcpListener(1)).WillRepeatedly(Return(80));
+  EXPECT_EQ(network.SocketStatus(1), 0x11);
+
+  EXPECT_CALL(mock_, SocketStatus(2)).WillRepeatedly(Return(kEstablished));
+  EXPECT_CALL(mock_, SocketIsTcpListener(2)).WillRepeatedly(Return(0));
+  EXPECT_EQ(network.SocketStatus(2), kEstablished);
+  EXPECT_EQ(network.counts().spurious_statuses, 1);
+}
+
+TEST_F(FaultInjectingPlatformNetworkTest, ResetClosesTheSocket) {
+  options_.reset_probability = 1;
+  FaultInjectingPlatformNetwork network(mock_, options_);
+  uint8_t buf[10];
+  EXPECT_CALL(mock_, SocketStatus(1)).WillOnce(Return(kEstablished));
+  EXPECT_CALL(mock_, StatusIsOpen(kEstablished)).WillOnce(Return(true));
+  EXPECT_CALL(mock_, CloseSocket(1)).WillOnce(Return(true));
+  EXPECT_CALL(mock_, Send(_, _, _)).Times(0);
+  EXPECT_EQ(network.Send(1, buf, 10), -1);
+  EXPECT_EQ(network.counts().resets, 1);
+}
+
+TEST_F(FaultInjectingPlatformNetworkTest, StallsInCloseWait) {
+  options_.close_wait_stall_probability = 1;
+  options_.close_wait_stall_duration = absl::Seconds(2);
+  FaultInjectingPlatformNetwork network(mock_, options_);
+  EXPECT_CALL(mock_, SocketIsHalfClosed(1)).WillRepeatedly(Return(true));
+  EXPECT_CALL(mock_, SocketStatus(1)).WillRepeatedly(Return(kCloseWait));
+
+  // The stall starts, and continues until the duration has passed...
+  EXPECT_CALL(mock_, DisconnectSocket(1)).Times(0);
+  EXPECT_TRUE(network.DisconnectSocket(1));
+  now_ += absl::Seconds(1);
+  EXPECT_TRUE(network.DisconnectSocket(1));
+  EXPECT_EQ(network.SocketStatus(1), kCloseWait);
+  testing::Mock::VerifyAndClearExpectations(&mock_);
+
+  // ... after which the disconnect goes through.
+  now_ += absl::Seconds(1);
+  EXPECT_CALL(mock_, DisconnectSocket(1)).WillOnce(Return(true));
+  EXPECT_TRUE(network.DisconnectSocket(1));
+  EXPECT_EQ(network.counts().close_wait_stalls, 1);
+}
+
+TEST_F(FaultInjectingPlatformNetworkTest, CloseEndsStall) {
+  options_.close_wait_stall_probability = 1;
+  FaultInjectingPlatformNetwork network(mock_, options_);
+  EXPECT_CALL(mock_, SocketIsHalfClosed(1))
+      .WillOnce(Return(true))
+      .WillOnce(Return(false));
+  EXPECT_TRUE(network.DisconnectSocket(1));
+  EXPECT_CALL(mock_, CloseSocket(1)).WillOnce(Return(true));
+  EXPECT_TRUE(network.CloseSocket(1));
+  EXPECT_CALL(mock_, DisconnectSocket(1)).WillOnce(Return(false));
+  EXPECT_FALSE(network.DisconnectSocket(1));
+}
+
+TEST_F(FaultInjectingPlatformNetworkTest, SameSeedSameFaults) {
+  options_.partial_recv_probability = 0.5;
+  uint8_t buf[1000];
+  std::vector<size_t> lens[2];
+  for (auto& run_lens : lens) {
+    FaultInjectingPlatformNetwork network(mock_, options_);
+    EXPECT_CALL(mock_, Recv(1, buf, _))
+        .Times(AnyNumber())
+        .WillRepeatedly([&](auto, auto, size_t len) {
+          run_lens.push_back(len);
+          return len;
+        });
+    for (int i = 0; i < 50; ++i) {
+      network.Recv(1, buf, sizeof buf);
+    }
+    testing::Mock::VerifyAndClearExpectations(&mock_);
+  }
+  EXPECT_EQ(lens[0], lens[1]);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet_host
@@ -0,0 +1,40 @@
+#include "extras/host/platform_network/forwarding_platform_network.h"
+
+#include <stdint.h>
+
+#include "extras/test_tools/mock_platform_network.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace mcunet_host {
+namespace test {
+namespace {
+
+using ::mcunet::test::MockPlatformNetwork;
+using ::testing::Return;
+
+TEST(ForwardingPlatformNetworkTest, ForwardsCalls) {
+  MockPlatformNetwork mock;
+  ForwardingPlatformNetwork forwarder(mock);
+  EXPECT_EQ(&forwarder.wrapped(), &mock);
+
+  EXPECT_CALL(mock, FindUnusedSocket()).WillOnce(Return(3));
+  EXPECT_EQ(forwarder.FindUnusedSocket(), 3);
+
+  EXPECT_CALL(mock, InitializeTcpListenerSocket(3, 80)).WillOnce(Return(true));
+  EXPECT_TRUE(forwarder.InitializeTcpListenerSocket(3, 80));
+
+  uint8_t buf[4] = {1, 2, 3, 4};
+  EXPECT_CALL(mock, Send(3, buf, 4)).WillOnce(Return(2));
+  EXPECT_EQ(forwarder.Send(3, buf, 4), 2);
+
+  EXPECT_CALL(mock, Flush(3));
+  forwarder.Flush(3);
+
+  EXPECT_CALL(mock, StatusIsClosing(0x18)).WillOnce(Return(true));
+  EXPECT_TRUE(forwarder.StatusIsClosing(0x18));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet_host
@@ -0,0 +1,87 @@
+#include "extras/host/platform_network/instrumented_platform_network.h"
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+
+#include "absl/time/time.h"
+#include "extras/test_tools/mock_platform_network.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace mcunet_host {
+namespace test {
+namespace {
+
+using ::mcunet::test::MockPlatformNetwork;
+using ::testing::_;
+using ::testing::HasSubstr;
+using ::testing::Not;
+using ::testing::Return;
+
+// Returns a clock which advances by 5us each time it is read, so that each
+// call appears to take 5us.
+std::function<absl::Time()> SteppingClock() {
+  auto now = std::make_shared<absl::Time>(absl::UnixEpoch());
+  return [now]() { return *now += absl::Microseconds(5); };
+}
+
+TEST(InstrumentedPlatformNetworkTest, CountsCallsBytesAndTime) {
+  MockPlatformNetwork mock;
+  InstrumentedPlatformNetwork instrumented(mock, SteppingClock());
+  EXPECT_CALL(mock, SocketStatus(1)).WillRepeatedly(Return(0x17));
+  EXPECT_CALL(mock, SocketStatus(2)).WillOnce(Return(0x14));
+  EXPECT_CALL(mock, StatusIsOpen(0x17)).WillOnce(Return(true));
+  EXPECT_CALL(mock, Recv(1, _, 100)).WillOnce(Return(40));
+  EXPECT_CALL(mock, Send(1, _, 60)).WillOnce(Return(60));
+  EXPECT_CALL(mock, TrySend(1, _, 60)).WillOnce(Return(-1));
+  EXPECT_CALL(mock, Flush(1));
+
+  uint8_t buf[100];
+  EXPECT_EQ(instrumented.SocketStatus(1), 0x17);
+  EXPECT_EQ(instrumented.SocketStatus(1), 0x17);
+  EXPECT_EQ(instrumented.SocketStatus(2), 0x14);
+  EXPECT_TRUE(instrumented.StatusIsOpen(0x17));
+  EXPECT_EQ(instrumented.Recv(1, buf, 100), 40);
+  EXPECT_EQ(instrumented.Send(1, buf, 60), 60);
+  EXPECT_EQ(instrumented.TrySend(1, buf, 60), -1);
+  instrumented.Flush(1);
+
+  const auto status = instrumented.MethodStats("SocketStatus");
+  EXPECT_EQ(status.calls, 3);
+  EXPECT_EQ(status.time, absl::Microseconds(15));
+  EXPECT_EQ(instrumented.MethodStats("StatusIsOpen").calls, 1);
+  EXPECT_EQ(instrumented.MethodStats("Recv").bytes_received, 40);
+  EXPECT_EQ(instrumented.MethodStats("Send").bytes_sent, 60);
+  EXPECT_EQ(instrumented.MethodStats("TrySend").bytes_sent, 0);
+  EXPECT_EQ(instrumented.MethodStats("Flush").calls, 1);
+  EXPECT_EQ(instrumented.MethodStats("Peek").calls, 0);
+  EXPECT_EQ(instrumented.MethodStats("NoSuchMethod").calls, 0);
+
+  // StatusIsOpen isn't attributed to a socket.
+  const auto socket1 = instrumented.SocketStats(1);
+  EXPECT_EQ(socket1.calls, 6);
+  EXPECT_EQ(socket1.bytes_sent, 60);
+  EXPECT_EQ(socket1.bytes_received, 40);
+  EXPECT_EQ(socket1.time, absl::Microseconds(30));
+  EXPECT_EQ(instrumented.SocketStats(2).calls, 1);
+  EXPECT_EQ(instrumented.SocketStats(3).calls, 0);
+
+  const auto total = instrumented.TotalStats();
+  EXPECT_EQ(total.calls, 8);
+  EXPECT_EQ(total.time, absl::Microseconds(40));
+
+  const auto table = instrumented.ToString();
+  EXPECT_THAT(table, HasSubstr("SocketStatus"));
+  EXPECT_THAT(table, HasSubstr("socket 2"));
+  EXPECT_THAT(table, Not(HasSubstr("Peek")));
+
+  instrumented.Reset();
+  EXPECT_EQ(instrumented.TotalStats().calls, 0);
+  EXPECT_EQ(instrumented.SocketStats(1).calls, 0);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet_host
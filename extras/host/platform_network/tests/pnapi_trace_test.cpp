@@ -0,0 +1,94 @@
+#include "extras/host/platform_network/pnapi_trace.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+
+namespace mcunet_host {
+namespace test {
+namespace {
+
+PnapiTraceRecord MakeRecord(PnapiMethod method, absl::Duration elapsed,
+                            int64_t result) {
+  PnapiTraceRecord record;
+  record.method = method;
+  record.elapsed = elapsed;
+  record.result = result;
+  return record;
+}
+
+TEST(PnapiTraceTest, RoundTrip) {
+  std::vector<PnapiTraceRecord> records;
+  records.push_back(
+      MakeRecord(PnapiMethod::kFindUnusedSocket, absl::ZeroDuration(), -1));
+  records.push_back(MakeRecord(PnapiMethod::kInitializeTcpListenerSocket,
+                               absl::Microseconds(3), 1));
+  records.back().sock_num = 300;
+  records.back().tcp_port = 8080;
+  records.push_back(
+      MakeRecord(PnapiMethod::kSocketStatus, absl::Milliseconds(70), 0x17));
+  records.back().sock_num = 2;
+  records.push_back(
+      MakeRecord(PnapiMethod::kStatusIsOpen, absl::Microseconds(1), 1));
+  records.back().status = 0x17;
+  records.push_back(
+      MakeRecord(PnapiMethod::kRecv, absl::Microseconds(200), 5));
+  records.back().sock_num = 2;
+  records.back().len = 128;
+  records.back().data = "hello";
+  records.push_back(MakeRecord(PnapiMethod::kSend, absl::Seconds(2), 4000));
+  records.back().sock_num = 2;
+  records.back().len = 4096;
+  records.push_back(MakeRecord(PnapiMethod::kFlush, absl::Microseconds(9), 0));
+  records.back().sock_num = 2;
+
+  std::string trace;
+  AppendPnapiTraceHeader(trace);
+  for (const auto& record : records) {
+    AppendPnapiTraceRecord(record, trace);
+  }
+
+  PnapiTraceReader reader(trace);
+  ASSERT_TRUE(reader.ok());
+  PnapiTraceRecord decoded;
+  for (const auto& record : records) {
+    SCOPED_TRACE(PnapiMethodName(record.method));
+    ASSERT_TRUE(reader.Next(decoded));
+    EXPECT_EQ(decoded.method, record.method);
+    EXPECT_EQ(decoded.elapsed, record.elapsed);
+    EXPECT_EQ(decoded.sock_num, record.sock_num);
+    EXPECT_EQ(decoded.tcp_port, record.tcp_port);
+    EXPECT_EQ(decoded.status, record.status);
+    EXPECT_EQ(decoded.len, record.len);
+    EXPECT_EQ(decoded.result, record.result);
+    EXPECT_EQ(decoded.data, record.data);
+  }
+  EXPECT_FALSE(reader.Next(decoded));
+  EXPECT_TRUE(reader.ok());
+}
+
+TEST(PnapiTraceTest, RejectsOtherData) {
+  EXPECT_FALSE(PnapiTraceReader("").ok());
+  EXPECT_FALSE(PnapiTraceReader("GIF89a").ok());
+}
+
+TEST(PnapiTraceTest, DetectsTruncation) {
+  std::string trace;
+  AppendPnapiTraceHeader(trace);
+  auto record = MakeRecord(PnapiMethod::kRecv, absl::Microseconds(1), 5);
+  record.data = "hello";
+  AppendPnapiTraceRecord(record, trace);
+  trace.pop_back();
+
+  PnapiTraceReader reader(trace);
+  ASSERT_TRUE(reader.ok());
+  PnapiTraceRecord decoded;
+  EXPECT_FALSE(reader.Next(decoded));
+  EXPECT_FALSE(reader.ok());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet_host
@@ -0,0 +1,273 @@
+// Tests of RecordingPlatformNetwork and ReplayPlatformNetwork, including
+// recording a session of ServerSocket with HostNetwork, and replaying it.
+
+#include <netinet/in.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "absl/time/time.h"
+#include "extras/host/ethernet5500/host_network.h"
+#include "extras/host/platform_network/pnapi_trace.h"
+#include "extras/host/platform_network/recording_platform_network.h"
+#include "extras/host/platform_network/replay_platform_network.h"
+#include "extras/test_tools/mock_platform_network.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "platform_network_interface.h"
+#include "server_socket.h"
+#include "socket_listener.h"
+
+namespace mcunet_host {
+namespace test {
+namespace {
+
+using ::mcunet::test::MockPlatformNetwork;
+using ::testing::_;
+using ::testing::Return;
+
+class EchoListener : public ::mcunet::ServerSocketListener {
+ public:
+  void OnConnect(::mcunet::Connection& connection) override {}
+  void OnCanRead(::mcunet::Connection& connection) override {
+    uint8_t buffer[64];
+    int size = connection.read(buffer, sizeof(buffer));
+    if (size > 0) {
+      connection.write(buffer, size);
+    }
+  }
+  void OnDisconnect() override { ++disconnects; }
+
+  int disconnects = 0;
+};
+
+// Returns a clock which advances by 10us each time it is read.
+std::function<absl::Time()> SteppingClock() {
+  auto now = std::make_shared<absl::Time>(absl::UnixEpoch());
+  return [now]() { return *now += absl::Microseconds(10); };
+}
+
+TEST(RecordReplayTest, RecordedResultsAreReplayed) {
+  MockPlatformNetwork mock;
+  RecordingPlatformNetwork recorder(mock, SteppingClock());
+  EXPECT_CALL(mock, FindUnusedSocket()).WillOnce(Return(1));
+  EXPECT_CALL(mock, SocketStatus(1)).WillOnce(Return(0x17));
+  EXPECT_CALL(mock, StatusIsOpen(0x17)).WillOnce(Return(true));
+  EXPECT_CALL(mock, Recv(1, _, 10)).WillOnce([](auto, uint8_t* buf, auto) {
+    std::memcpy(buf, "abc", 3);
+    return 3;
+  });
+  EXPECT_CALL(mock, Send(1, _, 3)).WillOnce(Return(2));
+  EXPECT_CALL(mock, CloseSocket(1)).WillOnce(Return(true));
+
+  uint8_t buf[10];
+  EXPECT_EQ(recorder.FindUnusedSocket(), 1);
+  EXPECT_EQ(recorder.SocketStatus(1), 0x17);
+  EXPECT_TRUE(recorder.StatusIsOpen(0x17));
+  EXPECT_EQ(recorder.Recv(1, buf, 10), 3);
+  EXPECT_EQ(recorder.Send(1, buf, 3), 2);
+  EXPECT_TRUE(recorder.CloseSocket(1));
+  EXPECT_EQ(recorder.num_records(), 6);
+
+  ReplayPlatformNetwork replay(recorder.trace());
+  ASSERT_TRUE(replay.ok());
+  uint8_t replay_buf[10] = {0};
+  EXPECT_TRUE(replay.StatusIsOpen(0x17));
+  EXPECT_FALSE(replay.StatusIsOpen(0x14));
+  EXPECT_EQ(replay.FindUnusedSocket(), 1);
+  EXPECT_EQ(replay.SocketStatus(1), 0x17);
+  EXPECT_EQ(replay.Recv(1, replay_buf, 10), 3);
+  EXPECT_EQ(std::string(reinterpret_cast<char*>(replay_buf), 3), "abc");
+  EXPECT_EQ(replay.Send(1, replay_buf, 3), 2);
+  EXPECT_TRUE(replay.CloseSocket(1));
+  EXPECT_TRUE(replay.AtEnd());
+
+  const auto report = replay.Report();
+  EXPECT_EQ(report.calls, 5);
+  EXPECT_EQ(report.matched_calls, 5);
+  EXPECT_EQ(report.unmatched_calls, 0);
+  EXPECT_EQ(report.bytes_sent, 2);
+  EXPECT_EQ(report.bytes_received, 3);
+  EXPECT_EQ(report.simulated_time, absl::Microseconds(60));
+  ASSERT_EQ(report.connections.size(), 1);
+  EXPECT_EQ(report.connections[0].sock_num, 1);
+  EXPECT_EQ(report.connections[0].calls, 4);
+  EXPECT_EQ(report.connections[0].bytes_received, 3);
+  // From the start of the SocketStatus call to the start of CloseSocket.
+  EXPECT_EQ(report.connections[0].simulated_time, absl::Microseconds(40));
+}
+
+TEST(RecordReplayTest, RemoteAddressAndPortAreReplayed) {
+  MockPlatformNetwork mock;
+  RecordingPlatformNetwork recorder(mock);
+  EXPECT_CALL(mock, RemoteAddress(2))
+      .WillOnce(Return(IPAddress(192, 168, 7, 254)));
+  EXPECT_CALL(mock, RemotePort(2)).WillOnce(Return(54321));
+  EXPECT_EQ(recorder.RemoteAddress(2), IPAddress(192, 168, 7, 254));
+  EXPECT_EQ(recorder.RemotePort(2), 54321);
+
+  ReplayPlatformNetwork replay(recorder.trace());
+  ASSERT_TRUE(replay.ok());
+  EXPECT_EQ(replay.RemoteAddress(2), IPAddress(192, 168, 7, 254));
+  EXPECT_EQ(replay.RemotePort(2), 54321);
+  EXPECT_TRUE(replay.AtEnd());
+  // Calls beyond the end of the trace get the values for no connection.
+  EXPECT_EQ(replay.RemoteAddress(2), IPAddress());
+  EXPECT_EQ(replay.RemotePort(2), 0);
+}
+
+TEST(RecordReplayTest, LongRecvIsReplayedThroughSmallerReads) {
+  std::string data(100, '\0');
+  for (size_t ndx = 0; ndx < data.size(); ++ndx) {
+    data[ndx] = static_cast<char>('A' + ndx % 26);
+  }
+  MockPlatformNetwork mock;
+  RecordingPlatformNetwork recorder(mock);
+  EXPECT_CALL(mock, Recv(1, _, 100)).WillOnce([&](auto, uint8_t* buf, auto) {
+    std::memcpy(buf, data.data(), data.size());
+    return 100;
+  });
+  EXPECT_CALL(mock, AvailableBytes(1)).WillOnce(Return(0));
+  uint8_t buf[100];
+  EXPECT_EQ(recorder.Recv(1, buf, sizeof buf), 100);
+  EXPECT_EQ(recorder.AvailableBytes(1), 0);
+
+  ReplayPlatformNetwork replay(recorder.trace());
+  uint8_t half[50];
+  EXPECT_EQ(replay.Recv(1, half, sizeof half), 50);
+  EXPECT_EQ(std::string(reinterpret_cast<char*>(half), 50), data.substr(0, 50));
+  // The rest of the recorded bytes are still available.
+  EXPECT_EQ(replay.AvailableBytes(1), 50);
+  EXPECT_EQ(replay.Peek(1), data[50]);
+  EXPECT_EQ(replay.Recv(1, half, sizeof half), 50);
+  EXPECT_EQ(std::string(reinterpret_cast<char*>(half), 50), data.substr(50));
+  EXPECT_EQ(replay.AvailableBytes(1), 0);
+  EXPECT_TRUE(replay.AtEnd());
+  const auto report = replay.Report();
+  EXPECT_EQ(report.bytes_received, 100);
+  EXPECT_EQ(report.unmatched_calls, 0);
+}
+
+TEST(RecordReplayTest, ResyncsWhenCallsDiffer) {
+  MockPlatformNetwork mock;
+  RecordingPlatformNetwork recorder(mock);
+  EXPECT_CALL(mock, AvailableBytes(0)).WillRepeatedly(Return(0));
+  EXPECT_CALL(mock, AvailableBytes(1)).WillOnce(Return(7));
+  recorder.AvailableBytes(0);
+  recorder.AvailableBytes(0);
+  recorder.AvailableBytes(1);
+
+  ReplayPlatformNetwork replay(recorder.trace());
+  // The new code doesn't poll socket 0 as often; the skipped record is
+  // counted, and the result for socket 1 is still found.
+  EXPECT_EQ(replay.AvailableBytes(0), 0);
+  EXPECT_EQ(replay.AvailableBytes(1), 7);
+  // And it makes a call the old code didn't.
+  EXPECT_EQ(replay.AvailableBytes(1), 0);
+  const auto report = replay.Report();
+  EXPECT_EQ(report.matched_calls, 2);
+  EXPECT_EQ(report.skipped_records, 1);
+  EXPECT_EQ(report.unmatched_calls, 1);
+  EXPECT_EQ(report.remaining_records, 0);
+}
+
+// Calls server_socket.PerformIO until pred returns true (or too many
+// iterations), and returns the number of calls to PerformIO.
+template <typename Predicate>
+int PerformIOUntil(::mcunet::ServerSocket& server_socket, Predicate pred) {
+  int loops = 0;
+  while (!pred() && loops < 100000) {
+    server_socket.PerformIO();
+    ++loops;
+  }
+  EXPECT_TRUE(pred());
+  return loops;
+}
+
+// Returns the port of the first listener initialized in the trace.
+uint16_t RecordedTcpPort(std::string_view trace) {
+  PnapiTraceReader reader(trace);
+  PnapiTraceRecord record;
+  while (reader.Next(record)) {
+    if (record.method == PnapiMethod::kInitializeTcpListenerSocket) {
+      return record.tcp_port;
+    }
+  }
+  ADD_FAILURE() << "No listener in trace";
+  return 0;
+}
+
+TEST(RecordReplayTest, ReplaysServerSocketSession) {
+  const std::string kMessage = "Hello, replay!";
+  std::string trace;
+  int recorded_loops = 0;
+  {
+    HostNetwork host_network(2);
+    RecordingPlatformNetwork recorder(host_network);
+    ::mcunet::PlatformNetworkThreadBinding binding(&recorder);
+    EchoListener listener;
+    const auto tcp_port = HostNetwork::FindFreeTcpPort();
+    ::mcunet::ServerSocket server_socket(tcp_port, listener);
+    ASSERT_TRUE(server_socket.PickClosedSocket());
+
+    const int peer_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(peer_fd, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(tcp_port);
+    ASSERT_EQ(
+        ::connect(peer_fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr),
+        0);
+    ASSERT_EQ(::send(peer_fd, kMessage.data(), kMessage.size(), 0),
+              kMessage.size());
+
+    std::string echoed;
+    recorded_loops += PerformIOUntil(server_socket, [&]() {
+      char buf[64];
+      const auto size = ::recv(peer_fd, buf, sizeof buf, MSG_DONTWAIT);
+      if (size > 0) {
+        echoed.append(buf, size);
+      }
+      return echoed.size() >= kMessage.size();
+    });
+    EXPECT_EQ(echoed, kMessage);
+
+    ::close(peer_fd);
+    recorded_loops += PerformIOUntil(
+        server_socket, [&]() { return listener.disconnects > 0; });
+    trace = recorder.trace();
+  }
+
+  ReplayPlatformNetwork replay(trace);
+  ASSERT_TRUE(replay.ok());
+  ::mcunet::PlatformNetworkThreadBinding binding(&replay);
+  EchoListener listener;
+  // Replay needs the same port as was recorded, though nothing listens on it.
+  ::mcunet::ServerSocket server_socket(RecordedTcpPort(trace), listener);
+  ASSERT_TRUE(server_socket.PickClosedSocket());
+  for (int i = 0; i < recorded_loops; ++i) {
+    server_socket.PerformIO();
+  }
+  EXPECT_EQ(listener.disconnects, 1);
+
+  const auto report = replay.Report();
+  EXPECT_EQ(report.unmatched_calls, 0) << report.ToString();
+  EXPECT_EQ(report.skipped_records, 0) << report.ToString();
+  EXPECT_EQ(report.remaining_records, 0) << report.ToString();
+  EXPECT_EQ(report.bytes_received, kMessage.size());
+  EXPECT_EQ(report.bytes_sent, kMessage.size());
+  ASSERT_EQ(report.connections.size(), 1) << report.ToString();
+  EXPECT_EQ(report.connections[0].bytes_received, kMessage.size());
+  EXPECT_GT(report.connections[0].calls, 0);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet_host
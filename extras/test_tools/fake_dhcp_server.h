@@ -0,0 +1,294 @@
+#ifndef MCUNET_EXTRAS_TEST_TOOLS_FAKE_DHCP_SERVER_H_
+#define MCUNET_EXTRAS_TEST_TOOLS_FAKE_DHCP_SERVER_H_
+
+// FakeDhcpServer stands in for both the EthernetUDP socket used by DhcpClient
+// and the DHCP server at the other end of it, allowing DhcpClient (and code
+// using it) to be tested on host. Each packet "sent" by the client is parsed
+// when endPacket is called, and (if responding) a reply is queued, to be
+// returned by a later parsePacket; time is controlled by the test, via the
+// now_millis passed to DhcpClient::PerformIO.
+//
+// To simulate the network round trip, the reply to a message sent while the
+// client is handling a reply is held back until parsePacket has reported that
+// no packet is available, i.e. until the client's next call to PerformIO.
+//
+// The server has a single address to lease (lease_ip), which it offers in
+// response to a DHCPDISCOVER, and ACKs in response to a DHCPREQUEST for that
+// address; a DHCPREQUEST for any other address is NAKed.
+//
+// Author: james.synge@gmail.com
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <deque>
+#include <vector>
+
+#include "extras/host/arduino/ip_address.h"
+#include "extras/host/ethernet5500/ethernet_udp.h"
+
+namespace mcunet {
+namespace test {
+
+class FakeDhcpServer : public EthernetUDP {
+ public:
+  // What the server knows about a message received from the client.
+  struct ClientMessage {
+    uint8_t message_type = 0;
+    IPAddress destination;
+    uint32_t xid = 0;
+    bool broadcast_flag = false;
+    IPAddress ciaddr;
+    IPAddress requested_ip;  // From the requested IP address option.
+    IPAddress server_id;     // From the server identifier option.
+  };
+
+  static constexpr uint8_t kDiscover = 1;
+  static constexpr uint8_t kOffer = 2;
+  static constexpr uint8_t kRequest = 3;
+  static constexpr uint8_t kAck = 5;
+  static constexpr uint8_t kNak = 6;
+
+  // The lease offered.
+  IPAddress server_ip{192, 168, 1, 1};
+  IPAddress lease_ip{192, 168, 1, 50};
+  IPAddress subnet_mask{255, 255, 255, 0};
+  IPAddress router{192, 168, 1, 1};
+  IPAddress dns_server{192, 168, 1, 2};
+  uint32_t lease_seconds = 3600;
+
+  // If false, messages from the client are dropped, as if there were no
+  // server, or no cable.
+  bool responding = true;
+
+  // If true, all DHCPREQUESTs are NAKed.
+  bool nak_requests = false;
+
+  // If not 0.0.0.0, the server identifier in DHCPACKs, as if some other server
+  // had acknowledged the request.
+  IPAddress ack_server_id;
+
+  // If true, the address in DHCPACKs (yiaddr) is 0.0.0.0.
+  bool ack_without_address = false;
+
+  // Added to the transaction id of replies; if non-zero, the replies appear to
+  // be for some other transaction.
+  uint32_t reply_xid_delta = 0;
+
+  // Messages received from the client, in order.
+  std::vector<ClientMessage> received;
+
+  bool is_open() const { return is_open_; }
+
+  int CountReceived(uint8_t message_type) const {
+    int count = 0;
+    for (const auto& message : received) {
+      if (message.message_type == message_type) {
+        ++count;
+      }
+    }
+    return count;
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // EthernetUDP methods.
+
+  uint8_t begin(uint16_t udp_port) override {
+    is_open_ = udp_port == 68;
+    return is_open_ ? 1 : 0;
+  }
+  void stop() override {
+    is_open_ = false;
+    replies_.clear();
+    delayed_replies_.clear();
+    reply_.clear();
+  }
+
+  int beginPacket(IPAddress ip, uint16_t port) override {
+    if (!is_open_ || port != 67) {
+      return 0;
+    }
+    destination_ = ip;
+    packet_.clear();
+    return 1;
+  }
+  size_t write(uint8_t b) override {
+    packet_.push_back(b);
+    return 1;
+  }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    packet_.insert(packet_.end(), buffer, buffer + size);
+    return size;
+  }
+  using EthernetUDP::write;
+  int endPacket() override {
+    HandleClientPacket();
+    return 1;
+  }
+
+  int parsePacket() override {
+    reply_.clear();
+    reply_pos_ = 0;
+    if (replies_.empty()) {
+      replies_.swap(delayed_replies_);
+      return 0;
+    }
+    reply_ = replies_.front();
+    replies_.pop_front();
+    return reply_.size();
+  }
+  int available() override { return reply_.size() - reply_pos_; }
+  int read() override {
+    return reply_pos_ < reply_.size() ? reply_[reply_pos_++] : -1;
+  }
+  int read(uint8_t* buffer, size_t len) override {
+    size_t count = 0;
+    while (count < len && reply_pos_ < reply_.size()) {
+      buffer[count++] = reply_[reply_pos_++];
+    }
+    return count;
+  }
+  int peek() override {
+    return reply_pos_ < reply_.size() ? reply_[reply_pos_] : -1;
+  }
+  void flush() override { reply_pos_ = reply_.size(); }
+  IPAddress remoteIP() override { return server_ip; }
+  uint16_t remotePort() override { return 67; }
+
+ private:
+  static uint32_t GetUint32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) |
+           (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+  }
+  static IPAddress GetIp(const uint8_t* p) {
+    return IPAddress(p[0], p[1], p[2], p[3]);
+  }
+  static void AppendUint32(uint32_t value, std::vector<uint8_t>& out) {
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+  }
+  static void AppendIpOption(uint8_t code, const IPAddress& ip,
+                             std::vector<uint8_t>& out) {
+    out.push_back(code);
+    out.push_back(4);
+    for (int i = 0; i < 4; ++i) {
+      out.push_back(ip[i]);
+    }
+  }
+  static void AppendUint32Option(uint8_t code, uint32_t value,
+                                 std::vector<uint8_t>& out) {
+    out.push_back(code);
+    out.push_back(4);
+    AppendUint32(value, out);
+  }
+
+  void HandleClientPacket() {
+    if (packet_.size() < 240 || packet_[0] != 1) {
+      return;
+    }
+    ClientMessage message;
+    message.destination = destination_;
+    message.xid = GetUint32(&packet_[4]);
+    message.broadcast_flag = (packet_[10] & 0x80) != 0;
+    message.ciaddr = GetIp(&packet_[12]);
+    memcpy(chaddr_, &packet_[28], sizeof chaddr_);
+    for (size_t pos = 240; pos < packet_.size();) {
+      const uint8_t code = packet_[pos++];
+      if (code == 0) {
+        continue;
+      } else if (code == 255 || pos >= packet_.size()) {
+        break;
+      }
+      const uint8_t len = packet_[pos++];
+      if (pos + len > packet_.size()) {
+        break;
+      }
+      const uint8_t* value = &packet_[pos];
+      pos += len;
+      if (code == 53 && len == 1) {
+        message.message_type = value[0];
+      } else if (code == 50 && len == 4) {
+        message.requested_ip = GetIp(value);
+      } else if (code == 54 && len == 4) {
+        message.server_id = GetIp(value);
+      }
+    }
+    received.push_back(message);
+    if (!responding) {
+      return;
+    }
+    if (message.message_type == kDiscover) {
+      QueueReply(kOffer, message.xid);
+    } else if (message.message_type == kRequest) {
+      const IPAddress requested = message.requested_ip == IPAddress()
+                                      ? message.ciaddr
+                                      : message.requested_ip;
+      if (nak_requests || !(requested == lease_ip)) {
+        QueueReply(kNak, message.xid);
+      } else {
+        QueueReply(kAck, message.xid);
+      }
+    }
+  }
+
+  void QueueReply(uint8_t message_type, uint32_t xid) {
+    xid += reply_xid_delta;
+    std::vector<uint8_t> reply(240, 0);
+    reply[0] = 2;  // BOOTREPLY
+    reply[1] = 1;
+    reply[2] = 6;
+    reply[4] = xid >> 24;
+    reply[5] = xid >> 16;
+    reply[6] = xid >> 8;
+    reply[7] = xid;
+    if (message_type != kNak &&
+        !(message_type == kAck && ack_without_address)) {
+      for (int i = 0; i < 4; ++i) {
+        reply[16 + i] = lease_ip[i];
+      }
+    }
+    memcpy(&reply[28], chaddr_, sizeof chaddr_);
+    reply[236] = 99;
+    reply[237] = 130;
+    reply[238] = 83;
+    reply[239] = 99;
+    reply.push_back(53);
+    reply.push_back(1);
+    reply.push_back(message_type);
+    const bool other_server =
+        message_type == kAck && !(ack_server_id == IPAddress());
+    AppendIpOption(54, other_server ? ack_server_id : server_ip, reply);
+    if (message_type != kNak) {
+      AppendUint32Option(51, lease_seconds, reply);
+      AppendUint32Option(58, lease_seconds / 2, reply);
+      AppendUint32Option(59, lease_seconds / 8 * 7, reply);
+      AppendIpOption(1, subnet_mask, reply);
+      AppendIpOption(3, router, reply);
+      AppendIpOption(6, dns_server, reply);
+    }
+    reply.push_back(255);
+    if (reply_.empty()) {
+      replies_.push_back(reply);
+    } else {
+      delayed_replies_.push_back(reply);
+    }
+  }
+
+  bool is_open_ = false;
+  IPAddress destination_;
+  std::vector<uint8_t> packet_;
+  uint8_t chaddr_[6] = {};
+  std::deque<std::vector<uint8_t>> replies_;
+  std::deque<std::vector<uint8_t>> delayed_replies_;
+  std::vector<uint8_t> reply_;
+  size_t reply_pos_ = 0;
+};
+
+}  // namespace test
+}  // namespace mcunet
+
+#endif  // MCUNET_EXTRAS_TEST_TOOLS_FAKE_DHCP_SERVER_H_
@@ -21,7 +21,8 @@ class FakePlatformNetwork : public PlatformNetworkInterface {
 #error "MCUNET_PNAPI_METHOD should not be defined!!"
 #endif
 
-#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS) virtual TYPE NAME ARGS = 0
+#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS, ARG_NAMES) \
+  virtual TYPE NAME ARGS = 0
 #include "platform_network_api.cc.inc"  // IWYU pragma: export
 #undef MCUNET_PNAPI_METHOD
 };
@@ -21,13 +21,13 @@ namespace test {
 
 class FakeWriteBufferedConnection : public WriteBufferedConnection {
  public:
-  FakeWriteBufferedConnection(Client& client, uint8_t sock_num,
+  FakeWriteBufferedConnection(Client& client, SocketNumber sock_num,
                               uint8_t* write_buffer, uint8_t write_buffer_limit)
       : WriteBufferedConnection(write_buffer, write_buffer_limit, client),
         sock_num_(sock_num) {}
 
   template <size_t N>
-  FakeWriteBufferedConnection(Client& client, uint8_t sock_num,
+  FakeWriteBufferedConnection(Client& client, SocketNumber sock_num,
                               std::array<uint8_t, N>& write_buffer)
       : FakeWriteBufferedConnection(client, sock_num, write_buffer.data(),
                                     static_cast<uint8_t>(N)) {
@@ -49,13 +49,13 @@ class FakeWriteBufferedConnection : public WriteBufferedConnection {
     return 0;
   }
 
-  uint8_t sock_num() const override { return sock_num_; }
+  SocketNumber sock_num() const override { return sock_num_; }
 
   // We make setWriteError public for testing.
   using WriteBufferedConnection::setWriteError;
 
  private:
-  const uint8_t sock_num_;
+  const SocketNumber sock_num_;
   size_t close_count_{0};
 };
 
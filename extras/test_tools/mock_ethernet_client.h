@@ -49,7 +49,7 @@ class MockEthernetClient : public EthernetClient {
 
   // EthernetClient metods:
   MOCK_METHOD(uint8_t, status, (), (override));
-  MOCK_METHOD(uint8_t, getSocketNumber, (), (const, override));
+  MOCK_METHOD(uint16_t, getSocketNumber, (), (const, override));
 };
 
 }  // namespace test
@@ -37,6 +37,7 @@ class MockEthernetUDP : public EthernetUDP {
 
   // EthernetUDP methods:
   MOCK_METHOD(uint8_t, begin, (uint16_t), (override));
+  MOCK_METHOD(void, stop, (), (override));
   MOCK_METHOD(int, beginPacket, (class IPAddress, uint16_t), (override));
   MOCK_METHOD(int, beginPacket, (const char *, uint16_t), (override));
   MOCK_METHOD(int, endPacket, (), (override));
@@ -14,7 +14,8 @@ class MockPlatformNetwork : public PlatformNetworkInterface {
 #error "MCUNET_PNAPI_METHOD should not be defined!!"
 #endif
 
-#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS) MOCK_METHOD(TYPE, NAME, ARGS)
+#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS, ARG_NAMES) \
+  MOCK_METHOD(TYPE, NAME, ARGS)
 #include "platform_network_api.cc.inc"  // IWYU pragma: export
 #undef MCUNET_PNAPI_METHOD
 };
@@ -24,7 +24,7 @@ namespace test {
 template <class BASE = Stream>
 class StringIoStreamImpl : public BASE {
  public:
-  StringIoStreamImpl(uint8_t sock_num, std::string_view input)
+  StringIoStreamImpl(SocketNumber sock_num, std::string_view input)
       : input_buffer_(input),
         input_view_(input_buffer_),
         is_open_(true),
@@ -36,6 +36,13 @@ class StringIoStreamImpl : public BASE {
 
   const std::string& output() const { return output_; }
 
+  // If set, read(buf, size) returns -1 rather than 0 when the connection is
+  // open but no input remains, as EthernetClient does (it returns 0 only at
+  // EOF).
+  void set_ethernet_client_semantics(bool value) {
+    ethernet_client_semantics_ = value;
+  }
+
   // Print methods:
 
   size_t write(uint8_t b) override {
@@ -87,7 +94,9 @@ class StringIoStreamImpl : public BASE {
       return -1;
     }
     size = std::min(size, input_view_.size());
-    if (size > 0) {
+    if (size == 0 && ethernet_client_semantics_) {
+      return -1;
+    } else if (size > 0) {
       std::memcpy(buf, input_view_.data(), size);
       input_view_.remove_prefix(size);
     }
@@ -103,14 +112,15 @@ class StringIoStreamImpl : public BASE {
 
   virtual void close() { is_open_ = false; }
 
-  virtual uint8_t sock_num() const { return sock_num_; }
+  virtual SocketNumber sock_num() const { return sock_num_; }
 
  private:
   const std::string input_buffer_;
   std::string_view input_view_;
   std::string output_;
   bool is_open_;
-  const uint8_t sock_num_;
+  bool ethernet_client_semantics_ = false;
+  const SocketNumber sock_num_;
 };
 
 using StringIoStream = StringIoStreamImpl<::Stream>;
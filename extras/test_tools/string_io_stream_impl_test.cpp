@@ -66,8 +66,18 @@ TYPED_TEST_P(StringIoStreamTest, ReadAll) {
   EXPECT_EQ(conn.available(), 0);
 }
 
+TYPED_TEST_P(StringIoStreamTest, EthernetClientSemantics) {
+  StringIoStream conn(1, "DE");
+  uint8_t buf[10];
+  EXPECT_EQ(conn.read(buf, 10), 2);
+  EXPECT_EQ(conn.read(buf, 10), 0);
+  conn.set_ethernet_client_semantics(true);
+  EXPECT_EQ(conn.read(buf, 10), -1);
+  EXPECT_TRUE(conn.connected());
+}
+
 REGISTER_TYPED_TEST_SUITE_P(StringIoStreamTest, DoNothing, WriteAndReadAndClose,
-                            ReadAll);
+                            ReadAll, EthernetClientSemantics);
 
 INSTANTIATE_TYPED_TEST_SUITE_P(ForStream, StringIoStreamTest, StringIoStream);
 INSTANTIATE_TYPED_TEST_SUITE_P(ForClient, StringIoStreamTest, StringIoClient);
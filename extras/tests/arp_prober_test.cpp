@@ -0,0 +1,178 @@
+#include "arp_prober.h"
+
+#include <McuCore.h>
+#include <stdint.h>
+
+#include <deque>
+#include <vector>
+
+#include "ethernet_address.h"
+#include "gtest/gtest.h"
+
+namespace mcunet {
+namespace test {
+namespace {
+
+using Event = ArpProber::Event;
+using State = ArpProber::State;
+
+const EthernetAddress kOurMac{0x52, 0x75, 0x76, 1, 2, 3};
+const EthernetAddress kOtherMac{0x52, 0x75, 0x76, 4, 5, 6};
+const IPAddress kOurIp(169, 254, 10, 20);
+const IPAddress kOtherIp(169, 254, 30, 40);
+const IPAddress kZeroIp(0, 0, 0, 0);
+
+class FakeArpTransport : public ArpTransport {
+ public:
+  bool Open() override {
+    is_open = can_open;
+    return is_open;
+  }
+  void Close() override { is_open = false; }
+  bool Send(const ArpPacket& packet) override {
+    sent.push_back(packet);
+    return true;
+  }
+  bool Receive(ArpPacket& packet) override {
+    if (to_receive.empty()) {
+      return false;
+    }
+    packet = to_receive.front();
+    to_receive.pop_front();
+    return true;
+  }
+
+  bool can_open = true;
+  bool is_open = false;
+  std::vector<ArpPacket> sent;
+  std::deque<ArpPacket> to_receive;
+};
+
+ArpPacket MakePacket(uint16_t operation, const EthernetAddress& sender_mac,
+                     const IPAddress& sender_ip, const IPAddress& target_ip) {
+  ArpPacket packet;
+  packet.operation = operation;
+  packet.sender_mac = sender_mac;
+  packet.sender_ip = sender_ip;
+  packet.target_mac = EthernetAddress{0, 0, 0, 0, 0, 0};
+  packet.target_ip = target_ip;
+  return packet;
+}
+
+class ArpProberTest : public testing::Test {
+ protected:
+  ArpProberTest() : prober_(transport_) {}
+
+  // Calls PerformIO at each millisecond until an event other than kNone is
+  // returned, or until the limit is reached.
+  Event RunUntilEvent(uint32_t limit_millis) {
+    for (uint32_t end = now_ + limit_millis; now_ != end; ++now_) {
+      const auto event = prober_.PerformIO(now_);
+      if (event != Event::kNone) {
+        return event;
+      }
+    }
+    return Event::kNone;
+  }
+
+  FakeArpTransport transport_;
+  ArpProber prober_;
+  uint32_t now_ = 1000;
+};
+
+TEST_F(ArpProberTest, OpenFails) {
+  transport_.can_open = false;
+  EXPECT_FALSE(prober_.Start(kOurMac, kOurIp, now_));
+  EXPECT_EQ(prober_.state(), State::kStopped);
+  EXPECT_EQ(prober_.PerformIO(now_ + 100000), Event::kNone);
+  EXPECT_TRUE(transport_.sent.empty());
+}
+
+TEST_F(ArpProberTest, ClaimsAddressAfterProbing) {
+  ASSERT_TRUE(prober_.Start(kOurMac, kOurIp, now_));
+  EXPECT_TRUE(transport_.is_open);
+  EXPECT_EQ(prober_.state(), State::kProbing);
+
+  // Three probes, then an announcement, all within the maximum times allowed.
+  const uint32_t start = now_;
+  EXPECT_EQ(RunUntilEvent(ArpProber::kProbeWaitMillis +
+                          2 * ArpProber::kProbeMaxMillis +
+                          ArpProber::kAnnounceWaitMillis + 10),
+            Event::kAddressClaimed);
+  EXPECT_GE(now_ - start, 2 * ArpProber::kProbeMinMillis +
+                              ArpProber::kAnnounceWaitMillis);
+  EXPECT_EQ(prober_.state(), State::kAnnouncing);
+  ASSERT_EQ(transport_.sent.size(), 4);
+  for (int ndx = 0; ndx < 3; ++ndx) {
+    const auto& probe = transport_.sent[ndx];
+    EXPECT_EQ(probe.operation, ArpPacket::kRequest);
+    EXPECT_EQ(probe.sender_ip, kZeroIp);
+    EXPECT_EQ(probe.target_ip, kOurIp);
+  }
+  const auto& announcement = transport_.sent[3];
+  EXPECT_EQ(announcement.sender_ip, kOurIp);
+  EXPECT_EQ(announcement.target_ip, kOurIp);
+
+  // The second announcement, after which the transport is closed, freeing the
+  // socket for other uses.
+  EXPECT_EQ(RunUntilEvent(ArpProber::kAnnounceIntervalMillis + 1),
+            Event::kNone);
+  EXPECT_EQ(transport_.sent.size(), 5);
+  EXPECT_EQ(prober_.state(), State::kStopped);
+  EXPECT_FALSE(transport_.is_open);
+}
+
+TEST_F(ArpProberTest, ConflictWhileProbing) {
+  ASSERT_TRUE(prober_.Start(kOurMac, kOurIp, now_));
+  // Another host replies to our probe.
+  transport_.to_receive.push_back(
+      MakePacket(ArpPacket::kReply, kOtherMac, kOurIp, kZeroIp));
+  EXPECT_EQ(prober_.PerformIO(now_), Event::kConflict);
+  EXPECT_EQ(prober_.state(), State::kStopped);
+  EXPECT_FALSE(transport_.is_open);
+}
+
+TEST_F(ArpProberTest, ConflictWithOtherProber) {
+  ASSERT_TRUE(prober_.Start(kOurMac, kOurIp, now_));
+  transport_.to_receive.push_back(
+      MakePacket(ArpPacket::kRequest, kOtherMac, kZeroIp, kOurIp));
+  EXPECT_EQ(prober_.PerformIO(now_), Event::kConflict);
+}
+
+TEST_F(ArpProberTest, IgnoresUnrelatedPackets) {
+  ASSERT_TRUE(prober_.Start(kOurMac, kOurIp, now_));
+  // Our own probe, looped back.
+  transport_.to_receive.push_back(
+      MakePacket(ArpPacket::kRequest, kOurMac, kZeroIp, kOurIp));
+  // Another host probing for, or using, another address.
+  transport_.to_receive.push_back(
+      MakePacket(ArpPacket::kRequest, kOtherMac, kZeroIp, kOtherIp));
+  transport_.to_receive.push_back(
+      MakePacket(ArpPacket::kRequest, kOtherMac, kOtherIp, kOurIp));
+  EXPECT_EQ(RunUntilEvent(10000), Event::kAddressClaimed);
+  EXPECT_TRUE(transport_.to_receive.empty());
+}
+
+TEST_F(ArpProberTest, DefendsOnceThenGivesUp) {
+  ASSERT_TRUE(prober_.Start(kOurMac, kOurIp, now_));
+  ASSERT_EQ(RunUntilEvent(10000), Event::kAddressClaimed);
+  const auto sent = transport_.sent.size();
+
+  // The first conflict is defended with an announcement.
+  transport_.to_receive.push_back(
+      MakePacket(ArpPacket::kRequest, kOtherMac, kOurIp, kOtherIp));
+  EXPECT_EQ(prober_.PerformIO(now_), Event::kNone);
+  ASSERT_EQ(transport_.sent.size(), sent + 1);
+  EXPECT_EQ(transport_.sent.back().sender_ip, kOurIp);
+
+  // But not a second one.
+  ++now_;
+  transport_.to_receive.push_back(
+      MakePacket(ArpPacket::kRequest, kOtherMac, kOurIp, kOtherIp));
+  EXPECT_EQ(prober_.PerformIO(now_), Event::kConflict);
+  EXPECT_EQ(prober_.state(), State::kStopped);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet
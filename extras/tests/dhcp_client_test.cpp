@@ -0,0 +1,250 @@
+#include "dhcp_client.h"
+
+#include <McuCore.h>
+#include <stdint.h>
+
+#include "ethernet_address.h"
+#include "extras/test_tools/fake_dhcp_server.h"
+#include "gtest/gtest.h"
+
+namespace mcunet {
+namespace test {
+namespace {
+
+using Event = DhcpClient::Event;
+using State = DhcpClient::State;
+
+const EthernetAddress kMac{0x52, 0x75, 0x76, 1, 2, 3};
+
+class DhcpClientTest : public testing::Test {
+ protected:
+  DhcpClientTest() : client_(server_) {}
+
+  // Starts the client, and completes the DISCOVER, OFFER, REQUEST, ACK
+  // sequence.
+  void AcquireLease() {
+    ASSERT_TRUE(client_.Start(kMac, now_));
+    EXPECT_EQ(client_.state(), State::kSelecting);
+    EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+    EXPECT_EQ(client_.state(), State::kRequesting);
+    EXPECT_EQ(client_.PerformIO(now_), Event::kLeaseAcquired);
+    EXPECT_EQ(client_.state(), State::kBound);
+  }
+
+  FakeDhcpServer server_;
+  DhcpClient client_;
+  uint32_t now_ = 12345;
+};
+
+TEST_F(DhcpClientTest, StartDoesNotWait) {
+  server_.responding = false;
+  ASSERT_TRUE(client_.Start(kMac, now_));
+  EXPECT_TRUE(server_.is_open());
+  ASSERT_EQ(server_.received.size(), 1);
+  const auto& discover = server_.received[0];
+  EXPECT_EQ(discover.message_type, FakeDhcpServer::kDiscover);
+  EXPECT_EQ(discover.destination, IPAddress(255, 255, 255, 255));
+  EXPECT_TRUE(discover.broadcast_flag);
+  EXPECT_FALSE(client_.HasLease());
+
+  client_.Stop();
+  EXPECT_EQ(client_.state(), State::kStopped);
+  EXPECT_FALSE(server_.is_open());
+  EXPECT_EQ(client_.PerformIO(now_ + 100000), Event::kNone);
+  EXPECT_EQ(server_.received.size(), 1);
+}
+
+TEST_F(DhcpClientTest, AcquiresLease) {
+  AcquireLease();
+  ASSERT_EQ(server_.received.size(), 2);
+  const auto& request = server_.received[1];
+  EXPECT_EQ(request.message_type, FakeDhcpServer::kRequest);
+  EXPECT_EQ(request.xid, server_.received[0].xid);
+  EXPECT_EQ(request.requested_ip, server_.lease_ip);
+  EXPECT_EQ(request.server_id, server_.server_ip);
+
+  const auto& lease = client_.lease();
+  EXPECT_EQ(lease.ip, server_.lease_ip);
+  EXPECT_EQ(lease.subnet_mask, server_.subnet_mask);
+  EXPECT_EQ(lease.gateway, server_.router);
+  EXPECT_EQ(lease.dns_server, server_.dns_server);
+  EXPECT_EQ(lease.server_id, server_.server_ip);
+  EXPECT_EQ(lease.lease_seconds, 3600);
+  EXPECT_EQ(lease.renew_seconds, 1800);
+  EXPECT_EQ(lease.rebind_seconds, 3150);
+}
+
+TEST_F(DhcpClientTest, RetransmitsWithBackoff) {
+  server_.responding = false;
+  ASSERT_TRUE(client_.Start(kMac, now_));
+  uint32_t expected_delay = DhcpClient::kInitialRetransmitMillis;
+  for (int expected = 2; expected <= 9; ++expected) {
+    EXPECT_EQ(client_.PerformIO(now_ + expected_delay - 1), Event::kNone);
+    EXPECT_EQ(server_.received.size(), expected - 1);
+    now_ += expected_delay;
+    EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+    EXPECT_EQ(server_.received.size(), expected);
+    if (expected_delay < DhcpClient::kMaxRetransmitMillis) {
+      expected_delay *= 2;
+    }
+  }
+  EXPECT_EQ(server_.CountReceived(FakeDhcpServer::kDiscover), 9);
+
+  // The server appears, and the next retransmission gets a lease.
+  server_.responding = true;
+  now_ += expected_delay;
+  EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+  EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+  EXPECT_EQ(client_.PerformIO(now_), Event::kLeaseAcquired);
+}
+
+TEST_F(DhcpClientTest, NakRestartsDiscovery) {
+  server_.nak_requests = true;
+  ASSERT_TRUE(client_.Start(kMac, now_));
+  EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+  EXPECT_EQ(client_.state(), State::kRequesting);
+  EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+  EXPECT_EQ(client_.state(), State::kSelecting);
+  EXPECT_EQ(server_.CountReceived(FakeDhcpServer::kDiscover), 2);
+  // A new transaction.
+  EXPECT_NE(server_.received[0].xid, server_.received[2].xid);
+}
+
+TEST_F(DhcpClientTest, IgnoresAckFromAnotherServer) {
+  server_.ack_server_id = IPAddress(192, 168, 1, 9);
+  ASSERT_TRUE(client_.Start(kMac, now_));
+  EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+  EXPECT_EQ(client_.state(), State::kRequesting);
+  EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+  EXPECT_EQ(client_.state(), State::kRequesting);
+  EXPECT_FALSE(client_.HasLease());
+
+  // The selected server's ACK of the retransmitted request is accepted.
+  server_.ack_server_id = IPAddress();
+  now_ += DhcpClient::kInitialRetransmitMillis;
+  EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+  EXPECT_EQ(client_.PerformIO(now_), Event::kLeaseAcquired);
+  EXPECT_EQ(client_.lease().server_id, server_.server_ip);
+}
+
+TEST_F(DhcpClientTest, IgnoresAckWithoutAddress) {
+  server_.ack_without_address = true;
+  ASSERT_TRUE(client_.Start(kMac, now_));
+  EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+  EXPECT_EQ(client_.state(), State::kRequesting);
+  EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+  EXPECT_EQ(client_.state(), State::kRequesting);
+  EXPECT_FALSE(client_.HasLease());
+}
+
+TEST_F(DhcpClientTest, RenewsAtT1) {
+  AcquireLease();
+  const uint32_t lease_start = now_;
+
+  EXPECT_EQ(client_.PerformIO(lease_start + 1799999), Event::kNone);
+  EXPECT_EQ(server_.received.size(), 2);
+  now_ = lease_start + 1800000;
+  EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+  EXPECT_EQ(client_.state(), State::kRenewing);
+  ASSERT_EQ(server_.received.size(), 3);
+  const auto& renew = server_.received[2];
+  EXPECT_EQ(renew.message_type, FakeDhcpServer::kRequest);
+  EXPECT_EQ(renew.destination, server_.server_ip);
+  EXPECT_EQ(renew.ciaddr, server_.lease_ip);
+  EXPECT_FALSE(renew.broadcast_flag);
+
+  EXPECT_EQ(client_.PerformIO(now_), Event::kLeaseRenewed);
+  EXPECT_EQ(client_.state(), State::kBound);
+}
+
+TEST_F(DhcpClientTest, RebindsAtT2AndLosesLeaseAtExpiry) {
+  AcquireLease();
+  const uint32_t lease_start = now_;
+  server_.responding = false;
+
+  EXPECT_EQ(client_.PerformIO(lease_start + 1800000), Event::kNone);
+  EXPECT_EQ(client_.state(), State::kRenewing);
+  // Retransmits while renewing.
+  EXPECT_EQ(client_.PerformIO(lease_start + 1860000), Event::kNone);
+  EXPECT_EQ(server_.CountReceived(FakeDhcpServer::kRequest), 3);
+
+  EXPECT_EQ(client_.PerformIO(lease_start + 3150000), Event::kNone);
+  EXPECT_EQ(client_.state(), State::kRebinding);
+  EXPECT_EQ(server_.received.back().destination,
+            IPAddress(255, 255, 255, 255));
+  EXPECT_EQ(server_.received.back().ciaddr, server_.lease_ip);
+
+  EXPECT_EQ(client_.PerformIO(lease_start + 3599999), Event::kNone);
+  EXPECT_TRUE(client_.HasLease());
+  EXPECT_EQ(client_.PerformIO(lease_start + 3600000), Event::kLeaseLost);
+  EXPECT_FALSE(client_.HasLease());
+  EXPECT_EQ(client_.state(), State::kSelecting);
+  EXPECT_EQ(server_.received.back().message_type, FakeDhcpServer::kDiscover);
+}
+
+TEST_F(DhcpClientTest, IgnoresRepliesToOtherTransactions) {
+  server_.reply_xid_delta = 1;
+  ASSERT_TRUE(client_.Start(kMac, now_));
+  EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+  EXPECT_EQ(client_.state(), State::kSelecting);
+  EXPECT_EQ(server_.received.size(), 1);
+}
+
+TEST_F(DhcpClientTest, InitRebootReusesPreviousAddress) {
+  DhcpLease previous;
+  previous.ip = server_.lease_ip;
+  ASSERT_TRUE(client_.Start(kMac, now_, &previous));
+  EXPECT_EQ(client_.state(), State::kRebooting);
+  ASSERT_EQ(server_.received.size(), 1);
+  const auto& request = server_.received[0];
+  EXPECT_EQ(request.message_type, FakeDhcpServer::kRequest);
+  EXPECT_EQ(request.destination, IPAddress(255, 255, 255, 255));
+  EXPECT_TRUE(request.broadcast_flag);
+  EXPECT_EQ(request.ciaddr, IPAddress());
+  EXPECT_EQ(request.requested_ip, server_.lease_ip);
+  EXPECT_EQ(request.server_id, IPAddress());
+
+  EXPECT_EQ(client_.PerformIO(now_), Event::kLeaseAcquired);
+  EXPECT_EQ(client_.state(), State::kBound);
+  EXPECT_EQ(client_.lease().ip, server_.lease_ip);
+  EXPECT_EQ(client_.lease().server_id, server_.server_ip);
+  EXPECT_EQ(server_.CountReceived(FakeDhcpServer::kDiscover), 0);
+}
+
+TEST_F(DhcpClientTest, InitRebootNakStartsDiscovery) {
+  DhcpLease previous;
+  previous.ip = IPAddress(192, 168, 1, 99);
+  ASSERT_TRUE(client_.Start(kMac, now_, &previous));
+  EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+  EXPECT_EQ(client_.state(), State::kSelecting);
+  EXPECT_EQ(server_.received.back().message_type, FakeDhcpServer::kDiscover);
+
+  // The offered address is then requested, and leased.
+  EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+  EXPECT_EQ(client_.PerformIO(now_), Event::kLeaseAcquired);
+  EXPECT_EQ(client_.lease().ip, server_.lease_ip);
+}
+
+TEST_F(DhcpClientTest, InitRebootWithoutReplyStartsDiscovery) {
+  server_.responding = false;
+  DhcpLease previous;
+  previous.ip = server_.lease_ip;
+  ASSERT_TRUE(client_.Start(kMac, now_, &previous));
+  uint32_t delay = DhcpClient::kInitialRetransmitMillis;
+  for (int attempt = 1; attempt < DhcpClient::kMaxRequestAttempts; ++attempt) {
+    now_ += delay;
+    delay *= 2;
+    EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+    EXPECT_EQ(client_.state(), State::kRebooting);
+  }
+  EXPECT_EQ(server_.CountReceived(FakeDhcpServer::kRequest),
+            DhcpClient::kMaxRequestAttempts);
+  now_ += delay;
+  EXPECT_EQ(client_.PerformIO(now_), Event::kNone);
+  EXPECT_EQ(client_.state(), State::kSelecting);
+  EXPECT_EQ(server_.received.back().message_type, FakeDhcpServer::kDiscover);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet
@@ -0,0 +1,81 @@
+#include "dhcp_lease.h"
+
+#include <McuCore.h>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "mcucore/extras/host/eeprom/eeprom.h"
+#include "mcucore/extras/test_tools/status_test_utils.h"
+
+namespace mcunet {
+namespace test {
+namespace {
+
+using ::mcucore::test::IsOk;
+using ::testing::Not;
+
+TEST(DhcpLeaseTest, WriteAndReadRegion) {
+  EEPROMClass eeprom;
+  {
+    mcucore::EepromRegion region(eeprom, 0, eeprom.length());
+    DhcpLease lease;
+    lease.ip = IPAddress(192, 168, 1, 50);
+    lease.server_id = IPAddress(192, 168, 1, 1);
+    lease.lease_seconds = 0x01020304;
+    EXPECT_STATUS_OK(lease.WriteToRegion(region));
+    EXPECT_EQ(region.cursor(), 12);
+  }
+
+  {
+    mcucore::EepromRegionReader region(eeprom, 0, eeprom.length());
+    DhcpLease lease;
+    lease.ip = IPAddress(255, 0, 255, 0);
+    lease.server_id = IPAddress(0, 255, 0, 255);
+    lease.lease_seconds = 0;
+    EXPECT_STATUS_OK(lease.ReadFromRegion(region));
+    EXPECT_EQ(lease.ip, IPAddress(192, 168, 1, 50));
+    EXPECT_EQ(lease.server_id, IPAddress(192, 168, 1, 1));
+    EXPECT_EQ(lease.lease_seconds, 0x01020304);
+  }
+
+  {
+    // ReadFromRegion fails if not enough room.
+    mcucore::EepromRegionReader region(eeprom, 0, 11);
+    DhcpLease lease;
+    EXPECT_THAT(lease.ReadFromRegion(region), Not(IsOk()));
+  }
+
+  {
+    // WriteToRegion fails if not enough room.
+    mcucore::EepromRegion region(eeprom, 0, 11);
+    DhcpLease lease;
+    EXPECT_THAT(lease.WriteToRegion(region), Not(IsOk()));
+  }
+}
+
+TEST(DhcpLeaseTest, WriteAndReadEntry) {
+  EEPROMClass eeprom(50);
+  auto eeprom_tlv = mcucore::EepromTlv::GetOrDie(eeprom);
+  DhcpLease lease;
+
+  // No entry to find yet.
+  EXPECT_THAT(lease.ReadEepromEntry(eeprom_tlv),
+              mcucore::test::StatusIs(mcucore::StatusCode::kNotFound));
+
+  lease.ip = IPAddress(10, 1, 2, 3);
+  lease.server_id = IPAddress(10, 1, 0, 1);
+  lease.lease_seconds = 86400;
+  EXPECT_STATUS_OK(lease.WriteEepromEntry(eeprom_tlv));
+
+  // Read it back into another instance.
+  DhcpLease lease2;
+  lease2.lease_seconds = 0;
+  EXPECT_STATUS_OK(lease2.ReadEepromEntry(eeprom_tlv));
+  EXPECT_EQ(lease2.ip, lease.ip);
+  EXPECT_EQ(lease2.server_id, lease.server_id);
+  EXPECT_EQ(lease2.lease_seconds, 86400);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet
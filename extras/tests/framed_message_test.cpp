@@ -0,0 +1,219 @@
+#include "framed_message.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "extras/test_tools/string_io_stream_impl.h"
+#include "gtest/gtest.h"
+
+namespace mcunet {
+namespace test {
+namespace {
+
+struct Message {
+  uint8_t type;
+  std::string payload;
+  // True if the payload was passed in place, i.e. from the input.
+  bool in_place;
+};
+
+class RecordingHandler : public FramedMessageHandler {
+ public:
+  void OnFramedMessage(uint8_t type, const uint8_t* payload,
+                       size_t payload_size) override {
+    const char* const data = reinterpret_cast<const char*>(payload);
+    messages.push_back(
+        {type, std::string(data, payload_size),
+         input_start <= data && data + payload_size <= input_end});
+  }
+
+  std::vector<Message> messages;
+  const char* input_start = nullptr;
+  const char* input_end = nullptr;
+};
+
+std::string Frame(uint8_t type, const std::string& payload, bool with_crc) {
+  StringIoConnection out(1, "");
+  EXPECT_TRUE(WriteFramedMessage(
+      out, type, reinterpret_cast<const uint8_t*>(payload.data()),
+      payload.size(), with_crc));
+  return out.output();
+}
+
+// Passes input to the reader at most piece_size bytes at a time. Returns false
+// if the reader reports an error.
+bool ProcessAll(FramedMessageReader& reader, RecordingHandler& handler,
+                const std::string& input, size_t piece_size) {
+  for (size_t start = 0; start < input.size(); start += piece_size) {
+    const size_t size = std::min(piece_size, input.size() - start);
+    handler.input_start = input.data() + start;
+    handler.input_end = handler.input_start + size;
+    if (!reader.ProcessInput(
+            reinterpret_cast<const uint8_t*>(handler.input_start), size)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+class FlushCountingConnection : public StringIoConnection {
+ public:
+  FlushCountingConnection() : StringIoConnection(1, "") {}
+  void flush() override { ++flushes; }
+  int flushes = 0;
+};
+
+TEST(FramedMessageTest, Crc) {
+  // The standard check value of CRC-16/CCITT-FALSE.
+  const std::string kCheck = "123456789";
+  EXPECT_EQ(UpdateFramedMessageCrc(
+                0xFFFF, reinterpret_cast<const uint8_t*>(kCheck.data()),
+                kCheck.size()),
+            0x29B1);
+}
+
+TEST(FramedMessageTest, WriteFrame) {
+  EXPECT_EQ(Frame(3, "abc", false), std::string("\x04\x03" "abc"));
+  EXPECT_EQ(Frame(0x7F, "", false), std::string("\x01\x7F"));
+  // The CRC covers the length and tag.
+  const std::string with_crc = Frame(3, "abc", true);
+  ASSERT_EQ(with_crc.size(), 7);
+  EXPECT_EQ(with_crc.substr(0, 5), std::string("\x06\x83" "abc"));
+  const uint16_t crc = UpdateFramedMessageCrc(
+      0xFFFF, reinterpret_cast<const uint8_t*>(with_crc.data()), 5);
+  EXPECT_EQ(static_cast<uint8_t>(with_crc[5]), crc >> 8);
+  EXPECT_EQ(static_cast<uint8_t>(with_crc[6]), crc & 0xFF);
+  // A length of 201 needs two bytes.
+  const std::string long_frame = Frame(1, std::string(200, 'x'), false);
+  EXPECT_EQ(long_frame.substr(0, 3), std::string("\xC9\x01\x01"));
+  EXPECT_EQ(long_frame.size(), 203);
+}
+
+TEST(FramedMessageTest, ReadsFramesSplitAnywhere) {
+  const std::string long_payload(FramedMessageReader::kMaxPayloadSize, 'L');
+  const std::string input =
+      Frame(1, "first", false) + Frame(2, "", false) +
+      Frame(3, "checked", true) + Frame(4, "", true) +
+      Frame(5, long_payload, true) + Frame(6, long_payload, false);
+  for (size_t piece_size = 1; piece_size <= input.size(); ++piece_size) {
+    RecordingHandler handler;
+    FramedMessageReader reader(handler);
+    ASSERT_TRUE(ProcessAll(reader, handler, input, piece_size))
+        << "piece_size=" << piece_size;
+    ASSERT_EQ(handler.messages.size(), 6) << "piece_size=" << piece_size;
+    EXPECT_EQ(handler.messages[0].type, 1);
+    EXPECT_EQ(handler.messages[0].payload, "first");
+    EXPECT_EQ(handler.messages[1].type, 2);
+    EXPECT_EQ(handler.messages[1].payload, "");
+    EXPECT_EQ(handler.messages[2].type, 3);
+    EXPECT_EQ(handler.messages[2].payload, "checked");
+    EXPECT_EQ(handler.messages[3].type, 4);
+    EXPECT_EQ(handler.messages[4].payload, long_payload);
+    EXPECT_EQ(handler.messages[5].type, 6);
+    EXPECT_EQ(handler.messages[5].payload, long_payload);
+    EXPECT_EQ(reader.error(), FramedMessageError::kNone);
+  }
+}
+
+TEST(FramedMessageTest, PassesWholeMessagesInPlace) {
+  const std::string input = Frame(1, "one", true) + Frame(2, "two", false);
+  RecordingHandler handler;
+  FramedMessageReader reader(handler);
+  // Split within the second frame's payload.
+  ASSERT_TRUE(ProcessAll(reader, handler, input, 10));
+  ASSERT_EQ(handler.messages.size(), 2);
+  EXPECT_TRUE(handler.messages[0].in_place);
+  EXPECT_EQ(handler.messages[1].payload, "two");
+  EXPECT_FALSE(handler.messages[1].in_place);
+}
+
+TEST(FramedMessageTest, ReadFromConnection) {
+  std::string input;
+  for (int ndx = 0; ndx < 20; ++ndx) {
+    input += Frame(ndx, std::string(ndx, 'a' + ndx), ndx % 2);
+  }
+  StringIoConnection conn(1, input);
+  RecordingHandler handler;
+  FramedMessageReader reader(handler);
+  EXPECT_TRUE(reader.ReadFrom(conn));
+  ASSERT_EQ(handler.messages.size(), 20);
+  for (int ndx = 0; ndx < 20; ++ndx) {
+    EXPECT_EQ(handler.messages[ndx].type, ndx);
+    EXPECT_EQ(handler.messages[ndx].payload, std::string(ndx, 'a' + ndx));
+  }
+}
+
+TEST(FramedMessageTest, Errors) {
+  std::string corrupt = Frame(1, "abc", true);
+  corrupt[3] ^= 1;
+  const struct {
+    std::string input;
+    FramedMessageError error;
+  } kCases[] = {
+      {std::string("\x00", 1), FramedMessageError::kBadLength},
+      {std::string("\x02\x81", 2), FramedMessageError::kBadLength},
+      {std::string("\x80\x80\x80\x80\x01", 5), FramedMessageError::kBadLength},
+      {Frame(1, std::string(FramedMessageReader::kMaxPayloadSize + 1, 'x'),
+             false),
+       FramedMessageError::kTooLarge},
+      {corrupt, FramedMessageError::kBadCrc},
+  };
+  for (const auto& test_case : kCases) {
+    RecordingHandler handler;
+    FramedMessageReader reader(handler);
+    EXPECT_FALSE(ProcessAll(reader, handler,
+                            Frame(9, "ok", true) + test_case.input +
+                                Frame(9, "ignored", false),
+                            1000));
+    EXPECT_EQ(reader.error(), test_case.error);
+    ASSERT_EQ(handler.messages.size(), 1);
+    // The reader stays in the error state until reset.
+    const std::string next = Frame(9, "ok", false);
+    EXPECT_FALSE(ProcessAll(reader, handler, next, next.size()));
+    reader.Reset();
+    EXPECT_TRUE(ProcessAll(reader, handler, next, next.size()));
+    EXPECT_EQ(handler.messages.size(), 2);
+  }
+}
+
+TEST(FramedMessageTest, BatchSendsQueuedFramesWithOneFlush) {
+  FramedMessageBatch batch;
+  EXPECT_TRUE(batch.empty());
+  const std::string kPayload = "payload";
+  const auto* const payload = reinterpret_cast<const uint8_t*>(kPayload.data());
+  EXPECT_TRUE(batch.Queue(1, payload, kPayload.size(), false));
+  EXPECT_TRUE(batch.Queue(2, payload, kPayload.size(), true));
+  EXPECT_TRUE(batch.Queue(3, nullptr, 0, false));
+  EXPECT_EQ(batch.size(), 9 + 11 + 2);
+
+  FlushCountingConnection conn;
+  EXPECT_TRUE(batch.Send(conn));
+  EXPECT_EQ(conn.output(), Frame(1, kPayload, false) +
+                               Frame(2, kPayload, true) + Frame(3, "", false));
+  EXPECT_EQ(conn.flushes, 1);
+  EXPECT_TRUE(batch.empty());
+  EXPECT_TRUE(batch.Send(conn));
+  EXPECT_EQ(conn.flushes, 1);
+}
+
+TEST(FramedMessageTest, BatchRejectsFramesThatDontFit) {
+  FramedMessageBatch batch;
+  const std::string fill(FramedMessageBatch::kCapacity - 2 - 4, 'f');
+  EXPECT_TRUE(batch.Queue(
+      1, reinterpret_cast<const uint8_t*>(fill.data()), fill.size(), false));
+  EXPECT_EQ(batch.size(), FramedMessageBatch::kCapacity - 4);
+  const uint8_t kTwo[] = {1, 2};
+  EXPECT_FALSE(batch.Queue(2, kTwo, sizeof kTwo, true));
+  EXPECT_TRUE(batch.Queue(2, kTwo, sizeof kTwo, false));
+  EXPECT_EQ(batch.size(), FramedMessageBatch::kCapacity);
+  batch.Clear();
+  EXPECT_TRUE(batch.empty());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet
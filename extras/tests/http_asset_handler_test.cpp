@@ -0,0 +1,149 @@
+#include "http_asset_handler.h"
+
+#include <stdint.h>
+
+#include <string>
+
+#include "extras/test_tools/string_io_stream_impl.h"
+#include "gtest/gtest.h"
+#include "http_request.h"
+#include "http_response.h"
+#include "http_server.h"
+
+namespace mcunet {
+namespace test {
+namespace {
+
+// The "gzip" data needn't be valid; the handler doesn't look at it.
+constexpr char kIndexPath[] PROGMEM = "/index.html";
+constexpr char kRootPath[] PROGMEM = "/";
+constexpr char kHtmlType[] PROGMEM = "text/html";
+constexpr uint8_t kIndexGzip[] PROGMEM = {'Z', 'I', 'P'};
+constexpr uint8_t kIndexIdentity[] PROGMEM = {'<', 'p', '>', 'H', 'i'};
+
+constexpr char kScriptPath[] PROGMEM = "/app.js";
+constexpr char kScriptType[] PROGMEM = "application/javascript";
+constexpr uint8_t kScriptGzip[] PROGMEM = {'J', 'S', 'Z'};
+
+constexpr char kImagePath[] PROGMEM = "/logo.png";
+constexpr char kImageType[] PROGMEM = "image/png";
+constexpr uint8_t kImageIdentity[] PROGMEM = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19,
+    20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37,
+    38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55,
+    56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71, 72, 73,
+    74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91,
+    92, 93, 94, 95, 96, 97, 98, 99};
+
+constexpr HttpAsset kAssets[] PROGMEM = {
+    MakeHttpAsset(kIndexPath, kHtmlType, kIndexGzip, sizeof kIndexGzip,
+                  0x11111111, kIndexIdentity, sizeof kIndexIdentity,
+                  0x22222222),
+    MakeHttpAsset(kRootPath, kHtmlType, kIndexGzip, sizeof kIndexGzip,
+                  0x11111111, kIndexIdentity, sizeof kIndexIdentity,
+                  0x22222222),
+    MakeHttpAsset(kScriptPath, kScriptType, kScriptGzip, sizeof kScriptGzip,
+                  0x33333333, nullptr, 0, 0),
+    MakeHttpAsset(kImagePath, kImageType, nullptr, 0, 0, kImageIdentity,
+                  sizeof kImageIdentity, 0x44444444),
+};
+
+class HttpAssetHandlerTest : public testing::Test {
+ protected:
+  HttpAssetHandlerTest() : handler_(kAssets), server_(80, handler_) {}
+
+  std::string Respond(const std::string& request) {
+    StringIoConnection conn(1, request);
+    server_.OnConnect(conn);
+    return conn.output();
+  }
+
+  std::string RespondStatusLine(const std::string& request) {
+    const std::string response = Respond(request);
+    return response.substr(0, response.find("\r\n"));
+  }
+
+  HttpAssetHandler handler_;
+  HttpServer server_;
+};
+
+TEST_F(HttpAssetHandlerTest, ServesGzipWhenAccepted) {
+  EXPECT_EQ(Respond("GET /index.html HTTP/1.1\r\n"
+                    "Accept-Encoding: gzip, deflate\r\n\r\n"),
+            "HTTP/1.1 200 OK\r\n"
+            "Vary: Accept-Encoding\r\n"
+            "Content-Type: text/html\r\n"
+            "Content-Encoding: gzip\r\n"
+            "ETag: \"11111111\"\r\n"
+            "Content-Length: 3\r\n"
+            "\r\n"
+            "ZIP");
+}
+
+TEST_F(HttpAssetHandlerTest, ServesIdentityOtherwise) {
+  EXPECT_EQ(Respond("GET /?x=1 HTTP/1.1\r\n\r\n"),
+            "HTTP/1.1 200 OK\r\n"
+            "Vary: Accept-Encoding\r\n"
+            "Content-Type: text/html\r\n"
+            "ETag: \"22222222\"\r\n"
+            "Content-Length: 5\r\n"
+            "\r\n"
+            "<p>Hi");
+  EXPECT_EQ(Respond("GET /logo.png HTTP/1.1\r\n"
+                    "Accept-Encoding: gzip\r\n\r\n"),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: image/png\r\n"
+            "ETag: \"44444444\"\r\n"
+            "Content-Length: 100\r\n"
+            "\r\n" +
+                std::string(reinterpret_cast<const char*>(kImageIdentity),
+                            sizeof kImageIdentity));
+}
+
+TEST_F(HttpAssetHandlerTest, OmitsBodyOfHeadResponse) {
+  EXPECT_EQ(Respond("HEAD /app.js HTTP/1.1\r\nAccept-Encoding: *\r\n\r\n"),
+            "HTTP/1.1 200 OK\r\n"
+            "Vary: Accept-Encoding\r\n"
+            "Content-Type: application/javascript\r\n"
+            "Content-Encoding: gzip\r\n"
+            "ETag: \"33333333\"\r\n"
+            "Content-Length: 3\r\n"
+            "\r\n");
+}
+
+TEST_F(HttpAssetHandlerTest, NotModified) {
+  EXPECT_EQ(Respond("GET /index.html HTTP/1.1\r\n"
+                    "Accept-Encoding: gzip\r\n"
+                    "If-None-Match: \"11111111\"\r\n\r\n"),
+            "HTTP/1.1 304 Not Modified\r\n"
+            "Vary: Accept-Encoding\r\n"
+            "ETag: \"11111111\"\r\n"
+            "\r\n");
+  // The ETag of the gzipped representation doesn't match the identity one.
+  EXPECT_EQ(RespondStatusLine("HEAD /index.html HTTP/1.1\r\n"
+                              "If-None-Match: \"11111111\"\r\n\r\n"),
+            "HTTP/1.1 200 OK");
+  // Vary isn't sent for an asset with only an identity representation.
+  EXPECT_EQ(Respond("GET /logo.png HTTP/1.1\r\n"
+                    "If-None-Match: \"44444444\"\r\n\r\n"),
+            "HTTP/1.1 304 Not Modified\r\n"
+            "ETag: \"44444444\"\r\n"
+            "\r\n");
+}
+
+TEST_F(HttpAssetHandlerTest, Errors) {
+  EXPECT_EQ(Respond("GET /app.js HTTP/1.1\r\n"
+                    "Accept-Encoding: gzip;q=0\r\n\r\n"),
+            "HTTP/1.1 406 Not Acceptable\r\n"
+            "Vary: Accept-Encoding\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n");
+  EXPECT_EQ(RespondStatusLine("POST /app.js HTTP/1.1\r\n\r\n"),
+            "HTTP/1.1 405 Method Not Allowed");
+  EXPECT_EQ(RespondStatusLine("GET /missing HTTP/1.1\r\n\r\n"),
+            "HTTP/1.1 404 Not Found");
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet
@@ -0,0 +1,76 @@
+#include "http_chunked_writer.h"
+
+#include <stdint.h>
+
+#include <array>
+#include <string>
+
+#include "extras/test_tools/fake_write_buffered_connection.h"
+#include "extras/test_tools/mock_client.h"
+#include "extras/test_tools/string_io_stream_impl.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace mcunet {
+namespace test {
+namespace {
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+
+TEST(HttpChunkedWriterTest, EmptyBody) {
+  StringIoConnection out(1, "");
+  HttpChunkedWriter writer(out);
+  writer.Start();
+  writer.End();
+  EXPECT_TRUE(writer.ended());
+  EXPECT_EQ(out.output(), "0\r\n\r\n");
+}
+
+TEST(HttpChunkedWriterTest, OneChunkPerWriteIfConnectionDoesNotChunk) {
+  StringIoConnection out(1, "");
+  HttpChunkedWriter writer(out);
+  writer.Start();
+  writer.print("abc");
+  writer.print('d');
+  EXPECT_EQ(out.output(), "3\r\nabc\r\n1\r\nd\r\n");
+  const std::string large(300, 'x');
+  writer.print(large.c_str());
+  // An empty write doesn't write an (empty) chunk, which would mark the end of
+  // the body.
+  writer.write(static_cast<const uint8_t*>(nullptr), 0);
+  writer.End();
+  EXPECT_EQ(out.output(),
+            "3\r\nabc\r\n1\r\nd\r\n12C\r\n" + large + "\r\n0\r\n\r\n");
+}
+
+TEST(HttpChunkedWriterTest, OneChunkPerFlushOfWriteBufferedConnection) {
+  NiceMock<MockClient> client;
+  std::string output;
+  ON_CALL(client, write(_, _))
+      .WillByDefault(Invoke([&output](const uint8_t* data, size_t size) {
+        output.append(reinterpret_cast<const char*>(data), size);
+        return size;
+      }));
+  std::array<uint8_t, 16> write_buffer;
+  {
+    FakeWriteBufferedConnection out(client, 1, write_buffer);
+    HttpChunkedWriter writer(out);
+    writer.Start();
+    writer.print("abc");
+    writer.print('d');
+    EXPECT_EQ(writer.availableForWrite(), 16 - 4 - 4 - 2);
+    writer.print("efghijklmnop");
+    EXPECT_EQ(output, "0A\r\nabcdefghij\r\n");
+    writer.flush();
+    EXPECT_EQ(output, "0A\r\nabcdefghij\r\n06\r\nklmnop\r\n");
+    writer.End();
+  }
+  EXPECT_EQ(output,
+            "0A\r\nabcdefghij\r\n06\r\nklmnop\r\n0\r\n\r\n");
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet
@@ -0,0 +1,315 @@
+#include "http_request_parser.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+
+#include "gtest/gtest.h"
+#include "http_request.h"
+#include "http_response.h"
+
+namespace mcunet {
+namespace test {
+namespace {
+
+using Result = HttpRequestParser::Result;
+
+std::string ToString(const mcucore::StringView& view) {
+  return std::string(view.data(), view.size());
+}
+
+// Parses all of input, one piece of size piece_size at a time. Returns the
+// last result, and sets consumed to the total bytes consumed.
+Result ParsePieces(HttpRequestParser& parser, std::string_view input,
+                   size_t piece_size, size_t& consumed) {
+  consumed = 0;
+  Result result = Result::kNeedMoreInput;
+  while (consumed < input.size()) {
+    const size_t size = std::min(piece_size, input.size() - consumed);
+    size_t piece_consumed = 0;
+    result = parser.Parse(
+        reinterpret_cast<const uint8_t*>(input.data() + consumed), size,
+        piece_consumed);
+    consumed += piece_consumed;
+    if (result != Result::kNeedMoreInput) {
+      break;
+    }
+  }
+  return result;
+}
+
+Result ParseAll(HttpRequestParser& parser, std::string_view input) {
+  size_t consumed;
+  return ParsePieces(parser, input, input.size(), consumed);
+}
+
+TEST(HttpRequestParserTest, SimpleGet) {
+  const std::string_view kRequest =
+      "GET /api/v1/status?client=1 HTTP/1.1\r\n"
+      "Host: example.com\r\n"
+      "\r\n";
+  // Parse the request in pieces of every size from 1 to the whole request.
+  for (size_t piece_size = 1; piece_size <= kRequest.size(); ++piece_size) {
+    HttpRequestParser parser;
+    EXPECT_FALSE(parser.in_progress());
+    size_t consumed;
+    ASSERT_EQ(ParsePieces(parser, kRequest, piece_size, consumed),
+              Result::kComplete)
+        << "piece_size=" << piece_size;
+    EXPECT_EQ(consumed, kRequest.size());
+    EXPECT_FALSE(parser.in_progress());
+    const auto& request = parser.request();
+    EXPECT_EQ(request.method, HttpMethod::kGet);
+    EXPECT_EQ(std::string(request.target), "/api/v1/status?client=1");
+    EXPECT_EQ(ToString(request.path()), "/api/v1/status");
+    EXPECT_EQ(ToString(request.query()), "client=1");
+    EXPECT_EQ(request.minor_version, 1);
+    EXPECT_FALSE(request.has_content_length);
+  }
+}
+
+TEST(HttpRequestParserTest, StopsAtEndOfHeaders) {
+  const std::string_view kRequest =
+      "PUT /x HTTP/1.0\n"
+      "content-length:  5 \n"
+      "X-Something-Very-Long-That-We-Do-Not-Know: "
+      "some value that is much longer than the token buffer\n"
+      "\n"
+      "hello";
+  HttpRequestParser parser;
+  size_t consumed;
+  ASSERT_EQ(ParsePieces(parser, kRequest, kRequest.size(), consumed),
+            Result::kComplete);
+  EXPECT_EQ(kRequest.substr(consumed), "hello");
+  const auto& request = parser.request();
+  EXPECT_EQ(request.method, HttpMethod::kPut);
+  EXPECT_EQ(ToString(request.path()), "/x");
+  EXPECT_TRUE(request.query().empty());
+  EXPECT_EQ(request.minor_version, 0);
+  EXPECT_TRUE(request.has_content_length);
+  EXPECT_EQ(request.content_length, 5);
+}
+
+TEST(HttpRequestParserTest, IgnoresLeadingBlankLines) {
+  HttpRequestParser parser;
+  EXPECT_EQ(ParseAll(parser, "\r\n\r\nHEAD / HTTP/1.1\r\n\r\n"),
+            Result::kComplete);
+  EXPECT_EQ(parser.request().method, HttpMethod::kHead);
+}
+
+TEST(HttpRequestParserTest, InProgress) {
+  HttpRequestParser parser;
+  EXPECT_EQ(ParseAll(parser, "GE"), Result::kNeedMoreInput);
+  EXPECT_TRUE(parser.in_progress());
+  parser.Reset();
+  EXPECT_FALSE(parser.in_progress());
+}
+
+TEST(HttpRequestParserTest, ConnectionOptions) {
+  {
+    HttpRequestParser parser;
+    EXPECT_EQ(ParseAll(parser, "GET / HTTP/1.1\r\n\r\n"), Result::kComplete);
+    EXPECT_FALSE(parser.request().connection_close);
+    EXPECT_TRUE(parser.request().KeepAlive());
+  }
+  {
+    HttpRequestParser parser;
+    EXPECT_EQ(
+        ParseAll(parser, "GET / HTTP/1.1\r\nConnection: Close\r\n\r\n"),
+        Result::kComplete);
+    EXPECT_TRUE(parser.request().connection_close);
+    EXPECT_FALSE(parser.request().KeepAlive());
+  }
+  {
+    HttpRequestParser parser;
+    EXPECT_EQ(ParseAll(parser, "GET / HTTP/1.0\r\n\r\n"), Result::kComplete);
+    EXPECT_FALSE(parser.request().KeepAlive());
+  }
+  {
+    // The value is a list; the length of the whole list doesn't matter, and
+    // an element that is too long to be recognized is ignored.
+    const std::string_view kRequest =
+        "GET / HTTP/1.0\r\n"
+        "connection: Some-Header-Name-That-Is-Longer-Than-The-Buffer,"
+        "\tKEEP-ALIVE , Another-Header-Name, Yet-Another-Header-Name\r\n"
+        "\r\n";
+    for (size_t piece_size = 1; piece_size <= kRequest.size(); ++piece_size) {
+      HttpRequestParser parser;
+      size_t consumed;
+      ASSERT_EQ(ParsePieces(parser, kRequest, piece_size, consumed),
+                Result::kComplete)
+          << "piece_size=" << piece_size;
+      EXPECT_TRUE(parser.request().connection_keep_alive);
+      EXPECT_FALSE(parser.request().connection_close);
+      EXPECT_TRUE(parser.request().KeepAlive());
+    }
+  }
+}
+
+TEST(HttpRequestParserTest, IfNoneMatch) {
+  {
+    HttpRequestParser parser;
+    EXPECT_EQ(ParseAll(parser, "GET / HTTP/1.1\r\n\r\n"), Result::kComplete);
+    EXPECT_EQ(parser.request().num_if_none_match_etags, 0);
+    EXPECT_FALSE(parser.request().IfNoneMatch(0));
+  }
+  {
+    // Only tags that we might have generated are recorded.
+    const std::string_view kRequest =
+        "GET / HTTP/1.1\r\n"
+        "If-None-Match: \"0000000a\", W/\"0000002A\" ,\"not-ours\", "
+        "\"some-opaque-tag-that-is-longer-than-the-token-buffer\"\r\n"
+        "\r\n";
+    for (size_t piece_size = 1; piece_size <= kRequest.size(); ++piece_size) {
+      HttpRequestParser parser;
+      size_t consumed;
+      ASSERT_EQ(ParsePieces(parser, kRequest, piece_size, consumed),
+                Result::kComplete)
+          << "piece_size=" << piece_size;
+      EXPECT_EQ(parser.request().num_if_none_match_etags, 2);
+      EXPECT_TRUE(parser.request().IfNoneMatch(0xA));
+      EXPECT_TRUE(parser.request().IfNoneMatch(0x2A));
+      EXPECT_FALSE(parser.request().IfNoneMatch(0xB));
+      EXPECT_FALSE(parser.request().if_none_match_any);
+    }
+  }
+  {
+    // Tags beyond kMaxIfNoneMatchETags are ignored, including those of another
+    // If-None-Match header.
+    static_assert(HttpRequest::kMaxIfNoneMatchETags == 4, "");
+    HttpRequestParser parser;
+    EXPECT_EQ(ParseAll(parser,
+                       "GET / HTTP/1.1\r\n"
+                       "If-None-Match: \"1\", \"2\", \"3\"\r\n"
+                       "If-None-Match: \"4\", \"5\"\r\n\r\n"),
+              Result::kComplete);
+    EXPECT_EQ(parser.request().num_if_none_match_etags, 4);
+    EXPECT_TRUE(parser.request().IfNoneMatch(1));
+    EXPECT_TRUE(parser.request().IfNoneMatch(4));
+    EXPECT_FALSE(parser.request().IfNoneMatch(5));
+  }
+  {
+    HttpRequestParser parser;
+    EXPECT_EQ(
+        ParseAll(parser, "GET / HTTP/1.1\r\nIf-None-Match: *\r\n\r\n"),
+        Result::kComplete);
+    EXPECT_TRUE(parser.request().IfNoneMatch(12345));
+  }
+}
+
+TEST(HttpRequestParserTest, AcceptEncoding) {
+  struct {
+    std::string_view header;
+    bool accepts_gzip;
+  } kCases[] = {
+      {"", false},
+      {"Accept-Encoding: gzip\r\n", true},
+      {"accept-encoding: deflate, GZIP;q=0.5, br\r\n", true},
+      {"Accept-Encoding: x-gzip\r\n", true},
+      {"Accept-Encoding: deflate, br\r\n", false},
+      {"Accept-Encoding: gzip;q=0\r\n", false},
+      {"Accept-Encoding: gzip ; q=0.000\r\n", false},
+      {"Accept-Encoding: gzip;q=0.001\r\n", true},
+      {"Accept-Encoding: *\r\n", true},
+      {"Accept-Encoding: gzip;q=0, *\r\n", false},
+      {"Accept-Encoding: *;q=0\r\n", false},
+      {"Accept-Encoding: gzipped\r\n", false},
+  };
+  for (const auto& test_case : kCases) {
+    const std::string request =
+        "GET / HTTP/1.1\r\n" + std::string(test_case.header) + "\r\n";
+    HttpRequestParser parser;
+    EXPECT_EQ(ParseAll(parser, request), Result::kComplete) << request;
+    EXPECT_EQ(parser.request().accepts_gzip, test_case.accepts_gzip)
+        << request;
+  }
+}
+
+TEST(HttpRequestParserTest, WebSocketUpgrade) {
+  {
+    HttpRequestParser parser;
+    EXPECT_EQ(ParseAll(parser,
+                       "GET /ws HTTP/1.1\r\n"
+                       "Upgrade: WebSocket\r\n"
+                       "Connection: keep-alive, Upgrade\r\n"
+                       "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                       "Sec-WebSocket-Version: 13\r\n"
+                       "\r\n"),
+              Result::kComplete);
+    EXPECT_TRUE(parser.request().IsWebSocketUpgrade());
+    EXPECT_EQ(std::string(parser.request().websocket_key,
+                          sizeof parser.request().websocket_key),
+              "dGhlIHNhbXBsZSBub25jZQ==");
+    EXPECT_EQ(parser.request().websocket_version, 13);
+  }
+  {
+    // The key has the wrong length, and the Connection header lacks Upgrade.
+    HttpRequestParser parser;
+    EXPECT_EQ(ParseAll(parser,
+                       "GET /ws HTTP/1.1\r\n"
+                       "Upgrade: websocket\r\n"
+                       "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ\r\n"
+                       "Sec-WebSocket-Version: 1300\r\n"
+                       "\r\n"),
+              Result::kComplete);
+    EXPECT_FALSE(parser.request().IsWebSocketUpgrade());
+    EXPECT_TRUE(parser.request().upgrade_websocket);
+    EXPECT_FALSE(parser.request().connection_upgrade);
+    EXPECT_FALSE(parser.request().has_websocket_key);
+    EXPECT_EQ(parser.request().websocket_version, 0);
+  }
+}
+
+TEST(HttpRequestParserTest, Errors) {
+  struct {
+    std::string_view input;
+    HttpStatusCode status;
+  } kCases[] = {
+      {"get / HTTP/1.1\r\n", HttpStatusCode::kNotImplemented},
+      {"BREW / HTTP/1.1\r\n", HttpStatusCode::kNotImplemented},
+      {" / HTTP/1.1\r\n", HttpStatusCode::kBadRequest},
+      {"GET  HTTP/1.1\r\n", HttpStatusCode::kBadRequest},
+      {"GET /\r\n", HttpStatusCode::kBadRequest},
+      {"GET / HTTP/2.0\r\n", HttpStatusCode::kHttpVersionNotSupported},
+      {"GET / FTP/1.0\r\n", HttpStatusCode::kBadRequest},
+      {"GET / HTTP/1.1\rX", HttpStatusCode::kBadRequest},
+      {"GET / HTTP/1.1\r\nHost : x\r\n", HttpStatusCode::kBadRequest},
+      {"GET / HTTP/1.1\r\nHost: x\r\n folded\r\n",
+       HttpStatusCode::kBadRequest},
+      {"GET / HTTP/1.1\r\nContent-Length: 1x\r\n", HttpStatusCode::kBadRequest},
+      {"GET / HTTP/1.1\r\nContent-Length: 99999999999\r\n",
+       HttpStatusCode::kBadRequest},
+      {"GET / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n",
+       HttpStatusCode::kBadRequest},
+      {"GET / HTTP/1.1\r\nContent-Length: 000000000000000000000000000000001\r\n",
+       HttpStatusCode::kRequestHeaderFieldsTooLarge},
+      {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n",
+       HttpStatusCode::kNotImplemented},
+  };
+  for (const auto& test_case : kCases) {
+    HttpRequestParser parser;
+    EXPECT_EQ(ParseAll(parser, test_case.input), Result::kError)
+        << test_case.input;
+    EXPECT_EQ(parser.error_status(), test_case.status) << test_case.input;
+    EXPECT_FALSE(parser.in_progress());
+  }
+}
+
+TEST(HttpRequestParserTest, TargetTooLong) {
+  HttpRequestParser parser;
+  std::string input = "GET /";
+  input.append(HttpRequest::kMaxTargetLength - 1, 'a');
+  // Just fits.
+  EXPECT_EQ(ParseAll(parser, input + " HTTP/1.1\r\n\r\n"), Result::kComplete);
+  EXPECT_EQ(parser.request().target_size, HttpRequest::kMaxTargetLength);
+
+  parser.Reset();
+  EXPECT_EQ(ParseAll(parser, input + "a HTTP/1.1\r\n\r\n"), Result::kError);
+  EXPECT_EQ(parser.error_status(), HttpStatusCode::kUriTooLong);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet
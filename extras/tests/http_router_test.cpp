@@ -0,0 +1,144 @@
+#include "http_router.h"
+
+#include <stdint.h>
+
+#include <cstring>
+#include <set>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "http_request.h"
+#include "http_response.h"
+
+namespace mcunet {
+namespace test {
+namespace {
+
+constexpr char kRootPath[] PROGMEM = "/";
+constexpr char kStatusPath[] PROGMEM = "/api/status";
+constexpr char kConfigPath[] PROGMEM = "/api/config";
+constexpr char kHeadOnlyPath[] PROGMEM = "/head";
+
+enum RouteId : uint8_t {
+  kGetRoot = 10,
+  kGetStatus,
+  kGetConfig,
+  kPutConfig,
+  kHeadConfig,
+  kHeadOnly,
+};
+
+constexpr HttpRoute kRoutes[] PROGMEM = {
+    MakeHttpRoute(HttpMethod::kGet, kRootPath, kGetRoot),
+    MakeHttpRoute(HttpMethod::kGet, kStatusPath, kGetStatus),
+    MakeHttpRoute(HttpMethod::kGet, kConfigPath, kGetConfig),
+    MakeHttpRoute(HttpMethod::kPut, kConfigPath, kPutConfig),
+    MakeHttpRoute(HttpMethod::kHead, kConfigPath, kHeadConfig),
+    MakeHttpRoute(HttpMethod::kHead, kHeadOnlyPath, kHeadOnly),
+};
+static_assert(HttpRoutesAreValid(kRoutes), "Conflicting routes");
+constexpr auto kRouteBuckets PROGMEM = MakeHttpRouteBuckets(kRoutes);
+
+constexpr HttpRoute kDuplicateRoutes[] = {
+    MakeHttpRoute(HttpMethod::kGet, kStatusPath, kGetStatus),
+    MakeHttpRoute(HttpMethod::kGet, kConfigPath, kGetConfig),
+    MakeHttpRoute(HttpMethod::kGet, kStatusPath, kGetRoot),
+};
+static_assert(!HttpRoutesAreValid(kDuplicateRoutes),
+              "Should detect a duplicate path and method");
+
+// Two distinct strings with the same FNV-1a hash.
+constexpr char kCollidingPath1[] = "costarring";
+constexpr char kCollidingPath2[] = "liquid";
+static_assert(HttpPathHash(kCollidingPath1) == HttpPathHash(kCollidingPath2),
+              "Expected a hash collision");
+constexpr HttpRoute kCollidingRoutes[] = {
+    MakeHttpRoute(HttpMethod::kGet, kCollidingPath1, 1),
+    MakeHttpRoute(HttpMethod::kGet, kCollidingPath2, 2),
+};
+static_assert(!HttpRoutesAreValid(kCollidingRoutes),
+              "Should detect a hash collision");
+
+HttpStatusCode Match(const HttpMethod method, const std::string& target,
+                     uint8_t& route_id) {
+  HttpRequest request;
+  request.method = method;
+  std::strcpy(request.target, target.c_str());
+  request.target_size = target.size();
+  return HttpRouter(kRoutes, kRouteBuckets).Match(request, route_id);
+}
+
+TEST(HttpRouterTest, RuntimeHashMatchesCompileTimeHash) {
+  const std::string path = "/api/status";
+  EXPECT_EQ(HttpPathHash(mcucore::StringView(path.data(), path.size())),
+            HttpPathHash(kStatusPath));
+  EXPECT_EQ(HttpPathHash(mcucore::StringView()), HttpPathHash(""));
+}
+
+TEST(HttpRouterTest, EachRouteIsInTheBucketOfItsHash) {
+  constexpr size_t kNumRoutes = sizeof kRoutes / sizeof kRoutes[0];
+  constexpr size_t kNumBuckets = HttpRouteBuckets<kNumRoutes>::kNumBuckets;
+  EXPECT_EQ(kNumBuckets, 16);
+  const uint8_t* const entries = kRouteBuckets.entries;
+  EXPECT_EQ(entries[0], 0);
+  EXPECT_EQ(entries[kNumBuckets], kNumRoutes);
+  std::set<uint8_t> indices;
+  for (size_t bucket = 0; bucket < kNumBuckets; ++bucket) {
+    EXPECT_LE(entries[bucket], entries[bucket + 1]);
+    for (uint8_t offset = entries[bucket]; offset < entries[bucket + 1];
+         ++offset) {
+      const uint8_t ndx = entries[kNumBuckets + 1 + offset];
+      ASSERT_LT(ndx, kNumRoutes);
+      EXPECT_EQ(internal::HttpRouteBucket(kRoutes[ndx].path_hash,
+                                          kNumBuckets - 1),
+                bucket);
+      EXPECT_TRUE(indices.insert(ndx).second);
+    }
+  }
+  EXPECT_EQ(indices.size(), kNumRoutes);
+}
+
+TEST(HttpRouterTest, MatchesMethodAndPath) {
+  uint8_t route_id = 0;
+  EXPECT_EQ(Match(HttpMethod::kGet, "/", route_id), HttpStatusCode::kOk);
+  EXPECT_EQ(route_id, kGetRoot);
+  EXPECT_EQ(Match(HttpMethod::kGet, "/api/status?verbose", route_id),
+            HttpStatusCode::kOk);
+  EXPECT_EQ(route_id, kGetStatus);
+  EXPECT_EQ(Match(HttpMethod::kPut, "/api/config", route_id),
+            HttpStatusCode::kOk);
+  EXPECT_EQ(route_id, kPutConfig);
+  EXPECT_EQ(Match(HttpMethod::kGet, "/api/config", route_id),
+            HttpStatusCode::kOk);
+  EXPECT_EQ(route_id, kGetConfig);
+}
+
+TEST(HttpRouterTest, HeadFallsBackToGet) {
+  uint8_t route_id = 0;
+  EXPECT_EQ(Match(HttpMethod::kHead, "/api/status", route_id),
+            HttpStatusCode::kOk);
+  EXPECT_EQ(route_id, kGetStatus);
+  EXPECT_EQ(Match(HttpMethod::kHead, "/api/config", route_id),
+            HttpStatusCode::kOk);
+  EXPECT_EQ(route_id, kHeadConfig);
+  EXPECT_EQ(Match(HttpMethod::kHead, "/head", route_id), HttpStatusCode::kOk);
+  EXPECT_EQ(route_id, kHeadOnly);
+}
+
+TEST(HttpRouterTest, Mismatches) {
+  uint8_t route_id = 99;
+  EXPECT_EQ(Match(HttpMethod::kPost, "/api/status", route_id),
+            HttpStatusCode::kMethodNotAllowed);
+  EXPECT_EQ(Match(HttpMethod::kGet, "/head", route_id),
+            HttpStatusCode::kMethodNotAllowed);
+  EXPECT_EQ(Match(HttpMethod::kGet, "/api/statu", route_id),
+            HttpStatusCode::kNotFound);
+  EXPECT_EQ(Match(HttpMethod::kGet, "/api/status/", route_id),
+            HttpStatusCode::kNotFound);
+  EXPECT_EQ(Match(HttpMethod::kGet, "", route_id), HttpStatusCode::kNotFound);
+  EXPECT_EQ(route_id, 99);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet
@@ -0,0 +1,434 @@
+#include "http_server.h"
+
+#include <string>
+#include <string_view>
+
+#include "extras/test_tools/string_io_stream_impl.h"
+#include "gtest/gtest.h"
+#include "http_request.h"
+#include "http_response.h"
+
+namespace mcunet {
+namespace test {
+namespace {
+
+// Prints a different body each time, as a buggy body generator might.
+class UnstableBody : public Printable {
+ public:
+  size_t printTo(Print& out) const override {
+    ++calls_;
+    return out.print(calls_ == 1 ? "Short" : "Longer");
+  }
+
+ private:
+  mutable int calls_ = 0;
+};
+
+class SizedBody : public Printable {
+ public:
+  size_t printTo(Print& out) const override {
+    size_t count = out.print("{\"value\": ");
+    count += out.print(42);
+    count += out.print('}');
+    return count;
+  }
+};
+
+class HelloHandler : public HttpRequestHandler {
+ public:
+  void HandleRequest(const HttpRequest& request,
+                     HttpResponse& response) override {
+    ++requests;
+    last_target = request.target;
+    if (request.path() == MCU_PSV("/hello")) {
+      response.StartHeaders(HttpStatusCode::kOk);
+      response.AddHeader(MCU_PSV("Content-Type"), MCU_PSV("text/plain"));
+      response.set_content_length(5);
+      response.EndHeaders();
+      response.print("Hello");
+    } else if (request.path() == MCU_PSV("/stream")) {
+      response.StartHeaders(HttpStatusCode::kOk);
+      response.EndHeaders();
+      response.print("Streamed");
+    } else if (request.path() == MCU_PSV("/sized")) {
+      response.StartHeaders(HttpStatusCode::kOk);
+      response.EndHeadersWithBody(SizedBody());
+    } else if (request.path() == MCU_PSV("/unstable")) {
+      response.StartHeaders(HttpStatusCode::kOk);
+      response.EndHeadersWithBody(UnstableBody());
+    } else if (request.path() == MCU_PSV("/versioned")) {
+      if (response.SendNotModifiedIfMatch(version)) {
+        return;
+      }
+      response.StartHeaders(HttpStatusCode::kOk);
+      response.set_content_length(1);
+      response.EndHeaders();
+      response.print('v');
+    } else if (request.path() == MCU_PSV("/hashed")) {
+      response.SendOkWithETag(MCU_PSV("application/json"), SizedBody());
+    } else if (request.path() == MCU_PSV("/nothing")) {
+      response.SendEmptyResponse(HttpStatusCode::kNoContent);
+    }
+  }
+
+  int requests = 0;
+  std::string last_target;
+  uint32_t version = 0x1234abcd;
+};
+
+class HttpServerTest : public testing::Test {
+ protected:
+  HttpServerTest() : server_(80, handler_) {}
+
+  HelloHandler handler_;
+  HttpServer server_;
+};
+
+TEST_F(HttpServerTest, RespondsAndCloses) {
+  StringIoConnection conn(
+      1, "GET /hello HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n");
+  server_.OnConnect(conn);
+  EXPECT_EQ(handler_.requests, 1);
+  EXPECT_EQ(handler_.last_target, "/hello");
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/plain\r\n"
+            "Content-Length: 5\r\n"
+            "Connection: close\r\n"
+            "\r\n"
+            "Hello");
+  EXPECT_FALSE(conn.connected());
+}
+
+TEST_F(HttpServerTest, OmitsBodyOfHeadResponse) {
+  StringIoConnection conn(1, "HEAD /hello HTTP/1.1\r\n\r\n");
+  server_.OnConnect(conn);
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/plain\r\n"
+            "Content-Length: 5\r\n"
+            "\r\n");
+}
+
+TEST_F(HttpServerTest, ResponseWithoutLengthIsChunked) {
+  StringIoConnection conn(1, "GET /stream HTTP/1.1\r\n\r\n");
+  server_.OnConnect(conn);
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 200 OK\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "\r\n"
+            "8\r\nStreamed\r\n"
+            "0\r\n\r\n");
+  EXPECT_TRUE(conn.connected());
+}
+
+TEST_F(HttpServerTest, HeadResponseWithoutLength) {
+  StringIoConnection conn(1, "HEAD /stream HTTP/1.1\r\n\r\n");
+  server_.OnConnect(conn);
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 200 OK\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "\r\n");
+  EXPECT_TRUE(conn.connected());
+}
+
+TEST_F(HttpServerTest, Http10ResponseWithoutLengthCloses) {
+  StringIoConnection conn(
+      1, "GET /stream HTTP/1.0\r\nConnection: keep-alive\r\n\r\n");
+  server_.OnConnect(conn);
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 200 OK\r\n"
+            "Connection: close\r\n"
+            "\r\n"
+            "Streamed");
+  EXPECT_FALSE(conn.connected());
+}
+
+TEST_F(HttpServerTest, SizedBody) {
+  StringIoConnection conn(1,
+                          "GET /sized HTTP/1.1\r\n\r\n"
+                          "HEAD /sized HTTP/1.1\r\n\r\n");
+  server_.OnConnect(conn);
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Length: 13\r\n"
+            "\r\n"
+            "{\"value\": 42}"
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Length: 13\r\n"
+            "\r\n");
+  EXPECT_TRUE(conn.connected());
+}
+
+TEST_F(HttpServerTest, ChangedBodyClosesConnection) {
+  StringIoConnection conn(1, "GET /unstable HTTP/1.1\r\n\r\n");
+  server_.OnConnect(conn);
+  // The excess is discarded, and the connection closed so that the client
+  // knows something is wrong.
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Length: 5\r\n"
+            "\r\n"
+            "Longe");
+  EXPECT_FALSE(conn.connected());
+}
+
+TEST_F(HttpServerTest, VersionETag) {
+  StringIoConnection conn(1,
+                          "GET /versioned HTTP/1.1\r\n\r\n"
+                          "GET /versioned HTTP/1.1\r\n"
+                          "If-None-Match: \"1234ABCD\"\r\n\r\n"
+                          "GET /versioned HTTP/1.1\r\n"
+                          "If-None-Match: \"1234abce\"\r\n\r\n");
+  server_.OnConnect(conn);
+  EXPECT_EQ(handler_.requests, 3);
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 200 OK\r\n"
+            "ETag: \"1234abcd\"\r\n"
+            "Content-Length: 1\r\n"
+            "\r\n"
+            "v"
+            "HTTP/1.1 304 Not Modified\r\n"
+            "ETag: \"1234abcd\"\r\n"
+            "\r\n"
+            "HTTP/1.1 200 OK\r\n"
+            "ETag: \"1234abcd\"\r\n"
+            "Content-Length: 1\r\n"
+            "\r\n"
+            "v");
+  EXPECT_TRUE(conn.connected());
+}
+
+TEST_F(HttpServerTest, HashETag) {
+  std::string etag;
+  {
+    StringIoConnection conn(1, "GET /hashed HTTP/1.1\r\n\r\n");
+    server_.OnConnect(conn);
+    const std::string& output = conn.output();
+    const auto pos = output.find("ETag: ");
+    ASSERT_NE(pos, std::string::npos);
+    etag = output.substr(pos + 6, 10);
+    EXPECT_EQ(output,
+              "HTTP/1.1 200 OK\r\n"
+              "Content-Type: application/json\r\n"
+              "ETag: " +
+                  etag +
+                  "\r\n"
+                  "Content-Length: 13\r\n"
+                  "\r\n"
+                  "{\"value\": 42}");
+  }
+  StringIoConnection conn(
+      1, "GET /hashed HTTP/1.1\r\nIf-None-Match: " + etag + "\r\n\r\n");
+  server_.OnCanRead(conn);
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 304 Not Modified\r\n"
+            "ETag: " +
+                etag +
+                "\r\n"
+                "\r\n");
+}
+
+TEST_F(HttpServerTest, NoContentHasNoFraming) {
+  StringIoConnection conn(1, "GET /nothing HTTP/1.1\r\n\r\n");
+  server_.OnConnect(conn);
+  EXPECT_EQ(conn.output(), "HTTP/1.1 204 No Content\r\n\r\n");
+  EXPECT_TRUE(conn.connected());
+}
+
+TEST_F(HttpServerTest, NotFoundIfNotHandled) {
+  StringIoConnection conn(1, "GET /missing HTTP/1.1\r\n\r\n");
+  server_.OnConnect(conn);
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 404 Not Found\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n");
+}
+
+TEST_F(HttpServerTest, BadRequest) {
+  StringIoConnection conn(1, "GET / HTTP/1.1\r\nBad Header\r\n\r\n");
+  server_.OnConnect(conn);
+  EXPECT_EQ(handler_.requests, 0);
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 400 Bad Request\r\n"
+            "Content-Length: 0\r\n"
+            "Connection: close\r\n"
+            "\r\n");
+  EXPECT_FALSE(conn.connected());
+}
+
+TEST_F(HttpServerTest, RequestSpreadAcrossReads) {
+  const std::string_view kRequest = "GET /hello HTTP/1.1\r\n\r\n";
+  {
+    StringIoConnection conn(1, kRequest.substr(0, 10));
+    server_.OnConnect(conn);
+    EXPECT_EQ(handler_.requests, 0);
+    EXPECT_TRUE(conn.output().empty());
+    EXPECT_TRUE(conn.connected());
+  }
+  {
+    StringIoConnection conn(1, kRequest.substr(10));
+    server_.OnCanRead(conn);
+    EXPECT_EQ(handler_.requests, 1);
+    EXPECT_EQ(handler_.last_target, "/hello");
+  }
+}
+
+TEST_F(HttpServerTest, DisconnectDiscardsPartialRequest) {
+  {
+    StringIoConnection conn(1, "GET /hel");
+    server_.OnConnect(conn);
+  }
+  server_.OnDisconnect();
+  StringIoConnection conn(1, "GET /hello HTTP/1.1\r\n\r\n");
+  server_.OnConnect(conn);
+  EXPECT_EQ(handler_.requests, 1);
+  EXPECT_EQ(handler_.last_target, "/hello");
+}
+
+TEST_F(HttpServerTest, KeepsConnectionAlive) {
+  {
+    StringIoConnection conn(1, "GET /hello HTTP/1.1\r\n\r\n");
+    server_.OnConnect(conn);
+    EXPECT_EQ(conn.output(),
+              "HTTP/1.1 200 OK\r\n"
+              "Content-Type: text/plain\r\n"
+              "Content-Length: 5\r\n"
+              "\r\n"
+              "Hello");
+    EXPECT_TRUE(conn.connected());
+  }
+  StringIoConnection conn(1, "GET /hello?again HTTP/1.1\r\n\r\n");
+  server_.OnCanRead(conn);
+  EXPECT_EQ(handler_.requests, 2);
+  EXPECT_EQ(handler_.last_target, "/hello?again");
+  EXPECT_TRUE(conn.connected());
+}
+
+TEST_F(HttpServerTest, Http10KeepAliveIsAnnounced) {
+  StringIoConnection conn(
+      1, "GET /hello HTTP/1.0\r\nConnection: keep-alive\r\n\r\n");
+  server_.OnConnect(conn);
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/plain\r\n"
+            "Content-Length: 5\r\n"
+            "Connection: keep-alive\r\n"
+            "\r\n"
+            "Hello");
+  EXPECT_TRUE(conn.connected());
+}
+
+TEST_F(HttpServerTest, Http10ClosesByDefault) {
+  StringIoConnection conn(1, "GET /hello HTTP/1.0\r\n\r\n");
+  server_.OnConnect(conn);
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/plain\r\n"
+            "Content-Length: 5\r\n"
+            "Connection: close\r\n"
+            "\r\n"
+            "Hello");
+  EXPECT_FALSE(conn.connected());
+}
+
+TEST_F(HttpServerTest, PipelinedRequests) {
+  // The body of the POST is discarded, and each response is written before
+  // the next request is parsed.
+  StringIoConnection conn(1,
+                          "GET /hello HTTP/1.1\r\n\r\n"
+                          "POST /missing HTTP/1.1\r\n"
+                          "Content-Length: 4\r\n"
+                          "\r\n"
+                          "x=1&"
+                          "HEAD /hello HTTP/1.1\r\n\r\n"
+                          "GET /hello?last HTTP/1.1\r\n"
+                          "Connection: close\r\n"
+                          "\r\n"
+                          "GET /not-read HTTP/1.1\r\n\r\n");
+  server_.OnConnect(conn);
+  EXPECT_EQ(handler_.requests, 4);
+  EXPECT_EQ(handler_.last_target, "/hello?last");
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/plain\r\n"
+            "Content-Length: 5\r\n"
+            "\r\n"
+            "Hello"
+            "HTTP/1.1 404 Not Found\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n"
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/plain\r\n"
+            "Content-Length: 5\r\n"
+            "\r\n"
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/plain\r\n"
+            "Content-Length: 5\r\n"
+            "Connection: close\r\n"
+            "\r\n"
+            "Hello");
+  EXPECT_FALSE(conn.connected());
+}
+
+TEST_F(HttpServerTest, ClosesAfterMaxRequests) {
+  std::string input;
+  for (int ndx = 0; ndx < HttpServer::kMaxRequestsPerConnection + 1; ++ndx) {
+    input += "GET /hello HTTP/1.1\r\n\r\n";
+  }
+  StringIoConnection conn(1, input);
+  server_.OnConnect(conn);
+  EXPECT_EQ(handler_.requests, HttpServer::kMaxRequestsPerConnection);
+  EXPECT_FALSE(conn.connected());
+  const std::string_view output = conn.output();
+  EXPECT_EQ(output.find("Connection: close"),
+            output.rfind("Connection: close\r\n\r\nHello"));
+}
+
+TEST_F(HttpServerTest, ClosesIdleConnection) {
+  server_.set_idle_timeout_millis(0);
+  StringIoConnection conn(1, "GET /hello HTTP/1.1\r\n\r\n");
+  conn.set_ethernet_client_semantics(true);
+  server_.OnConnect(conn);
+  EXPECT_EQ(handler_.requests, 1);
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: text/plain\r\n"
+            "Content-Length: 5\r\n"
+            "\r\n"
+            "Hello");
+  EXPECT_FALSE(conn.connected());
+}
+
+TEST_F(HttpServerTest, HalfClosedConnectionIsNotTimedOut) {
+  server_.set_idle_timeout_millis(0);
+  // Without EthernetClient semantics, read returns 0 (EOF) once the input is
+  // consumed, so the server leaves closing the connection to ServerSocket.
+  StringIoConnection conn(1, "");
+  server_.OnConnect(conn);
+  EXPECT_EQ(conn.output(), "");
+  EXPECT_TRUE(conn.connected());
+}
+
+TEST_F(HttpServerTest, PartialRequestTimesOut) {
+  {
+    StringIoConnection conn(1, "GET /hel");
+    server_.OnConnect(conn);
+    EXPECT_TRUE(conn.connected());
+  }
+  server_.set_idle_timeout_millis(0);
+  StringIoConnection conn(1, "");
+  conn.set_ethernet_client_semantics(true);
+  server_.OnCanRead(conn);
+  EXPECT_EQ(handler_.requests, 0);
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 408 Request Timeout\r\n"
+            "Content-Length: 0\r\n"
+            "Connection: close\r\n"
+            "\r\n");
+  EXPECT_FALSE(conn.connected());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet
@@ -0,0 +1,88 @@
+#include "platform_network_interface.h"
+
+#include <memory>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "extras/test_tools/mock_platform_network.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace mcunet {
+namespace test {
+namespace {
+
+using ::testing::Return;
+
+TEST(PlatformNetworkInterfaceTest, ProcessWideImplementation) {
+  EXPECT_EQ(PlatformNetworkInterface::GetImplementation(), nullptr);
+  {
+    PlatformNetworkLifetime<MockPlatformNetwork> lifetime(
+        std::make_unique<MockPlatformNetwork>());
+    auto* const mock = lifetime.platform_network();
+    EXPECT_EQ(PlatformNetworkInterface::GetImplementation(), mock);
+
+    // Other threads see the same implementation.
+    PlatformNetworkInterface* seen = nullptr;
+    std::thread([&seen] {
+      seen = PlatformNetworkInterface::GetImplementation();
+    }).join();
+    EXPECT_EQ(seen, mock);
+  }
+  EXPECT_EQ(PlatformNetworkInterface::GetImplementation(), nullptr);
+}
+
+TEST(PlatformNetworkInterfaceTest, ThreadBindingOverridesProcessWide) {
+  PlatformNetworkLifetime<MockPlatformNetwork> lifetime(
+      std::make_unique<MockPlatformNetwork>());
+  auto* const process_wide = lifetime.platform_network();
+
+  MockPlatformNetwork outer, inner;
+  {
+    PlatformNetworkThreadBinding outer_binding(&outer);
+    EXPECT_EQ(PlatformNetworkInterface::GetImplementation(), &outer);
+    {
+      PlatformNetworkThreadBinding inner_binding(&inner);
+      EXPECT_EQ(PlatformNetworkInterface::GetImplementationOrDie(), &inner);
+
+      // The binding doesn't affect other threads.
+      PlatformNetworkInterface* seen = nullptr;
+      std::thread([&seen] {
+        seen = PlatformNetworkInterface::GetImplementation();
+      }).join();
+      EXPECT_EQ(seen, process_wide);
+    }
+    EXPECT_EQ(PlatformNetworkInterface::GetImplementation(), &outer);
+  }
+  EXPECT_EQ(PlatformNetworkInterface::GetImplementation(), process_wide);
+}
+
+TEST(PlatformNetworkInterfaceTest, ThreadScopedLifetimes) {
+  // Each thread simulates a separate device, with its own implementation, and
+  // PlatformNetwork calls are routed to the implementation of the thread.
+  constexpr int kNumThreads = 8;
+  std::vector<int> results(kNumThreads, -1);
+  std::vector<std::thread> threads;
+  for (int ndx = 0; ndx < kNumThreads; ++ndx) {
+    threads.emplace_back([ndx, &results] {
+      PlatformNetworkLifetime<MockPlatformNetwork> lifetime(
+          std::make_unique<MockPlatformNetwork>(),
+          PlatformNetworkScope::kThread);
+      EXPECT_CALL(*lifetime.platform_network(), FindUnusedSocket())
+          .WillOnce(Return(ndx));
+      results[ndx] =
+          PlatformNetworkInterface::GetImplementationOrDie()->FindUnusedSocket();
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int ndx = 0; ndx < kNumThreads; ++ndx) {
+    EXPECT_EQ(results[ndx], ndx);
+  }
+  EXPECT_EQ(PlatformNetworkInterface::GetImplementation(), nullptr);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet
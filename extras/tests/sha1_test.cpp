@@ -0,0 +1,67 @@
+#include "sha1.h"
+
+#include <stdint.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace mcunet {
+namespace test {
+namespace {
+
+std::string ToHex(const uint8_t (&digest)[Sha1::kDigestSize]) {
+  static const char kDigits[] = "0123456789abcdef";
+  std::string result;
+  for (const uint8_t b : digest) {
+    result.push_back(kDigits[b >> 4]);
+    result.push_back(kDigits[b & 15]);
+  }
+  return result;
+}
+
+std::string Digest(const std::string& message) {
+  Sha1 sha1;
+  sha1.Update(reinterpret_cast<const uint8_t*>(message.data()),
+              message.size());
+  uint8_t digest[Sha1::kDigestSize];
+  sha1.Finish(digest);
+  return ToHex(digest);
+}
+
+TEST(Sha1Test, KnownDigests) {
+  EXPECT_EQ(Digest(""), "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+  EXPECT_EQ(Digest("abc"), "a9993e364706816aba3e25717850c26c9cd0d89d");
+  // 56 bytes, so the padding needs a second block.
+  EXPECT_EQ(Digest("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+            "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+  EXPECT_EQ(Digest(std::string(1000000, 'a')),
+            "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+}
+
+TEST(Sha1Test, IncrementalUpdates) {
+  const std::string message = "The quick brown fox jumps over the lazy dog";
+  for (size_t split = 0; split <= message.size(); ++split) {
+    Sha1 sha1;
+    sha1.Update(reinterpret_cast<const uint8_t*>(message.data()), split);
+    sha1.Update(reinterpret_cast<const uint8_t*>(message.data()) + split,
+                message.size() - split);
+    uint8_t digest[Sha1::kDigestSize];
+    sha1.Finish(digest);
+    EXPECT_EQ(ToHex(digest), "2fd4e1c67a2d28fced849ee1bb76e7391b93eb12")
+        << "split=" << split;
+  }
+}
+
+TEST(Sha1Test, ProgmemUpdate) {
+  Sha1 sha1;
+  sha1.Update(reinterpret_cast<const uint8_t*>("ab"), 2);
+  sha1.Update(MCU_PSV("c"));
+  uint8_t digest[Sha1::kDigestSize];
+  sha1.Finish(digest);
+  EXPECT_EQ(ToHex(digest), "a9993e364706816aba3e25717850c26c9cd0d89d");
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet
@@ -0,0 +1,191 @@
+#include "websocket_frame.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "extras/test_tools/string_io_stream_impl.h"
+#include "gtest/gtest.h"
+
+namespace mcunet {
+namespace test {
+namespace {
+
+constexpr uint8_t kMaskKey[4] = {0x37, 0xfa, 0x21, 0x3d};
+
+// Returns a frame as a client would send it, i.e. masked with kMaskKey.
+std::string ClientFrame(uint8_t first_byte, const std::string& payload) {
+  std::string frame(1, static_cast<char>(first_byte));
+  if (payload.size() < 126) {
+    frame.push_back(static_cast<char>(0x80 | payload.size()));
+  } else {
+    frame.push_back(static_cast<char>(0x80 | 126));
+    frame.push_back(static_cast<char>(payload.size() >> 8));
+    frame.push_back(static_cast<char>(payload.size()));
+  }
+  frame.append(reinterpret_cast<const char*>(kMaskKey), sizeof kMaskKey);
+  for (size_t ndx = 0; ndx < payload.size(); ++ndx) {
+    frame.push_back(static_cast<char>(payload[ndx] ^ kMaskKey[ndx % 4]));
+  }
+  return frame;
+}
+
+struct Event {
+  WebSocketFrameDecoder::Result result;
+  std::string payload;  // For kPayload.
+};
+
+// Decodes input, passing the decoder at most piece_size bytes at a time, and
+// returns the events, merging adjacent pieces of payload.
+std::vector<Event> DecodeAll(WebSocketFrameDecoder& decoder,
+                             std::string input, size_t piece_size) {
+  std::vector<Event> events;
+  size_t start = 0;
+  while (start < input.size()) {
+    const size_t size = std::min(piece_size, input.size() - start);
+    size_t consumed = 0;
+    const auto result = decoder.Decode(
+        reinterpret_cast<uint8_t*>(&input[start]), size, consumed);
+    EXPECT_LE(consumed, size);
+    if (result == WebSocketFrameDecoder::Result::kPayload) {
+      const std::string payload = input.substr(start, consumed);
+      if (!events.empty() &&
+          events.back().result == WebSocketFrameDecoder::Result::kPayload) {
+        events.back().payload += payload;
+      } else {
+        events.push_back({result, payload});
+      }
+    } else if (result != WebSocketFrameDecoder::Result::kNeedMoreInput) {
+      events.push_back({result, ""});
+    }
+    if (result == WebSocketFrameDecoder::Result::kError) {
+      break;
+    }
+    start += consumed;
+  }
+  return events;
+}
+
+TEST(WebSocketFrameTest, ApplyMaskMatchesBytewiseMasking) {
+  std::vector<uint8_t> original(37);
+  for (size_t ndx = 0; ndx < original.size(); ++ndx) {
+    original[ndx] = static_cast<uint8_t>(ndx * 7 + 3);
+  }
+  for (uint32_t offset = 0; offset < 8; ++offset) {
+    for (size_t start = 0; start < 4; ++start) {
+      for (size_t size = 0; start + size <= original.size(); ++size) {
+        std::vector<uint8_t> data = original;
+        ApplyWebSocketMask(kMaskKey, offset, data.data() + start, size);
+        for (size_t ndx = 0; ndx < data.size(); ++ndx) {
+          uint8_t expected = original[ndx];
+          if (start <= ndx && ndx < start + size) {
+            expected ^= kMaskKey[(offset + ndx - start) % 4];
+          }
+          ASSERT_EQ(data[ndx], expected)
+              << "offset=" << offset << " start=" << start
+              << " size=" << size << " ndx=" << ndx;
+        }
+      }
+    }
+  }
+}
+
+TEST(WebSocketFrameTest, WriteFrameHeader) {
+  {
+    StringIoConnection out(1, "");
+    WriteWebSocketFrameHeader(out, WebSocketOpcode::kText, 5);
+    EXPECT_EQ(out.output(), std::string("\x81\x05", 2));
+  }
+  {
+    StringIoConnection out(1, "");
+    WriteWebSocketFrameHeader(out, WebSocketOpcode::kBinary, 126,
+                              /*fin=*/false);
+    EXPECT_EQ(out.output(), std::string("\x02\x7e\x00\x7e", 4));
+  }
+  {
+    StringIoConnection out(1, "");
+    WriteWebSocketFrameHeader(out, WebSocketOpcode::kBinary, 0x10000);
+    EXPECT_EQ(out.output(),
+              std::string("\x82\x7f\x00\x00\x00\x00\x00\x01\x00\x00", 10));
+  }
+}
+
+TEST(WebSocketFrameTest, DecodesRfcExample) {
+  // From section 5.7 of RFC 6455.
+  const std::string kFrame =
+      "\x81\x85\x37\xfa\x21\x3d\x7f\x9f\x4d\x51\x58";
+  EXPECT_EQ(kFrame, ClientFrame(0x81, "Hello"));
+  for (size_t piece_size = 1; piece_size <= kFrame.size(); ++piece_size) {
+    WebSocketFrameDecoder decoder;
+    const auto events = DecodeAll(decoder, kFrame, piece_size);
+    ASSERT_EQ(events.size(), 2) << "piece_size=" << piece_size;
+    EXPECT_EQ(events[0].result, WebSocketFrameDecoder::Result::kFrameHeader);
+    EXPECT_EQ(events[1].result, WebSocketFrameDecoder::Result::kPayload);
+    EXPECT_EQ(events[1].payload, "Hello");
+    EXPECT_EQ(decoder.opcode(), WebSocketOpcode::kText);
+    EXPECT_TRUE(decoder.fin());
+    EXPECT_EQ(decoder.payload_size(), 5);
+    EXPECT_EQ(decoder.payload_remaining(), 0);
+  }
+}
+
+TEST(WebSocketFrameTest, DecodesFragmentedMessageWithControlFrame) {
+  const std::string long_payload(300, 'x');
+  const std::string input = ClientFrame(0x02, "Hel") + ClientFrame(0x89, "") +
+                            ClientFrame(0x00, long_payload) +
+                            ClientFrame(0x80, "lo");
+  WebSocketFrameDecoder decoder;
+  const auto events = DecodeAll(decoder, input, input.size());
+  ASSERT_EQ(events.size(), 7);
+  EXPECT_EQ(events[1].payload, "Hel");
+  EXPECT_EQ(events[2].result, WebSocketFrameDecoder::Result::kFrameHeader);
+  EXPECT_EQ(events[3].result, WebSocketFrameDecoder::Result::kFrameHeader);
+  EXPECT_EQ(events[4].payload, long_payload);
+  EXPECT_EQ(events[6].payload, "lo");
+  EXPECT_EQ(decoder.opcode(), WebSocketOpcode::kContinuation);
+  EXPECT_EQ(decoder.message_opcode(), WebSocketOpcode::kBinary);
+  EXPECT_TRUE(decoder.fin());
+}
+
+TEST(WebSocketFrameTest, ProtocolErrors) {
+  struct {
+    std::string input;
+    WebSocketCloseCode error_code;
+  } kCases[] = {
+      // Not masked.
+      {std::string("\x81\x05Hello", 7), WebSocketCloseCode::kProtocolError},
+      // Reserved bit set.
+      {ClientFrame(0xC1, "x"), WebSocketCloseCode::kProtocolError},
+      // Unknown opcode.
+      {ClientFrame(0x83, "x"), WebSocketCloseCode::kProtocolError},
+      // Continuation without a message.
+      {ClientFrame(0x80, "x"), WebSocketCloseCode::kProtocolError},
+      // New message before the end of the previous.
+      {ClientFrame(0x01, "x") + ClientFrame(0x81, "y"),
+       WebSocketCloseCode::kProtocolError},
+      // Fragmented control frame.
+      {ClientFrame(0x09, ""), WebSocketCloseCode::kProtocolError},
+      // Control frame that is too long.
+      {ClientFrame(0x89, std::string(126, 'p')),
+       WebSocketCloseCode::kProtocolError},
+      // Close frame with a partial status code.
+      {ClientFrame(0x88, "x"), WebSocketCloseCode::kProtocolError},
+      // Payload of 2^32 bytes.
+      {std::string("\x82\xff\x00\x00\x00\x01\x00\x00\x00\x00", 10),
+       WebSocketCloseCode::kMessageTooBig},
+  };
+  for (const auto& test_case : kCases) {
+    WebSocketFrameDecoder decoder;
+    const auto events = DecodeAll(decoder, test_case.input, 1000);
+    ASSERT_FALSE(events.empty());
+    EXPECT_EQ(events.back().result, WebSocketFrameDecoder::Result::kError);
+    EXPECT_EQ(decoder.error_code(), test_case.error_code);
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet
@@ -0,0 +1,280 @@
+#include "websocket.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "extras/test_tools/string_io_stream_impl.h"
+#include "gtest/gtest.h"
+#include "http_request.h"
+#include "http_response.h"
+#include "http_server.h"
+#include "websocket_frame.h"
+
+namespace mcunet {
+namespace test {
+namespace {
+
+// The example key from RFC 6455, and the corresponding accept value.
+constexpr char kUpgradeRequest[] =
+    "GET /ws HTTP/1.1\r\n"
+    "Host: server.example.com\r\n"
+    "Upgrade: websocket\r\n"
+    "Connection: keep-alive, Upgrade\r\n"
+    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+    "Sec-WebSocket-Version: 13\r\n"
+    "\r\n";
+constexpr char kUpgradeResponse[] =
+    "HTTP/1.1 101 Switching Protocols\r\n"
+    "Upgrade: websocket\r\n"
+    "Connection: Upgrade\r\n"
+    "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"
+    "\r\n";
+
+// Returns a frame as a client would send it, i.e. masked.
+std::string ClientFrame(uint8_t first_byte, const std::string& payload) {
+  constexpr uint8_t kMaskKey[4] = {0x12, 0x34, 0x56, 0x78};
+  std::string frame(1, static_cast<char>(first_byte));
+  frame.push_back(static_cast<char>(0x80 | payload.size()));
+  frame.append(reinterpret_cast<const char*>(kMaskKey), sizeof kMaskKey);
+  for (size_t ndx = 0; ndx < payload.size(); ++ndx) {
+    frame.push_back(static_cast<char>(payload[ndx] ^ kMaskKey[ndx % 4]));
+  }
+  return frame;
+}
+
+// Returns a frame as the server sends it, i.e. unmasked.
+std::string ServerFrame(uint8_t first_byte, const std::string& payload) {
+  return std::string(1, static_cast<char>(first_byte)) +
+         static_cast<char>(payload.size()) + payload;
+}
+
+class EchoHandler : public WebSocketHandler {
+ public:
+  bool AcceptWebSocket(const HttpRequest& request) override {
+    return request.path() == MCU_PSV("/ws");
+  }
+
+  void OnWebSocketOpen(WebSocket& websocket) override {
+    ++opens;
+    websocket.QueueText(mcucore::StringView("hi"));
+  }
+
+  // Echoes each text message, and closes the WebSocket if asked to.
+  void OnWebSocketData(WebSocket& websocket, WebSocketOpcode message_opcode,
+                       const uint8_t* data, size_t size,
+                       bool message_end) override {
+    message.append(reinterpret_cast<const char*>(data), size);
+    if (!message_end) {
+      return;
+    }
+    EXPECT_EQ(message_opcode, WebSocketOpcode::kText);
+    if (message == "bye") {
+      websocket.Close();
+    } else {
+      websocket.QueueText(mcucore::StringView(message.data(), message.size()));
+    }
+    ++messages;
+    message.clear();
+  }
+
+  void OnWebSocketClose(WebSocket& websocket) override { ++closes; }
+
+  std::string message;
+  int opens = 0;
+  int messages = 0;
+  int closes = 0;
+};
+
+class NotFoundHandler : public HttpRequestHandler {
+ public:
+  void HandleRequest(const HttpRequest& request,
+                     HttpResponse& response) override {}
+};
+
+class WebSocketTest : public testing::Test {
+ protected:
+  WebSocketTest()
+      : websocket_(handler_), server_(80, http_handler_, websocket_) {}
+
+  // Upgrades a new connection to a WebSocket.
+  void Open() {
+    StringIoConnection conn(1, kUpgradeRequest);
+    conn.set_ethernet_client_semantics(true);
+    server_.OnConnect(conn);
+    ASSERT_EQ(conn.output(),
+              std::string(kUpgradeResponse) + ServerFrame(0x81, "hi"));
+    ASSERT_TRUE(websocket_.is_open());
+  }
+
+  // Passes input to the open WebSocket, and returns the output.
+  std::string Exchange(const std::string& input,
+                       bool expect_connected = true) {
+    StringIoConnection conn(1, input);
+    conn.set_ethernet_client_semantics(true);
+    server_.OnCanRead(conn);
+    EXPECT_EQ(conn.connected(), expect_connected);
+    return conn.output();
+  }
+
+  EchoHandler handler_;
+  NotFoundHandler http_handler_;
+  WebSocket websocket_;
+  HttpServer server_;
+};
+
+TEST(ComputeWebSocketAcceptTest, RfcExample) {
+  const char kKey[24] = {'d', 'G', 'h', 'l', 'I', 'H', 'N', 'h',
+                         'b', 'X', 'B', 's', 'Z', 'S', 'B', 'u',
+                         'b', '2', '5', 'j', 'Z', 'Q', '=', '='};
+  char accept[28];
+  ComputeWebSocketAccept(kKey, accept);
+  EXPECT_EQ(std::string(accept, sizeof accept),
+            "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+TEST_F(WebSocketTest, UpgradesAndEchoes) {
+  Open();
+  EXPECT_EQ(handler_.opens, 1);
+  EXPECT_EQ(Exchange(ClientFrame(0x81, "Hello")), ServerFrame(0x81, "Hello"));
+  // A fragmented message, with a Ping between the fragments.
+  EXPECT_EQ(Exchange(ClientFrame(0x01, "Hel") + ClientFrame(0x89, "p!") +
+                     ClientFrame(0x80, "lo")),
+            ServerFrame(0x8A, "p!") + ServerFrame(0x81, "Hello"));
+  EXPECT_EQ(handler_.messages, 2);
+}
+
+TEST_F(WebSocketTest, FramesAfterUpgradeRequest) {
+  StringIoConnection conn(
+      1, std::string(kUpgradeRequest) + ClientFrame(0x81, "x"));
+  server_.OnConnect(conn);
+  EXPECT_EQ(conn.output(), std::string(kUpgradeResponse) +
+                               ServerFrame(0x81, "hi") +
+                               ServerFrame(0x81, "x"));
+}
+
+TEST_F(WebSocketTest, Broadcast) {
+  EchoHandler other_handler;
+  WebSocket other(other_handler);
+  WebSocket* const kWebSockets[] = {&websocket_, &other};
+  WebSocketBroadcaster broadcaster(kWebSockets);
+  EXPECT_EQ(broadcaster.BroadcastText(mcucore::StringView("x")), 0);
+  Open();
+  EXPECT_EQ(broadcaster.BroadcastText(mcucore::StringView("old")), 1);
+  EXPECT_EQ(broadcaster.BroadcastText(mcucore::StringView("state")), 1);
+  // Only the latest message is sent.
+  EXPECT_EQ(Exchange(""), ServerFrame(0x81, "state"));
+  EXPECT_EQ(Exchange(""), "");
+  const std::string too_long(WebSocket::kOutboxSize + 1, 'x');
+  EXPECT_EQ(broadcaster.BroadcastText(
+                mcucore::StringView(too_long.data(), too_long.size())),
+            0);
+}
+
+TEST_F(WebSocketTest, SendsToIdleClient) {
+  WebSocket* const kWebSockets[] = {&websocket_};
+  WebSocketBroadcaster broadcaster(kWebSockets);
+  Open();
+  EXPECT_EQ(broadcaster.BroadcastText(mcucore::StringView("news")), 1);
+  // The open connection has no input, so read returns -1.
+  StringIoConnection conn(1, "");
+  conn.set_ethernet_client_semantics(true);
+  server_.OnCanRead(conn);
+  EXPECT_EQ(conn.output(), ServerFrame(0x81, "news"));
+  EXPECT_TRUE(conn.connected());
+}
+
+TEST_F(WebSocketTest, SendsNothingAfterClientHalfCloses) {
+  WebSocket* const kWebSockets[] = {&websocket_};
+  WebSocketBroadcaster broadcaster(kWebSockets);
+  Open();
+  EXPECT_EQ(broadcaster.BroadcastText(mcucore::StringView("news")), 1);
+  // Without EthernetClient semantics, read returns 0 (EOF) once the input is
+  // consumed.
+  StringIoConnection conn(1, "");
+  server_.OnCanRead(conn);
+  EXPECT_EQ(conn.output(), "");
+}
+
+TEST_F(WebSocketTest, ClientCloses) {
+  Open();
+  const std::string kClose = std::string("\x03\xe8", 2) + "done";
+  EXPECT_EQ(Exchange(ClientFrame(0x88, kClose), /*expect_connected=*/false),
+            ServerFrame(0x88, kClose));
+  EXPECT_FALSE(websocket_.is_connected());
+  EXPECT_EQ(handler_.closes, 1);
+}
+
+TEST_F(WebSocketTest, ServerCloses) {
+  Open();
+  EXPECT_EQ(Exchange(ClientFrame(0x81, "bye")),
+            ServerFrame(0x88, std::string("\x03\xe8", 2)));
+  EXPECT_TRUE(websocket_.is_connected());
+  EXPECT_FALSE(websocket_.is_open());
+  // Pings aren't answered while closing.
+  EXPECT_EQ(Exchange(ClientFrame(0x89, "") + ClientFrame(0x88, ""),
+                     /*expect_connected=*/false),
+            "");
+  EXPECT_EQ(handler_.closes, 1);
+}
+
+TEST_F(WebSocketTest, ProtocolErrorCloses) {
+  Open();
+  // Not masked.
+  EXPECT_EQ(Exchange(ServerFrame(0x81, "x"), /*expect_connected=*/false),
+            ServerFrame(0x88, std::string("\x03\xea", 2)));
+  EXPECT_EQ(handler_.closes, 1);
+}
+
+TEST_F(WebSocketTest, PingsIdleClientAndClosesIfUnresponsive) {
+  Open();
+  websocket_.set_ping_interval_millis(0);
+  websocket_.set_pong_timeout_millis(1000000);
+  EXPECT_EQ(Exchange(""), ServerFrame(0x89, ""));
+  EXPECT_EQ(Exchange(""), "");
+  // The Pong resets the timer.
+  EXPECT_EQ(Exchange(ClientFrame(0x8A, "")), ServerFrame(0x89, ""));
+  websocket_.set_pong_timeout_millis(0);
+  EXPECT_EQ(Exchange("", /*expect_connected=*/false), "");
+  EXPECT_EQ(handler_.closes, 1);
+}
+
+TEST_F(WebSocketTest, UnsupportedVersion) {
+  std::string request = kUpgradeRequest;
+  request.replace(request.find("13"), 2, "8");
+  StringIoConnection conn(1, request);
+  server_.OnConnect(conn);
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 426 Upgrade Required\r\n"
+            "Sec-WebSocket-Version: 13\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n");
+  EXPECT_FALSE(websocket_.is_connected());
+  EXPECT_TRUE(conn.connected());
+}
+
+TEST_F(WebSocketTest, DeclinedUpgradeGoesToHttpHandler) {
+  std::string request = kUpgradeRequest;
+  request.replace(request.find("/ws"), 3, "/other");
+  StringIoConnection conn(1, request);
+  server_.OnConnect(conn);
+  EXPECT_EQ(conn.output(),
+            "HTTP/1.1 404 Not Found\r\n"
+            "Content-Length: 0\r\n"
+            "\r\n");
+  EXPECT_FALSE(websocket_.is_connected());
+}
+
+TEST_F(WebSocketTest, DisconnectNotifiesHandler) {
+  Open();
+  server_.OnDisconnect();
+  EXPECT_FALSE(websocket_.is_connected());
+  EXPECT_EQ(handler_.closes, 1);
+  server_.OnDisconnect();
+  EXPECT_EQ(handler_.closes, 1);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mcunet
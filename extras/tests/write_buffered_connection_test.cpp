@@ -168,6 +168,106 @@ TEST_F(WriteBufferedConnectionTest, FlushWithError) {
   EXPECT_EQ(conn.getWriteError(), 321);
 }
 
+TEST_F(WriteBufferedConnectionTest, TryFlushWithPartialWrites) {
+  FakeWriteBufferedConnection conn{mock_client_, 2, write_buffer_};
+  EXPECT_TRUE(conn.TryFlush());
+
+  EXPECT_EQ(conn.print("abcdefghij"), 10);
+  EXPECT_CALL(mock_client_, write(write_buffer_.data(), 10))
+      .WillOnce(Invoke([this](const uint8_t* data, size_t size) {
+        flushed_data_.insert(flushed_data_.end(), data, data + 4);
+        return 4;
+      }));
+  EXPECT_FALSE(conn.TryFlush());
+  EXPECT_THAT(flushed_data_, ElementsAre('a', 'b', 'c', 'd'));
+  EXPECT_EQ(conn.availableForWrite(), kWriteBufferSize - 6);
+
+  // No room, but no error either.
+  EXPECT_CALL(mock_client_, write(write_buffer_.data(), 6)).WillOnce(Return(0));
+  EXPECT_FALSE(conn.TryFlush());
+  EXPECT_EQ(conn.getWriteError(), 0);
+
+  // More can be appended to the remaining bytes.
+  EXPECT_EQ(conn.print("kl"), 2);
+  EXPECT_CALL(mock_client_, write(write_buffer_.data(), 8));
+  EXPECT_TRUE(conn.TryFlush());
+  EXPECT_THAT(flushed_data_, ElementsAre('a', 'b', 'c', 'd', 'e', 'f', 'g', 'h',
+                                         'i', 'j', 'k', 'l'));
+  EXPECT_EQ(conn.availableForWrite(), kWriteBufferSize);
+
+  // Nothing left to write when conn is deleted.
+  EXPECT_CALL(mock_client_, write(_, _)).Times(0);
+}
+
+TEST_F(WriteBufferedConnectionTest, TryFlushWithError) {
+  FakeWriteBufferedConnection conn{mock_client_, 2, write_buffer_};
+  conn.write(123);
+  EXPECT_CALL(mock_client_, write(_, _))
+      .WillOnce(Invoke([this](const uint8_t* data, size_t size) {
+        mock_client_.setWriteError(321);
+        return 0;
+      }));
+  EXPECT_FALSE(conn.TryFlush());
+  EXPECT_EQ(conn.getWriteError(), 321);
+  EXPECT_FALSE(conn.TryFlush());
+}
+
+TEST_F(WriteBufferedConnectionTest, ChunkedCodingFramesEachFlush) {
+  FakeWriteBufferedConnection conn{mock_client_, 2, write_buffer_};
+  EXPECT_EQ(conn.print("HDR"), 3);
+  EXPECT_TRUE(conn.StartChunkedCoding());
+  // Room is reserved for the chunk-size line and the CRLF after the data.
+  EXPECT_EQ(conn.availableForWrite(), kWriteBufferSize - 3 - 4 - 2);
+
+  // The first chunk shares the buffer (and so the write) with "HDR", and the
+  // next one fills the buffer.
+  EXPECT_CALL(mock_client_, write(write_buffer_.data(), kWriteBufferSize))
+      .Times(2);
+  EXPECT_EQ(conn.print("abcdefghijklmnopqrstuvwxyz"), 26);
+  EXPECT_EQ(std::string(flushed_data_.begin(), flushed_data_.end()),
+            "HDR07\r\nabcdefg\r\n0A\r\nhijklmnopq\r\n");
+
+  EXPECT_CALL(mock_client_, write(write_buffer_.data(), 4 + 9 + 2));
+  conn.flush();
+  EXPECT_EQ(std::string(flushed_data_.begin(), flushed_data_.end()),
+            "HDR07\r\nabcdefg\r\n0A\r\nhijklmnopq\r\n09\r\nrstuvwxyz\r\n");
+
+  // Flushing without data doesn't write an (empty) chunk, which would mark the
+  // end of the body.
+  EXPECT_CALL(mock_client_, write(_, _)).Times(0);
+  conn.flush();
+  EXPECT_EQ(conn.print('!'), 1);
+  conn.EndChunkedCoding();
+  EXPECT_EQ(conn.availableForWrite(), kWriteBufferSize - 4 - 1 - 2 - 5);
+
+  EXPECT_CALL(mock_client_, write(write_buffer_.data(), 12));
+  conn.flush();
+  flushed_data_.erase(flushed_data_.begin(), flushed_data_.end() - 12);
+  EXPECT_EQ(std::string(flushed_data_.begin(), flushed_data_.end()),
+            "01\r\n!\r\n0\r\n\r\n");
+}
+
+TEST_F(WriteBufferedConnectionTest, ChunkedCodingWithPartialTryFlush) {
+  FakeWriteBufferedConnection conn{mock_client_, 2, write_buffer_};
+  EXPECT_TRUE(conn.StartChunkedCoding());
+  EXPECT_EQ(conn.print("abc"), 3);
+  EXPECT_CALL(mock_client_, write(write_buffer_.data(), 9))
+      .WillOnce(Invoke([this](const uint8_t* data, size_t size) {
+        flushed_data_.insert(flushed_data_.end(), data, data + 5);
+        return 5;
+      }));
+  EXPECT_FALSE(conn.TryFlush());
+
+  // The rest of the chunk is written before the next one.
+  EXPECT_EQ(conn.print("de"), 2);
+  EXPECT_CALL(mock_client_, write(write_buffer_.data(), 4 + 8));
+  EXPECT_TRUE(conn.TryFlush());
+  EXPECT_EQ(std::string(flushed_data_.begin(), flushed_data_.end()),
+            "03\r\nabc\r\n02\r\nde\r\n");
+  conn.EndChunkedCoding();
+  EXPECT_CALL(mock_client_, write(write_buffer_.data(), 5));
+}
+
 TEST_F(WriteBufferedConnectionTest, ReadForwardedToClient) {
   FakeWriteBufferedConnection conn{mock_client_, 2, write_buffer_};
 
@@ -7,18 +7,34 @@
 // Author: james.synge@gmail.com
 
 #include "addresses.h"                   // IWYU pragma: export
+#include "arp_prober.h"                  // IWYU pragma: export
 #include "connection.h"                  // IWYU pragma: export
+#include "dhcp_client.h"                 // IWYU pragma: export
+#include "dhcp_lease.h"                  // IWYU pragma: export
 #include "disconnect_data.h"             // IWYU pragma: export
 #include "eeprom_tags.h"                 // IWYU pragma: export
 #include "ethernet_address.h"            // IWYU pragma: export
+#include "framed_message.h"              // IWYU pragma: export
+#include "http_asset_handler.h"          // IWYU pragma: export
+#include "http_chunked_writer.h"         // IWYU pragma: export
+#include "http_request.h"                // IWYU pragma: export
+#include "http_request_parser.h"         // IWYU pragma: export
+#include "http_response.h"               // IWYU pragma: export
+#include "http_router.h"                 // IWYU pragma: export
+#include "http_server.h"                 // IWYU pragma: export
 #include "ip_address.h"                  // IWYU pragma: export
 #include "ip_device.h"                   // IWYU pragma: export
 #include "mcunet_config.h"               // IWYU pragma: export
 #include "platform_network.h"            // IWYU pragma: export
 #include "platform_network_interface.h"  // IWYU pragma: export
+#include "pnapi_counters.h"              // IWYU pragma: export
 #include "server_socket.h"               // IWYU pragma: export
+#include "sha1.h"                        // IWYU pragma: export
 #include "socket_listener.h"             // IWYU pragma: export
 #include "tcp_server_connection.h"       // IWYU pragma: export
+#include "w5500_arp_transport.h"         // IWYU pragma: export
+#include "websocket.h"                   // IWYU pragma: export
+#include "websocket_frame.h"             // IWYU pragma: export
 #include "write_buffered_connection.h"   // IWYU pragma: export
 
 #endif  // MCUNET_SRC_MCUNET_H_
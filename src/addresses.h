@@ -29,12 +29,12 @@ struct Addresses {
   mcucore::Status WriteEepromEntry(mcucore::EepromTlv& eeprom_tlv) const;
 
   // Randomly generate the addresses, using the Generate method of each address
-  // class. The Ethernet address has the specified OuiPrefix if supplied. No
-  // support is provided for detecting conflicts with other users of the
-  // generated addresses. The Arduino random number library is used, so be sure
-  // to seed it according to the level of randomness you want in the generated
-  // address; if you don't set the seed, the same sequence of numbers is always
-  // produced.
+  // class. The Ethernet address has the specified OuiPrefix if supplied. This
+  // doesn't check for conflicts with other users of the generated addresses;
+  // IpDevice uses ArpProber to do that for the IP address. The Arduino random
+  // number library is used, so be sure to seed it according to the level of
+  // randomness you want in the generated address; if you don't set the seed,
+  // the same sequence of numbers is always produced.
   void GenerateAddresses(const OuiPrefix* oui_prefix = nullptr);
 
   // Insert formatted addresses into the output stream, e.g. for logging.
@@ -0,0 +1,146 @@
+#include "arp_prober.h"
+
+#include <McuCore.h>
+#include <string.h>
+
+namespace mcunet {
+namespace {
+
+bool IsZero(const IPAddress& ip) {
+  return ip[0] == 0 && ip[1] == 0 && ip[2] == 0 && ip[3] == 0;
+}
+
+bool SameMac(const EthernetAddress& a, const EthernetAddress& b) {
+  return memcmp(a.bytes, b.bytes, sizeof a.bytes) == 0;
+}
+
+}  // namespace
+
+ArpProber::ArpProber(ArpTransport& transport)
+    : transport_(transport),
+      state_(State::kStopped),
+      sent_count_(0),
+      timer_start_millis_(0),
+      timer_millis_(0),
+      have_defended_(false) {}
+
+bool ArpProber::Start(const EthernetAddress& mac, const IPAddress& ip,
+                      const uint32_t now_millis, const uint32_t delay_millis) {
+  Stop();
+  if (!transport_.Open()) {
+    MCU_VLOG(1) << MCU_PSD("ArpProber unable to open transport");
+    return false;
+  }
+  mac_ = mac;
+  ip_ = ip;
+  state_ = State::kProbing;
+  sent_count_ = 0;
+  have_defended_ = false;
+  // Randomize the first probe so that hosts powered up together (e.g. after a
+  // power failure) don't probe in lock step.
+  SetTimer(now_millis, delay_millis + random(0, kProbeWaitMillis + 1));
+  return true;
+}
+
+void ArpProber::Stop() {
+  if (state_ != State::kStopped) {
+    transport_.Close();
+    state_ = State::kStopped;
+  }
+}
+
+ArpProber::Event ArpProber::PerformIO(const uint32_t now_millis) {
+  if (state_ == State::kStopped) {
+    return Event::kNone;
+  }
+  ArpPacket packet;
+  for (uint8_t count = 0; count < 4 && transport_.Receive(packet); ++count) {
+    if (IsConflict(packet)) {
+      const auto event = HandleConflict(now_millis);
+      if (event != Event::kNone) {
+        return event;
+      }
+    }
+  }
+  if (now_millis - timer_start_millis_ >= timer_millis_) {
+    return HandleTimer(now_millis);
+  }
+  return Event::kNone;
+}
+
+bool ArpProber::IsConflict(const ArpPacket& packet) const {
+  if (SameMac(packet.sender_mac, mac_)) {
+    return false;
+  } else if (packet.sender_ip == ip_) {
+    return true;
+  }
+  // While probing, another host probing for the same address is a conflict.
+  return state_ == State::kProbing && packet.operation == ArpPacket::kRequest &&
+         IsZero(packet.sender_ip) && packet.target_ip == ip_;
+}
+
+ArpProber::Event ArpProber::HandleConflict(const uint32_t now_millis) {
+  if (state_ == State::kAnnouncing && !have_defended_) {
+    // We've already claimed the address, so defend it once, in case the other
+    // host has stale ARP cache entries.
+    MCU_VLOG(2) << MCU_PSD("ArpProber defending ") << ip_;
+    have_defended_ = true;
+    SendArp(/*announcement=*/true);
+    return Event::kNone;
+  }
+  MCU_VLOG(1) << MCU_PSD("ArpProber conflict for ") << ip_;
+  Stop();
+  return Event::kConflict;
+}
+
+ArpProber::Event ArpProber::HandleTimer(const uint32_t now_millis) {
+  if (state_ == State::kProbing) {
+    if (sent_count_ < kProbeNum) {
+      SendArp(/*announcement=*/false);
+      ++sent_count_;
+      if (sent_count_ < kProbeNum) {
+        SetTimer(now_millis, random(kProbeMinMillis, kProbeMaxMillis + 1));
+      } else {
+        SetTimer(now_millis, kAnnounceWaitMillis);
+      }
+      return Event::kNone;
+    }
+    // No conflicting packets arrived, so we've claimed the address.
+    MCU_VLOG(2) << MCU_PSD("ArpProber claimed ") << ip_;
+    state_ = State::kAnnouncing;
+    SendArp(/*announcement=*/true);
+    sent_count_ = 1;
+    SetTimer(now_millis, kAnnounceIntervalMillis);
+    return Event::kAddressClaimed;
+  }
+  MCU_DCHECK(state_ == State::kAnnouncing);
+  SendArp(/*announcement=*/true);
+  if (++sent_count_ < kAnnounceNum) {
+    SetTimer(now_millis, kAnnounceIntervalMillis);
+  } else {
+    // Done announcing, so release the transport (i.e. the W5500's socket 0).
+    MCU_VLOG(2) << MCU_PSD("ArpProber done announcing ") << ip_;
+    Stop();
+  }
+  return Event::kNone;
+}
+
+void ArpProber::SendArp(const bool announcement) {
+  ArpPacket packet;
+  packet.operation = ArpPacket::kRequest;
+  packet.sender_mac = mac_;
+  packet.sender_ip = announcement ? ip_ : IPAddress(0, 0, 0, 0);
+  memset(packet.target_mac.bytes, 0, sizeof packet.target_mac.bytes);
+  packet.target_ip = ip_;
+  if (!transport_.Send(packet)) {
+    MCU_VLOG(2) << MCU_PSD("ArpProber send failed");
+  }
+}
+
+void ArpProber::SetTimer(const uint32_t now_millis,
+                         const uint32_t delay_millis) {
+  timer_start_millis_ = now_millis;
+  timer_millis_ = delay_millis;
+}
+
+}  // namespace mcunet
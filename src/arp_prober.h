@@ -0,0 +1,144 @@
+#ifndef MCUNET_SRC_ARP_PROBER_H_
+#define MCUNET_SRC_ARP_PROBER_H_
+
+// ArpProber checks, without blocking, that no other host is using an IPv4
+// Link-Local address, following RFC 3927: it sends ARP probes for the address,
+// then (if no other host claims it) announces that it is using the address,
+// defending it once against another host using the same address while
+// announcing, but reporting a conflict if the other host persists. Each call to
+// PerformIO (e.g. from loop()) handles received ARP packets and sends the next
+// probe or announcement when it is due.
+//
+// Once the announcements have been sent, the prober stops, closing the
+// transport. RFC 3927 also suggests watching for conflicts for as long as the
+// address is used, but on the W5500 that would hold one of the 8 hardware
+// sockets for good, so conflicts arising later (e.g. from a host that joins
+// the network) aren't detected.
+//
+// The ARP packets are sent and received via an ArpTransport; on the W5500 this
+// is W5500ArpTransport, which uses a socket in MACRAW mode, and on host tests
+// a fake is used.
+//
+// Author: james.synge@gmail.com
+
+#include <McuCore.h>
+
+#include "ethernet_address.h"
+#include "platform_network.h"
+
+namespace mcunet {
+
+// The fields of an ARP packet (RFC 826) for IPv4 over Ethernet.
+struct ArpPacket {
+  static constexpr uint16_t kRequest = 1;
+  static constexpr uint16_t kReply = 2;
+
+  uint16_t operation;
+  EthernetAddress sender_mac;
+  IPAddress sender_ip;
+  EthernetAddress target_mac;
+  IPAddress target_ip;
+};
+
+// Sends and receives ARP packets.
+class ArpTransport {
+ public:
+  virtual ~ArpTransport() {}
+
+  // Starts receiving ARP packets. Returns false if unable to do so (e.g. the
+  // necessary socket is in use).
+  virtual bool Open() = 0;
+
+  // Stops receiving ARP packets.
+  virtual void Close() = 0;
+
+  // Broadcasts the packet. Returns true if sent.
+  virtual bool Send(const ArpPacket& packet) = 0;
+
+  // If an ARP packet has been received, stores it in packet and returns true.
+  virtual bool Receive(ArpPacket& packet) = 0;
+};
+
+class ArpProber {
+ public:
+  enum class State : uint8_t {
+    kStopped,
+    // Sending probes, checking whether another host is using (or probing for)
+    // the address.
+    kProbing,
+    // Have claimed the address, announcing that to the other hosts.
+    kAnnouncing,
+  };
+
+  // Returned by PerformIO.
+  enum class Event : uint8_t {
+    kNone,
+    // No other host is using the address, which may now be used.
+    kAddressClaimed,
+    // Another host is using the address; the caller should choose another
+    // address. The prober is stopped.
+    kConflict,
+  };
+
+  // Timing constants from RFC 3927, section 9.
+  static constexpr uint32_t kProbeWaitMillis = 1000;
+  static constexpr uint8_t kProbeNum = 3;
+  static constexpr uint32_t kProbeMinMillis = 1000;
+  static constexpr uint32_t kProbeMaxMillis = 2000;
+  static constexpr uint32_t kAnnounceWaitMillis = 2000;
+  static constexpr uint8_t kAnnounceNum = 2;
+  static constexpr uint32_t kAnnounceIntervalMillis = 2000;
+  static constexpr uint8_t kMaxConflicts = 10;
+  static constexpr uint32_t kRateLimitIntervalMillis = 60000;
+
+  explicit ArpProber(ArpTransport& transport);
+
+  // Opens the transport, and schedules the first probe for a random time up to
+  // kProbeWaitMillis after delay_millis from now. Returns false if unable to
+  // open the transport.
+  bool Start(const EthernetAddress& mac, const IPAddress& ip,
+             uint32_t now_millis, uint32_t delay_millis = 0);
+
+  // Stops probing or announcing, and closes the transport.
+  void Stop();
+
+  // Handles received ARP packets, and sends probes and announcements when due.
+  // Should be called frequently (e.g. from loop()) while not stopped.
+  Event PerformIO(uint32_t now_millis);
+
+  State state() const { return state_; }
+
+ private:
+  // Returns true if the packet shows that another host is using the address
+  // or, while probing, is also probing for it.
+  bool IsConflict(const ArpPacket& packet) const;
+
+  // Handles a conflicting packet; returns kConflict if the address must be
+  // given up.
+  Event HandleConflict(uint32_t now_millis);
+
+  // Handles the expiry of timer_millis_.
+  Event HandleTimer(uint32_t now_millis);
+
+  // Sends a probe (sender_ip is 0.0.0.0) or an announcement (sender_ip is
+  // ip_).
+  void SendArp(bool announcement);
+
+  // Starts the timer, to expire delay_millis from now.
+  void SetTimer(uint32_t now_millis, uint32_t delay_millis);
+
+  ArpTransport& transport_;
+  EthernetAddress mac_;
+  IPAddress ip_;
+  State state_;
+  // Number of probes or announcements sent in the current state.
+  uint8_t sent_count_;
+  uint32_t timer_start_millis_;
+  uint32_t timer_millis_;
+  // True once we've defended the address while announcing.
+  bool have_defended_;
+};
+
+}  // namespace mcunet
+
+#endif  // MCUNET_SRC_ARP_PROBER_H_
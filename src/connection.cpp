@@ -4,4 +4,8 @@ namespace mcunet {
 
 Connection::~Connection() {}
 
+bool Connection::StartChunkedCoding() { return false; }
+
+void Connection::EndChunkedCoding() {}
+
 }  // namespace mcunet
@@ -58,7 +58,19 @@ class Connection : public Stream {
 
   // Returns the hardware socket number of this connection. This is exposed
   // primarily to support debugging.
-  virtual uint8_t sock_num() const = 0;
+  virtual SocketNumber sock_num() const = 0;
+
+  // Asks the connection to frame the data written from now on using the
+  // chunked transfer coding of HTTP/1.1, i.e. to write each batch of buffered
+  // data as one chunk, until EndChunkedCoding is called. Returns false if the
+  // connection doesn't support this (the default), in which case the caller
+  // must do the framing.
+  virtual bool StartChunkedCoding();
+
+  // Writes the buffered data as the final chunk, if it isn't empty, and then
+  // the last (empty) chunk, which marks the end of the body. Must only be
+  // called if StartChunkedCoding returned true.
+  virtual void EndChunkedCoding();
 };
 
 }  // namespace mcunet
@@ -0,0 +1,432 @@
+#include "dhcp_client.h"
+
+#include <McuCore.h>
+#include <string.h>
+
+namespace mcunet {
+namespace {
+
+// Values and offsets from RFC 2131 and RFC 2132.
+constexpr uint8_t kBootRequest = 1;
+constexpr uint8_t kBootReply = 2;
+constexpr uint8_t kHardwareTypeEthernet = 1;
+constexpr uint8_t kHardwareAddressLength = 6;
+
+constexpr uint8_t kXidOffset = 4;
+constexpr uint8_t kSecsOffset = 8;
+constexpr uint8_t kFlagsOffset = 10;
+constexpr uint8_t kCiaddrOffset = 12;
+constexpr uint8_t kYiaddrOffset = 16;
+constexpr uint8_t kChaddrOffset = 28;
+// Size of the fields up to the end of chaddr; followed by sname and file,
+// which we don't use, then by the magic cookie and the options.
+constexpr uint8_t kFixedFieldsSize = 44;
+constexpr uint8_t kSnameAndFileSize = 64 + 128;
+constexpr uint8_t kMagicCookie[4] = {99, 130, 83, 99};
+
+constexpr uint8_t kDhcpDiscover = 1;
+constexpr uint8_t kDhcpOffer = 2;
+constexpr uint8_t kDhcpRequest = 3;
+constexpr uint8_t kDhcpAck = 5;
+constexpr uint8_t kDhcpNak = 6;
+
+constexpr uint8_t kOptionPad = 0;
+constexpr uint8_t kOptionSubnetMask = 1;
+constexpr uint8_t kOptionRouter = 3;
+constexpr uint8_t kOptionDnsServer = 6;
+constexpr uint8_t kOptionRequestedIp = 50;
+constexpr uint8_t kOptionLeaseTime = 51;
+constexpr uint8_t kOptionMessageType = 53;
+constexpr uint8_t kOptionServerId = 54;
+constexpr uint8_t kOptionParameterRequestList = 55;
+constexpr uint8_t kOptionRenewalTime = 58;
+constexpr uint8_t kOptionRebindingTime = 59;
+constexpr uint8_t kOptionClientId = 61;
+constexpr uint8_t kOptionEnd = 255;
+
+void PutUint32(uint8_t* p, uint32_t value) {
+  p[0] = value >> 24;
+  p[1] = value >> 16;
+  p[2] = value >> 8;
+  p[3] = value;
+}
+
+uint32_t GetUint32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+uint8_t* PutIpAddress(uint8_t* p, const IPAddress& ip) {
+  for (int i = 0; i < 4; ++i) {
+    *p++ = ip[i];
+  }
+  return p;
+}
+
+IPAddress GetIpAddress(const uint8_t* p) {
+  return IPAddress(p[0], p[1], p[2], p[3]);
+}
+
+bool IsZero(const IPAddress& ip) {
+  return ip[0] == 0 && ip[1] == 0 && ip[2] == 0 && ip[3] == 0;
+}
+
+uint32_t Min(uint32_t a, uint32_t b) { return a < b ? a : b; }
+
+}  // namespace
+
+DhcpClient::DhcpClient(EthernetUDP& udp)
+    : udp_(udp),
+      state_(State::kStopped),
+      xid_(0),
+      transaction_start_millis_(0),
+      last_send_millis_(0),
+      retransmit_millis_(kInitialRetransmitMillis),
+      lease_start_millis_(0),
+      request_attempts_(0),
+      lease_() {}
+
+bool DhcpClient::Start(const EthernetAddress& mac, uint32_t now_millis,
+                       const DhcpLease* const previous_lease) {
+  mac_ = mac;
+  if (!ReopenSocket()) {
+    MCU_VLOG(1) << MCU_PSD("DhcpClient unable to open UDP socket");
+    state_ = State::kStopped;
+    return false;
+  }
+  if (previous_lease == nullptr || IsZero(previous_lease->ip)) {
+    SendDiscover(now_millis);
+    return true;
+  }
+  // INIT-REBOOT: ask to keep using the previously leased address. Any server
+  // may reply, so the server identifier isn't included in the request.
+  StartTransaction(now_millis);
+  offered_ip_ = previous_lease->ip;
+  offer_server_id_ = IPAddress();
+  retransmit_millis_ = kInitialRetransmitMillis;
+  request_attempts_ = 0;
+  state_ = State::kRebooting;
+  MCU_VLOG(2) << MCU_PSD("DhcpClient requesting previous address ")
+              << offered_ip_;
+  SendRequest(now_millis);
+  return true;
+}
+
+void DhcpClient::Stop() {
+  if (state_ != State::kStopped) {
+    udp_.stop();
+    state_ = State::kStopped;
+  }
+}
+
+bool DhcpClient::ReopenSocket() {
+  udp_.stop();
+  return udp_.begin(kClientPort) != 0;
+}
+
+bool DhcpClient::HasLease() const {
+  return state_ == State::kBound || state_ == State::kRenewing ||
+         state_ == State::kRebinding;
+}
+
+DhcpClient::Event DhcpClient::PerformIO(const uint32_t now_millis) {
+  if (state_ == State::kStopped) {
+    return Event::kNone;
+  }
+  // Handle any replies that have arrived, but not so many that loop() is
+  // starved if there is a flood of them.
+  for (uint8_t count = 0; count < 4 && udp_.parsePacket() > 0; ++count) {
+    const auto event = HandleReply(now_millis);
+    udp_.flush();
+    if (event != Event::kNone) {
+      return event;
+    }
+  }
+  return CheckTimers(now_millis);
+}
+
+void DhcpClient::StartTransaction(const uint32_t now_millis) {
+  // The transaction id needn't be random, just unlikely to be the same as that
+  // of other clients, or as our previous one.
+  for (uint8_t i = 2; i < 6; ++i) {
+    xid_ = (xid_ << 8 | xid_ >> 24) ^ mac_.bytes[i];
+  }
+  xid_ = xid_ * 1103515245UL + now_millis + 12345;
+  transaction_start_millis_ = now_millis;
+}
+
+void DhcpClient::SendDiscover(const uint32_t now_millis) {
+  StartTransaction(now_millis);
+  retransmit_millis_ = kInitialRetransmitMillis;
+  request_attempts_ = 0;
+  state_ = State::kSelecting;
+  MCU_VLOG(3) << MCU_PSD("DhcpClient sending DHCPDISCOVER");
+  SendMessage(kDhcpDiscover, now_millis);
+}
+
+void DhcpClient::SendRequest(const uint32_t now_millis) {
+  if (state_ == State::kRequesting || state_ == State::kRebooting) {
+    ++request_attempts_;
+  }
+  MCU_VLOG(3) << MCU_PSD("DhcpClient sending DHCPREQUEST");
+  SendMessage(kDhcpRequest, now_millis);
+}
+
+bool DhcpClient::SendMessage(const uint8_t message_type,
+                             const uint32_t now_millis) {
+  last_send_millis_ = now_millis;
+
+  // When renewing we have an address, and know the server; otherwise we must
+  // broadcast, and ask that replies be broadcast too, as we can't receive
+  // unicast packets until we have an address.
+  const bool have_address =
+      state_ == State::kRenewing || state_ == State::kRebinding;
+  const IPAddress destination = state_ == State::kRenewing
+                                    ? lease_.server_id
+                                    : IPAddress(255, 255, 255, 255);
+  if (!udp_.beginPacket(destination, kServerPort)) {
+    MCU_VLOG(2) << MCU_PSD("DhcpClient beginPacket failed");
+    return false;
+  }
+
+  uint8_t buffer[kFixedFieldsSize];
+  memset(buffer, 0, sizeof buffer);
+  buffer[0] = kBootRequest;
+  buffer[1] = kHardwareTypeEthernet;
+  buffer[2] = kHardwareAddressLength;
+  PutUint32(buffer + kXidOffset, xid_);
+  const uint32_t secs =
+      Min((now_millis - transaction_start_millis_) / 1000, 0xFFFF);
+  buffer[kSecsOffset] = secs >> 8;
+  buffer[kSecsOffset + 1] = secs;
+  if (have_address) {
+    PutIpAddress(buffer + kCiaddrOffset, lease_.ip);
+  } else {
+    buffer[kFlagsOffset] = 0x80;  // The BROADCAST flag.
+  }
+  memcpy(buffer + kChaddrOffset, mac_.bytes, kHardwareAddressLength);
+  udp_.write(buffer, sizeof buffer);
+
+  // sname and file are all zeroes.
+  memset(buffer, 0, sizeof buffer);
+  for (uint8_t remaining = kSnameAndFileSize; remaining > 0;) {
+    const uint8_t size = remaining < sizeof buffer ? remaining : sizeof buffer;
+    udp_.write(buffer, size);
+    remaining -= size;
+  }
+
+  // The options fit in the same buffer.
+  uint8_t* p = buffer;
+  memcpy(p, kMagicCookie, sizeof kMagicCookie);
+  p += sizeof kMagicCookie;
+  *p++ = kOptionMessageType;
+  *p++ = 1;
+  *p++ = message_type;
+  *p++ = kOptionClientId;
+  *p++ = 1 + kHardwareAddressLength;
+  *p++ = kHardwareTypeEthernet;
+  memcpy(p, mac_.bytes, kHardwareAddressLength);
+  p += kHardwareAddressLength;
+  if (message_type == kDhcpRequest &&
+      (state_ == State::kRequesting || state_ == State::kRebooting)) {
+    *p++ = kOptionRequestedIp;
+    *p++ = 4;
+    p = PutIpAddress(p, offered_ip_);
+  }
+  if (message_type == kDhcpRequest && state_ == State::kRequesting) {
+    *p++ = kOptionServerId;
+    *p++ = 4;
+    p = PutIpAddress(p, offer_server_id_);
+  }
+  *p++ = kOptionParameterRequestList;
+  *p++ = 3;
+  *p++ = kOptionSubnetMask;
+  *p++ = kOptionRouter;
+  *p++ = kOptionDnsServer;
+  *p++ = kOptionEnd;
+  udp_.write(buffer, p - buffer);
+
+  if (!udp_.endPacket()) {
+    MCU_VLOG(2) << MCU_PSD("DhcpClient endPacket failed");
+    return false;
+  }
+  return true;
+}
+
+DhcpClient::Event DhcpClient::HandleReply(const uint32_t now_millis) {
+  uint8_t buffer[kFixedFieldsSize];
+  if (udp_.read(buffer, sizeof buffer) != sizeof buffer ||
+      buffer[0] != kBootReply || GetUint32(buffer + kXidOffset) != xid_ ||
+      memcmp(buffer + kChaddrOffset, mac_.bytes, kHardwareAddressLength) !=
+          0) {
+    // Not a reply to our current transaction.
+    return Event::kNone;
+  }
+  const IPAddress yiaddr = GetIpAddress(buffer + kYiaddrOffset);
+
+  for (uint8_t remaining = kSnameAndFileSize; remaining > 0;) {
+    const uint8_t size = remaining < sizeof buffer ? remaining : sizeof buffer;
+    if (udp_.read(buffer, size) != size) {
+      return Event::kNone;
+    }
+    remaining -= size;
+  }
+  if (udp_.read(buffer, sizeof kMagicCookie) != sizeof kMagicCookie ||
+      memcmp(buffer, kMagicCookie, sizeof kMagicCookie) != 0) {
+    return Event::kNone;
+  }
+
+  uint8_t message_type = 0;
+  IPAddress server_id, subnet_mask, gateway, dns_server;
+  uint32_t lease_seconds = 0, renew_seconds = 0, rebind_seconds = 0;
+  while (true) {
+    const int code = udp_.read();
+    if (code < 0 || code == kOptionEnd) {
+      break;
+    }
+    if (code == kOptionPad) {
+      continue;
+    }
+    const int len = udp_.read();
+    if (len < 0) {
+      return Event::kNone;
+    }
+    // The values we're interested in are at most 4 bytes long; for the lists
+    // of addresses (e.g. routers), we use just the first.
+    uint8_t value[4] = {0, 0, 0, 0};
+    for (int ndx = 0; ndx < len; ++ndx) {
+      const int c = udp_.read();
+      if (c < 0) {
+        return Event::kNone;
+      }
+      if (ndx < 4) {
+        value[ndx] = c;
+      }
+    }
+    if (code == kOptionMessageType && len == 1) {
+      message_type = value[0];
+    } else if (len < 4) {
+      continue;
+    } else if (code == kOptionServerId) {
+      server_id = GetIpAddress(value);
+    } else if (code == kOptionSubnetMask) {
+      subnet_mask = GetIpAddress(value);
+    } else if (code == kOptionRouter) {
+      gateway = GetIpAddress(value);
+    } else if (code == kOptionDnsServer) {
+      dns_server = GetIpAddress(value);
+    } else if (code == kOptionLeaseTime) {
+      lease_seconds = GetUint32(value);
+    } else if (code == kOptionRenewalTime) {
+      renew_seconds = GetUint32(value);
+    } else if (code == kOptionRebindingTime) {
+      rebind_seconds = GetUint32(value);
+    }
+  }
+
+  if (state_ == State::kSelecting) {
+    if (message_type == kDhcpOffer && !IsZero(server_id)) {
+      MCU_VLOG(2) << MCU_PSD("DhcpClient offered ") << yiaddr
+                  << MCU_PSD(" by ") << server_id;
+      offered_ip_ = yiaddr;
+      offer_server_id_ = server_id;
+      state_ = State::kRequesting;
+      request_attempts_ = 0;
+      retransmit_millis_ = kInitialRetransmitMillis;
+      SendRequest(now_millis);
+    }
+    return Event::kNone;
+  } else if (state_ == State::kBound || state_ == State::kStopped) {
+    return Event::kNone;
+  }
+
+  if (state_ == State::kRequesting && !IsZero(server_id) &&
+      !(server_id == offer_server_id_)) {
+    // Not from the server whose offer we selected (e.g. another server which
+    // saw our broadcast REQUEST).
+    MCU_VLOG(2) << MCU_PSD("DhcpClient ignoring reply from ") << server_id;
+    return Event::kNone;
+  }
+  if (message_type == kDhcpNak) {
+    MCU_VLOG(1) << MCU_PSD("DhcpClient received DHCPNAK");
+    const bool had_lease = HasLease();
+    SendDiscover(now_millis);
+    return had_lease ? Event::kLeaseLost : Event::kNone;
+  } else if (message_type != kDhcpAck) {
+    return Event::kNone;
+  } else if (IsZero(yiaddr)) {
+    MCU_VLOG(1) << MCU_PSD("DhcpClient received DHCPACK without an address");
+    return Event::kNone;
+  }
+
+  const bool renewed = HasLease() && lease_.ip == yiaddr;
+  if (IsZero(server_id)) {
+    server_id = HasLease() ? lease_.server_id : offer_server_id_;
+  }
+  if (lease_seconds == 0 || lease_seconds > kMaxLeaseSeconds) {
+    lease_seconds = kMaxLeaseSeconds;
+  }
+  if (rebind_seconds == 0 || rebind_seconds > lease_seconds) {
+    rebind_seconds = lease_seconds - lease_seconds / 8;
+  }
+  if (renew_seconds == 0 || renew_seconds > rebind_seconds) {
+    renew_seconds = Min(lease_seconds / 2, rebind_seconds);
+  }
+  lease_.ip = yiaddr;
+  lease_.subnet_mask = subnet_mask;
+  lease_.gateway = gateway;
+  lease_.dns_server = dns_server;
+  lease_.server_id = server_id;
+  lease_.lease_seconds = lease_seconds;
+  lease_.renew_seconds = renew_seconds;
+  lease_.rebind_seconds = rebind_seconds;
+  // The lease started (at the latest) when we sent the request.
+  lease_start_millis_ = last_send_millis_;
+  state_ = State::kBound;
+  MCU_VLOG(2) << MCU_PSD("DhcpClient leased ") << yiaddr
+              << MCU_NAME_VAL(lease_seconds);
+  return renewed ? Event::kLeaseRenewed : Event::kLeaseAcquired;
+}
+
+DhcpClient::Event DhcpClient::CheckTimers(const uint32_t now_millis) {
+  if (state_ == State::kSelecting || state_ == State::kRequesting ||
+      state_ == State::kRebooting) {
+    if (now_millis - last_send_millis_ < retransmit_millis_) {
+      return Event::kNone;
+    }
+    retransmit_millis_ = Min(retransmit_millis_ * 2, kMaxRetransmitMillis);
+    if (state_ == State::kSelecting) {
+      SendMessage(kDhcpDiscover, now_millis);
+    } else if (request_attempts_ >= kMaxRequestAttempts) {
+      SendDiscover(now_millis);
+    } else {
+      SendRequest(now_millis);
+    }
+    return Event::kNone;
+  } else if (!HasLease()) {
+    return Event::kNone;
+  }
+
+  const uint32_t elapsed_millis = now_millis - lease_start_millis_;
+  if (elapsed_millis >= lease_.lease_seconds * 1000) {
+    MCU_VLOG(1) << MCU_PSD("DhcpClient lease expired");
+    SendDiscover(now_millis);
+    return Event::kLeaseLost;
+  } else if (state_ != State::kRebinding &&
+             elapsed_millis >= lease_.rebind_seconds * 1000) {
+    state_ = State::kRebinding;
+    SendRequest(now_millis);
+  } else if (state_ == State::kBound &&
+             elapsed_millis >= lease_.renew_seconds * 1000) {
+    state_ = State::kRenewing;
+    StartTransaction(now_millis);
+    SendRequest(now_millis);
+  } else if (state_ != State::kBound &&
+             now_millis - last_send_millis_ >= kRenewRetransmitMillis) {
+    SendRequest(now_millis);
+  }
+  return Event::kNone;
+}
+
+}  // namespace mcunet
@@ -0,0 +1,145 @@
+#ifndef MCUNET_SRC_DHCP_CLIENT_H_
+#define MCUNET_SRC_DHCP_CLIENT_H_
+
+// DhcpClient leases an IPv4 address using DHCP (RFC 2131) without blocking.
+// Start sends a DHCPDISCOVER and returns immediately; each call to PerformIO
+// (e.g. from loop()) handles any replies that have arrived, retransmits if a
+// reply is overdue, and renews or rebinds the lease when it is time to do so.
+// This is unlike Ethernet5500's DhcpClass, whose beginWithDHCP blocks until a
+// lease is obtained or its (long) timeout expires, delaying startup when there
+// is no DHCP server.
+//
+// The UDP socket is provided by the caller; on the host, tests provide a fake
+// DHCP server in its place (see extras/test_tools/fake_dhcp_server.h).
+//
+// If the address of a previous lease is known (e.g. saved in EEPROM before a
+// reset), Start can instead broadcast a DHCPREQUEST for that address (the
+// INIT-REBOOT state of RFC 2131), saving the DHCPDISCOVER/DHCPOFFER round trip;
+// if the server refuses, or doesn't reply, the client falls back to discovery.
+//
+// Only what is needed to configure the W5500 is supported: a single
+// transaction at a time, the subnet mask, router and DNS server options, and
+// the lease timers. Messages are written and read in small pieces so that
+// there is no need for a packet sized buffer. Retransmissions (while selecting
+// or requesting) start after kInitialRetransmitMillis and double up to
+// kMaxRetransmitMillis; they aren't randomized.
+//
+// Author: james.synge@gmail.com
+
+#include <McuCore.h>
+
+#include "dhcp_lease.h"
+#include "ethernet_address.h"
+#include "platform_network.h"
+
+namespace mcunet {
+
+class DhcpClient {
+ public:
+  enum class State : uint8_t {
+    kStopped,
+    // Sent a DHCPDISCOVER, waiting for a DHCPOFFER.
+    kSelecting,
+    // Sent a DHCPREQUEST for an offered address, waiting for a DHCPACK.
+    kRequesting,
+    // Sent a DHCPREQUEST for a previously leased address, waiting for a
+    // DHCPACK.
+    kRebooting,
+    // Have a lease, which isn't yet due for renewal.
+    kBound,
+    // Past T1, sending DHCPREQUESTs to the server which granted the lease.
+    kRenewing,
+    // Past T2, broadcasting DHCPREQUESTs to any server.
+    kRebinding,
+  };
+
+  // Returned by PerformIO.
+  enum class Event : uint8_t {
+    kNone,
+    // A lease has been granted, for an address not previously leased.
+    kLeaseAcquired,
+    // The lease has been extended.
+    kLeaseRenewed,
+    // The lease has expired or been refused by the server; selecting again.
+    kLeaseLost,
+  };
+
+  static constexpr uint16_t kClientPort = 68;
+  static constexpr uint16_t kServerPort = 67;
+  static constexpr uint32_t kInitialRetransmitMillis = 1000;
+  static constexpr uint32_t kMaxRetransmitMillis = 32000;
+  static constexpr uint32_t kRenewRetransmitMillis = 60000;
+
+  // Number of DHCPREQUESTs sent for an offer (or a previously leased address)
+  // before starting over.
+  static constexpr uint8_t kMaxRequestAttempts = 4;
+
+  // Lease times are limited to this so that the timers can be computed with
+  // 32-bit millisecond arithmetic.
+  static constexpr uint32_t kMaxLeaseSeconds = 0x7FFFFFFFUL / 1000;
+
+  explicit DhcpClient(EthernetUDP& udp);
+
+  // Opens the UDP socket and sends a DHCPDISCOVER or, if previous_lease is
+  // provided, a DHCPREQUEST for previous_lease->ip. Returns false if unable to
+  // open the socket.
+  bool Start(const EthernetAddress& mac, uint32_t now_millis,
+             const DhcpLease* previous_lease = nullptr);
+
+  // Abandons the lease, if any (without releasing it), and closes the socket.
+  void Stop();
+
+  // Closes and reopens the UDP socket, without changing the state. Needed if
+  // the socket has been closed by reinitializing the W5500 (e.g. by
+  // Ethernet.begin).
+  bool ReopenSocket();
+
+  // Handles replies, retransmissions and the lease timers. Should be called
+  // frequently (e.g. from loop()) while not stopped.
+  Event PerformIO(uint32_t now_millis);
+
+  State state() const { return state_; }
+  bool HasLease() const;
+
+  // The current (or most recent) lease; valid only if HasLease() is true.
+  const DhcpLease& lease() const { return lease_; }
+
+ private:
+  // Chooses a new transaction id.
+  void StartTransaction(uint32_t now_millis);
+
+  // Starts a new transaction by broadcasting a DHCPDISCOVER.
+  void SendDiscover(uint32_t now_millis);
+
+  // Sends a DHCPREQUEST appropriate to the state.
+  void SendRequest(uint32_t now_millis);
+
+  // Writes and sends a message of the specified type. Returns true if sent.
+  bool SendMessage(uint8_t message_type, uint32_t now_millis);
+
+  // Reads the current packet, returning the event it causes.
+  Event HandleReply(uint32_t now_millis);
+
+  // Handles the expiry of the retransmission and lease timers.
+  Event CheckTimers(uint32_t now_millis);
+
+  EthernetUDP& udp_;
+  EthernetAddress mac_;
+  State state_;
+  uint32_t xid_;
+  uint32_t transaction_start_millis_;
+  uint32_t last_send_millis_;
+  uint32_t retransmit_millis_;
+  uint32_t lease_start_millis_;
+  uint8_t request_attempts_;
+
+  // The offer (or previously leased address) being requested.
+  IPAddress offered_ip_;
+  IPAddress offer_server_id_;
+
+  DhcpLease lease_;
+};
+
+}  // namespace mcunet
+
+#endif  // MCUNET_SRC_DHCP_CLIENT_H_
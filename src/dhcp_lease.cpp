@@ -0,0 +1,73 @@
+#include "dhcp_lease.h"
+
+#include <McuCore.h>
+
+#include "eeprom_tags.h"
+
+namespace mcunet {
+namespace {
+
+// Size of the saved fields: ip, server_id and lease_seconds.
+constexpr size_t kSavedSize = 4 + 4 + 4;
+
+// Helper for calls to WriteEntryToCursor.
+mcucore::Status WriteDhcpLeaseToRegion(mcucore::EepromRegion& region,
+                                       const DhcpLease& lease) {
+  return lease.WriteToRegion(region);
+}
+
+bool ReadIp(mcucore::EepromRegionReader& region, IPAddress& ip) {
+  uint8_t bytes[4];
+  if (!region.ReadBytes(bytes)) {
+    return false;
+  }
+  ip = IPAddress(bytes[0], bytes[1], bytes[2], bytes[3]);
+  return true;
+}
+
+bool WriteIp(mcucore::EepromRegion& region, const IPAddress& ip) {
+  return region.Write(ip[0]) && region.Write(ip[1]) && region.Write(ip[2]) &&
+         region.Write(ip[3]);
+}
+
+}  // namespace
+
+mcucore::Status DhcpLease::ReadEepromEntry(mcucore::EepromTlv& eeprom_tlv) {
+  MCU_VLOG(4) << MCU_PSD("DhcpLease::ReadEepromEntry");
+  MCU_ASSIGN_OR_RETURN(auto region, eeprom_tlv.FindEntry(GetDhcpLeaseTag()));
+  return ReadFromRegion(region);
+}
+
+mcucore::Status DhcpLease::WriteEepromEntry(
+    mcucore::EepromTlv& eeprom_tlv) const {
+  MCU_VLOG(4) << MCU_PSD("DhcpLease::WriteEepromEntry");
+  return eeprom_tlv.WriteEntryToCursor(GetDhcpLeaseTag(), kSavedSize,
+                                       WriteDhcpLeaseToRegion, *this);
+}
+
+mcucore::Status DhcpLease::ReadFromRegion(mcucore::EepromRegionReader& region) {
+  uint8_t seconds[4];
+  if (!ReadIp(region, ip) || !ReadIp(region, server_id) ||
+      !region.ReadBytes(seconds)) {
+    return mcucore::UnknownError(MCU_PSV("Unable to read lease from EEPROM"));
+  }
+  lease_seconds = (static_cast<uint32_t>(seconds[0]) << 24) |
+                  (static_cast<uint32_t>(seconds[1]) << 16) |
+                  (static_cast<uint32_t>(seconds[2]) << 8) | seconds[3];
+  return mcucore::OkStatus();
+}
+
+mcucore::Status DhcpLease::WriteToRegion(mcucore::EepromRegion& region) const {
+  bool result = WriteIp(region, ip) && WriteIp(region, server_id);
+  result = result && region.Write(static_cast<uint8_t>(lease_seconds >> 24));
+  result = result && region.Write(static_cast<uint8_t>(lease_seconds >> 16));
+  result = result && region.Write(static_cast<uint8_t>(lease_seconds >> 8));
+  result = result && region.Write(static_cast<uint8_t>(lease_seconds));
+  if (result) {
+    return mcucore::OkStatus();
+  } else {
+    return mcucore::UnknownError(MCU_PSV("Unable to write lease to EEPROM"));
+  }
+}
+
+}  // namespace mcunet
@@ -0,0 +1,51 @@
+#ifndef MCUNET_SRC_DHCP_LEASE_H_
+#define MCUNET_SRC_DHCP_LEASE_H_
+
+// DhcpLease holds the configuration granted by a DHCP server. The address, the
+// server which granted it, and the lease duration can be saved in EEPROM so
+// that after a reset DhcpClient can ask to reuse that address (the INIT-REBOOT
+// state of RFC 2131), rather than starting over with a DHCPDISCOVER. There is
+// no clock that survives a reset, so when the saved lease expires is unknown;
+// the server decides (with a DHCPACK or DHCPNAK) whether it is still valid.
+//
+// Author: james.synge@gmail.com
+
+#include <McuCore.h>
+
+#include "platform_network.h"
+
+namespace mcunet {
+
+struct DhcpLease {
+  // Restore the saved lease from an entry managed using EepromTlv. Returns OK
+  // if a valid entry is found, else an error. Only ip, server_id and
+  // lease_seconds are restored.
+  mcucore::Status ReadEepromEntry(mcucore::EepromTlv& eeprom_tlv);
+
+  // Save ip, server_id and lease_seconds in an EepromTlv entry. Returns OK if
+  // successful, else an error.
+  mcucore::Status WriteEepromEntry(mcucore::EepromTlv& eeprom_tlv) const;
+
+  // Read the saved fields from the region, starting at the cursor. This is
+  // exposed for testing.
+  mcucore::Status ReadFromRegion(mcucore::EepromRegionReader& region);
+
+  // Write the saved fields to the region, starting at the cursor. This is
+  // exposed for testing.
+  mcucore::Status WriteToRegion(mcucore::EepromRegion& region) const;
+
+  IPAddress ip;
+  IPAddress subnet_mask;
+  IPAddress gateway;
+  IPAddress dns_server;
+  // The DHCP server which granted the lease.
+  IPAddress server_id;
+  // Durations from when the lease was granted, in seconds.
+  uint32_t lease_seconds;
+  uint32_t renew_seconds;   // T1
+  uint32_t rebind_seconds;  // T2
+};
+
+}  // namespace mcunet
+
+#endif  // MCUNET_SRC_DHCP_LEASE_H_
@@ -14,4 +14,10 @@ mcucore::EepromTag GetAddressesTag() {
   return {.domain = MCU_DOMAIN(McuNetDomain), .id = 1};
 }
 
+mcucore::EepromTag GetDhcpLeaseTag() {
+  // REMEMBER: Don't change the values here, or the tagged EEPROM entries will
+  // be orphaned.
+  return {.domain = MCU_DOMAIN(McuNetDomain), .id = 2};
+}
+
 }  // namespace mcunet
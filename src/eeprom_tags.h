@@ -13,6 +13,9 @@ namespace mcunet {
 // Tag for use by mcunet::Addresses.
 mcucore::EepromTag GetAddressesTag();
 
+// Tag for use by mcunet::DhcpLease.
+mcucore::EepromTag GetDhcpLeaseTag();
+
 }  // namespace mcunet
 
 #endif  // MCUNET_SRC_EEPROM_TAGS_H_
@@ -0,0 +1,273 @@
+#include "framed_message.h"
+
+#include <McuCore.h>
+
+namespace mcunet {
+namespace {
+
+// Amount of stack space to allocate for reading from the connection; as for
+// HttpServer, this needs to fit alongside the write buffer of
+// TcpServerConnection. Messages that fit in it (along with their framing) are
+// usually passed to the handler without being copied.
+constexpr uint8_t kReadBufferSize = 64;
+
+constexpr uint8_t kCrcFlag = 0x80;
+constexpr uint8_t kVarintMoreBit = 0x80;
+constexpr uint8_t kVarintValueBits = 0x7F;
+constexpr uint16_t kCrcInitialValue = 0xFFFF;
+constexpr uint8_t kCrcSize = 2;
+
+// The shift of the last 7 bit group of the (at most) 4 byte length.
+constexpr uint8_t kMaxLengthShift = 21;
+
+}  // namespace
+
+uint16_t UpdateFramedMessageCrc(uint16_t crc, const uint8_t* data,
+                                size_t size) {
+  // Polynomial 0x1021, processed a byte at a time with shifts and XORs rather
+  // than with a lookup table, which would take 512 bytes of flash.
+  for (size_t ndx = 0; ndx < size; ++ndx) {
+    crc = static_cast<uint16_t>((crc >> 8) | (crc << 8));
+    crc ^= data[ndx];
+    crc ^= (crc & 0xFF) >> 4;
+    crc ^= static_cast<uint16_t>(crc << 12);
+    crc ^= static_cast<uint16_t>((crc & 0xFF) << 5);
+  }
+  return crc;
+}
+
+uint8_t EncodeFramedMessageHeader(
+    const uint8_t type, const uint32_t payload_size, const bool with_crc,
+    uint8_t (&header)[kMaxFramedMessageHeaderSize]) {
+  MCU_DCHECK_LE(type, kMaxFramedMessageType);
+  uint32_t body_size = payload_size + (with_crc ? 1 + kCrcSize : 1);
+  MCU_DCHECK_LT(body_size, 1UL << (kMaxLengthShift + 7));
+  uint8_t size = 0;
+  while (body_size > kVarintValueBits) {
+    header[size++] = kVarintMoreBit | (body_size & kVarintValueBits);
+    body_size >>= 7;
+  }
+  header[size++] = static_cast<uint8_t>(body_size);
+  header[size++] = type | (with_crc ? kCrcFlag : 0);
+  return size;
+}
+
+bool WriteFramedMessage(Print& out, const uint8_t type, const uint8_t* payload,
+                        const size_t payload_size, const bool with_crc) {
+  uint8_t header[kMaxFramedMessageHeaderSize];
+  const uint8_t header_size =
+      EncodeFramedMessageHeader(type, payload_size, with_crc, header);
+  bool ok = out.write(header, header_size) == header_size;
+  if (payload_size > 0) {
+    ok = ok && out.write(payload, payload_size) == payload_size;
+  }
+  if (with_crc) {
+    const uint16_t crc = UpdateFramedMessageCrc(
+        UpdateFramedMessageCrc(kCrcInitialValue, header, header_size), payload,
+        payload_size);
+    const uint8_t crc_bytes[kCrcSize] = {static_cast<uint8_t>(crc >> 8),
+                                         static_cast<uint8_t>(crc)};
+    ok = ok && out.write(crc_bytes, kCrcSize) == kCrcSize;
+  }
+  return ok;
+}
+
+FramedMessageReader::FramedMessageReader(FramedMessageHandler& handler)
+    : handler_(handler) {
+  Reset();
+}
+
+void FramedMessageReader::Reset() {
+  StartFrame();
+  payload_size_ = 0;
+  type_ = 0;
+  has_crc_ = false;
+  error_ = FramedMessageError::kNone;
+}
+
+void FramedMessageReader::StartFrame() {
+  body_size_ = 0;
+  buffered_ = 0;
+  crc_ = kCrcInitialValue;
+  received_crc_ = 0;
+  received_crc_bytes_ = 0;
+  length_shift_ = 0;
+  state_ = State::kLength;
+}
+
+bool FramedMessageReader::ReadFrom(Connection& connection) {
+  uint8_t buffer[kReadBufferSize];
+  while (true) {
+    const int size = connection.read(buffer, sizeof buffer);
+    if (size <= 0) {
+      // No more data available right now, or the peer has half-closed the
+      // connection, in which case ServerSocket will close it.
+      return state_ != State::kError;
+    }
+    if (!ProcessInput(buffer, static_cast<size_t>(size))) {
+      return false;
+    }
+  }
+}
+
+bool FramedMessageReader::ProcessInput(const uint8_t* data, size_t size) {
+  while (size > 0 && state_ != State::kError) {
+    size_t consumed;
+    if (state_ == State::kLength || state_ == State::kTag) {
+      DecodeHeaderByte(*data);
+      consumed = 1;
+    } else {
+      consumed = DecodePayload(data, size);
+    }
+    data += consumed;
+    size -= consumed;
+  }
+  return state_ != State::kError;
+}
+
+bool FramedMessageReader::DecodeHeaderByte(const uint8_t b) {
+  crc_ = UpdateFramedMessageCrc(crc_, &b, 1);
+  if (state_ == State::kLength) {
+    body_size_ |= static_cast<uint32_t>(b & kVarintValueBits) << length_shift_;
+    if (b & kVarintMoreBit) {
+      if (length_shift_ == kMaxLengthShift) {
+        return Error(FramedMessageError::kBadLength);
+      }
+      length_shift_ += 7;
+    } else if (body_size_ == 0) {
+      // There must at least be a tag.
+      return Error(FramedMessageError::kBadLength);
+    } else {
+      state_ = State::kTag;
+    }
+    return true;
+  }
+
+  MCU_DCHECK(state_ == State::kTag);
+  type_ = b & kMaxFramedMessageType;
+  has_crc_ = (b & kCrcFlag) != 0;
+  const uint8_t framing_size = has_crc_ ? 1 + kCrcSize : 1;
+  if (body_size_ < framing_size) {
+    return Error(FramedMessageError::kBadLength);
+  } else if (body_size_ - framing_size > kMaxPayloadSize) {
+    return Error(FramedMessageError::kTooLarge);
+  }
+  payload_size_ = static_cast<uint16_t>(body_size_ - framing_size);
+  MCU_VLOG(5) << MCU_PSD("FramedMessageReader type ") << type_
+              << MCU_PSD(", payload_size ") << payload_size_
+              << MCU_PSD(", has_crc ") << has_crc_;
+  if (payload_size_ > 0) {
+    state_ = State::kPayload;
+  } else if (has_crc_) {
+    state_ = State::kCrc;
+  } else {
+    return EndFrame(buffer_, 0);
+  }
+  return true;
+}
+
+size_t FramedMessageReader::DecodePayload(const uint8_t* data,
+                                          const size_t size) {
+  const uint8_t crc_size = has_crc_ ? kCrcSize : 0;
+  if (state_ == State::kPayload && buffered_ == 0 &&
+      size >= payload_size_ + crc_size) {
+    // The rest of the frame is in data, so the handler can be passed the
+    // payload in place.
+    uint16_t received_crc = 0;
+    if (has_crc_) {
+      received_crc = (static_cast<uint16_t>(data[payload_size_]) << 8) |
+                     data[payload_size_ + 1];
+    }
+    EndFrame(data, received_crc);
+    return payload_size_ + crc_size;
+  }
+
+  size_t consumed = 0;
+  if (state_ == State::kPayload) {
+    consumed = payload_size_ - buffered_;
+    if (consumed > size) {
+      consumed = size;
+    }
+    memcpy(buffer_ + buffered_, data, consumed);
+    buffered_ += consumed;
+    if (buffered_ < payload_size_) {
+      return consumed;
+    } else if (!has_crc_) {
+      EndFrame(buffer_, 0);
+      return consumed;
+    }
+    state_ = State::kCrc;
+  }
+  while (consumed < size && state_ == State::kCrc) {
+    received_crc_ =
+        static_cast<uint16_t>(received_crc_ << 8) | data[consumed++];
+    if (++received_crc_bytes_ == kCrcSize) {
+      EndFrame(buffer_, received_crc_);
+    }
+  }
+  return consumed;
+}
+
+bool FramedMessageReader::EndFrame(const uint8_t* payload,
+                                   const uint16_t received_crc) {
+  if (has_crc_ && UpdateFramedMessageCrc(crc_, payload, payload_size_) !=
+                      received_crc) {
+    return Error(FramedMessageError::kBadCrc);
+  }
+  handler_.OnFramedMessage(type_, payload, payload_size_);
+  StartFrame();
+  return true;
+}
+
+bool FramedMessageReader::Error(const FramedMessageError error) {
+  MCU_VLOG(2) << MCU_PSD("FramedMessageReader::Error ")
+              << static_cast<uint8_t>(error);
+  error_ = error;
+  state_ = State::kError;
+  return false;
+}
+
+FramedMessageBatch::FramedMessageBatch() : size_(0) {}
+
+bool FramedMessageBatch::Queue(const uint8_t type, const uint8_t* payload,
+                               const size_t payload_size, const bool with_crc) {
+  if (payload_size > kCapacity) {
+    return false;
+  }
+  uint8_t header[kMaxFramedMessageHeaderSize];
+  const uint8_t header_size =
+      EncodeFramedMessageHeader(type, payload_size, with_crc, header);
+  const size_t frame_size =
+      header_size + payload_size + (with_crc ? kCrcSize : 0);
+  if (frame_size > static_cast<size_t>(kCapacity - size_)) {
+    return false;
+  }
+  uint8_t* const frame = buffer_ + size_;
+  memcpy(frame, header, header_size);
+  if (payload_size > 0) {
+    memcpy(frame + header_size, payload, payload_size);
+  }
+  if (with_crc) {
+    const uint16_t crc = UpdateFramedMessageCrc(kCrcInitialValue, frame,
+                                                header_size + payload_size);
+    frame[frame_size - 2] = static_cast<uint8_t>(crc >> 8);
+    frame[frame_size - 1] = static_cast<uint8_t>(crc);
+  }
+  size_ += frame_size;
+  return true;
+}
+
+bool FramedMessageBatch::Send(Connection& connection) {
+  if (size_ == 0) {
+    return true;
+  }
+  const size_t wrote = connection.write(buffer_, size_);
+  connection.flush();
+  MCU_VLOG(5) << MCU_PSD("FramedMessageBatch::Send ") << size_
+              << MCU_PSD(", wrote ") << wrote;
+  const bool ok = wrote == size_;
+  size_ = 0;
+  return ok;
+}
+
+}  // namespace mcunet
@@ -0,0 +1,193 @@
+#ifndef MCUNET_SRC_FRAMED_MESSAGE_H_
+#define MCUNET_SRC_FRAMED_MESSAGE_H_
+
+// Support for exchanging small binary messages (e.g. RPCs between a device and
+// a gateway) over a Connection, with far less overhead than a text protocol
+// such as HTTP. Each message is sent as a frame:
+//
+//   length   A varint (7 bits per byte, least significant group first, high
+//            bit set on all but the last byte): the number of bytes that
+//            follow, i.e. 1 + payload size (+ 2 if there is a CRC).
+//   tag      The message type in the low 7 bits; the high bit is set if the
+//            frame ends with a CRC.
+//   payload  The message itself.
+//   crc      Optional: the CRC-16/CCITT-FALSE of all of the preceding bytes of
+//            the frame, most significant byte first.
+//
+// So a short message (up to 126 bytes, or 124 with a CRC) has just 2 bytes of
+// framing, or 4 with a CRC.
+// The CRC is useful where the bytes pass through something less reliable than
+// TCP, such as a serial link to the gateway.
+//
+// FramedMessageReader parses frames incrementally from whatever pieces the
+// reads return, and passes each complete message to a FramedMessageHandler.
+// A message that arrives whole in one read is passed from the read buffer,
+// without being copied; only one that is split across reads is reassembled.
+// FramedMessageBatch accumulates encoded frames (e.g. the responses to several
+// requests, or messages generated between calls to PerformIO), and sends them
+// with a single write and flush.
+//
+// Example, in a ServerSocketListener:
+//
+//   void OnCanRead(Connection& connection) override {
+//     // The handler may queue responses in batch_.
+//     if (!reader_.ReadFrom(connection)) {
+//       connection.close();
+//       return;
+//     }
+//     batch_.Send(connection);
+//   }
+//
+// Author: james.synge@gmail.com
+
+#include <McuCore.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "connection.h"
+#include "mcunet_config.h"
+
+namespace mcunet {
+
+// The largest message type; the high bit of the tag is the CRC flag.
+constexpr uint8_t kMaxFramedMessageType = 0x7F;
+
+// The most bytes of framing before the payload, i.e. a 4 byte length (which
+// allows for bodies of up to 2^28 - 1 bytes) and the tag.
+constexpr uint8_t kMaxFramedMessageHeaderSize = 5;
+
+enum class FramedMessageError : uint8_t {
+  kNone,
+  // The length is zero (i.e. there is no tag), too small for the CRC, or too
+  // long a varint.
+  kBadLength,
+  // The payload is larger than FramedMessageReader::kMaxPayloadSize.
+  kTooLarge,
+  // The CRC doesn't match the frame.
+  kBadCrc,
+};
+
+// Returns the CRC-16/CCITT-FALSE of data, continuing from crc, which should
+// initially be 0xFFFF.
+uint16_t UpdateFramedMessageCrc(uint16_t crc, const uint8_t* data,
+                                size_t size);
+
+// Writes the length and tag of a frame into header, computing the length from
+// payload_size and with_crc. Returns the number of bytes written.
+uint8_t EncodeFramedMessageHeader(
+    uint8_t type, uint32_t payload_size, bool with_crc,
+    uint8_t (&header)[kMaxFramedMessageHeaderSize]);
+
+// Writes a complete frame. Returns false if it couldn't all be written.
+bool WriteFramedMessage(Print& out, uint8_t type, const uint8_t* payload,
+                        size_t payload_size, bool with_crc);
+
+class FramedMessageHandler {
+ public:
+#if !MCU_EMBEDDED_TARGET
+  virtual ~FramedMessageHandler() = default;
+#endif
+
+  // Called with each complete message received (whose CRC, if it has one, is
+  // correct). payload is only valid for the duration of the call.
+  virtual void OnFramedMessage(uint8_t type, const uint8_t* payload,
+                               size_t payload_size) = 0;
+};
+
+class FramedMessageReader {
+ public:
+  static constexpr uint16_t kMaxPayloadSize =
+      MCUNET_FRAMED_MESSAGE_MAX_PAYLOAD_SIZE;
+
+  explicit FramedMessageReader(FramedMessageHandler& handler);
+
+  // Prepares for a new stream of frames, e.g. on a new connection.
+  void Reset();
+
+  // Reads from the connection until there is no more data available, passing
+  // each message completed to the handler. Returns false if the input is
+  // malformed; the reader can't find the next frame after an error, so the
+  // caller should then close the connection.
+  bool ReadFrom(Connection& connection);
+
+  // As ReadFrom, for data that the caller has already read.
+  bool ProcessInput(const uint8_t* data, size_t size);
+
+  FramedMessageError error() const { return error_; }
+
+ private:
+  enum class State : uint8_t {
+    kLength,
+    kTag,
+    kPayload,
+    kCrc,
+    kError,
+  };
+
+  // Decodes one byte of the length or tag. Returns false on error.
+  bool DecodeHeaderByte(uint8_t b);
+
+  // Consumes as much of the payload and CRC as is in data, returning the
+  // number of bytes consumed, and passes the message to the handler if it is
+  // complete. Sets state_ to kError on error.
+  size_t DecodePayload(const uint8_t* data, size_t size);
+
+  // Prepares for the next frame.
+  void StartFrame();
+
+  // Verifies the CRC (if any) of the complete message, then passes it to the
+  // handler. Returns false on error.
+  bool EndFrame(const uint8_t* payload, uint16_t received_crc);
+
+  bool Error(FramedMessageError error);
+
+  FramedMessageHandler& handler_;
+  uint32_t body_size_;
+  uint16_t payload_size_;
+  // Number of bytes of the payload in buffer_.
+  uint16_t buffered_;
+  // CRC of the frame so far.
+  uint16_t crc_;
+  // CRC at the end of a frame that is split across reads, and the number of
+  // its bytes received so far.
+  uint16_t received_crc_;
+  uint8_t received_crc_bytes_;
+  uint8_t length_shift_;
+  uint8_t type_;
+  bool has_crc_;
+  State state_;
+  FramedMessageError error_;
+  // Holds the payload of a message that is split across reads.
+  uint8_t buffer_[kMaxPayloadSize];
+};
+
+class FramedMessageBatch {
+ public:
+  static constexpr uint16_t kCapacity = MCUNET_FRAMED_MESSAGE_BATCH_SIZE;
+
+  FramedMessageBatch();
+
+  // Appends a frame carrying the message to the batch. Returns false, without
+  // appending anything, if there isn't room for the whole frame.
+  bool Queue(uint8_t type, const uint8_t* payload, size_t payload_size,
+             bool with_crc);
+
+  // Writes all of the queued frames to the connection with one write, and
+  // flushes it, then empties the batch. Returns false if they couldn't all be
+  // written.
+  bool Send(Connection& connection);
+
+  // Discards the queued frames, e.g. when the connection has been closed.
+  void Clear() { size_ = 0; }
+
+  bool empty() const { return size_ == 0; }
+  uint16_t size() const { return size_; }
+
+ private:
+  uint16_t size_;
+  uint8_t buffer_[kCapacity];
+};
+
+}  // namespace mcunet
+
+#endif  // MCUNET_SRC_FRAMED_MESSAGE_H_
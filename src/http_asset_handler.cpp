@@ -0,0 +1,113 @@
+#include "http_asset_handler.h"
+
+#include <McuCore.h>
+
+namespace mcunet {
+namespace {
+
+// Copies size bytes of data from PROGMEM to out, in pieces no larger than the
+// space remaining in the write buffer of out (if it reports that), so that each
+// piece completes a packet rather than straddling two.
+void CopyFromProgmem(const uint8_t* data, uint32_t size, Print& out) {
+  uint8_t buffer[HttpAssetHandler::kCopySize];
+  while (size > 0) {
+    uint8_t piece_size =
+        size < sizeof buffer ? static_cast<uint8_t>(size) : sizeof buffer;
+    const int available = out.availableForWrite();
+    if (available > 0 && available < piece_size) {
+      piece_size = available;
+    }
+    memcpy_P(buffer, data, piece_size);
+    out.write(buffer, piece_size);
+    data += piece_size;
+    size -= piece_size;
+  }
+}
+
+// Writes the status line, and the Vary header if vary is true.
+void StartHeaders(HttpStatusCode status_code, bool vary,
+                  HttpResponse& response) {
+  response.StartHeaders(status_code);
+  if (vary) {
+    response.AddHeader(MCU_PSV("Vary"), MCU_PSV("Accept-Encoding"));
+  }
+}
+
+}  // namespace
+
+bool HttpAssetHandler::Serve(const HttpRequest& request,
+                             HttpResponse& response) const {
+  HttpAsset asset;
+  if (!Find(request.path(), asset)) {
+    return false;
+  }
+  if (request.method != HttpMethod::kGet &&
+      request.method != HttpMethod::kHead) {
+    response.SendEmptyResponse(HttpStatusCode::kMethodNotAllowed);
+    return true;
+  }
+  // Whenever there is a gzipped representation, the response depends on
+  // Accept-Encoding, which caches need to know about, including for the 304
+  // and 406 responses.
+  const bool vary = asset.gzip_data != nullptr;
+  bool gzipped;
+  if (asset.gzip_data != nullptr && request.accepts_gzip) {
+    gzipped = true;
+  } else if (asset.identity_data != nullptr) {
+    gzipped = false;
+  } else {
+    StartHeaders(HttpStatusCode::kNotAcceptable, vary, response);
+    response.set_content_length(0);
+    response.EndHeaders();
+    return true;
+  }
+  const uint8_t* const data = gzipped ? asset.gzip_data : asset.identity_data;
+  const uint32_t size = gzipped ? asset.gzip_size : asset.identity_size;
+  const uint32_t etag = gzipped ? asset.gzip_etag : asset.identity_etag;
+  response.set_etag(etag);
+  if (request.IfNoneMatch(etag)) {
+    StartHeaders(HttpStatusCode::kNotModified, vary, response);
+    response.EndHeaders();
+    return true;
+  }
+  MCU_VLOG(3) << MCU_PSD("HttpAssetHandler::Serve ")
+              << mcucore::ProgmemStringView(asset.path, asset.path_size)
+              << MCU_PSD(" ") << MCU_NAME_VAL(gzipped) << MCU_NAME_VAL(size);
+  StartHeaders(HttpStatusCode::kOk, vary, response);
+  response.AddHeader(
+      MCU_PSV("Content-Type"),
+      mcucore::ProgmemStringView(asset.content_type, asset.content_type_size));
+  if (gzipped) {
+    response.AddHeader(MCU_PSV("Content-Encoding"), MCU_PSV("gzip"));
+  }
+  response.set_content_length(size);
+  response.EndHeaders();
+  if (request.method == HttpMethod::kGet) {
+    CopyFromProgmem(data, size, response);
+  }
+  return true;
+}
+
+void HttpAssetHandler::HandleRequest(const HttpRequest& request,
+                                     HttpResponse& response) {
+  Serve(request, response);
+}
+
+bool HttpAssetHandler::Find(const mcucore::StringView& path,
+                            HttpAsset& asset) const {
+  const uint32_t hash = HttpPathHash(path);
+  for (uint8_t ndx = 0; ndx < num_assets_; ++ndx) {
+    uint32_t path_hash;
+    memcpy_P(&path_hash, &assets_[ndx].path_hash, sizeof path_hash);
+    if (path_hash != hash) {
+      continue;
+    }
+    memcpy_P(&asset, &assets_[ndx], sizeof asset);
+    if (path == mcucore::ProgmemStringView(asset.path, asset.path_size)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace mcunet
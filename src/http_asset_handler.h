@@ -0,0 +1,110 @@
+#ifndef MCUNET_SRC_HTTP_ASSET_HANDLER_H_
+#define MCUNET_SRC_HTTP_ASSET_HANDLER_H_
+
+// HttpAssetHandler serves static files (e.g. the HTML, CSS and JavaScript of a
+// configuration UI) from a table of HttpAssets in PROGMEM. The table is
+// generated at build time by extras/dev_tools/pack_http_assets.py, which
+// gzips each file, and records the length of each representation of the file
+// and an ETag computed from its contents, so that nothing needs to be computed
+// when a request is served.
+//
+// The gzipped representation is sent (with "Content-Encoding: gzip") to clients
+// whose Accept-Encoding header allows it, which is nearly all browsers; the
+// identity (uncompressed) representation is sent to other clients if the
+// packer was asked to include it, else they receive 406 Not Acceptable. This
+// typically reduces both the flash used and the bytes sent by a factor of 3 to
+// 5 for text files. The body is copied from flash to the connection through a
+// small stack buffer, sized to fill the connection's write buffer, so serving
+// an asset uses no more RAM than any other response.
+//
+// Example:
+//
+//   #include "generated_assets.h"  // Output of pack_http_assets.py.
+//
+//   HttpAssetHandler asset_handler(kHttpAssets);
+//   HttpServer server(80, asset_handler);
+//
+// To combine assets with other routes, call Serve from another handler, which
+// returns false if there is no asset for the request's path.
+//
+// Author: james.synge@gmail.com
+
+#include <McuCore.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "http_request.h"
+#include "http_response.h"
+#include "http_router.h"
+#include "http_server.h"
+#include "mcunet_config.h"
+
+namespace mcunet {
+
+struct HttpAsset {
+  uint32_t path_hash;
+  // The path and content_type are NUL terminated, and in PROGMEM on AVR, as
+  // are the data arrays.
+  const char* path;
+  const char* content_type;
+  uint8_t path_size;
+  uint8_t content_type_size;
+  // The gzipped representation, or nullptr if none.
+  const uint8_t* gzip_data;
+  uint32_t gzip_size;
+  uint32_t gzip_etag;
+  // The identity (uncompressed) representation, or nullptr if none.
+  const uint8_t* identity_data;
+  uint32_t identity_size;
+  uint32_t identity_etag;
+};
+
+constexpr HttpAsset MakeHttpAsset(const char* path, const char* content_type,
+                                  const uint8_t* gzip_data, uint32_t gzip_size,
+                                  uint32_t gzip_etag,
+                                  const uint8_t* identity_data,
+                                  uint32_t identity_size,
+                                  uint32_t identity_etag) {
+  return HttpAsset{HttpPathHash(path),
+                   path,
+                   content_type,
+                   internal::HttpPathLength(path),
+                   internal::HttpPathLength(content_type),
+                   gzip_data,
+                   gzip_size,
+                   gzip_etag,
+                   identity_data,
+                   identity_size,
+                   identity_etag};
+}
+
+class HttpAssetHandler : public HttpRequestHandler {
+ public:
+  static constexpr uint8_t kCopySize = MCUNET_HTTP_ASSET_COPY_SIZE;
+
+  template <size_t N>
+  explicit HttpAssetHandler(const HttpAsset (&assets)[N])
+      : assets_(assets), num_assets_(N) {}
+
+  // If there is an asset whose path is the request's path, responds with it
+  // (or with 304 Not Modified, 405 Method Not Allowed or 406 Not Acceptable)
+  // and returns true. Else returns false without starting a response.
+  bool Serve(const HttpRequest& request, HttpResponse& response) const;
+
+  // HttpRequestHandler method. Responds with 404 Not Found (by not starting a
+  // response) if there is no asset for the path.
+  void HandleRequest(const HttpRequest& request,
+                     HttpResponse& response) override;
+
+ private:
+  // Finds the asset whose path is path, and copies it from PROGMEM into asset.
+  // Returns false if not found.
+  bool Find(const mcucore::StringView& path, HttpAsset& asset) const;
+
+  const HttpAsset* const assets_;
+  const uint8_t num_assets_;
+};
+
+}  // namespace mcunet
+
+#endif  // MCUNET_SRC_HTTP_ASSET_HANDLER_H_
@@ -0,0 +1,66 @@
+#include "http_chunked_writer.h"
+
+#include <McuCore.h>
+
+namespace mcunet {
+namespace {
+
+// Writes size as (upper case) hexadecimal digits, without leading zeros, as
+// required for the chunk-size of a chunk.
+void PrintChunkSize(Print& out, size_t size) {
+  char digits[sizeof(size_t) * 2];
+  uint8_t num_digits = 0;
+  do {
+    const uint8_t nibble = size & 0xF;
+    digits[sizeof digits - ++num_digits] =
+        nibble < 10 ? '0' + nibble : 'A' + (nibble - 10);
+    size >>= 4;
+  } while (size > 0);
+  out.write(digits + sizeof digits - num_digits, num_digits);
+}
+
+}  // namespace
+
+HttpChunkedWriter::HttpChunkedWriter(Connection& out)
+    : out_(out), out_chunks_(false), ended_(false) {}
+
+void HttpChunkedWriter::Start() { out_chunks_ = out_.StartChunkedCoding(); }
+
+size_t HttpChunkedWriter::write(uint8_t b) { return write(&b, 1); }
+
+size_t HttpChunkedWriter::write(const uint8_t* buf, size_t size) {
+  MCU_DCHECK(!ended_);
+  if (out_chunks_) {
+    return out_.write(buf, size);
+  } else if (size > 0) {
+    WriteChunk(buf, size);
+  }
+  return size;
+}
+
+int HttpChunkedWriter::availableForWrite() { return out_.availableForWrite(); }
+
+void HttpChunkedWriter::flush() { out_.flush(); }
+
+void HttpChunkedWriter::End() {
+  MCU_DCHECK(!ended_);
+  if (out_chunks_) {
+    out_.EndChunkedCoding();
+  } else {
+    mcucore::OPrintStream strm(out_);
+    strm << MCU_PSD("0\r\n\r\n");
+  }
+  ended_ = true;
+}
+
+void HttpChunkedWriter::WriteChunk(const uint8_t* buf, size_t size) {
+  MCU_VLOG(9) << MCU_PSD("HttpChunkedWriter::WriteChunk ")
+              << MCU_NAME_VAL(size);
+  mcucore::OPrintStream strm(out_);
+  PrintChunkSize(out_, size);
+  strm << MCU_PSD("\r\n");
+  out_.write(buf, size);
+  strm << MCU_PSD("\r\n");
+}
+
+}  // namespace mcunet
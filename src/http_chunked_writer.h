@@ -0,0 +1,60 @@
+#ifndef MCUNET_SRC_HTTP_CHUNKED_WRITER_H_
+#define MCUNET_SRC_HTTP_CHUNKED_WRITER_H_
+
+// HttpChunkedWriter is a Print adapter that writes the data printed to it to a
+// Connection using the chunked transfer coding of HTTP/1.1. This allows a
+// response whose length isn't known in advance to be streamed over a
+// persistent connection, rather than closing the connection to mark the end of
+// the body.
+//
+// If the connection supports it (see Connection::StartChunkedCoding, e.g. a
+// WriteBufferedConnection), the connection does the framing, writing one chunk
+// each time its write buffer is flushed; the data is copied only into the
+// connection's write buffer. Otherwise each write becomes a chunk. Thus
+// responses of any size are sent using a constant amount of memory.
+//
+// Author: james.synge@gmail.com
+
+#include <McuCore.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "connection.h"
+
+namespace mcunet {
+
+class HttpChunkedWriter : public Print {
+ public:
+  explicit HttpChunkedWriter(Connection& out);
+
+  // Starts the body, after the headers have been written to out. Must be
+  // called before any data is written.
+  void Start();
+
+  // Print methods.
+  using Print::write;
+  size_t write(uint8_t b) override;
+  size_t write(const uint8_t* buf, size_t size) override;
+  int availableForWrite() override;
+  void flush() override;
+
+  // Writes the last (empty) chunk, which marks the end of the body, after any
+  // data buffered by the connection. No more data may be written after this.
+  void End();
+
+  // Returns true if End has been called.
+  bool ended() const { return ended_; }
+
+ private:
+  // Writes one chunk (i.e. the size line, the data and the CRLF).
+  void WriteChunk(const uint8_t* buf, size_t size);
+
+  Connection& out_;
+  // True if out_ does the framing.
+  bool out_chunks_;
+  bool ended_;
+};
+
+}  // namespace mcunet
+
+#endif  // MCUNET_SRC_HTTP_CHUNKED_WRITER_H_
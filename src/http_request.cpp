@@ -0,0 +1,75 @@
+#include "http_request.h"
+
+#include <McuCore.h>
+
+namespace mcunet {
+namespace {
+
+// Returns the size of the path portion of the target.
+uint8_t PathSize(const char* target, const uint8_t target_size) {
+  for (uint8_t ndx = 0; ndx < target_size; ++ndx) {
+    if (target[ndx] == '?') {
+      return ndx;
+    }
+  }
+  return target_size;
+}
+
+}  // namespace
+
+void HttpRequest::Reset() {
+  method = HttpMethod::kUnknown;
+  target[0] = 0;
+  target_size = 0;
+  minor_version = 1;
+  content_length = 0;
+  has_content_length = false;
+  connection_close = false;
+  connection_keep_alive = false;
+  connection_upgrade = false;
+  num_if_none_match_etags = 0;
+  if_none_match_any = false;
+  accepts_gzip = false;
+  upgrade_websocket = false;
+  has_websocket_key = false;
+  websocket_version = 0;
+}
+
+bool HttpRequest::KeepAlive() const {
+  if (connection_close) {
+    return false;
+  }
+  return minor_version >= 1 || connection_keep_alive;
+}
+
+bool HttpRequest::IfNoneMatch(const uint32_t etag) const {
+  if (if_none_match_any) {
+    return true;
+  }
+  for (uint8_t ndx = 0; ndx < num_if_none_match_etags; ++ndx) {
+    if (if_none_match_etags[ndx] == etag) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool HttpRequest::IsWebSocketUpgrade() const {
+  return method == HttpMethod::kGet && minor_version >= 1 &&
+         upgrade_websocket && connection_upgrade && has_websocket_key;
+}
+
+mcucore::StringView HttpRequest::path() const {
+  return mcucore::StringView(target, PathSize(target, target_size));
+}
+
+mcucore::StringView HttpRequest::query() const {
+  const uint8_t path_size = PathSize(target, target_size);
+  if (path_size >= target_size) {
+    return mcucore::StringView();
+  }
+  return mcucore::StringView(target + path_size + 1,
+                             target_size - path_size - 1);
+}
+
+}  // namespace mcunet
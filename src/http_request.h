@@ -0,0 +1,100 @@
+#ifndef MCUNET_SRC_HTTP_REQUEST_H_
+#define MCUNET_SRC_HTTP_REQUEST_H_
+
+// HttpRequest holds the parts of an HTTP/1.x request (the request line and the
+// headers that we care about) that HttpRequestParser extracts, in a fixed
+// amount of memory. The body, if any, is not stored here.
+//
+// Author: james.synge@gmail.com
+
+#include <McuCore.h>
+#include <stdint.h>
+
+#include "mcunet_config.h"
+
+namespace mcunet {
+
+enum class HttpMethod : uint8_t {
+  kUnknown,
+  kGet,
+  kHead,
+  kPost,
+  kPut,
+  kDelete,
+  kOptions,
+  kPatch,
+};
+
+struct HttpRequest {
+  static constexpr uint8_t kMaxTargetLength = MCUNET_HTTP_MAX_TARGET_LENGTH;
+  static constexpr uint8_t kMaxIfNoneMatchETags =
+      MCUNET_HTTP_MAX_IF_NONE_MATCH_ETAGS;
+
+  // Restores the state to that at construction.
+  void Reset();
+
+  // Returns the path portion of the target, i.e. excluding any query string.
+  mcucore::StringView path() const;
+
+  // Returns the query string (after the '?'), or an empty view if there is
+  // none.
+  mcucore::StringView query() const;
+
+  // Returns true if the client is willing to send further requests over the
+  // same connection; i.e. for HTTP/1.1, unless it sent "Connection: close",
+  // and for HTTP/1.0, only if it sent "Connection: keep-alive".
+  bool KeepAlive() const;
+
+  // Returns true if the If-None-Match header lists etag (or is "*"), i.e. if
+  // the client already has the representation identified by etag.
+  bool IfNoneMatch(uint32_t etag) const;
+
+  // Returns true if this is a request to upgrade the connection to the
+  // WebSocket protocol (RFC 6455), with the headers needed to accept it. The
+  // version of the protocol isn't checked here.
+  bool IsWebSocketUpgrade() const;
+
+  HttpMethod method = HttpMethod::kUnknown;
+
+  // The request-target, NUL terminated.
+  char target[kMaxTargetLength + 1] = {0};
+  uint8_t target_size = 0;
+
+  // 0 for HTTP/1.0, 1 for HTTP/1.1.
+  uint8_t minor_version = 1;
+
+  // From the Content-Length header, if present; else zero.
+  uint32_t content_length = 0;
+  bool has_content_length = false;
+
+  // Options from the Connection header.
+  bool connection_close = false;
+  bool connection_keep_alive = false;
+  bool connection_upgrade = false;
+
+  // From the If-None-Match header. Only entity tags that HttpResponse could
+  // have generated are recorded, and only the first kMaxIfNoneMatchETags of
+  // those.
+  uint32_t if_none_match_etags[kMaxIfNoneMatchETags] = {0};
+  uint8_t num_if_none_match_etags = 0;
+  bool if_none_match_any = false;
+
+  // True if the Accept-Encoding header allows a gzip encoded body.
+  bool accepts_gzip = false;
+
+  // True if the Upgrade header lists "websocket".
+  bool upgrade_websocket = false;
+
+  // From the Sec-WebSocket-Key header, if it has the expected length (i.e. the
+  // base64 encoding of 16 bytes); not NUL terminated.
+  char websocket_key[24] = {0};
+  bool has_websocket_key = false;
+
+  // From the Sec-WebSocket-Version header, if present and no more than 255;
+  // else zero.
+  uint8_t websocket_version = 0;
+};
+
+}  // namespace mcunet
+
+#endif  // MCUNET_SRC_HTTP_REQUEST_H_
@@ -0,0 +1,488 @@
+#include "http_request_parser.h"
+
+#include <McuCore.h>
+
+namespace mcunet {
+namespace {
+
+// Returns true if c may appear in a method or header name (i.e. is a 'tchar'
+// per RFC 7230, section 3.2.6).
+bool IsTokenChar(const char c) {
+  if (('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') ||
+      ('0' <= c && c <= '9')) {
+    return true;
+  }
+  switch (c) {
+    case '!':
+    case '#':
+    case '$':
+    case '%':
+    case '&':
+    case '\'':
+    case '*':
+    case '+':
+    case '-':
+    case '.':
+    case '^':
+    case '_':
+    case '`':
+    case '|':
+    case '~':
+      return true;
+  }
+  return false;
+}
+
+bool IsControlChar(const char c) {
+  return (0 <= c && c < ' ') || c == 0x7F;
+}
+
+char ToLower(const char c) { return ('A' <= c && c <= 'Z') ? c + 32 : c; }
+
+// Returns the value of the hexadecimal digit c, or -1 if it isn't one.
+int8_t HexDigitValue(const char c) {
+  if ('0' <= c && c <= '9') {
+    return c - '0';
+  }
+  const char lower = ToLower(c);
+  if ('a' <= lower && lower <= 'f') {
+    return lower - 'a' + 10;
+  }
+  return -1;
+}
+
+bool TokenEquals(const char* token, const uint8_t size,
+                 const mcucore::ProgmemStringView& expected,
+                 const bool ignore_case) {
+  if (size != expected.size()) {
+    return false;
+  }
+  for (uint8_t ndx = 0; ndx < size; ++ndx) {
+    const char c = expected.at(ndx);
+    if (token[ndx] != c &&
+        !(ignore_case && ToLower(token[ndx]) == ToLower(c))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+HttpRequestParser::HttpRequestParser() { Reset(); }
+
+void HttpRequestParser::Reset() {
+  request_.Reset();
+  ResetToken();
+  saw_cr_ = false;
+  gzip_listed_ = false;
+  header_ = Header::kUnknown;
+  state_ = State::kMethod;
+  error_status_ = HttpStatusCode::kBadRequest;
+}
+
+bool HttpRequestParser::in_progress() const {
+  return (state_ != State::kMethod || token_size_ > 0) &&
+         state_ != State::kComplete && state_ != State::kError;
+}
+
+HttpRequestParser::Result HttpRequestParser::Parse(const uint8_t* data,
+                                                   const size_t size,
+                                                   size_t& consumed) {
+  consumed = 0;
+  if (state_ == State::kComplete) {
+    return Result::kComplete;
+  } else if (state_ == State::kError) {
+    return Result::kError;
+  }
+  while (consumed < size) {
+    const auto result = ProcessChar(static_cast<char>(data[consumed++]));
+    if (result != Result::kNeedMoreInput) {
+      return result;
+    }
+  }
+  return Result::kNeedMoreInput;
+}
+
+HttpRequestParser::Result HttpRequestParser::ProcessChar(const char c) {
+  // Lines may end with CRLF or just LF; a CR elsewhere is an error.
+  if (saw_cr_) {
+    saw_cr_ = false;
+    if (c != '\n') {
+      return Error(HttpStatusCode::kBadRequest);
+    }
+  } else if (c == '\r') {
+    saw_cr_ = true;
+    return Result::kNeedMoreInput;
+  }
+
+  switch (state_) {
+    case State::kMethod:
+      if (c == ' ') {
+        return EndMethod();
+      } else if (c == '\n' && token_size_ == 0) {
+        // RFC 7230 says that we SHOULD ignore blank lines before the request
+        // line (e.g. left over after the body of the previous request).
+        return Result::kNeedMoreInput;
+      } else if (!IsTokenChar(c)) {
+        return Error(HttpStatusCode::kBadRequest);
+      }
+      AppendToToken(c);
+      return Result::kNeedMoreInput;
+
+    case State::kTarget:
+      if (c == ' ') {
+        if (request_.target_size == 0) {
+          return Error(HttpStatusCode::kBadRequest);
+        }
+        state_ = State::kVersion;
+        return Result::kNeedMoreInput;
+      } else if (IsControlChar(c)) {
+        // Includes a newline, i.e. a request line without a version.
+        return Error(HttpStatusCode::kBadRequest);
+      } else if (request_.target_size >= HttpRequest::kMaxTargetLength) {
+        return Error(HttpStatusCode::kUriTooLong);
+      }
+      request_.target[request_.target_size++] = c;
+      request_.target[request_.target_size] = 0;
+      return Result::kNeedMoreInput;
+
+    case State::kVersion:
+      if (c == '\n') {
+        return EndVersion();
+      } else if (IsControlChar(c) || c == ' ') {
+        return Error(HttpStatusCode::kBadRequest);
+      }
+      AppendToToken(c);
+      return Result::kNeedMoreInput;
+
+    case State::kHeaderLineStart:
+      if (c == '\n') {
+        state_ = State::kComplete;
+        return Result::kComplete;
+      } else if (!IsTokenChar(c)) {
+        // Includes leading whitespace (i.e. obsolete line folding).
+        return Error(HttpStatusCode::kBadRequest);
+      }
+      ResetToken();
+      AppendToToken(c);
+      state_ = State::kHeaderName;
+      return Result::kNeedMoreInput;
+
+    case State::kHeaderName:
+      if (c == ':') {
+        header_ = Header::kUnknown;
+        if (token_overflow_) {
+          // Too long to be one we recognize.
+        } else if (TokenEquals(token_, token_size_, MCU_PSV("Accept-Encoding"),
+                               true)) {
+          header_ = Header::kAcceptEncoding;
+        } else if (TokenEquals(token_, token_size_, MCU_PSV("Content-Length"),
+                               true)) {
+          header_ = Header::kContentLength;
+        } else if (TokenEquals(token_, token_size_,
+                               MCU_PSV("Transfer-Encoding"), true)) {
+          header_ = Header::kTransferEncoding;
+        } else if (TokenEquals(token_, token_size_, MCU_PSV("Connection"),
+                               true)) {
+          header_ = Header::kConnection;
+        } else if (TokenEquals(token_, token_size_, MCU_PSV("If-None-Match"),
+                               true)) {
+          header_ = Header::kIfNoneMatch;
+        } else if (TokenEquals(token_, token_size_, MCU_PSV("Upgrade"),
+                               true)) {
+          header_ = Header::kUpgrade;
+        } else if (TokenEquals(token_, token_size_,
+                               MCU_PSV("Sec-WebSocket-Key"), true)) {
+          header_ = Header::kSecWebSocketKey;
+        } else if (TokenEquals(token_, token_size_,
+                               MCU_PSV("Sec-WebSocket-Version"), true)) {
+          header_ = Header::kSecWebSocketVersion;
+        }
+        ResetToken();
+        state_ = State::kHeaderValueStart;
+        return Result::kNeedMoreInput;
+      } else if (!IsTokenChar(c)) {
+        // Includes whitespace between the name and the colon, which RFC 7230
+        // says we MUST reject.
+        return Error(HttpStatusCode::kBadRequest);
+      }
+      AppendToToken(c);
+      return Result::kNeedMoreInput;
+
+    case State::kHeaderValueStart:
+      if (c == ' ' || c == '\t') {
+        return Result::kNeedMoreInput;
+      }
+      state_ = State::kHeaderValue;
+      // Fall through.
+
+    case State::kHeaderValue:
+      if (c == '\n') {
+        return EndHeaderValue();
+      } else if (IsControlChar(c) && c != '\t') {
+        return Error(HttpStatusCode::kBadRequest);
+      } else if (c == ',' && IsListHeader()) {
+        // The value is a list, whose elements we examine one at a time, so
+        // that the length of the whole value doesn't matter.
+        EndListElement();
+      } else if (header_ != Header::kUnknown) {
+        AppendToToken(c);
+      }
+      return Result::kNeedMoreInput;
+
+    case State::kComplete:
+      return Result::kComplete;
+
+    case State::kError:
+      break;
+  }
+  return Result::kError;
+}
+
+HttpRequestParser::Result HttpRequestParser::EndMethod() {
+  struct MethodName {
+    HttpMethod method;
+    mcucore::ProgmemStringView name;
+  };
+  const MethodName kMethods[] = {
+      {HttpMethod::kGet, MCU_PSV("GET")},
+      {HttpMethod::kHead, MCU_PSV("HEAD")},
+      {HttpMethod::kPost, MCU_PSV("POST")},
+      {HttpMethod::kPut, MCU_PSV("PUT")},
+      {HttpMethod::kDelete, MCU_PSV("DELETE")},
+      {HttpMethod::kOptions, MCU_PSV("OPTIONS")},
+      {HttpMethod::kPatch, MCU_PSV("PATCH")},
+  };
+  if (token_size_ == 0) {
+    return Error(HttpStatusCode::kBadRequest);
+  }
+  if (!token_overflow_) {
+    for (const auto& entry : kMethods) {
+      // Unlike header names, method names are case-sensitive.
+      if (TokenEquals(token_, token_size_, entry.name, false)) {
+        request_.method = entry.method;
+        ResetToken();
+        state_ = State::kTarget;
+        return Result::kNeedMoreInput;
+      }
+    }
+  }
+  return Error(HttpStatusCode::kNotImplemented);
+}
+
+HttpRequestParser::Result HttpRequestParser::EndVersion() {
+  if (token_overflow_) {
+    return Error(HttpStatusCode::kBadRequest);
+  } else if (TokenEquals(token_, token_size_, MCU_PSV("HTTP/1.1"), false)) {
+    request_.minor_version = 1;
+  } else if (TokenEquals(token_, token_size_, MCU_PSV("HTTP/1.0"), false)) {
+    request_.minor_version = 0;
+  } else if (token_size_ > 5 &&
+             TokenEquals(token_, 5, MCU_PSV("HTTP/"), false)) {
+    return Error(HttpStatusCode::kHttpVersionNotSupported);
+  } else {
+    return Error(HttpStatusCode::kBadRequest);
+  }
+  ResetToken();
+  state_ = State::kHeaderLineStart;
+  return Result::kNeedMoreInput;
+}
+
+HttpRequestParser::Result HttpRequestParser::EndHeaderValue() {
+  while (token_size_ > 0 &&
+         (token_[token_size_ - 1] == ' ' || token_[token_size_ - 1] == '\t')) {
+    --token_size_;
+  }
+  if (IsListHeader()) {
+    EndListElement();
+  } else if (token_overflow_) {
+    return Error(HttpStatusCode::kRequestHeaderFieldsTooLarge);
+  }
+  switch (header_) {
+    case Header::kContentLength: {
+      if (token_size_ == 0) {
+        return Error(HttpStatusCode::kBadRequest);
+      }
+      uint32_t value = 0;
+      for (uint8_t ndx = 0; ndx < token_size_; ++ndx) {
+        const char c = token_[ndx];
+        if (c < '0' || '9' < c || value > (0xFFFFFFFFUL - 9) / 10) {
+          return Error(HttpStatusCode::kBadRequest);
+        }
+        value = value * 10 + (c - '0');
+      }
+      if (request_.has_content_length && request_.content_length != value) {
+        return Error(HttpStatusCode::kBadRequest);
+      }
+      request_.content_length = value;
+      request_.has_content_length = true;
+      break;
+    }
+
+    case Header::kTransferEncoding:
+      // We don't support decoding a chunked request body.
+      return Error(HttpStatusCode::kNotImplemented);
+
+    case Header::kSecWebSocketKey:
+      if (token_size_ == sizeof request_.websocket_key) {
+        memcpy(request_.websocket_key, token_, token_size_);
+        request_.has_websocket_key = true;
+      }
+      break;
+
+    case Header::kSecWebSocketVersion: {
+      uint16_t value = 0;
+      for (uint8_t ndx = 0; ndx < token_size_ && value <= 255; ++ndx) {
+        const char c = token_[ndx];
+        if (c < '0' || '9' < c) {
+          value = 0;
+          break;
+        }
+        value = value * 10 + (c - '0');
+      }
+      request_.websocket_version = value <= 255 ? value : 0;
+      break;
+    }
+
+    case Header::kAcceptEncoding:
+    case Header::kConnection:
+    case Header::kIfNoneMatch:
+    case Header::kUpgrade:
+    case Header::kUnknown:
+      break;
+  }
+  ResetToken();
+  state_ = State::kHeaderLineStart;
+  return Result::kNeedMoreInput;
+}
+
+void HttpRequestParser::EndListElement() {
+  uint8_t start = 0;
+  while (start < token_size_ &&
+         (token_[start] == ' ' || token_[start] == '\t')) {
+    ++start;
+  }
+  uint8_t end = token_size_;
+  while (end > start && (token_[end - 1] == ' ' || token_[end - 1] == '\t')) {
+    --end;
+  }
+  const char* element = token_ + start;
+  const uint8_t size = end - start;
+  if (token_overflow_) {
+    // Too long to be one we recognize.
+  } else if (header_ == Header::kConnection) {
+    if (TokenEquals(element, size, MCU_PSV("close"), true)) {
+      request_.connection_close = true;
+    } else if (TokenEquals(element, size, MCU_PSV("keep-alive"), true)) {
+      request_.connection_keep_alive = true;
+    } else if (TokenEquals(element, size, MCU_PSV("upgrade"), true)) {
+      request_.connection_upgrade = true;
+    }
+  } else if (header_ == Header::kIfNoneMatch) {
+    EndEntityTag(element, size);
+  } else if (header_ == Header::kAcceptEncoding) {
+    EndContentCoding(element, size);
+  } else if (header_ == Header::kUpgrade) {
+    if (TokenEquals(element, size, MCU_PSV("websocket"), true)) {
+      request_.upgrade_websocket = true;
+    }
+  }
+  ResetToken();
+}
+
+bool HttpRequestParser::IsListHeader() const {
+  return header_ == Header::kAcceptEncoding ||
+         header_ == Header::kConnection || header_ == Header::kIfNoneMatch ||
+         header_ == Header::kUpgrade;
+}
+
+void HttpRequestParser::EndContentCoding(const char* coding, uint8_t size) {
+  // Split off the parameters (e.g. ";q=0.5"), if any.
+  uint8_t coding_size = 0;
+  while (coding_size < size && coding[coding_size] != ';' &&
+         coding[coding_size] != ' ' && coding[coding_size] != '\t') {
+    ++coding_size;
+  }
+  const bool is_gzip =
+      TokenEquals(coding, coding_size, MCU_PSV("gzip"), true) ||
+      TokenEquals(coding, coding_size, MCU_PSV("x-gzip"), true);
+  const bool is_any = coding_size == 1 && coding[0] == '*';
+  if (!is_gzip && !(is_any && !gzip_listed_)) {
+    return;
+  }
+  // A quality value of zero means "not acceptable"; we don't otherwise care
+  // about the preferences expressed by the quality values.
+  bool acceptable = true;
+  for (uint8_t ndx = coding_size; ndx + 1 < size; ++ndx) {
+    if (ToLower(coding[ndx]) == 'q' && coding[ndx + 1] == '=') {
+      acceptable = false;
+      for (ndx += 2; ndx < size && coding[ndx] != ';'; ++ndx) {
+        if ('1' <= coding[ndx] && coding[ndx] <= '9') {
+          acceptable = true;
+        }
+      }
+      break;
+    }
+  }
+  request_.accepts_gzip = acceptable;
+  if (is_gzip) {
+    gzip_listed_ = true;
+  }
+}
+
+void HttpRequestParser::EndEntityTag(const char* tag, uint8_t size) {
+  if (size == 1 && tag[0] == '*') {
+    request_.if_none_match_any = true;
+    return;
+  }
+  // If-None-Match uses the weak comparison, so the weakness indicator doesn't
+  // matter.
+  if (size >= 2 && tag[0] == 'W' && tag[1] == '/') {
+    tag += 2;
+    size -= 2;
+  }
+  // The only entity tags we generate are quoted hexadecimal numbers of up to 8
+  // digits (see HttpResponse); others can't match, so are ignored.
+  if (size < 3 || size > 10 || tag[0] != '"' || tag[size - 1] != '"') {
+    return;
+  }
+  uint32_t value = 0;
+  for (uint8_t ndx = 1; ndx < size - 1; ++ndx) {
+    const int8_t digit = HexDigitValue(tag[ndx]);
+    if (digit < 0) {
+      return;
+    }
+    value = (value << 4) | static_cast<uint8_t>(digit);
+  }
+  if (request_.num_if_none_match_etags < HttpRequest::kMaxIfNoneMatchETags) {
+    request_.if_none_match_etags[request_.num_if_none_match_etags++] = value;
+  } else {
+    MCU_VLOG(2) << MCU_PSD("Ignoring If-None-Match entity tag ")
+                << mcucore::BaseHex << value;
+  }
+}
+
+HttpRequestParser::Result HttpRequestParser::Error(
+    const HttpStatusCode status) {
+  MCU_VLOG(2) << MCU_PSD("HttpRequestParser error ")
+              << static_cast<uint16_t>(status);
+  error_status_ = status;
+  state_ = State::kError;
+  return Result::kError;
+}
+
+void HttpRequestParser::ResetToken() {
+  token_size_ = 0;
+  token_overflow_ = false;
+}
+
+void HttpRequestParser::AppendToToken(const char c) {
+  if (token_size_ < kMaxTokenLength) {
+    token_[token_size_++] = c;
+  } else {
+    token_overflow_ = true;
+  }
+}
+
+}  // namespace mcunet
@@ -0,0 +1,119 @@
+#ifndef MCUNET_SRC_HTTP_REQUEST_PARSER_H_
+#define MCUNET_SRC_HTTP_REQUEST_PARSER_H_
+
+// HttpRequestParser incrementally parses the request line and headers of an
+// HTTP/1.x request, one byte at a time, so that a request can arrive in any
+// number of pieces (e.g. across many calls to SocketListener::OnCanRead). It
+// doesn't allocate memory, and doesn't buffer the request: the request-target
+// is stored in the HttpRequest, and the name and value of a header are held in
+// a small buffer only while the parser needs them. The values of headers that
+// the parser doesn't recognize are skipped, so their length doesn't matter.
+//
+// Parsing stops at the end of the headers, so that the caller can deal with the
+// body (if any) and with the next (pipelined) request.
+//
+// Author: james.synge@gmail.com
+
+#include <McuCore.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "http_request.h"
+#include "http_response.h"
+#include "mcunet_config.h"
+
+namespace mcunet {
+
+class HttpRequestParser {
+ public:
+  enum class Result : uint8_t {
+    // All of the input has been consumed, and more is needed.
+    kNeedMoreInput,
+    // The end of the headers has been reached; request() is ready for use.
+    kComplete,
+    // The request is malformed or unsupported; see error_status().
+    kError,
+  };
+
+  static constexpr uint8_t kMaxTokenLength =
+      MCUNET_HTTP_MAX_HEADER_TOKEN_LENGTH;
+
+  HttpRequestParser();
+
+  // Prepares for parsing a new request.
+  void Reset();
+
+  // Parses up to size bytes of data, setting consumed to the number of bytes
+  // used. Stops early if the end of the headers is reached (kComplete) or an
+  // error is detected (kError). Once kComplete or kError has been returned,
+  // Reset must be called before parsing another request.
+  Result Parse(const uint8_t* data, size_t size, size_t& consumed);
+
+  // Returns true if some of a request has been parsed, but not all of it.
+  bool in_progress() const;
+
+  const HttpRequest& request() const { return request_; }
+
+  // The status code with which to respond if Parse returned kError.
+  HttpStatusCode error_status() const { return error_status_; }
+
+ private:
+  enum class State : uint8_t {
+    kMethod,
+    kTarget,
+    kVersion,
+    kHeaderLineStart,
+    kHeaderName,
+    kHeaderValueStart,
+    kHeaderValue,
+    kComplete,
+    kError,
+  };
+
+  // The headers whose values the parser needs.
+  enum class Header : uint8_t {
+    kUnknown,
+    kAcceptEncoding,
+    kConnection,
+    kContentLength,
+    kIfNoneMatch,
+    kSecWebSocketKey,
+    kSecWebSocketVersion,
+    kTransferEncoding,
+    kUpgrade,
+  };
+
+  Result ProcessChar(char c);
+  Result EndMethod();
+  Result EndVersion();
+  Result EndHeaderValue();
+  // Returns true if the value of the current header is a comma separated list,
+  // whose elements are examined one at a time.
+  bool IsListHeader() const;
+  // Examines an element of the list that is the value of the current header.
+  void EndListElement();
+  // Records whether gzip is acceptable, per an element of Accept-Encoding.
+  void EndContentCoding(const char* coding, uint8_t size);
+  // Records an entity tag from If-None-Match, if it is one we might match.
+  void EndEntityTag(const char* tag, uint8_t size);
+  Result Error(HttpStatusCode status);
+
+  void ResetToken();
+  void AppendToToken(char c);
+
+  HttpRequest request_;
+  char token_[kMaxTokenLength];
+  uint8_t token_size_;
+  bool token_overflow_;
+  bool saw_cr_;
+  // True if gzip has been named in Accept-Encoding, in which case "*" doesn't
+  // apply to it.
+  bool gzip_listed_;
+  Header header_;
+  State state_;
+  HttpStatusCode error_status_;
+};
+
+}  // namespace mcunet
+
+#endif  // MCUNET_SRC_HTTP_REQUEST_PARSER_H_
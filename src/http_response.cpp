@@ -0,0 +1,287 @@
+#include "http_response.h"
+
+#include <McuCore.h>
+
+namespace mcunet {
+namespace {
+
+// Counts and computes a Fletcher-32 checksum of the bytes printed to it, and
+// passes on (to out, if there is one) only the first limit bytes. Used to
+// measure a body, then to send it while verifying that it hasn't changed. The
+// checksum also serves as an ETag; Fletcher's is used because it needs only
+// additions, which are cheap on an 8-bit MCU.
+class BodyDigester : public Print {
+ public:
+  BodyDigester(Print* out, uint32_t limit) : out_(out), limit_(limit) {}
+
+  using Print::write;
+  size_t write(uint8_t b) override {
+    Add(b);
+    if (out_ != nullptr && count_ <= limit_) {
+      out_->write(b);
+    }
+    return 1;
+  }
+
+  size_t write(const uint8_t* buf, size_t size) override {
+    const uint32_t room = count_ < limit_ ? limit_ - count_ : 0;
+    for (size_t ndx = 0; ndx < size; ++ndx) {
+      Add(buf[ndx]);
+    }
+    if (out_ != nullptr && room > 0) {
+      out_->write(buf, size < room ? size : static_cast<size_t>(room));
+    }
+    return size;
+  }
+
+  uint32_t count() const { return count_; }
+  uint32_t checksum() const { return (sum2_ << 16) | sum1_; }
+
+ private:
+  void Add(uint8_t b) {
+    ++count_;
+    sum1_ += b;
+    if (sum1_ >= 65535) {
+      sum1_ -= 65535;
+    }
+    sum2_ += sum1_;
+    if (sum2_ >= 65535) {
+      sum2_ -= 65535;
+    }
+  }
+
+  Print* const out_;
+  const uint32_t limit_;
+  uint32_t count_ = 0;
+  uint32_t sum1_ = 0;
+  uint32_t sum2_ = 0;
+};
+
+// Prints etag as a quoted, fixed width hexadecimal number, the form that
+// HttpRequestParser recognizes in If-None-Match.
+void PrintETag(Print& out, uint32_t etag) {
+  char text[10];
+  text[0] = '"';
+  for (int ndx = 8; ndx >= 1; --ndx) {
+    const uint8_t nibble = etag & 0xF;
+    text[ndx] = nibble < 10 ? '0' + nibble : 'a' + (nibble - 10);
+    etag >>= 4;
+  }
+  text[9] = '"';
+  out.write(reinterpret_cast<const uint8_t*>(text), sizeof text);
+}
+
+}  // namespace
+
+mcucore::ProgmemStringView HttpReasonPhrase(HttpStatusCode status_code) {
+  switch (status_code) {
+    case HttpStatusCode::kSwitchingProtocols:
+      return MCU_PSV("Switching Protocols");
+    case HttpStatusCode::kOk:
+      return MCU_PSV("OK");
+    case HttpStatusCode::kNoContent:
+      return MCU_PSV("No Content");
+    case HttpStatusCode::kNotModified:
+      return MCU_PSV("Not Modified");
+    case HttpStatusCode::kBadRequest:
+      return MCU_PSV("Bad Request");
+    case HttpStatusCode::kNotFound:
+      return MCU_PSV("Not Found");
+    case HttpStatusCode::kMethodNotAllowed:
+      return MCU_PSV("Method Not Allowed");
+    case HttpStatusCode::kNotAcceptable:
+      return MCU_PSV("Not Acceptable");
+    case HttpStatusCode::kRequestTimeout:
+      return MCU_PSV("Request Timeout");
+    case HttpStatusCode::kPayloadTooLarge:
+      return MCU_PSV("Payload Too Large");
+    case HttpStatusCode::kUriTooLong:
+      return MCU_PSV("URI Too Long");
+    case HttpStatusCode::kUpgradeRequired:
+      return MCU_PSV("Upgrade Required");
+    case HttpStatusCode::kRequestHeaderFieldsTooLarge:
+      return MCU_PSV("Request Header Fields Too Large");
+    case HttpStatusCode::kInternalServerError:
+      return MCU_PSV("Internal Server Error");
+    case HttpStatusCode::kNotImplemented:
+      return MCU_PSV("Not Implemented");
+    case HttpStatusCode::kHttpVersionNotSupported:
+      return MCU_PSV("HTTP Version Not Supported");
+  }
+  return MCU_PSV("Unknown");
+}
+
+HttpResponse::HttpResponse(Connection& connection, bool omit_body,
+                           bool close_connection)
+    : connection_(connection),
+      request_(nullptr),
+      content_length_(0),
+      etag_(0),
+      omit_body_(omit_body),
+      bodyless_status_(false),
+      has_etag_(false),
+      close_connection_(close_connection),
+      has_content_length_(false),
+      started_(false),
+      headers_ended_(false),
+      chunked_(false),
+      chunked_writer_(connection) {}
+
+void HttpResponse::set_etag(uint32_t etag) {
+  MCU_DCHECK(!headers_ended_);
+  etag_ = etag;
+  has_etag_ = true;
+}
+
+bool HttpResponse::SendNotModifiedIfMatch(uint32_t etag) {
+  set_etag(etag);
+  if (request_ == nullptr || !request_->IfNoneMatch(etag)) {
+    return false;
+  }
+  StartHeaders(HttpStatusCode::kNotModified);
+  EndHeaders();
+  return true;
+}
+
+void HttpResponse::SendOkWithETag(
+    const mcucore::ProgmemStringView& content_type, const Printable& body) {
+  BodyDigester measure(nullptr, 0);
+  body.printTo(measure);
+  if (SendNotModifiedIfMatch(measure.checksum())) {
+    return;
+  }
+  StartHeaders(HttpStatusCode::kOk);
+  AddHeader(MCU_PSV("Content-Type"), content_type);
+  SendMeasuredBody(body, measure.count(), measure.checksum());
+}
+
+void HttpResponse::StartHeaders(HttpStatusCode status_code) {
+  MCU_DCHECK(!started_);
+  started_ = true;
+  bodyless_status_ = status_code == HttpStatusCode::kNoContent ||
+                     status_code == HttpStatusCode::kNotModified;
+  mcucore::OPrintStream strm(connection_);
+  strm << MCU_PSD("HTTP/1.1 ") << static_cast<uint16_t>(status_code) << ' '
+       << HttpReasonPhrase(status_code) << MCU_PSD("\r\n");
+}
+
+void HttpResponse::AddHeader(const mcucore::ProgmemStringView& name,
+                             const mcucore::ProgmemStringView& value) {
+  MCU_DCHECK(started_ && !headers_ended_);
+  mcucore::OPrintStream strm(connection_);
+  strm << name << MCU_PSD(": ") << value << MCU_PSD("\r\n");
+}
+
+void HttpResponse::set_content_length(uint32_t content_length) {
+  MCU_DCHECK(!headers_ended_);
+  content_length_ = content_length;
+  has_content_length_ = true;
+}
+
+void HttpResponse::EndHeaders() {
+  MCU_DCHECK(started_ && !headers_ended_);
+  headers_ended_ = true;
+  const uint8_t minor_version =
+      request_ == nullptr ? 1 : request_->minor_version;
+  mcucore::OPrintStream strm(connection_);
+  if (has_etag_) {
+    strm << MCU_PSD("ETag: ");
+    PrintETag(connection_, etag_);
+    strm << MCU_PSD("\r\n");
+  }
+  if (bodyless_status_) {
+    // The end of the response is implied by the status code.
+  } else if (has_content_length_) {
+    strm << MCU_PSD("Content-Length: ") << content_length_ << MCU_PSD("\r\n");
+  } else if (minor_version >= 1 && !close_connection_) {
+    strm << MCU_PSD("Transfer-Encoding: chunked\r\n");
+    chunked_ = true;
+  } else {
+    // The only way left to mark the end of the body.
+    close_connection_ = true;
+  }
+  if (close_connection_) {
+    strm << MCU_PSD("Connection: close\r\n");
+  } else if (minor_version == 0) {
+    strm << MCU_PSD("Connection: keep-alive\r\n");
+  }
+  strm << MCU_PSD("\r\n");
+  if (chunked_ && !omit_body()) {
+    chunked_writer_.Start();
+  }
+}
+
+void HttpResponse::EndHeadersWithBody(const Printable& body) {
+  MCU_DCHECK(started_ && !headers_ended_ && !has_content_length_);
+  BodyDigester measure(nullptr, 0);
+  body.printTo(measure);
+  SendMeasuredBody(body, measure.count(), measure.checksum());
+}
+
+void HttpResponse::SendMeasuredBody(const Printable& body, uint32_t size,
+                                    uint32_t checksum) {
+  set_content_length(size);
+  EndHeaders();
+  if (omit_body()) {
+    return;
+  }
+  BodyDigester send(this, size);
+  body.printTo(send);
+  if (send.count() != size || send.checksum() != checksum) {
+    MCU_VLOG(1) << MCU_PSD("Body changed between passes; measured ") << size
+                << MCU_PSD(", sent ") << send.count();
+    close_connection_ = true;
+  }
+}
+
+void HttpResponse::EndResponse() {
+  MCU_DCHECK(headers_ended_);
+  // The body of a response to a HEAD request is omitted entirely, including
+  // the last chunk.
+  if (chunked_ && !omit_body() && !chunked_writer_.ended()) {
+    chunked_writer_.End();
+  }
+}
+
+void HttpResponse::SendEmptyResponse(HttpStatusCode status_code) {
+  StartHeaders(status_code);
+  set_content_length(0);
+  EndHeaders();
+}
+
+size_t HttpResponse::write(uint8_t b) {
+  MCU_DCHECK(headers_ended_);
+  if (omit_body()) {
+    return 1;
+  } else if (chunked_) {
+    return chunked_writer_.write(b);
+  }
+  return connection_.write(b);
+}
+
+size_t HttpResponse::write(const uint8_t* buf, size_t size) {
+  MCU_DCHECK(headers_ended_);
+  if (omit_body()) {
+    return size;
+  } else if (chunked_) {
+    return chunked_writer_.write(buf, size);
+  }
+  return connection_.write(buf, size);
+}
+
+int HttpResponse::availableForWrite() {
+  if (chunked_ && !omit_body()) {
+    return chunked_writer_.availableForWrite();
+  }
+  return connection_.availableForWrite();
+}
+
+void HttpResponse::flush() {
+  if (chunked_ && !omit_body()) {
+    chunked_writer_.flush();
+  } else {
+    connection_.flush();
+  }
+}
+
+}  // namespace mcunet
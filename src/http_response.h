@@ -0,0 +1,180 @@
+#ifndef MCUNET_SRC_HTTP_RESPONSE_H_
+#define MCUNET_SRC_HTTP_RESPONSE_H_
+
+// HttpResponse is used by an HttpRequestHandler to write the response to a
+// request: first the status line and headers, then the body, which is written
+// using the Print methods of HttpResponse. The bytes are written directly to
+// the Connection (i.e. to a WriteBufferedConnection when used by HttpServer),
+// so there is no need to buffer the response in RAM.
+//
+// HttpResponse takes care of the framing of the response: the handler either
+// calls set_content_length before EndHeaders, or the body is sent using the
+// chunked transfer coding (see HttpChunkedWriter), so that the connection can
+// still be kept alive for another request. HTTP/1.0 clients don't understand
+// chunked, so for them the connection is closed after the body to mark its
+// end. HttpResponse also omits the body of responses to HEAD requests.
+//
+// A generated body (e.g. JSON) can be sent with a Content-Length, without
+// buffering it, using EndHeadersWithBody: the body is printed twice, first to
+// measure it, and then to send it.
+//
+// Clients that poll for a resource can avoid receiving it again if it hasn't
+// changed, by sending the entity tag (ETag) of the copy they have in an
+// If-None-Match header. A handler supports this either by calling
+// SendNotModifiedIfMatch with a cheap version number of the resource before
+// generating the body, or by using SendOkWithETag, which uses a hash of the
+// body (computed while measuring it) as the ETag.
+//
+// Author: james.synge@gmail.com
+
+#include <McuCore.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "connection.h"
+#include "http_chunked_writer.h"
+#include "http_request.h"
+
+namespace mcunet {
+
+enum class HttpStatusCode : uint16_t {
+  kSwitchingProtocols = 101,
+  kOk = 200,
+  kNoContent = 204,
+  kNotModified = 304,
+  kBadRequest = 400,
+  kNotFound = 404,
+  kMethodNotAllowed = 405,
+  kNotAcceptable = 406,
+  kRequestTimeout = 408,
+  kPayloadTooLarge = 413,
+  kUriTooLong = 414,
+  kUpgradeRequired = 426,
+  kRequestHeaderFieldsTooLarge = 431,
+  kInternalServerError = 500,
+  kNotImplemented = 501,
+  kHttpVersionNotSupported = 505,
+};
+
+// Returns the reason phrase for the status code (e.g. "Not Found").
+mcucore::ProgmemStringView HttpReasonPhrase(HttpStatusCode status_code);
+
+class HttpResponse : public Print {
+ public:
+  // If omit_body is true (i.e. for a HEAD request), writes of the body are
+  // discarded (but still counted as written). If close_connection is true, the
+  // response will tell the client that the connection will be closed after
+  // the response.
+  HttpResponse(Connection& connection, bool omit_body, bool close_connection);
+
+  // Records the request being responded to, which determines the framing that
+  // the client understands, and provides the conditions (i.e. If-None-Match)
+  // used by SendNotModifiedIfMatch and SendOkWithETag. If not called, the
+  // client is assumed to use HTTP/1.1 and to send no conditions. For an
+  // HTTP/1.0 client, EndHeaders writes "Connection: keep-alive" if the
+  // connection isn't to be closed, as such clients don't otherwise assume it.
+  void set_request(const HttpRequest& request) { request_ = &request; }
+
+  // Records the entity tag of the response's body, which EndHeaders writes as
+  // the ETag header.
+  void set_etag(uint32_t etag);
+
+  // If the request's If-None-Match header matches etag (e.g. a version number
+  // that is changed whenever the resource changes), sends a 304 Not Modified
+  // response and returns true, in which case the handler should return
+  // without generating the body. Otherwise calls set_etag(etag) and returns
+  // false, in which case the handler should continue with StartHeaders.
+  bool SendNotModifiedIfMatch(uint32_t etag);
+
+  // Prints body once to determine its length and its hash, which is used as the
+  // ETag. If the request's If-None-Match header matches, sends 304 Not
+  // Modified. Otherwise sends a 200 OK response with the ETag and the body (see
+  // EndHeadersWithBody), whose Content-Type is content_type. Use instead of
+  // StartHeaders.
+  void SendOkWithETag(const mcucore::ProgmemStringView& content_type,
+                      const Printable& body);
+
+  // Writes the status line. Must be called exactly once, before any of the
+  // other methods below. The body of a 204 No Content or 304 Not Modified
+  // response is omitted, as is its framing.
+  void StartHeaders(HttpStatusCode status_code);
+
+  // Writes a header. May be called multiple times between StartHeaders and
+  // EndHeaders. Framing headers (Content-Length and Connection) and ETag are
+  // written by HttpResponse, so should not be added this way.
+  void AddHeader(const mcucore::ProgmemStringView& name,
+                 const mcucore::ProgmemStringView& value);
+
+  // Records the length of the body, which will be written as the
+  // Content-Length header by EndHeaders. If not called, the body will be
+  // chunked, or the connection closed after the response.
+  void set_content_length(uint32_t content_length);
+
+  // Writes the framing headers and the blank line that ends the headers. After
+  // this the body (if any) may be written.
+  void EndHeaders();
+
+  // Prints body once to determine its length, writes the framing headers (i.e.
+  // as EndHeaders does), and then prints body again to send it. body.printTo
+  // MUST produce the same output each time; if the second pass differs in
+  // length or content, the excess (if any) is discarded and the connection is
+  // marked for closing, as the client can't then tell where the response ends
+  // or has received a corrupt body. Must not be called with set_content_length
+  // or EndHeaders.
+  void EndHeadersWithBody(const Printable& body);
+
+  // Completes the body, i.e. writes the last chunk if the body is chunked.
+  // Called by HttpServer after the handler returns.
+  void EndResponse();
+
+  // Writes a response with no body, i.e. for an error.
+  void SendEmptyResponse(HttpStatusCode status_code);
+
+  // Print methods, for writing the body.
+  using Print::write;
+  size_t write(uint8_t b) override;
+  size_t write(const uint8_t* buf, size_t size) override;
+  int availableForWrite() override;
+  void flush() override;
+
+  // Returns true if StartHeaders has been called.
+  bool started() const { return started_; }
+
+  // Returns true if EndHeaders has been called.
+  bool headers_ended() const { return headers_ended_; }
+
+  // Returns true if the connection needs to be closed after the response.
+  bool close_connection() const { return close_connection_; }
+
+  // Returns true if the body is being sent with the chunked transfer coding.
+  bool chunked() const { return chunked_; }
+
+  Connection& connection() { return connection_; }
+
+ private:
+  // Returns true if writes of the body are to be discarded.
+  bool omit_body() const { return omit_body_ || bodyless_status_; }
+
+  // Sets the content length to size, ends the headers, and prints body,
+  // verifying that it produces size bytes with the given checksum.
+  void SendMeasuredBody(const Printable& body, uint32_t size,
+                        uint32_t checksum);
+
+  Connection& connection_;
+  const HttpRequest* request_;
+  uint32_t content_length_;
+  uint32_t etag_;
+  const bool omit_body_;
+  bool bodyless_status_;
+  bool has_etag_;
+  bool close_connection_;
+  bool has_content_length_;
+  bool started_;
+  bool headers_ended_;
+  bool chunked_;
+  HttpChunkedWriter chunked_writer_;
+};
+
+}  // namespace mcunet
+
+#endif  // MCUNET_SRC_HTTP_RESPONSE_H_
@@ -0,0 +1,62 @@
+#include "http_router.h"
+
+#include <McuCore.h>
+
+namespace mcunet {
+
+uint32_t HttpPathHash(const mcucore::StringView& path) {
+  uint32_t hash = 2166136261UL;
+  const char* const end = path.data() + path.size();
+  for (const char* ptr = path.data(); ptr < end; ++ptr) {
+    hash = (hash ^ static_cast<uint8_t>(*ptr)) * 16777619UL;
+  }
+  return hash;
+}
+
+HttpStatusCode HttpRouter::Match(const HttpRequest& request,
+                                 uint8_t& route_id) const {
+  const mcucore::StringView path = request.path();
+  const uint32_t hash = HttpPathHash(path);
+  const uint16_t bucket = internal::HttpRouteBucket(hash, bucket_mask_);
+  const uint8_t begin = pgm_read_byte(buckets_ + bucket);
+  const uint8_t end = pgm_read_byte(buckets_ + bucket + 1);
+  // The route indices follow the bucket_mask_ + 2 offsets.
+  const uint8_t* const indices = buckets_ + bucket_mask_ + 2;
+  bool path_matched = false;
+  bool get_matched = false;
+  uint8_t get_route_id = 0;
+  for (uint8_t offset = begin; offset < end; ++offset) {
+    const uint8_t ndx = pgm_read_byte(indices + offset);
+    uint32_t path_hash;
+    memcpy_P(&path_hash, &routes_[ndx].path_hash, sizeof path_hash);
+    if (path_hash != hash) {
+      continue;
+    }
+    HttpRoute route;
+    memcpy_P(&route, &routes_[ndx], sizeof route);
+    if (!path_matched) {
+      // The hash is perfect for the table, so this is the only path that can
+      // match; if it doesn't, the request's path merely has the same hash.
+      if (!(path ==
+            mcucore::ProgmemStringView(route.path, route.path_size))) {
+        return HttpStatusCode::kNotFound;
+      }
+      path_matched = true;
+    }
+    if (route.method == request.method) {
+      route_id = route.id;
+      return HttpStatusCode::kOk;
+    } else if (route.method == HttpMethod::kGet) {
+      get_matched = true;
+      get_route_id = route.id;
+    }
+  }
+  if (get_matched && request.method == HttpMethod::kHead) {
+    route_id = get_route_id;
+    return HttpStatusCode::kOk;
+  }
+  return path_matched ? HttpStatusCode::kMethodNotAllowed
+                      : HttpStatusCode::kNotFound;
+}
+
+}  // namespace mcunet
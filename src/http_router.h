@@ -0,0 +1,254 @@
+#ifndef MCUNET_SRC_HTTP_ROUTER_H_
+#define MCUNET_SRC_HTTP_ROUTER_H_
+
+// HttpRouter maps the method and path of a request to the id of a route, using
+// a table of routes built at compile time and stored in PROGMEM. Each route
+// records a hash of its path, computed by the compiler. HttpRoutesAreValid
+// verifies at compile time that the hash is perfect for the table (i.e.
+// distinct paths have distinct hashes), so a matching hash identifies the only
+// candidate path, which is then compared with the request's path to confirm
+// the match.
+//
+// MakeHttpRouteBuckets groups the routes into buckets selected by the hash,
+// also at compile time, with at least twice as many buckets as routes. So
+// dispatching a request requires hashing its path once (i.e. O(path length)),
+// reading the bounds of one bucket, comparing the 4-byte hashes of the routes
+// in that bucket (usually at most one path), and comparing the path once,
+// rather than comparing the path with the path of each route (e.g. with
+// strcmp_P).
+//
+// Example:
+//
+//   constexpr char kStatusPath[] PROGMEM = "/api/status";
+//   constexpr char kConfigPath[] PROGMEM = "/api/config";
+//   enum RouteId : uint8_t { kGetStatus, kGetConfig, kPutConfig };
+//   constexpr HttpRoute kRoutes[] PROGMEM = {
+//       MakeHttpRoute(HttpMethod::kGet, kStatusPath, kGetStatus),
+//       MakeHttpRoute(HttpMethod::kGet, kConfigPath, kGetConfig),
+//       MakeHttpRoute(HttpMethod::kPut, kConfigPath, kPutConfig),
+//   };
+//   static_assert(HttpRoutesAreValid(kRoutes), "Conflicting routes");
+//   constexpr auto kRouteBuckets PROGMEM = MakeHttpRouteBuckets(kRoutes);
+//   constexpr HttpRouter kRouter(kRoutes, kRouteBuckets);
+//
+// The paths must be stored in named PROGMEM arrays, as above, so that the
+// compiler can hash them while the table refers to them in flash.
+//
+// Author: james.synge@gmail.com
+
+#include <McuCore.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "http_request.h"
+#include "http_response.h"
+
+namespace mcunet {
+
+// The 32-bit FNV-1a hash of the path, which is NUL terminated.
+constexpr uint32_t HttpPathHash(const char* path,
+                                uint32_t hash = 2166136261UL) {
+  return *path == 0 ? hash
+                    : HttpPathHash(path + 1,
+                                   (hash ^ static_cast<uint8_t>(*path)) *
+                                       16777619UL);
+}
+
+// The same hash, computed at runtime for a path that isn't NUL terminated.
+uint32_t HttpPathHash(const mcucore::StringView& path);
+
+namespace internal {
+
+constexpr uint8_t HttpPathLength(const char* path) {
+  return *path == 0 ? 0 : 1 + HttpPathLength(path + 1);
+}
+
+}  // namespace internal
+
+struct HttpRoute {
+  uint32_t path_hash;
+  // NUL terminated, and in PROGMEM on AVR.
+  const char* path;
+  uint8_t path_size;
+  HttpMethod method;
+  // Chosen by the caller, and returned by HttpRouter::Match.
+  uint8_t id;
+};
+
+constexpr HttpRoute MakeHttpRoute(HttpMethod method, const char* path,
+                                  uint8_t id) {
+  return HttpRoute{HttpPathHash(path), path, internal::HttpPathLength(path),
+                   method, id};
+}
+
+namespace internal {
+
+constexpr bool HttpPathsEqual(const char* a, const char* b) {
+  return *a == *b && (*a == 0 || HttpPathsEqual(a + 1, b + 1));
+}
+
+// Returns true if a and b can't be told apart; i.e. distinct paths with the
+// same hash, or the same path and method.
+constexpr bool HttpRoutesConflict(const HttpRoute& a, const HttpRoute& b) {
+  return a.path_hash == b.path_hash &&
+         (!HttpPathsEqual(a.path, b.path) || a.method == b.method);
+}
+
+constexpr bool HttpRouteConflictsWithAny(const HttpRoute& route,
+                                         const HttpRoute* routes, size_t num) {
+  return num > 0 && (HttpRoutesConflict(route, routes[0]) ||
+                     HttpRouteConflictsWithAny(route, routes + 1, num - 1));
+}
+
+constexpr bool AnyHttpRoutesConflict(const HttpRoute* routes, size_t num) {
+  return num > 1 &&
+         (HttpRouteConflictsWithAny(routes[0], routes + 1, num - 1) ||
+          AnyHttpRoutesConflict(routes + 1, num - 1));
+}
+
+}  // namespace internal
+
+// Returns true if no two routes conflict. Intended for use in a static_assert.
+template <size_t N>
+constexpr bool HttpRoutesAreValid(const HttpRoute (&routes)[N]) {
+  return N <= 255 && !internal::AnyHttpRoutesConflict(routes, N);
+}
+
+namespace internal {
+
+template <size_t... I>
+struct IndexSequence {};
+
+template <size_t N, size_t... I>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...> {};
+
+template <size_t... I>
+struct MakeIndexSequence<0, I...> : IndexSequence<I...> {};
+
+// Returns the number of buckets for num_routes routes, the smallest power of
+// two that is at least twice num_routes, so that few buckets hold two paths.
+constexpr size_t HttpRouteBucketCount(size_t num_routes, size_t count = 2) {
+  return count >= 2 * num_routes ? count
+                                 : HttpRouteBucketCount(num_routes, 2 * count);
+}
+
+// Returns the bucket of a path with the hash, where mask is the number of
+// buckets minus one. The high bits are folded in because the low bits of an
+// FNV-1a hash depend only on the low bits of the bytes of the path.
+constexpr uint16_t HttpRouteBucket(uint32_t path_hash, uint16_t mask) {
+  return static_cast<uint16_t>((path_hash ^ (path_hash >> 16)) & mask);
+}
+
+// Returns the number of routes in routes[begin, end) that come before position
+// (bucket, index) when the routes are ordered by bucket, then by index. The
+// range is halved, rather than reduced by one, to limit the recursion depth.
+constexpr size_t CountHttpRoutesBefore(const HttpRoute* routes, size_t begin,
+                                       size_t end, uint16_t mask,
+                                       uint16_t bucket, size_t index) {
+  return end - begin == 1
+             ? (HttpRouteBucket(routes[begin].path_hash, mask) < bucket ||
+                        (HttpRouteBucket(routes[begin].path_hash, mask) ==
+                             bucket &&
+                         begin < index)
+                    ? 1
+                    : 0)
+             : CountHttpRoutesBefore(routes, begin, (begin + end) / 2, mask,
+                                     bucket, index) +
+                   CountHttpRoutesBefore(routes, (begin + end) / 2, end, mask,
+                                         bucket, index);
+}
+
+// Returns the index of the route in routes[begin, end) that is at position pos
+// when all num routes are ordered by bucket, then by index; returns num if
+// there is no such route in the range.
+constexpr size_t FindHttpRouteAt(const HttpRoute* routes, size_t num,
+                                 size_t begin, size_t end, uint16_t mask,
+                                 size_t pos) {
+  return end - begin == 1
+             ? (CountHttpRoutesBefore(
+                    routes, 0, num, mask,
+                    HttpRouteBucket(routes[begin].path_hash, mask),
+                    begin) == pos
+                    ? begin
+                    : num)
+             : (FindHttpRouteAt(routes, num, begin, (begin + end) / 2, mask,
+                                pos) != num
+                    ? FindHttpRouteAt(routes, num, begin, (begin + end) / 2,
+                                      mask, pos)
+                    : FindHttpRouteAt(routes, num, (begin + end) / 2, end,
+                                      mask, pos));
+}
+
+// Returns entry ndx of HttpRouteBuckets::entries.
+constexpr uint8_t HttpRouteBucketsEntry(const HttpRoute* routes, size_t num,
+                                        uint16_t mask, size_t ndx) {
+  return static_cast<uint8_t>(
+      ndx <= mask + 1u
+          ? CountHttpRoutesBefore(routes, 0, num, mask,
+                                  static_cast<uint16_t>(ndx), 0)
+          : FindHttpRouteAt(routes, num, 0, num, mask, ndx - mask - 2));
+}
+
+}  // namespace internal
+
+// The routes of a table grouped by bucket, stored in PROGMEM alongside the
+// table. Created by MakeHttpRouteBuckets.
+template <size_t N>
+struct HttpRouteBuckets {
+  static constexpr size_t kNumBuckets = internal::HttpRouteBucketCount(N);
+
+  // The first kNumBuckets + 1 entries are offsets into the remaining N entries,
+  // which are the indices of the routes, ordered by bucket, then by index. The
+  // routes in bucket b are those whose indices are at offsets entries[b] up to
+  // (but not including) entries[b + 1].
+  uint8_t entries[kNumBuckets + 1 + N];
+};
+
+namespace internal {
+
+template <size_t N, size_t... I>
+constexpr HttpRouteBuckets<N> MakeHttpRouteBuckets(
+    const HttpRoute (&routes)[N], IndexSequence<I...>) {
+  return HttpRouteBuckets<N>{{HttpRouteBucketsEntry(
+      routes, N, HttpRouteBuckets<N>::kNumBuckets - 1, I)...}};
+}
+
+}  // namespace internal
+
+template <size_t N>
+constexpr HttpRouteBuckets<N> MakeHttpRouteBuckets(
+    const HttpRoute (&routes)[N]) {
+  static_assert(N <= 255, "Route indices are stored in a byte");
+  return internal::MakeHttpRouteBuckets(
+      routes, internal::MakeIndexSequence<HttpRouteBuckets<N>::kNumBuckets +
+                                          1 + N>());
+}
+
+class HttpRouter {
+ public:
+  // routes and buckets must be in PROGMEM, and buckets must have been made by
+  // MakeHttpRouteBuckets(routes).
+  template <size_t N>
+  constexpr HttpRouter(const HttpRoute (&routes)[N],
+                       const HttpRouteBuckets<N>& buckets)
+      : routes_(routes),
+        buckets_(buckets.entries),
+        bucket_mask_(HttpRouteBuckets<N>::kNumBuckets - 1) {
+    static_assert(N <= 255, "Route indices are stored in a byte");
+  }
+
+  // Finds the route for the method and path (i.e. excluding any query) of the
+  // request. If found, sets route_id and returns kOk. A HEAD request matches a
+  // GET route unless the path has a HEAD route. Returns kMethodNotAllowed if
+  // the path has routes, but not for the method, else returns kNotFound.
+  HttpStatusCode Match(const HttpRequest& request, uint8_t& route_id) const;
+
+ private:
+  const HttpRoute* const routes_;
+  const uint8_t* const buckets_;
+  const uint16_t bucket_mask_;
+};
+
+}  // namespace mcunet
+
+#endif  // MCUNET_SRC_HTTP_ROUTER_H_
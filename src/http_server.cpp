@@ -0,0 +1,177 @@
+#include "http_server.h"
+
+#include <McuCore.h>
+
+namespace mcunet {
+namespace {
+
+// Amount of stack space to allocate for reading from the connection. Each read
+// is an SPI transaction, so we don't want this to be tiny, but it needs to fit
+// on the stack alongside the write buffer of TcpServerConnection.
+constexpr uint8_t kReadBufferSize = 64;
+
+}  // namespace
+
+HttpServer::HttpServer(uint16_t tcp_port, HttpRequestHandler& handler)
+    : server_socket_(tcp_port, *this),
+      handler_(handler),
+      websocket_(nullptr),
+      body_remaining_(0),
+      last_activity_millis_(0),
+      idle_timeout_millis_(kIdleTimeoutMillis),
+      requests_on_connection_(0) {}
+
+HttpServer::HttpServer(uint16_t tcp_port, HttpRequestHandler& handler,
+                       WebSocket& websocket)
+    : server_socket_(tcp_port, *this),
+      handler_(handler),
+      websocket_(&websocket),
+      body_remaining_(0),
+      last_activity_millis_(0),
+      idle_timeout_millis_(kIdleTimeoutMillis),
+      requests_on_connection_(0) {}
+
+void HttpServer::OnConnect(Connection& connection) {
+  MCU_VLOG(2) << MCU_PSD("HttpServer::OnConnect socket ")
+              << connection.sock_num();
+  parser_.Reset();
+  body_remaining_ = 0;
+  requests_on_connection_ = 0;
+  last_activity_millis_ = millis();
+  if (websocket_ != nullptr) {
+    // In case we missed the end of the previous connection.
+    websocket_->OnDisconnect();
+  }
+  // The request may have arrived along with the connection.
+  OnCanRead(connection);
+}
+
+void HttpServer::OnCanRead(Connection& connection) {
+  if (!websocket_connected()) {
+    ReadRequests(connection);
+  }
+  // Not an else, as the connection may have just been upgraded, in which case
+  // the WebSocket reads the rest of the input, and sends any message queued by
+  // its handler when it opened.
+  if (websocket_connected()) {
+    websocket_->OnCanRead(connection);
+  }
+}
+
+void HttpServer::ReadRequests(Connection& connection) {
+  uint8_t buffer[kReadBufferSize];
+  while (true) {
+    const int size = connection.read(buffer, sizeof buffer);
+    if (size < 0) {
+      // No more data available right now.
+      if (mcucore::ElapsedMillis(last_activity_millis_) >=
+          idle_timeout_millis_) {
+        HandleIdleTimeout(connection);
+      }
+      return;
+    } else if (size == 0) {
+      // The client has half-closed the connection; ServerSocket will close it
+      // once we've read everything.
+      return;
+    }
+    last_activity_millis_ = millis();
+    if (!ProcessInput(connection, buffer, static_cast<size_t>(size)) ||
+        websocket_connected()) {
+      return;
+    }
+  }
+}
+
+void HttpServer::OnDisconnect() {
+  MCU_VLOG(2) << MCU_PSD("HttpServer::OnDisconnect");
+  parser_.Reset();
+  body_remaining_ = 0;
+  if (websocket_ != nullptr) {
+    websocket_->OnDisconnect();
+  }
+}
+
+bool HttpServer::ProcessInput(Connection& connection, uint8_t* data,
+                              size_t size) {
+  while (size > 0) {
+    if (body_remaining_ > 0) {
+      const size_t skip =
+          body_remaining_ < size ? static_cast<size_t>(body_remaining_) : size;
+      body_remaining_ -= skip;
+      data += skip;
+      size -= skip;
+      continue;
+    }
+    size_t consumed;
+    const auto result = parser_.Parse(data, size, consumed);
+    data += consumed;
+    size -= consumed;
+    if (result == HttpRequestParser::Result::kError) {
+      HandleParseError(connection);
+      return false;
+    } else if (result == HttpRequestParser::Result::kComplete) {
+      // Any remaining data is the body of this request, and/or the start of
+      // the next (pipelined) request.
+      if (!HandleRequest(connection)) {
+        return false;
+      } else if (websocket_connected()) {
+        // Any remaining data consists of WebSocket frames.
+        return websocket_->ProcessInput(connection, data, size);
+      }
+    }
+  }
+  return true;
+}
+
+bool HttpServer::HandleRequest(Connection& connection) {
+  const HttpRequest& request = parser_.request();
+  MCU_VLOG(2) << MCU_PSD("HttpServer::HandleRequest ") << request.target;
+  ++requests_on_connection_;
+  const bool close_connection =
+      !request.KeepAlive() ||
+      requests_on_connection_ >= kMaxRequestsPerConnection;
+  if (websocket_ != nullptr && request.IsWebSocketUpgrade() &&
+      websocket_->Accept(request, connection)) {
+    parser_.Reset();
+    return true;
+  }
+  HttpResponse response(connection, request.method == HttpMethod::kHead,
+                        close_connection);
+  response.set_request(request);
+  handler_.HandleRequest(request, response);
+  if (!response.started()) {
+    response.SendEmptyResponse(HttpStatusCode::kNotFound);
+  } else if (!response.headers_ended()) {
+    response.EndHeaders();
+  }
+  response.EndResponse();
+  body_remaining_ = request.content_length;
+  parser_.Reset();
+  if (response.close_connection()) {
+    connection.close();
+    return false;
+  }
+  return true;
+}
+
+void HttpServer::HandleParseError(Connection& connection) {
+  HttpResponse response(connection, /*omit_body=*/false,
+                        /*close_connection=*/true);
+  response.SendEmptyResponse(parser_.error_status());
+  connection.close();
+  parser_.Reset();
+}
+
+void HttpServer::HandleIdleTimeout(Connection& connection) {
+  MCU_VLOG(2) << MCU_PSD("HttpServer::HandleIdleTimeout");
+  if (parser_.in_progress()) {
+    HttpResponse response(connection, /*omit_body=*/false,
+                          /*close_connection=*/true);
+    response.SendEmptyResponse(HttpStatusCode::kRequestTimeout);
+  }
+  connection.close();
+  parser_.Reset();
+  body_remaining_ = 0;
+}
+
+}  // namespace mcunet
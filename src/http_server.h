@@ -0,0 +1,133 @@
+#ifndef MCUNET_SRC_HTTP_SERVER_H_
+#define MCUNET_SRC_HTTP_SERVER_H_
+
+// HttpServer is a minimal HTTP/1.1 server layered on ServerSocket: it is the
+// ServerSocketListener for its own ServerSocket, parses requests arriving on
+// the connection using HttpRequestParser, and passes each complete request to
+// an HttpRequestHandler, which writes the response via an HttpResponse. All of
+// the per-connection state is in the HttpServer instance, so no memory is
+// allocated, and the response is streamed out through the
+// WriteBufferedConnection that ServerSocket provides.
+//
+// An HttpServer handles one connection at a time (i.e. it uses one hardware
+// socket); to handle more connections concurrently, create several HttpServer
+// instances for the same port and handler.
+//
+// Connections are persistent (kept alive) unless the client asks otherwise, so
+// that a client needn't pay for a new TCP connection per request. Requests that
+// a client pipelines (i.e. sends without waiting for the previous response) are
+// parsed from the data already received, and their responses are batched in
+// the write buffer. A connection is closed after
+// MCUNET_HTTP_MAX_REQUESTS_PER_CONNECTION requests, or when it has been idle
+// for MCUNET_HTTP_IDLE_TIMEOUT_MILLIS, so that a socket can't be held
+// indefinitely by one client.
+//
+// The request body (if any) is not passed to the handler; it is discarded.
+//
+// If constructed with a WebSocket, requests to upgrade the connection to the
+// WebSocket protocol are offered to the WebSocket's handler, and once one is
+// accepted, the rest of the connection is handled by the WebSocket.
+//
+// Author: james.synge@gmail.com
+
+#include <McuCore.h>
+#include <stdint.h>
+
+#include "connection.h"
+#include "http_request.h"
+#include "http_request_parser.h"
+#include "http_response.h"
+#include "mcunet_config.h"
+#include "server_socket.h"
+#include "socket_listener.h"
+#include "websocket.h"
+
+namespace mcunet {
+
+class HttpRequestHandler {
+ public:
+#if !MCU_EMBEDDED_TARGET
+  virtual ~HttpRequestHandler() = default;
+#endif
+
+  // Called when the request line and headers of a request have been received.
+  // Should write the complete response; if the handler doesn't start a
+  // response, a 404 Not Found response is sent.
+  virtual void HandleRequest(const HttpRequest& request,
+                             HttpResponse& response) = 0;
+};
+
+class HttpServer : public ServerSocketListener {
+ public:
+  static constexpr uint16_t kMaxRequestsPerConnection =
+      MCUNET_HTTP_MAX_REQUESTS_PER_CONNECTION;
+  static constexpr mcucore::MillisT kIdleTimeoutMillis =
+      MCUNET_HTTP_IDLE_TIMEOUT_MILLIS;
+
+  HttpServer(uint16_t tcp_port, HttpRequestHandler& handler);
+  HttpServer(uint16_t tcp_port, HttpRequestHandler& handler,
+             WebSocket& websocket);
+
+  // Finds a hardware socket on which to listen for connections. Returns true if
+  // successful.
+  bool PickClosedSocket() { return server_socket_.PickClosedSocket(); }
+
+  // Performs I/O on the connection, if there is one. Should be called from
+  // loop().
+  void PerformIO() { server_socket_.PerformIO(); }
+
+  ServerSocket& server_socket() { return server_socket_; }
+
+  // Overrides kIdleTimeoutMillis, e.g. for testing.
+  void set_idle_timeout_millis(mcucore::MillisT idle_timeout_millis) {
+    idle_timeout_millis_ = idle_timeout_millis;
+  }
+
+  // ServerSocketListener methods, called by server_socket_.
+  void OnConnect(Connection& connection) override;
+  void OnCanRead(Connection& connection) override;
+  void OnDisconnect() override;
+
+ private:
+  // Reads from the connection until there is no more data available, or the
+  // connection has been closed or upgraded to a WebSocket.
+  void ReadRequests(Connection& connection);
+
+  // Parses the data, discarding request bodies, and handles each request it
+  // completes. Returns false if the connection has been closed.
+  bool ProcessInput(Connection& connection, uint8_t* data, size_t size);
+
+  // Passes the request to the handler (or to the WebSocket if the request is
+  // an upgrade that it accepts), then closes the connection if the client or
+  // the limit on requests per connection requires it, else prepares for the
+  // next request. Returns false if the connection has been closed.
+  bool HandleRequest(Connection& connection);
+
+  // Returns true if the connection has been upgraded to a WebSocket.
+  bool websocket_connected() const {
+    return websocket_ != nullptr && websocket_->is_connected();
+  }
+
+  // Closes the connection because it has been idle for too long; if the client
+  // was part way through sending a request, tells it why.
+  void HandleIdleTimeout(Connection& connection);
+
+  // Responds with the error status determined by the parser, and closes the
+  // connection.
+  void HandleParseError(Connection& connection);
+
+  ServerSocket server_socket_;
+  HttpRequestHandler& handler_;
+  WebSocket* const websocket_;
+  HttpRequestParser parser_;
+
+  // Number of bytes of the current request's body still to be discarded.
+  uint32_t body_remaining_;
+  mcucore::MillisT last_activity_millis_;
+  mcucore::MillisT idle_timeout_millis_;
+  uint16_t requests_on_connection_;
+};
+
+}  // namespace mcunet
+
+#endif  // MCUNET_SRC_HTTP_SERVER_H_
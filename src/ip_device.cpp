@@ -4,11 +4,6 @@
 // TODO(jamessynge): EthernetClass should use millis() and a static var to
 // decide whether it has been long enough since power-up or hard-reset so that
 // we can rely on the chip being ready to work.
-//
-// TODO(jamessynge): Add some means of testing whether there is an Ethernet
-// cable attached. In the not, or in the event that DHCP doesn't work, we may
-// want to keep trying to initialize the networking from the main loop, at least
-// until we see some traffic.
 
 #include "ip_device.h"
 
@@ -26,8 +21,6 @@ constexpr uint8_t kW5500ChipSelectPin = 10;
 constexpr uint8_t kW5500ResetPin = 7;
 constexpr uint8_t kSDcardSelectPin = 4;
 
-static ::DhcpClass dhcp;
-
 }  // namespace
 
 // static
@@ -64,21 +57,36 @@ void Mega2560Eth::SetupW5500(uint8_t max_sock_num) {
   MCU_VLOG(3) << MCU_PSD("SetupW5500 Exit");
 }
 
+IpDevice::IpDevice()
+    : eeprom_tlv_(nullptr),
+      saved_lease_(),
+      dhcp_client_(dhcp_udp_),
+      state_(State::kUninitialized),
+      has_link_(false),
+      last_link_check_millis_(0),
+      dhcp_stop_millis_(0),
+      dhcp_retry_millis_(0),
+      arp_prober_(arp_transport_),
+      arp_probe_pending_(false),
+      arp_retry_millis_(0),
+      address_conflicts_(0),
+      server_sockets_(),
+      num_server_sockets_(0) {}
+
 mcucore::Status IpDevice::InitializeNetworking(
     mcucore::EepromTlv& eeprom_tlv, const OuiPrefix* const oui_prefix) {
   // Load the addresses saved to EEPROM, if they were previously saved. If they
   // were not successfully loaded, then generate them and save them into the
   // EEPROM.
-  Addresses addresses;
-  auto status = addresses.ReadEepromEntry(eeprom_tlv, oui_prefix);
+  auto status = addresses_.ReadEepromEntry(eeprom_tlv, oui_prefix);
   if (!status.ok()) {
     MCU_VLOG(2) << MCU_PSD("Error loading network addresses: ") << status;
     MCU_VLOG(1) << MCU_PSD("Generating Ethernet and default IP addresses");
 
     // Need to generate a new address.
-    addresses.GenerateAddresses(oui_prefix);
+    addresses_.GenerateAddresses(oui_prefix);
 
-    status = addresses.WriteEepromEntry(eeprom_tlv);
+    status = addresses_.WriteEepromEntry(eeprom_tlv);
     MCU_DCHECK_OK(status) << MCU_PSD(
         "Failed to save generated network addresses");
     if (!status.ok()) {
@@ -87,71 +95,256 @@ mcucore::Status IpDevice::InitializeNetworking(
     }
   }
 
-  // If unable to get an address using DHCP, try again with a softReset
-  // between the two attempts.
-  Ethernet.setDhcp(&dhcp);
-  using_dhcp_ = Ethernet.begin(addresses.ethernet.bytes);
-  if (!using_dhcp_ && false) {
-    MCU_VLOG(1) << MCU_PSD("Failed to get an address using DHCP");
-    // TODO(jamessynge): First check whether there is an Ethernet cable
-    // attached; if not, then we don't benefit from a retry. Instead, we can
-    // check whether a cable is attached later in the main loop. This may
-    // require splitting TinyAlpacaServer::initialize into two parts: one for
-    // the networking hardware, repeated as necessary, and another (once only)
-    // for the Alpaca devices (but not the Alpaca network servers). OR just loop
-    // here indefinitely, waiting for the network cable to be attached.
-    Ethernet.softreset();
-    MCU_VLOG(1) << MCU_PSD("softreset complete");
-    using_dhcp_ = Ethernet.begin(addresses.ethernet.bytes);
-    if (!using_dhcp_) {
-      MCU_VLOG(1) << MCU_PSD("Failed to get an address using DHCP")
-                  << MCU_PSD(" after a soft reset.");
-    }
+  // Start with the link-local address, so that we can serve immediately,
+  // rather than waiting to learn whether there is a DHCP server.
+  UseLinkLocalAddress();
+
+  // Is there hardware? If there is, we should be able to read our MAC address
+  // back from the chip.
+  EthernetAddress mac;
+  Ethernet.macAddress(mac.bytes);
+  if (!(mac == addresses_.ethernet)) {
+    // Oops, this isn't the right board to run this sketch.
+    state_ = State::kUninitialized;
+    return mcucore::NotFoundError(MCU_PSV("Found no networking hardware"));
   }
 
-  if (!using_dhcp_) {
-    // Is there hardware? If there is, we should be able to read our MAC address
-    // back from the chip.
-    EthernetAddress mac;
-    Ethernet.macAddress(mac.bytes);
-    if (!(mac == addresses.ethernet)) {
-      // Oops, this isn't the right board to run this sketch.
-      return mcucore::NotFoundError(MCU_PSV("Found no networking hardware"));
+  // If we saved a lease before the reset, we'll ask to keep using that address.
+  eeprom_tlv_ = &eeprom_tlv;
+  status = saved_lease_.ReadEepromEntry(eeprom_tlv);
+  if (!status.ok()) {
+    MCU_VLOG(2) << MCU_PSD("No saved DHCP lease: ") << status;
+    saved_lease_ = DhcpLease();
+  }
+
+  // Start DHCP in the background if there is a cable attached; if not,
+  // MaintainDhcpLease will start it when the link comes up. Either way,
+  // MaintainDhcpLease will switch to the leased address when it arrives.
+  const uint32_t now = millis();
+  last_link_check_millis_ = now;
+  has_link_ = Ethernet.link() != 0;
+  dhcp_retry_millis_ = 0;
+  if (has_link_) {
+    // The MACRAW socket used for ARP probing must be socket 0, so it needs to
+    // be opened before the DHCP socket.
+    StartArpProbe(now);
+    StartDhcp(now);
+  } else {
+    mcucore::LogSink() << MCU_PSD("No Ethernet link");
+  }
+  return mcucore::OkStatus();
+}
+
+int IpDevice::MaintainDhcpLease() {
+  if (state_ == State::kUninitialized) {
+    return DHCP_CHECK_NONE;
+  }
+  const uint32_t now = millis();
+  if (now - last_link_check_millis_ >= kLinkCheckIntervalMillis) {
+    last_link_check_millis_ = now;
+    CheckLink();
+  }
+  if (arp_prober_.state() != ArpProber::State::kStopped) {
+    HandleArpProberEvent(arp_prober_.PerformIO(now));
+  } else if (arp_probe_pending_ &&
+             now - arp_retry_millis_ >= kArpProbeRetryMillis) {
+    StartArpProbe(now);
+  }
+  if (dhcp_client_.state() == DhcpClient::State::kStopped) {
+    if (has_link_ && now - dhcp_stop_millis_ >= dhcp_retry_millis_) {
+      StartDhcp(now);
     }
+    return DHCP_CHECK_NONE;
+  }
+  switch (dhcp_client_.PerformIO(now)) {
+    case DhcpClient::Event::kLeaseAcquired:
+      UseDhcpLease();
+      return DHCP_CHECK_REBIND_OK;
 
-    mcucore::LogSink() << MCU_PSD("No DHCP, using default IP ") << addresses.ip;
+    case DhcpClient::Event::kLeaseRenewed:
+      return DHCP_CHECK_RENEW_OK;
+
+    case DhcpClient::Event::kLeaseLost:
+      // The DhcpClient is already looking for a new lease; meanwhile, we
+      // return to the link-local address.
+      mcucore::LogSink() << MCU_PSD("Lost DHCP lease on ")
+                         << Ethernet.localIP();
+      UseLinkLocalAddress();
+      return DHCP_CHECK_REBIND_FAIL;
+
+    case DhcpClient::Event::kNone:
+      break;
+  }
+  return DHCP_CHECK_NONE;
+}
+
+void IpDevice::CheckLink() {
+  const bool has_link = Ethernet.link() != 0;
+  if (has_link == has_link_) {
+    return;
+  }
+  has_link_ = has_link;
+  if (has_link) {
+    // Start DHCP on the next call to MaintainDhcpLease.
+    mcucore::LogSink() << MCU_PSD("Ethernet link up");
+    dhcp_retry_millis_ = 0;
+    // There may be another host using our link-local address on the network
+    // we're now attached to.
+    StartArpProbe(millis());
+  } else {
+    // There is no point in sending DHCP messages without a link. We keep using
+    // the current address, and will ask to keep using it (if leased) when the
+    // link comes back up.
+    mcucore::LogSink() << MCU_PSD("Ethernet link down");
+    dhcp_client_.Stop();
+    arp_prober_.Stop();
+  }
+}
 
-    // No DHCP server responded with a lease on an IP address, so we'll fallback
-    // to using our randomly generated IP.
-    using_dhcp_ = false;
+void IpDevice::StartDhcp(const uint32_t now) {
+  // Note that the W5500 uses the current address (e.g. link-local) as the
+  // source of the DHCP broadcasts, rather than 0.0.0.0; DHCP servers reply
+  // based on the client's MAC address, so this doesn't matter in practice.
+  const DhcpLease* previous_lease =
+      state_ == State::kLeased ? &dhcp_client_.lease() : &saved_lease_;
+  if (dhcp_client_.Start(addresses_.ethernet, now, previous_lease)) {
+    return;
+  }
+  // Probably unable to get a socket; try again later, backing off so that we
+  // don't spend much time doing so if the sockets are all in use.
+  dhcp_stop_millis_ = now;
+  if (dhcp_retry_millis_ < kMinDhcpRetryMillis) {
+    dhcp_retry_millis_ = kMinDhcpRetryMillis;
+  } else if (dhcp_retry_millis_ < kMaxDhcpRetryMillis) {
+    dhcp_retry_millis_ *= 2;
+  }
+  MCU_VLOG(1) << MCU_PSD("Unable to start DHCP, will retry in ")
+              << dhcp_retry_millis_ << MCU_PSD("ms");
+}
 
-    // The link-local address range must not be divided into smaller subnets, so
-    // we set our subnet mask accordingly:
-    IPAddress subnet(255, 255, 0, 0);
+void IpDevice::StartArpProbe(const uint32_t now) {
+  if (state_ != State::kLinkLocal || !has_link_) {
+    arp_prober_.Stop();
+    arp_probe_pending_ = false;
+    return;
+  }
+  // RFC 3927 requires that, after many conflicts, we slow down the rate at
+  // which we try new addresses.
+  const uint32_t delay_millis =
+      address_conflicts_ >= ArpProber::kMaxConflicts
+          ? ArpProber::kRateLimitIntervalMillis
+          : 0;
+  if (arp_prober_.Start(addresses_.ethernet, addresses_.ip, now,
+                        delay_millis)) {
+    arp_probe_pending_ = false;
+    return;
+  }
+  // We're already using the address, so all we can do is keep trying to
+  // check for conflicts.
+  if (!arp_probe_pending_) {
+    mcucore::LogSink() << MCU_PSD("Unable to probe for conflicts with ")
+                       << addresses_.ip << MCU_PSD(", will retry");
+  }
+  arp_probe_pending_ = true;
+  arp_retry_millis_ = now;
+}
 
-    // Assume that the gateway is on the same subnet, at address 1 within the
-    // subnet. This code will work with many subnets, not just a /16.
-    IPAddress gateway = addresses.ip;
-    gateway[0] &= subnet[0];
-    gateway[1] &= subnet[1];
-    gateway[2] &= subnet[2];
-    gateway[3] &= subnet[3];
-    gateway[3] |= 1;
+void IpDevice::HandleArpProberEvent(const ArpProber::Event event) {
+  if (event == ArpProber::Event::kAddressClaimed) {
+    address_conflicts_ = 0;
+  } else if (event == ArpProber::Event::kConflict) {
+    // Another host is using our link-local address, so choose another, and
+    // save it so that we don't start with the conflicting address next time.
+    if (address_conflicts_ < 255) {
+      ++address_conflicts_;
+    }
+    mcucore::LogSink() << MCU_PSD("Another host is using ") << addresses_.ip;
+    addresses_.ip.GenerateAddress();
+    if (eeprom_tlv_ != nullptr) {
+      auto status = addresses_.WriteEepromEntry(*eeprom_tlv_);
+      if (!status.ok()) {
+        MCU_VLOG(1) << MCU_PSD("Failed to save network addresses: ")
+                    << status;
+      }
+    }
+    UseLinkLocalAddress();
+  }
+}
 
-    Ethernet.begin(addresses.ethernet.bytes, addresses.ip, subnet, gateway);
+bool IpDevice::AddServerSocket(ServerSocket& server_socket) {
+  if (num_server_sockets_ >= kMaxServerSockets) {
+    return false;
   }
+  server_sockets_[num_server_sockets_++] = &server_socket;
+  return true;
+}
 
-  return mcucore::OkStatus();
+void IpDevice::UseDhcpLease() {
+  const DhcpLease& lease = dhcp_client_.lease();
+  if (state_ == State::kLeased && lease.ip == Ethernet.localIP() &&
+      lease.subnet_mask == Ethernet.subnetMask() &&
+      lease.gateway == Ethernet.gatewayIP()) {
+    // Confirmed that we can keep using the current address (e.g. after the
+    // link was down), so there is no need to reinitialize the chip.
+    return;
+  }
+  mcucore::LogSink() << MCU_PSD("DHCP assigned IP ") << lease.ip;
+  Ethernet.begin(addresses_.ethernet.bytes, lease.ip, lease.dns_server,
+                 lease.gateway, lease.subnet_mask);
+  state_ = State::kLeased;
+  OnAddressChanged();
+  SaveDhcpLease();
 }
 
-int IpDevice::MaintainDhcpLease() {
-  // If we're using an IP address assigned via DHCP, renew the lease
-  // periodically. The Ethernet library will do so at the appropriate interval
-  // if we call it often enough.
-  if (using_dhcp_) {
-    return Ethernet.maintain();
+void IpDevice::SaveDhcpLease() {
+  // Avoid wearing out the EEPROM by writing only when the lease is from a
+  // different server or for a different address.
+  const DhcpLease& lease = dhcp_client_.lease();
+  if (eeprom_tlv_ == nullptr || (lease.ip == saved_lease_.ip &&
+                                 lease.server_id == saved_lease_.server_id)) {
+    return;
+  }
+  auto status = lease.WriteEepromEntry(*eeprom_tlv_);
+  if (status.ok()) {
+    saved_lease_ = lease;
   } else {
-    return DHCP_CHECK_NONE;
+    MCU_VLOG(1) << MCU_PSD("Failed to save DHCP lease: ") << status;
+  }
+}
+
+void IpDevice::UseLinkLocalAddress() {
+  mcucore::LogSink() << MCU_PSD("Using link-local IP ") << addresses_.ip;
+
+  // The link-local address range must not be divided into smaller subnets, so
+  // we set our subnet mask accordingly:
+  IPAddress subnet(255, 255, 0, 0);
+
+  // Assume that the gateway is on the same subnet, at address 1 within the
+  // subnet. This code will work with many subnets, not just a /16.
+  IPAddress gateway = addresses_.ip;
+  gateway[0] &= subnet[0];
+  gateway[1] &= subnet[1];
+  gateway[2] &= subnet[2];
+  gateway[3] &= subnet[3];
+  gateway[3] |= 1;
+
+  Ethernet.begin(addresses_.ethernet.bytes, addresses_.ip, subnet, gateway);
+  state_ = State::kLinkLocal;
+  OnAddressChanged();
+}
+
+void IpDevice::OnAddressChanged() {
+  // Ethernet.begin reinitializes the chip, closing all of the sockets,
+  // including those used for ARP probing and DHCP; the former must be reopened
+  // first, as it needs socket 0.
+  StartArpProbe(millis());
+  if (dhcp_client_.state() != DhcpClient::State::kStopped) {
+    dhcp_client_.ReopenSocket();
+  }
+  for (uint8_t ndx = 0; ndx < num_server_sockets_; ++ndx) {
+    if (server_sockets_[ndx]->HasSocket()) {
+      server_sockets_[ndx]->SocketLost();
+    }
   }
 }
 
@@ -8,8 +8,14 @@
 
 #include <McuCore.h>
 
+#include "addresses.h"
+#include "arp_prober.h"
+#include "dhcp_client.h"
+#include "dhcp_lease.h"
 #include "ethernet_address.h"
 #include "platform_network.h"
+#include "server_socket.h"
+#include "w5500_arp_transport.h"
 
 namespace mcunet {
 
@@ -23,9 +29,40 @@ struct Mega2560Eth {
 
 class IpDevice {
  public:
-  // Set the MAC address of the Ethernet chip and get a DHCP assigned IP address
-  // or use a "randomly" generated address. Returns false if unable to configure
-  // addresses or if there is no Ethernet hardware, else returns true.
+  // Maximum number of ServerSockets that can be registered with
+  // AddServerSocket; there can't be more ServerSockets than hardware sockets.
+  static constexpr uint8_t kMaxServerSockets = MAX_SOCK_NUM;
+
+  // How often MaintainDhcpLease checks whether the Ethernet cable is attached
+  // (i.e. whether the link is up).
+  static constexpr uint32_t kLinkCheckIntervalMillis = 500;
+
+  // Range of delays before retrying if unable to start DHCP.
+  static constexpr uint32_t kMinDhcpRetryMillis = 1000;
+  static constexpr uint32_t kMaxDhcpRetryMillis = 64000;
+  // Delay before retrying if unable to start probing for conflicts with our
+  // link-local address (i.e. because socket 0 is in use).
+  static constexpr uint32_t kArpProbeRetryMillis = 10000;
+
+  IpDevice();
+
+  // Set the MAC address of the Ethernet chip and configure it with the
+  // "randomly" generated link-local IP address, so that it is immediately
+  // usable, then start requesting an IP address using DHCP in the background.
+  // While using the link-local address, ArpProber checks (without blocking)
+  // that no other host is using the same address; if one is, a new link-local
+  // address is generated and saved in EEPROM.
+  // MaintainDhcpLease must be called (e.g. from loop()) to advance DHCP; when a
+  // lease is granted, the chip is switched to the leased address. DHCP is only
+  // attempted while the Ethernet link is up (i.e. a cable is attached to an
+  // active network), so there is no delay if there is no cable. Returns an
+  // error if unable to configure addresses or if there is no Ethernet hardware,
+  // else returns OK.
+  //
+  // The address of the most recent DHCP lease is saved in eeprom_tlv, so that
+  // after a reset we can ask the DHCP server to confirm that we may continue
+  // using it, which is quicker than discovering a new lease. Therefore
+  // eeprom_tlv must remain valid while MaintainDhcpLease is being called.
   //
   // If it is necessary to generate an Ethernet (MAC) address, the Arduino
   // random number library is used, so be sure to seed it according to the level
@@ -41,14 +78,94 @@ class IpDevice {
   mcucore::Status InitializeNetworking(mcucore::EepromTlv& eeprom_tlv,
                                        const OuiPrefix* oui_prefix = nullptr);
 
-  // Ensures that the DHCP lease (if there is one) is maintained. Returns a
-  // DHCP_CHECK_* value; definitions in Ethernet5500's Dhcp.h.
+  // Advances the acquisition of a DHCP lease, and ensures that the lease (if
+  // there is one) is maintained; should be called frequently (e.g. from
+  // loop()). Also checks periodically whether the link is up, pausing DHCP
+  // while it is down, and resuming it when the link comes back up. Returns a
+  // DHCP_CHECK_* value (definitions in Ethernet5500's Dhcp.h):
+  // DHCP_CHECK_REBIND_OK when the leased address has been applied,
+  // DHCP_CHECK_RENEW_OK when the lease has been renewed, DHCP_CHECK_REBIND_FAIL
+  // when the lease has been lost (and the link-local address restored), else
+  // DHCP_CHECK_NONE.
   int MaintainDhcpLease();
 
+  // Registers a ServerSocket to be notified (via SocketLost) when the IP
+  // address changes, which closes all hardware sockets. The ServerSocket will
+  // then need to pick a socket again (i.e. PickClosedSocket) in order to
+  // listen on the new address. Returns false if kMaxServerSockets are already
+  // registered.
+  bool AddServerSocket(ServerSocket& server_socket);
+
+  // Returns true once an IP address (leased or link-local) has been applied to
+  // the Ethernet chip.
+  bool HasIpAddress() const {
+    return state_ == State::kLeased || state_ == State::kLinkLocal;
+  }
+
+  // Returns true if the IP address is from a DHCP lease.
+  bool HasDhcpLease() const { return state_ == State::kLeased; }
+
+  // Returns true if the Ethernet link was up when last checked.
+  bool HasLink() const { return has_link_; }
+
   static void PrintNetworkAddresses();
 
  private:
-  bool using_dhcp_{false};
+  enum class State : uint8_t {
+    kUninitialized,
+    kLinkLocal,
+    kLeased,
+  };
+
+  // Polls the link state, stopping DHCP if the link has gone down.
+  void CheckLink();
+
+  // Starts probing for other users of the link-local address, if using it and
+  // the link is up; else stops probing. If unable to start, schedules a retry.
+  void StartArpProbe(uint32_t now);
+
+  // Handles the result of ArpProber::PerformIO, choosing a new link-local
+  // address if there is a conflict.
+  void HandleArpProberEvent(ArpProber::Event event);
+
+  // Starts DHCP, asking to keep using the current or saved lease, if there is
+  // one. If unable to start, schedules a retry.
+  void StartDhcp(uint32_t now);
+
+  // Configures the chip with the addresses from the DHCP lease.
+  void UseDhcpLease();
+
+  // Configures the chip with the link-local address in addresses_.
+  void UseLinkLocalAddress();
+
+  // Called after the chip has been configured with a new address, which closes
+  // all of the hardware sockets.
+  void OnAddressChanged();
+
+  // Saves the address of the new lease, if different from that saved earlier.
+  void SaveDhcpLease();
+
+  Addresses addresses_;
+  mcucore::EepromTlv* eeprom_tlv_;
+  DhcpLease saved_lease_;
+  EthernetUDP dhcp_udp_;
+  DhcpClient dhcp_client_;
+  State state_;
+  bool has_link_;
+  uint32_t last_link_check_millis_;
+  // When DHCP was last unable to start, and how long to wait before retrying.
+  uint32_t dhcp_stop_millis_;
+  uint32_t dhcp_retry_millis_;
+  W5500ArpTransport arp_transport_;
+  ArpProber arp_prober_;
+  // True if probing is needed but couldn't be started; it is retried
+  // kArpProbeRetryMillis after the last attempt, at arp_retry_millis_.
+  bool arp_probe_pending_;
+  uint32_t arp_retry_millis_;
+  // Number of conflicts since a link-local address was last claimed.
+  uint8_t address_conflicts_;
+  ServerSocket* server_sockets_[kMaxServerSockets];
+  uint8_t num_server_sockets_;
 };
 
 }  // namespace mcunet
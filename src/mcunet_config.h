@@ -13,4 +13,102 @@
 #endif  // MCU_HOST_TARGET
 #endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
 
+// If MCUNET_ENABLE_PNAPI_COUNTERS is 1, the methods of PlatformNetwork count
+// their calls, the time spent in them, and the bytes sent and received, in a
+// table in RAM (see pnapi_counters.h). Off by default because of the RAM and
+// the calls to micros() it costs.
+#ifndef MCUNET_ENABLE_PNAPI_COUNTERS
+#define MCUNET_ENABLE_PNAPI_COUNTERS 0
+#endif  // MCUNET_ENABLE_PNAPI_COUNTERS
+
+// The maximum length of the request-target (e.g. "/path?query") that
+// HttpRequestParser will accept; longer targets are rejected with status 414.
+// Each HttpServer reserves this much RAM for the target.
+#ifndef MCUNET_HTTP_MAX_TARGET_LENGTH
+#define MCUNET_HTTP_MAX_TARGET_LENGTH 64
+#endif  // MCUNET_HTTP_MAX_TARGET_LENGTH
+
+// The maximum length of the name or value of a header that HttpRequestParser
+// needs to examine (i.e. one that it recognizes); other headers are skipped,
+// regardless of their length.
+#ifndef MCUNET_HTTP_MAX_HEADER_TOKEN_LENGTH
+#define MCUNET_HTTP_MAX_HEADER_TOKEN_LENGTH 32
+#endif  // MCUNET_HTTP_MAX_HEADER_TOKEN_LENGTH
+
+// The maximum number of entity tags from the If-None-Match header of a request
+// that HttpRequestParser records; later tags are ignored, so the response is
+// then sent in full rather than as 304 Not Modified. A cache may hold several
+// representations of a resource (e.g. gzipped or not), and list the tag of
+// each. Costs 4 bytes of RAM each.
+#ifndef MCUNET_HTTP_MAX_IF_NONE_MATCH_ETAGS
+#define MCUNET_HTTP_MAX_IF_NONE_MATCH_ETAGS 4
+#endif  // MCUNET_HTTP_MAX_IF_NONE_MATCH_ETAGS
+
+// The maximum number of requests that HttpServer will handle on a single
+// connection before closing it, so that one client can't monopolize a socket.
+#ifndef MCUNET_HTTP_MAX_REQUESTS_PER_CONNECTION
+#define MCUNET_HTTP_MAX_REQUESTS_PER_CONNECTION 100
+#endif  // MCUNET_HTTP_MAX_REQUESTS_PER_CONNECTION
+
+// How long HttpServer waits for (more of) a request on a connection before
+// closing it. Frees the socket when a client keeps a connection open but
+// doesn't use it.
+#ifndef MCUNET_HTTP_IDLE_TIMEOUT_MILLIS
+#define MCUNET_HTTP_IDLE_TIMEOUT_MILLIS 5000
+#endif  // MCUNET_HTTP_IDLE_TIMEOUT_MILLIS
+
+// The size of the stack buffer through which HttpAssetHandler copies an asset
+// from flash to the connection. Ideally no larger than the write buffer of the
+// connection, so that each copy is sent in at most one packet.
+#ifndef MCUNET_HTTP_ASSET_COPY_SIZE
+#define MCUNET_HTTP_ASSET_COPY_SIZE 64
+#endif  // MCUNET_HTTP_ASSET_COPY_SIZE
+
+// The size of the buffer in which a WebSocket holds a message queued for
+// sending to the client (e.g. by WebSocketBroadcaster), until the next call to
+// PerformIO. Limits the size of such messages.
+#ifndef MCUNET_WEBSOCKET_OUTBOX_SIZE
+#define MCUNET_WEBSOCKET_OUTBOX_SIZE 64
+#endif  // MCUNET_WEBSOCKET_OUTBOX_SIZE
+
+// How long a WebSocket waits without hearing from the client before sending it
+// a Ping, to check that it is still there (and to keep NAT mappings alive).
+#ifndef MCUNET_WEBSOCKET_PING_INTERVAL_MILLIS
+#define MCUNET_WEBSOCKET_PING_INTERVAL_MILLIS 20000
+#endif  // MCUNET_WEBSOCKET_PING_INTERVAL_MILLIS
+
+// How long a WebSocket waits for a response to a Ping (or to a Close frame)
+// before closing the connection.
+#ifndef MCUNET_WEBSOCKET_PONG_TIMEOUT_MILLIS
+#define MCUNET_WEBSOCKET_PONG_TIMEOUT_MILLIS 10000
+#endif  // MCUNET_WEBSOCKET_PONG_TIMEOUT_MILLIS
+
+// The largest payload of a framed message that FramedMessageReader can
+// receive. A message that arrives split across reads is reassembled in a buffer
+// of this size.
+#ifndef MCUNET_FRAMED_MESSAGE_MAX_PAYLOAD_SIZE
+#define MCUNET_FRAMED_MESSAGE_MAX_PAYLOAD_SIZE 64
+#endif  // MCUNET_FRAMED_MESSAGE_MAX_PAYLOAD_SIZE
+
+// The size of the buffer in which FramedMessageBatch accumulates encoded
+// frames until they are sent, all in one write.
+#ifndef MCUNET_FRAMED_MESSAGE_BATCH_SIZE
+#define MCUNET_FRAMED_MESSAGE_BATCH_SIZE 128
+#endif  // MCUNET_FRAMED_MESSAGE_BATCH_SIZE
+
+namespace mcunet {
+
+// The type used to identify a (hardware) socket. The W5500 has only 8 sockets,
+// so a byte is plenty on the device, but when a PlatformNetworkInterface
+// implementation is used (e.g. HostNetwork), we allow for many more so that
+// the server code can be stress tested at higher concurrency than the chip
+// allows.
+#if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+using SocketNumber = uint16_t;
+#else
+using SocketNumber = uint8_t;
+#endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+
+}  // namespace mcunet
+
 #endif  // MCUNET_SRC_MCUNET_CONFIG_H_
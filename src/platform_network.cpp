@@ -5,18 +5,52 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include "mcunet_config.h"
+#include "pnapi_counters.h"
+
 namespace mcunet {
 
+#if MCUNET_ENABLE_PNAPI_COUNTERS
+#define COUNT_PNAPI_CALL(NAME) \
+  PnapiCallCounter pnapi_call_counter(GetPnapiCounters().NAME)
+#define COUNT_PNAPI_SOCKET_CALL(NAME, SOCK_NUM) \
+  PnapiCallCounter pnapi_call_counter(GetPnapiCounters().NAME, SOCK_NUM)
+#define COUNT_PNAPI_SENT(RESULT) pnapi_call_counter.CountSent(RESULT)
+#define COUNT_PNAPI_RECEIVED(RESULT) pnapi_call_counter.CountReceived(RESULT)
+#else  // !MCUNET_ENABLE_PNAPI_COUNTERS
+#define COUNT_PNAPI_CALL(NAME)
+#define COUNT_PNAPI_SOCKET_CALL(NAME, SOCK_NUM)
+#define COUNT_PNAPI_SENT(RESULT) (RESULT)
+#define COUNT_PNAPI_RECEIVED(RESULT) (RESULT)
+#endif  // MCUNET_ENABLE_PNAPI_COUNTERS
+
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
 #define CALL_PNAPI_METHOD(NAME, ARGS) \
   return PlatformNetworkInterface::GetImplementationOrDie()->NAME ARGS;
 
+#else  // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+namespace {
+
+// Implements TxFreeBytes without counting the calls, so that TrySend can use
+// it without the count of TxFreeBytes calls including those of TrySend.
+ssize_t UncountedTxFreeBytes(SocketNumber sock_num) {
+  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
+  EthernetClient client(sock_num);
+  const uint8_t status = client.status();
+  if (status != SnSR::ESTABLISHED && status != SnSR::CLOSE_WAIT) {
+    return -1;
+  }
+  return w5500.getTXFreeSize(sock_num);
+}
+
+}  // namespace
 #endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
 
 ////////////////////////////////////////////////////////////////////////////////
 // Methods getting the status of a socket.
 
 int PlatformNetwork::FindUnusedSocket() {
+  COUNT_PNAPI_CALL(FindUnusedSocket);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   CALL_PNAPI_METHOD(FindUnusedSocket, ());
 #else
@@ -29,11 +63,12 @@ int PlatformNetwork::FindUnusedSocket() {
 #endif
 }
 
-uint16_t PlatformNetwork::SocketIsTcpListener(uint8_t sock_num) {
-  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
+uint16_t PlatformNetwork::SocketIsTcpListener(SocketNumber sock_num) {
+  COUNT_PNAPI_SOCKET_CALL(SocketIsTcpListener, sock_num);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   CALL_PNAPI_METHOD(SocketIsTcpListener, (sock_num));
 #else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
   if (SocketStatus(sock_num) == SnSR::LISTEN) {
     return EthernetClass::_server_port[sock_num];
   }
@@ -41,11 +76,12 @@ uint16_t PlatformNetwork::SocketIsTcpListener(uint8_t sock_num) {
 #endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
 }
 
-bool PlatformNetwork::SocketIsInTcpConnectionLifecycle(uint8_t sock_num) {
-  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
+bool PlatformNetwork::SocketIsInTcpConnectionLifecycle(SocketNumber sock_num) {
+  COUNT_PNAPI_SOCKET_CALL(SocketIsInTcpConnectionLifecycle, sock_num);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   CALL_PNAPI_METHOD(SocketIsInTcpConnectionLifecycle, (sock_num));
 #else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
   switch (SocketStatus(sock_num)) {
     case SnSR::SYNRECV:
     case SnSR::ESTABLISHED:
@@ -62,25 +98,28 @@ bool PlatformNetwork::SocketIsInTcpConnectionLifecycle(uint8_t sock_num) {
 #endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
 }
 
-bool PlatformNetwork::SocketIsHalfClosed(uint8_t sock_num) {
-  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
+bool PlatformNetwork::SocketIsHalfClosed(SocketNumber sock_num) {
+  COUNT_PNAPI_SOCKET_CALL(SocketIsHalfClosed, sock_num);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   CALL_PNAPI_METHOD(SocketIsHalfClosed, (sock_num));
 #else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
   return SocketStatus(sock_num) == SnSR::CLOSE_WAIT;
 #endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
 }
 
-bool PlatformNetwork::SocketIsClosed(uint8_t sock_num) {
-  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
+bool PlatformNetwork::SocketIsClosed(SocketNumber sock_num) {
+  COUNT_PNAPI_SOCKET_CALL(SocketIsClosed, sock_num);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   CALL_PNAPI_METHOD(SocketIsClosed, (sock_num));
 #else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
   return SocketStatus(sock_num) == SnSR::CLOSED;
 #endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
 }
 
-uint8_t PlatformNetwork::SocketStatus(uint8_t sock_num) {
+uint8_t PlatformNetwork::SocketStatus(SocketNumber sock_num) {
+  COUNT_PNAPI_SOCKET_CALL(SocketStatus, sock_num);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   CALL_PNAPI_METHOD(SocketStatus, (sock_num));
 #else
@@ -89,11 +128,41 @@ uint8_t PlatformNetwork::SocketStatus(uint8_t sock_num) {
 #endif
 }
 
+IPAddress PlatformNetwork::RemoteAddress(SocketNumber sock_num) {
+  COUNT_PNAPI_SOCKET_CALL(RemoteAddress, sock_num);
+#if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  CALL_PNAPI_METHOD(RemoteAddress, (sock_num));
+#else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
+  if (!StatusIsOpen(SocketStatus(sock_num))) {
+    return IPAddress();
+  }
+  // Sn_DIPR holds the peer's address once the connection is established.
+  uint8_t octets[4];
+  w5500.readSnDIPR(sock_num, octets);
+  return IPAddress(octets[0], octets[1], octets[2], octets[3]);
+#endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+}
+
+uint16_t PlatformNetwork::RemotePort(SocketNumber sock_num) {
+  COUNT_PNAPI_SOCKET_CALL(RemotePort, sock_num);
+#if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  CALL_PNAPI_METHOD(RemotePort, (sock_num));
+#else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
+  if (!StatusIsOpen(SocketStatus(sock_num))) {
+    return 0;
+  }
+  return w5500.readSnDPORT(sock_num);
+#endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Methods modifying sockets.
 
-bool PlatformNetwork::InitializeTcpListenerSocket(uint8_t sock_num,
+bool PlatformNetwork::InitializeTcpListenerSocket(SocketNumber sock_num,
                                                   uint16_t tcp_port) {
+  COUNT_PNAPI_SOCKET_CALL(InitializeTcpListenerSocket, sock_num);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   CALL_PNAPI_METHOD(InitializeTcpListenerSocket, (sock_num, tcp_port));
 #else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
@@ -128,11 +197,12 @@ bool PlatformNetwork::InitializeTcpListenerSocket(uint8_t sock_num,
 #endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
 }
 
-bool PlatformNetwork::AcceptConnection(uint8_t sock_num) {
-  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
+bool PlatformNetwork::AcceptConnection(SocketNumber sock_num) {
+  COUNT_PNAPI_SOCKET_CALL(AcceptConnection, sock_num);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   CALL_PNAPI_METHOD(AcceptConnection, (sock_num));
 #else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
   // There really isn't any need to call this method when using a W5500.
   MCU_VLOG(3) << MCU_PSD(
       "PlatformNetwork::AcceptConnection called unexpectedly");
@@ -140,21 +210,23 @@ bool PlatformNetwork::AcceptConnection(uint8_t sock_num) {
 #endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
 }
 
-bool PlatformNetwork::DisconnectSocket(uint8_t sock_num) {
-  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
+bool PlatformNetwork::DisconnectSocket(SocketNumber sock_num) {
+  COUNT_PNAPI_SOCKET_CALL(DisconnectSocket, sock_num);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   CALL_PNAPI_METHOD(DisconnectSocket, (sock_num));
 #else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
   ::disconnect(sock_num);
   return true;
 #endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
 }
 
-bool PlatformNetwork::CloseSocket(uint8_t sock_num) {
-  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
+bool PlatformNetwork::CloseSocket(SocketNumber sock_num) {
+  COUNT_PNAPI_SOCKET_CALL(CloseSocket, sock_num);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   CALL_PNAPI_METHOD(CloseSocket, (sock_num));
 #else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
   ::close(sock_num);
   return true;
 #endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
@@ -163,52 +235,91 @@ bool PlatformNetwork::CloseSocket(uint8_t sock_num) {
 ////////////////////////////////////////////////////////////////////////////////
 // Methods using open sockets.
 
-ssize_t PlatformNetwork::Send(uint8_t sock_num, const uint8_t* buf,
+ssize_t PlatformNetwork::Send(SocketNumber sock_num, const uint8_t* buf,
                               size_t len) {
+  COUNT_PNAPI_SOCKET_CALL(Send, sock_num);
+#if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  return COUNT_PNAPI_SENT(
+      PlatformNetworkInterface::GetImplementationOrDie()->Send(sock_num, buf,
+                                                               len));
+#else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
+  return COUNT_PNAPI_SENT(::send(sock_num, buf, len));
+#endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+}
+
+ssize_t PlatformNetwork::TxFreeBytes(SocketNumber sock_num) {
+  COUNT_PNAPI_SOCKET_CALL(TxFreeBytes, sock_num);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
-  CALL_PNAPI_METHOD(Send, (sock_num, buf, len));
+  CALL_PNAPI_METHOD(TxFreeBytes, (sock_num));
 #else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
-  return ::send(sock_num, buf, len);
+  return UncountedTxFreeBytes(sock_num);
 #endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
 }
 
-void PlatformNetwork::Flush(uint8_t sock_num) {
-  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
+ssize_t PlatformNetwork::TrySend(SocketNumber sock_num, const uint8_t* buf,
+                                 size_t len) {
+  COUNT_PNAPI_SOCKET_CALL(TrySend, sock_num);
+#if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  return COUNT_PNAPI_SENT(
+      PlatformNetworkInterface::GetImplementationOrDie()->TrySend(sock_num, buf,
+                                                                  len));
+#else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  const ssize_t free_bytes = UncountedTxFreeBytes(sock_num);
+  if (free_bytes <= 0) {
+    return free_bytes;
+  }
+  if (len > static_cast<size_t>(free_bytes)) {
+    len = free_bytes;
+  }
+  // There is room for all len bytes, so ::send won't wait for room, though it
+  // does wait for the chip to report that the SEND command has completed.
+  return COUNT_PNAPI_SENT(::send(sock_num, buf, len));
+#endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+}
+
+void PlatformNetwork::Flush(SocketNumber sock_num) {
+  COUNT_PNAPI_SOCKET_CALL(Flush, sock_num);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   CALL_PNAPI_METHOD(Flush, (sock_num));
 #else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
   EthernetClient client(sock_num);
   return client.flush();
 #endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
 }
 
-ssize_t PlatformNetwork::AvailableBytes(uint8_t sock_num) {
-  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
+ssize_t PlatformNetwork::AvailableBytes(SocketNumber sock_num) {
+  COUNT_PNAPI_SOCKET_CALL(AvailableBytes, sock_num);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   CALL_PNAPI_METHOD(AvailableBytes, (sock_num));
 #else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
   EthernetClient client(sock_num);
   return client.available();
 #endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
 }
 
-int PlatformNetwork::Peek(uint8_t sock_num) {
-  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
+int PlatformNetwork::Peek(SocketNumber sock_num) {
+  COUNT_PNAPI_SOCKET_CALL(Peek, sock_num);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   CALL_PNAPI_METHOD(Peek, (sock_num));
 #else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
   EthernetClient client(sock_num);
   return client.peek();
 #endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
 }
 
-ssize_t PlatformNetwork::Recv(uint8_t sock_num, uint8_t* buf, size_t len) {
-  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
+ssize_t PlatformNetwork::Recv(SocketNumber sock_num, uint8_t* buf, size_t len) {
+  COUNT_PNAPI_SOCKET_CALL(Recv, sock_num);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
-  CALL_PNAPI_METHOD(Recv, (sock_num, buf, len));
+  return COUNT_PNAPI_RECEIVED(
+      PlatformNetworkInterface::GetImplementationOrDie()->Recv(sock_num, buf,
+                                                               len));
 #else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
-  return ::recv(sock_num, buf, len);
+  MCU_DCHECK_LT(sock_num, MAX_SOCK_NUM);
+  return COUNT_PNAPI_RECEIVED(::recv(sock_num, buf, len));
 #endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
 }
 
@@ -217,6 +328,7 @@ ssize_t PlatformNetwork::Recv(uint8_t sock_num, uint8_t* buf, size_t len) {
 // status value.
 
 bool PlatformNetwork::StatusIsOpen(uint8_t status) {
+  COUNT_PNAPI_CALL(StatusIsOpen);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   CALL_PNAPI_METHOD(StatusIsOpen, (status));
 #else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
@@ -225,6 +337,7 @@ bool PlatformNetwork::StatusIsOpen(uint8_t status) {
 }
 
 bool PlatformNetwork::StatusIsHalfClosed(uint8_t status) {
+  COUNT_PNAPI_CALL(StatusIsHalfClosed);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   CALL_PNAPI_METHOD(StatusIsHalfClosed, (status));
 #else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
@@ -233,6 +346,7 @@ bool PlatformNetwork::StatusIsHalfClosed(uint8_t status) {
 }
 
 bool PlatformNetwork::StatusIsClosing(uint8_t status) {
+  COUNT_PNAPI_CALL(StatusIsClosing);
 #if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
   CALL_PNAPI_METHOD(StatusIsClosing, (status));
 #else   // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
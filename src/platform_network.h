@@ -18,6 +18,7 @@
 #include <IPAddress.h>       // IWYU pragma: export
 #include <Stream.h>          // IWYU pragma: export
 #include <utility/socket.h>  // IWYU pragma: export
+#include <utility/w5500.h>   // IWYU pragma: export
 
 #elif MCU_EMBEDDED_TARGET
 
@@ -42,7 +43,8 @@ struct PlatformNetwork {
 #error "MCUNET_PNAPI_METHOD should not be defined!!"
 #endif
 
-#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS) static TYPE NAME ARGS
+#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS, ARG_NAMES) \
+  static TYPE NAME ARGS
 #include "platform_network_api.cc.inc"  // IWYU pragma: export
 #undef MCUNET_PNAPI_METHOD
 };
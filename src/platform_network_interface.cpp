@@ -10,10 +10,14 @@
 namespace mcunet {
 namespace {
 std::unique_ptr<PlatformNetworkInterface> g_platform_network;  // NOLINT
+
+// The implementation bound to the current thread, if any. Not owned.
+thread_local PlatformNetworkInterface* t_platform_network = nullptr;
 }  // namespace
 
 PlatformNetworkInterface::~PlatformNetworkInterface() {
   MCU_CHECK_NE(this, g_platform_network.get());
+  MCU_CHECK_NE(this, t_platform_network);
 }
 
 void PlatformNetworkInterface::SetImplementation(
@@ -28,12 +32,28 @@ void PlatformNetworkInterface::RemoveImplementation() {
 }
 
 PlatformNetworkInterface* PlatformNetworkInterface::GetImplementation() {
+  if (t_platform_network != nullptr) {
+    return t_platform_network;
+  }
   return g_platform_network.get();
 }
 
 PlatformNetworkInterface* PlatformNetworkInterface::GetImplementationOrDie() {
-  MCU_DCHECK_NE(g_platform_network.get(), nullptr);
-  return g_platform_network.get();
+  auto* const platform_network = GetImplementation();
+  MCU_DCHECK_NE(platform_network, nullptr);
+  return platform_network;
+}
+
+PlatformNetworkThreadBinding::PlatformNetworkThreadBinding(
+    PlatformNetworkInterface* platform_network)
+    : platform_network_(platform_network), previous_(t_platform_network) {
+  MCU_CHECK_NE(platform_network_, nullptr);
+  t_platform_network = platform_network_;
+}
+
+PlatformNetworkThreadBinding::~PlatformNetworkThreadBinding() {
+  MCU_CHECK_EQ(t_platform_network, platform_network_);
+  t_platform_network = previous_;
 }
 
 }  // namespace mcunet
@@ -5,6 +5,11 @@
 // of PlatformNetwork, allowing mocking for tests, and a full host networking
 // implementation.
 //
+// Normally there is a single, process wide, implementation. To allow a process
+// to simulate many devices, each running on its own thread, an implementation
+// can also be bound to a thread (see PlatformNetworkThreadBinding), in which
+// case it is used instead of the process wide implementation by that thread.
+//
 // Author: james.synge@gmail.com
 
 #include "mcunet_config.h"
@@ -16,6 +21,8 @@
 #include <memory>   // pragma: keep standard include
 #include <utility>  // pragma: keep standard include
 
+#include "extras/host/arduino/ip_address.h"  // IWYU pragma: export
+
 namespace mcunet {
 
 class PlatformNetworkInterface {
@@ -30,7 +37,8 @@ class PlatformNetworkInterface {
   // Remove (delete) the current implementation, which must be set.
   static void RemoveImplementation();
 
-  // Get the current implementation.
+  // Get the current implementation, which is the one bound to the current
+  // thread, if there is one, else the process wide implementation.
   static PlatformNetworkInterface* GetImplementation();
   static PlatformNetworkInterface* GetImplementationOrDie();
 
@@ -38,21 +46,61 @@ class PlatformNetworkInterface {
 #error "MCUNET_PNAPI_METHOD should not be defined!!"
 #endif
 
-#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS) virtual TYPE NAME ARGS = 0
+#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS, ARG_NAMES) \
+  virtual TYPE NAME ARGS = 0
 #include "platform_network_api.cc.inc"  // IWYU pragma: export
 #undef MCUNET_PNAPI_METHOD
 };
 
+// Binds an implementation of PlatformNetworkInterface to the current thread
+// for the lifetime of the binding, overriding the process wide implementation
+// for this thread only. Does not take ownership of the implementation, which
+// must outlive the binding. Bindings may be nested, in which case destroying
+// the inner binding restores the outer one; they must be destroyed on the
+// thread that created them, in the reverse order of creation.
+class PlatformNetworkThreadBinding {
+ public:
+  explicit PlatformNetworkThreadBinding(
+      PlatformNetworkInterface* platform_network);
+  ~PlatformNetworkThreadBinding();
+
+  PlatformNetworkThreadBinding(const PlatformNetworkThreadBinding&) = delete;
+  PlatformNetworkThreadBinding& operator=(const PlatformNetworkThreadBinding&) =
+      delete;
+
+ private:
+  PlatformNetworkInterface* const platform_network_;
+  PlatformNetworkInterface* const previous_;
+};
+
+// Where PlatformNetworkLifetime installs the implementation.
+enum class PlatformNetworkScope {
+  // Installed as the process wide implementation, of which there must be only
+  // one at a time.
+  kProcess,
+  // Bound to the thread which creates the PlatformNetworkLifetime instance.
+  kThread,
+};
+
 // Supports installing and removing an implementation of
-// PlatformNetworkInterface, of which there must be only one at a time.
+// PlatformNetworkInterface, either for the whole process or for the current
+// thread.
 template <typename T>  // T must extend PlatformNetworkInterface.
 class PlatformNetworkLifetime {
  public:
   // Sets *platform_network as the current implementation.
-  explicit PlatformNetworkLifetime(std::unique_ptr<T> platform_network)
+  explicit PlatformNetworkLifetime(
+      std::unique_ptr<T> platform_network,
+      PlatformNetworkScope scope = PlatformNetworkScope::kProcess)
       : platform_network_(platform_network.get()) {
     MCU_CHECK_NE(platform_network_, nullptr);
-    PlatformNetworkInterface::SetImplementation(std::move(platform_network));
+    if (scope == PlatformNetworkScope::kThread) {
+      owned_ = std::move(platform_network);
+      thread_binding_ =
+          std::make_unique<PlatformNetworkThreadBinding>(platform_network_);
+    } else {
+      PlatformNetworkInterface::SetImplementation(std::move(platform_network));
+    }
   }
 
   // Removes (deletes) current implementation, which must match the expected
@@ -60,7 +108,12 @@ class PlatformNetworkLifetime {
   ~PlatformNetworkLifetime() {
     MCU_CHECK_EQ(platform_network_,
                  PlatformNetworkInterface::GetImplementation());
-    PlatformNetworkInterface::RemoveImplementation();
+    if (thread_binding_) {
+      thread_binding_.reset();
+      owned_.reset();
+    } else {
+      PlatformNetworkInterface::RemoveImplementation();
+    }
   }
 
   // Returns current implementation, which must match the expected value.
@@ -72,6 +125,10 @@ class PlatformNetworkLifetime {
 
  private:
   T* const platform_network_;
+
+  // Only set if the scope is kThread.
+  std::unique_ptr<T> owned_;
+  std::unique_ptr<PlatformNetworkThreadBinding> thread_binding_;
 };
 
 }  // namespace mcunet
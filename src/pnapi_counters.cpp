@@ -0,0 +1,78 @@
+#include "pnapi_counters.h"
+
+#if MCUNET_ENABLE_PNAPI_COUNTERS
+
+#include <McuCore.h>
+#include <string.h>
+
+namespace mcunet {
+namespace {
+
+PnapiCounters pnapi_counters;  // NOLINT
+
+void InsertMethodCounter(mcucore::OPrintStream& strm,
+                         mcucore::ProgmemStringView name,
+                         const PnapiMethodCounter& counter) {
+  if (counter.calls > 0) {
+    strm << name << MCU_PSD(": calls=") << counter.calls
+         << MCU_PSD(", micros=") << counter.micros << '\n';
+  }
+}
+
+}  // namespace
+
+void PnapiCounters::Reset() { memset(this, 0, sizeof *this); }
+
+void PnapiCounters::InsertInto(mcucore::OPrintStream& strm) const {
+#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS, ARG_NAMES) \
+  InsertMethodCounter(strm, MCU_PSD(#NAME), NAME)
+#include "platform_network_api.cc.inc"
+#undef MCUNET_PNAPI_METHOD
+
+  for (uint8_t sock_num = 0; sock_num < kNumSockets; ++sock_num) {
+    const auto& socket = sockets[sock_num];
+    if (socket.calls > 0) {
+      strm << MCU_PSD("socket ") << sock_num << MCU_PSD(": calls=")
+           << socket.calls << MCU_PSD(", bytes_sent=") << socket.bytes_sent
+           << MCU_PSD(", bytes_received=") << socket.bytes_received << '\n';
+    }
+  }
+}
+
+PnapiCounters& GetPnapiCounters() { return pnapi_counters; }
+
+PnapiCallCounter::PnapiCallCounter(PnapiMethodCounter& method)
+    : method_(method), socket_(nullptr), start_micros_(micros()) {
+  ++method_.calls;
+}
+
+PnapiCallCounter::PnapiCallCounter(PnapiMethodCounter& method,
+                                   SocketNumber sock_num)
+    : PnapiCallCounter(method) {
+  if (sock_num < PnapiCounters::kNumSockets) {
+    socket_ = &pnapi_counters.sockets[sock_num];
+    ++socket_->calls;
+  }
+}
+
+PnapiCallCounter::~PnapiCallCounter() {
+  method_.micros += micros() - start_micros_;
+}
+
+ssize_t PnapiCallCounter::CountSent(ssize_t result) {
+  if (socket_ != nullptr && result > 0) {
+    socket_->bytes_sent += result;
+  }
+  return result;
+}
+
+ssize_t PnapiCallCounter::CountReceived(ssize_t result) {
+  if (socket_ != nullptr && result > 0) {
+    socket_->bytes_received += result;
+  }
+  return result;
+}
+
+}  // namespace mcunet
+
+#endif  // MCUNET_ENABLE_PNAPI_COUNTERS
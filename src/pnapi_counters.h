@@ -0,0 +1,89 @@
+#ifndef MCUNET_SRC_PNAPI_COUNTERS_H_
+#define MCUNET_SRC_PNAPI_COUNTERS_H_
+
+// PnapiCounters is an optional table of the number of calls to each method of
+// PlatformNetwork (PNAPI), the time spent in them, and the calls and bytes sent
+// and received per socket. It is compiled in only if
+// MCUNET_ENABLE_PNAPI_COUNTERS is 1 (see mcunet_config.h), allowing the cost of
+// a request to be measured on the device itself, e.g. by logging the table
+// after serving a request:
+//
+//    MCU_VLOG(1) << GetPnapiCounters();
+//    GetPnapiCounters().Reset();
+//
+// The time is measured with micros(), so is inclusive of calls made by one
+// method to another (e.g. TrySend calls TxFreeBytes on the device).
+//
+// On the host, InstrumentedPlatformNetwork provides more detail.
+//
+// Author: james.synge@gmail.com
+
+#include <McuCore.h>
+
+#include "mcunet_config.h"
+#include "platform_network_interface.h"
+
+#if MCUNET_ENABLE_PNAPI_COUNTERS
+
+namespace mcunet {
+
+struct PnapiMethodCounter {
+  uint32_t calls;
+  uint32_t micros;
+};
+
+struct PnapiSocketCounter {
+  uint32_t calls;
+  uint32_t bytes_sent;
+  uint32_t bytes_received;
+};
+
+struct PnapiCounters {
+  // The W5500 has 8 sockets; calls for higher numbered sockets (e.g. with
+  // HostNetwork) are counted only per method.
+  static constexpr uint8_t kNumSockets = 8;
+
+  // Zeroes all of the counters.
+  void Reset();
+
+  // Inserts the non-zero counters into the stream, e.g. for logging.
+  void InsertInto(mcucore::OPrintStream& strm) const;
+
+  // A counter per method, with the same name as the method.
+#ifdef MCUNET_PNAPI_METHOD
+#error "MCUNET_PNAPI_METHOD should not be defined!!"
+#endif
+#define MCUNET_PNAPI_METHOD(TYPE, NAME, ARGS, ARG_NAMES) PnapiMethodCounter NAME
+#include "platform_network_api.cc.inc"
+#undef MCUNET_PNAPI_METHOD
+
+  PnapiSocketCounter sockets[kNumSockets];
+};
+
+// Returns the table updated by the methods of PlatformNetwork.
+PnapiCounters& GetPnapiCounters();
+
+// Counts a call of a method of PlatformNetwork, including the time until the
+// end of the call (i.e. the destruction of the PnapiCallCounter).
+class PnapiCallCounter {
+ public:
+  explicit PnapiCallCounter(PnapiMethodCounter& method);
+  PnapiCallCounter(PnapiMethodCounter& method, SocketNumber sock_num);
+  ~PnapiCallCounter();
+
+  // Count the bytes sent or received by the call (if result is positive), and
+  // return result.
+  ssize_t CountSent(ssize_t result);
+  ssize_t CountReceived(ssize_t result);
+
+ private:
+  PnapiMethodCounter& method_;
+  PnapiSocketCounter* socket_;
+  const uint32_t start_micros_;
+};
+
+}  // namespace mcunet
+
+#endif  // MCUNET_ENABLE_PNAPI_COUNTERS
+
+#endif  // MCUNET_SRC_PNAPI_COUNTERS_H_
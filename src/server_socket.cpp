@@ -30,12 +30,12 @@ constexpr mcucore::MillisT kDisconnectMaxMillis = 5000;
 }  // namespace
 
 ServerSocket::ServerSocket(uint16_t tcp_port, ServerSocketListener &listener)
-    : sock_num_(MAX_SOCK_NUM),
+    : sock_num_(kNoSocket),
       last_status_(SnSR::CLOSED),
       listener_(listener),
       tcp_port_(tcp_port) {}
 
-bool ServerSocket::HasSocket() const { return sock_num_ < MAX_SOCK_NUM; }
+bool ServerSocket::HasSocket() const { return sock_num_ != kNoSocket; }
 
 bool ServerSocket::IsConnected() const {
   const bool result =
@@ -54,15 +54,15 @@ bool ServerSocket::PickClosedSocket() {
   last_status_ = SnSR::CLOSED;
 
   int sock_num = PlatformNetwork::FindUnusedSocket();
-  if (0 <= sock_num && sock_num < MAX_SOCK_NUM) {
-    sock_num_ = sock_num & 0xff;
+  if (0 <= sock_num && sock_num < kNoSocket) {
+    sock_num_ = static_cast<SocketNumber>(sock_num);
     if (BeginListening()) {
       last_status_ = PlatformNetwork::SocketStatus(sock_num_);
       return true;
     }
     MCU_VLOG(1) << MCU_PSD("listen for ") << tcp_port_
                 << MCU_PSD(" failed with socket ") << sock_num_;
-    sock_num_ = MAX_SOCK_NUM;
+    sock_num_ = kNoSocket;
   } else {
     MCU_VLOG(1) << MCU_PSD("No free socket for ") << tcp_port_;
   }
@@ -75,7 +75,7 @@ bool ServerSocket::ReleaseSocket() {
       return false;
     }
     CloseHardwareSocket();
-    sock_num_ = MAX_SOCK_NUM;
+    sock_num_ = kNoSocket;
   }
   return true;
 }
@@ -84,7 +84,7 @@ void ServerSocket::SocketLost() {
   if (HasSocket() && PlatformNetwork::StatusIsOpen(last_status_)) {
     listener_.OnDisconnect();
   }
-  sock_num_ = MAX_SOCK_NUM;
+  sock_num_ = kNoSocket;
   last_status_ = SnSR::CLOSED;
   disconnect_data_.RecordDisconnect();
 }
@@ -107,12 +107,15 @@ class ServerSocket {
   // of the closure of that connection.
   void CloseHardwareSocket();
 
-  // If sock_num_ is >= MAX_SOCK_NUM, then there isn't (yet) a hardware socket
-  // bound to this ServerSocket instance.
-  uint8_t sock_num_;
+  // Value of sock_num_ when there isn't (yet) a hardware socket bound to this
+  // ServerSocket instance. This is the largest SocketNumber, rather than
+  // MAX_SOCK_NUM, so that a PlatformNetworkInterface implementation may
+  // provide more sockets than the W5500 does.
+  static constexpr SocketNumber kNoSocket = static_cast<SocketNumber>(~0);
 
-  static_assert(static_cast<uint8_t>(MAX_SOCK_NUM) == MAX_SOCK_NUM,
-                "MAX_SOCK_NUM is too big!");
+  static_assert(MAX_SOCK_NUM < kNoSocket, "MAX_SOCK_NUM is too big!");
+
+  SocketNumber sock_num_;
 
   // mcucore::Status at the end of the last call to Initialize or PerformIO.
   // mcucore::Status after a successful Initialize call will be SnSR::LISTEN,
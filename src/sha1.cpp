@@ -0,0 +1,112 @@
+#include "sha1.h"
+
+#include <McuCore.h>
+
+namespace mcunet {
+namespace {
+
+inline uint32_t RotateLeft(uint32_t value, uint8_t bits) {
+  return (value << bits) | (value >> (32 - bits));
+}
+
+}  // namespace
+
+Sha1::Sha1()
+    : state_{0x67452301UL, 0xEFCDAB89UL, 0x98BADCFEUL, 0x10325476UL,
+             0xC3D2E1F0UL},
+      message_size_(0),
+      block_size_(0) {}
+
+void Sha1::Update(const uint8_t* data, size_t size) {
+  for (size_t ndx = 0; ndx < size; ++ndx) {
+    Append(data[ndx]);
+  }
+  message_size_ += size;
+}
+
+void Sha1::Update(const mcucore::ProgmemStringView& data) {
+  for (uint8_t ndx = 0; ndx < data.size(); ++ndx) {
+    Append(static_cast<uint8_t>(data.at(ndx)));
+  }
+  message_size_ += data.size();
+}
+
+void Sha1::Finish(uint8_t (&digest)[kDigestSize]) {
+  // The message size is appended in bits, as a 64-bit big-endian number, of
+  // which only the low 35 bits can be non-zero given that message_size_ is a
+  // 32-bit count of bytes.
+  const uint32_t size_in_bits = message_size_ << 3;
+  Append(0x80);
+  while (block_size_ != 56) {
+    Append(0);
+  }
+  for (uint8_t ndx = 0; ndx < 3; ++ndx) {
+    Append(0);
+  }
+  Append(message_size_ >> 29);
+  for (int8_t shift = 24; shift >= 0; shift -= 8) {
+    Append(static_cast<uint8_t>(size_in_bits >> shift));
+  }
+  for (uint8_t ndx = 0; ndx < kDigestSize; ++ndx) {
+    digest[ndx] =
+        static_cast<uint8_t>(state_[ndx / 4] >> (24 - 8 * (ndx % 4)));
+  }
+}
+
+void Sha1::Append(uint8_t b) {
+  block_[block_size_++] = b;
+  if (block_size_ == sizeof block_) {
+    ProcessBlock();
+    block_size_ = 0;
+  }
+}
+
+void Sha1::ProcessBlock() {
+  // The message schedule is computed in place, in a 16 word circular buffer,
+  // rather than expanding the block to 80 words, to save stack space.
+  uint32_t w[16];
+  for (uint8_t ndx = 0; ndx < 16; ++ndx) {
+    w[ndx] = (static_cast<uint32_t>(block_[4 * ndx]) << 24) |
+             (static_cast<uint32_t>(block_[4 * ndx + 1]) << 16) |
+             (static_cast<uint32_t>(block_[4 * ndx + 2]) << 8) |
+             block_[4 * ndx + 3];
+  }
+  uint32_t a = state_[0];
+  uint32_t b = state_[1];
+  uint32_t c = state_[2];
+  uint32_t d = state_[3];
+  uint32_t e = state_[4];
+  for (uint8_t t = 0; t < 80; ++t) {
+    if (t >= 16) {
+      w[t & 15] = RotateLeft(
+          w[(t + 13) & 15] ^ w[(t + 8) & 15] ^ w[(t + 2) & 15] ^ w[t & 15], 1);
+    }
+    uint32_t f, k;
+    if (t < 20) {
+      f = (b & c) | (~b & d);
+      k = 0x5A827999UL;
+    } else if (t < 40) {
+      f = b ^ c ^ d;
+      k = 0x6ED9EBA1UL;
+    } else if (t < 60) {
+      f = (b & c) | (b & d) | (c & d);
+      k = 0x8F1BBCDCUL;
+    } else {
+      f = b ^ c ^ d;
+      k = 0xCA62C1D6UL;
+    }
+    const uint32_t temp = RotateLeft(a, 5) + f + e + k + w[t & 15];
+    e = d;
+    d = c;
+    c = RotateLeft(b, 30);
+    b = a;
+    a = temp;
+  }
+  state_[0] += a;
+  state_[1] += b;
+  state_[2] += c;
+  state_[3] += d;
+  state_[4] += e;
+}
+
+}  // namespace mcunet
@@ -0,0 +1,45 @@
+#ifndef MCUNET_SRC_SHA1_H_
+#define MCUNET_SRC_SHA1_H_
+
+// Sha1 computes the SHA-1 digest (FIPS 180-4) of a stream of bytes, in a fixed
+// amount of memory (about 96 bytes). SHA-1 is no longer suitable for security
+// purposes; it is here because the WebSocket opening handshake (RFC 6455)
+// requires it to compute Sec-WebSocket-Accept.
+//
+// Author: james.synge@gmail.com
+
+#include <McuCore.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace mcunet {
+
+class Sha1 {
+ public:
+  static constexpr uint8_t kDigestSize = 20;
+
+  Sha1();
+
+  // Appends data to the message being digested.
+  void Update(const uint8_t* data, size_t size);
+
+  // Appends data from PROGMEM to the message being digested.
+  void Update(const mcucore::ProgmemStringView& data);
+
+  // Completes the digest of the message, and writes it to digest. The Sha1
+  // instance must not be used after this.
+  void Finish(uint8_t (&digest)[kDigestSize]);
+
+ private:
+  void Append(uint8_t b);
+  void ProcessBlock();
+
+  uint32_t state_[5];
+  uint32_t message_size_;  // In bytes.
+  uint8_t block_[64];
+  uint8_t block_size_;
+};
+
+}  // namespace mcunet
+
+#endif  // MCUNET_SRC_SHA1_H_
@@ -15,6 +15,10 @@ TcpServerConnection::TcpServerConnection(uint8_t* write_buffer,
   disconnect_data_.Reset();
 }
 
+int TcpServerConnection::TryWriteToClient(const uint8_t* buf, size_t size) {
+  return PlatformNetwork::TrySend(sock_num_, buf, size);
+}
+
 void TcpServerConnection::close() {
   // The Ethernet5500 library's EthernetClient::stop method bakes in a limit
   // of 1 second for closing a connection, and spins in a loop waiting until
@@ -25,11 +25,16 @@ class TcpServerConnection : public WriteBufferedConnection {
   void close() override;
 
   // Delegates to the wrapped client.
-  uint8_t sock_num() const final { return sock_num_; }
+  SocketNumber sock_num() const final { return sock_num_; }
+
+ protected:
+  // Uses PlatformNetwork::TrySend, which doesn't wait for room in the TX
+  // buffer of the hardware socket.
+  int TryWriteToClient(const uint8_t* buf, size_t size) override;
 
  private:
   DisconnectData& disconnect_data_;
-  const uint8_t sock_num_;
+  const SocketNumber sock_num_;
 };
 
 }  // namespace mcunet
@@ -0,0 +1,144 @@
+#include "w5500_arp_transport.h"
+
+#include <McuCore.h>
+#include <string.h>
+
+#include "mcunet_config.h"
+#include "platform_network.h"
+
+namespace mcunet {
+
+#if MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+
+bool W5500ArpTransport::Open() { return false; }
+void W5500ArpTransport::Close() {}
+bool W5500ArpTransport::Send(const ArpPacket&) { return false; }
+bool W5500ArpTransport::Receive(ArpPacket&) { return false; }
+
+#else  // !MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+
+namespace {
+
+// Only socket 0 supports MACRAW mode.
+constexpr SocketNumber kMacRawSocket = 0;
+
+constexpr uint16_t kEtherTypeArp = 0x0806;
+constexpr uint16_t kEtherTypeIpv4 = 0x0800;
+constexpr uint8_t kEthernetHeaderSize = 14;
+constexpr uint8_t kArpPacketSize = 28;
+constexpr uint8_t kArpFrameSize = kEthernetHeaderSize + kArpPacketSize;
+// Shorter frames must be padded to this size.
+constexpr uint8_t kMinFrameSize = 60;
+
+uint16_t GetUint16(const uint8_t* p) {
+  return (static_cast<uint16_t>(p[0]) << 8) | p[1];
+}
+
+uint8_t* PutUint16(uint8_t* p, uint16_t value) {
+  *p++ = value >> 8;
+  *p++ = value;
+  return p;
+}
+
+uint8_t* PutMac(uint8_t* p, const EthernetAddress& mac) {
+  memcpy(p, mac.bytes, sizeof mac.bytes);
+  return p + sizeof mac.bytes;
+}
+
+uint8_t* PutIp(uint8_t* p, const IPAddress& ip) {
+  for (int i = 0; i < 4; ++i) {
+    *p++ = ip[i];
+  }
+  return p;
+}
+
+const uint8_t* GetIp(const uint8_t* p, IPAddress& ip) {
+  ip = IPAddress(p[0], p[1], p[2], p[3]);
+  return p + 4;
+}
+
+}  // namespace
+
+bool W5500ArpTransport::Open() {
+  if (!PlatformNetwork::SocketIsClosed(kMacRawSocket)) {
+    MCU_VLOG(2) << MCU_PSD("MACRAW socket is in use");
+    return false;
+  }
+  ::socket(kMacRawSocket, SnMR::MACRAW, 0, 0);
+  return PlatformNetwork::SocketStatus(kMacRawSocket) == SnSR::MACRAW;
+}
+
+void W5500ArpTransport::Close() {
+  if (PlatformNetwork::SocketStatus(kMacRawSocket) == SnSR::MACRAW) {
+    ::close(kMacRawSocket);
+  }
+}
+
+bool W5500ArpTransport::Send(const ArpPacket& packet) {
+  if (w5500.getTXFreeSize(kMacRawSocket) < kMinFrameSize) {
+    return false;
+  }
+  uint8_t frame[kMinFrameSize];
+  memset(frame, 0, sizeof frame);
+  // Broadcast, whether a probe or an announcement.
+  memset(frame, 0xFF, 6);
+  uint8_t* p = PutMac(frame + 6, packet.sender_mac);
+  p = PutUint16(p, kEtherTypeArp);
+  p = PutUint16(p, 1);  // Hardware type: Ethernet.
+  p = PutUint16(p, kEtherTypeIpv4);
+  *p++ = sizeof packet.sender_mac.bytes;
+  *p++ = 4;
+  p = PutUint16(p, packet.operation);
+  p = PutMac(p, packet.sender_mac);
+  p = PutIp(p, packet.sender_ip);
+  p = PutMac(p, packet.target_mac);
+  PutIp(p, packet.target_ip);
+
+  // Copy the frame into the transmit buffer and start sending it; unlike
+  // ::send, we don't wait for the chip to report that it has been sent.
+  w5500.send_data_processing(kMacRawSocket, frame, sizeof frame);
+  w5500.execCmdSn(kMacRawSocket, Sock_SEND);
+  return true;
+}
+
+bool W5500ArpTransport::Receive(ArpPacket& packet) {
+  // In MACRAW mode, each frame in the receive buffer is preceded by a 2 byte
+  // length, which includes the length itself.
+  while (w5500.getRXReceivedSize(kMacRawSocket) >= 2) {
+    uint8_t frame[kArpFrameSize];
+    w5500.recv_data_processing(kMacRawSocket, frame, 2);
+    uint16_t remaining = GetUint16(frame);
+    remaining = remaining > 2 ? remaining - 2 : 0;
+    const uint16_t size = remaining < sizeof frame ? remaining : sizeof frame;
+    w5500.recv_data_processing(kMacRawSocket, frame, size);
+    // Discard the rest of the frame (e.g. the padding).
+    uint8_t discard[16];
+    for (uint16_t left = remaining - size; left > 0;) {
+      const uint16_t len = left < sizeof discard ? left : sizeof discard;
+      w5500.recv_data_processing(kMacRawSocket, discard, len);
+      left -= len;
+    }
+    w5500.execCmdSn(kMacRawSocket, Sock_RECV);
+
+    const uint8_t* p = frame + 12;
+    if (size < kArpFrameSize || GetUint16(p) != kEtherTypeArp ||
+        GetUint16(p + 2) != 1 || GetUint16(p + 4) != kEtherTypeIpv4 ||
+        p[6] != sizeof packet.sender_mac.bytes || p[7] != 4) {
+      // Not an ARP packet for IPv4 over Ethernet.
+      continue;
+    }
+    p += 8;
+    packet.operation = GetUint16(p);
+    p += 2;
+    memcpy(packet.sender_mac.bytes, p, sizeof packet.sender_mac.bytes);
+    p = GetIp(p + sizeof packet.sender_mac.bytes, packet.sender_ip);
+    memcpy(packet.target_mac.bytes, p, sizeof packet.target_mac.bytes);
+    GetIp(p + sizeof packet.target_mac.bytes, packet.target_ip);
+    return true;
+  }
+  return false;
+}
+
+#endif  // MCU_HAS_PLATFORM_NETWORK_IMPLEMENTATION
+
+}  // namespace mcunet
@@ -0,0 +1,31 @@
+#ifndef MCUNET_SRC_W5500_ARP_TRANSPORT_H_
+#define MCUNET_SRC_W5500_ARP_TRANSPORT_H_
+
+// W5500ArpTransport sends and receives ARP packets using socket 0 of the W5500
+// in MACRAW mode (only socket 0 supports that mode). While open, socket 0 is
+// unavailable for other uses, so Open should be called before other sockets
+// are allocated (e.g. before the DHCP socket is opened). ArpProber only keeps
+// it open while probing and announcing (about 10 seconds), after which socket
+// 0 is available to servers; if socket 0 is in use, Open returns false.
+//
+// On host there is no MACRAW support, so Open always returns false.
+//
+// Author: james.synge@gmail.com
+
+#include <McuCore.h>
+
+#include "arp_prober.h"
+
+namespace mcunet {
+
+class W5500ArpTransport : public ArpTransport {
+ public:
+  bool Open() override;
+  void Close() override;
+  bool Send(const ArpPacket& packet) override;
+  bool Receive(ArpPacket& packet) override;
+};
+
+}  // namespace mcunet
+
+#endif  // MCUNET_SRC_W5500_ARP_TRANSPORT_H_
@@ -0,0 +1,338 @@
+#include "websocket.h"
+
+#include <McuCore.h>
+
+#include "http_response.h"
+#include "sha1.h"
+
+namespace mcunet {
+namespace {
+
+// Amount of stack space to allocate for reading from the connection; as for
+// HttpServer, this needs to fit alongside the write buffer of
+// TcpServerConnection.
+constexpr uint8_t kReadBufferSize = 64;
+
+// The only version of the protocol that has been standardized.
+constexpr uint8_t kWebSocketVersion = 13;
+
+char Base64Digit(uint8_t value) {
+  if (value < 26) {
+    return 'A' + value;
+  } else if (value < 52) {
+    return 'a' + (value - 26);
+  } else if (value < 62) {
+    return '0' + (value - 52);
+  }
+  return value == 62 ? '+' : '/';
+}
+
+// Writes the base64 encoding of the 20 byte digest, which is 27 digits and one
+// '=' of padding.
+void Base64EncodeDigest(const uint8_t (&digest)[Sha1::kDigestSize],
+                        char (&encoded)[28]) {
+  uint8_t out = 0;
+  for (size_t ndx = 0; ndx < sizeof digest; ndx += 3) {
+    uint32_t group = static_cast<uint32_t>(digest[ndx]) << 16;
+    if (ndx + 1 < sizeof digest) {
+      group |= static_cast<uint32_t>(digest[ndx + 1]) << 8;
+    }
+    if (ndx + 2 < sizeof digest) {
+      group |= digest[ndx + 2];
+    }
+    encoded[out++] = Base64Digit((group >> 18) & 0x3F);
+    encoded[out++] = Base64Digit((group >> 12) & 0x3F);
+    encoded[out++] = Base64Digit((group >> 6) & 0x3F);
+    encoded[out++] =
+        ndx + 2 < sizeof digest ? Base64Digit(group & 0x3F) : '=';
+  }
+}
+
+void WriteCloseFrame(Connection& connection, WebSocketCloseCode code) {
+  const uint16_t value = static_cast<uint16_t>(code);
+  const uint8_t payload[2] = {static_cast<uint8_t>(value >> 8),
+                              static_cast<uint8_t>(value)};
+  WriteWebSocketFrameHeader(connection, WebSocketOpcode::kClose,
+                            sizeof payload);
+  connection.write(payload, sizeof payload);
+}
+
+}  // namespace
+
+void ComputeWebSocketAccept(const char (&key)[24], char (&accept)[28]) {
+  Sha1 sha1;
+  sha1.Update(reinterpret_cast<const uint8_t*>(key), sizeof key);
+  sha1.Update(MCU_PSV("258EAFA5-E914-47DA-95CA-C5AB0DC85B11"));
+  uint8_t digest[Sha1::kDigestSize];
+  sha1.Finish(digest);
+  Base64EncodeDigest(digest, accept);
+}
+
+WebSocket::WebSocket(WebSocketHandler& handler)
+    : handler_(handler),
+      last_receive_millis_(0),
+      ping_interval_millis_(kPingIntervalMillis),
+      pong_timeout_millis_(kPongTimeoutMillis),
+      state_(State::kClosed),
+      echo_payload_(false),
+      ping_sent_(false),
+      close_requested_(false),
+      outbox_pending_(false),
+      outbox_opcode_(WebSocketOpcode::kText),
+      outbox_size_(0) {}
+
+bool WebSocket::QueueText(const mcucore::StringView& text) {
+  return QueueMessage(WebSocketOpcode::kText,
+                      reinterpret_cast<const uint8_t*>(text.data()),
+                      text.size());
+}
+
+bool WebSocket::QueueBinary(const uint8_t* data, size_t size) {
+  return QueueMessage(WebSocketOpcode::kBinary, data, size);
+}
+
+bool WebSocket::QueueMessage(WebSocketOpcode opcode, const uint8_t* data,
+                             size_t size) {
+  if (!is_open() || size > kOutboxSize) {
+    return false;
+  }
+  memcpy(outbox_, data, size);
+  outbox_size_ = size;
+  outbox_opcode_ = opcode;
+  outbox_pending_ = true;
+  return true;
+}
+
+void WebSocket::Close() {
+  if (is_open()) {
+    close_requested_ = true;
+  }
+}
+
+bool WebSocket::Accept(const HttpRequest& request, Connection& connection) {
+  if (!handler_.AcceptWebSocket(request)) {
+    return false;
+  }
+  if (request.websocket_version != kWebSocketVersion) {
+    HttpResponse response(connection, /*omit_body=*/false,
+                          /*close_connection=*/false);
+    response.set_request(request);
+    response.StartHeaders(HttpStatusCode::kUpgradeRequired);
+    response.AddHeader(MCU_PSV("Sec-WebSocket-Version"), MCU_PSV("13"));
+    response.set_content_length(0);
+    response.EndHeaders();
+    return true;
+  }
+  char accept[28];
+  ComputeWebSocketAccept(request.websocket_key, accept);
+  mcucore::OPrintStream strm(connection);
+  strm << MCU_PSD("HTTP/1.1 101 ")
+       << HttpReasonPhrase(HttpStatusCode::kSwitchingProtocols)
+       << MCU_PSD("\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                  "Sec-WebSocket-Accept: ");
+  connection.write(reinterpret_cast<const uint8_t*>(accept), sizeof accept);
+  strm << MCU_PSD("\r\n\r\n");
+  MCU_VLOG(2) << MCU_PSD("WebSocket::Accept ") << request.target;
+  decoder_.Reset();
+  last_receive_millis_ = millis();
+  state_ = State::kOpen;
+  echo_payload_ = false;
+  ping_sent_ = false;
+  close_requested_ = false;
+  outbox_pending_ = false;
+  handler_.OnWebSocketOpen(*this);
+  return true;
+}
+
+void WebSocket::OnCanRead(Connection& connection) {
+  uint8_t buffer[kReadBufferSize];
+  while (is_connected()) {
+    const int size = connection.read(buffer, sizeof buffer);
+    if (size < 0) {
+      // No more data available right now.
+      break;
+    } else if (size == 0) {
+      // The client has half-closed the connection; ServerSocket will close it
+      // once we've read everything.
+      return;
+    }
+    if (!ProcessInput(connection, buffer, static_cast<size_t>(size))) {
+      return;
+    }
+  }
+  if (is_connected()) {
+    SendQueued(connection);
+    CheckKeepAlive(connection);
+  }
+}
+
+bool WebSocket::ProcessInput(Connection& connection, uint8_t* data,
+                             size_t size) {
+  if (size > 0) {
+    last_receive_millis_ = millis();
+    ping_sent_ = false;
+  }
+  // Send anything queued (e.g. by OnWebSocketOpen) before it can be replaced
+  // by a response to the input.
+  SendQueued(connection);
+  while (size > 0) {
+    size_t consumed;
+    const auto result = decoder_.Decode(data, size, consumed);
+    if (result == WebSocketFrameDecoder::Result::kError) {
+      Fail(connection, decoder_.error_code());
+      return false;
+    } else if (result == WebSocketFrameDecoder::Result::kFrameHeader) {
+      OnFrameHeader(connection);
+    } else if (result == WebSocketFrameDecoder::Result::kPayload) {
+      OnPayload(connection, data, consumed);
+    }
+    data += consumed;
+    size -= consumed;
+    if (result != WebSocketFrameDecoder::Result::kNeedMoreInput &&
+        decoder_.payload_remaining() == 0) {
+      if (!OnFrameEnd(connection)) {
+        return false;
+      }
+      // Send any response that the handler queued.
+      SendQueued(connection);
+    }
+  }
+  return true;
+}
+
+void WebSocket::OnDisconnect() {
+  if (is_connected()) {
+    MCU_VLOG(2) << MCU_PSD("WebSocket::OnDisconnect");
+    state_ = State::kClosed;
+    handler_.OnWebSocketClose(*this);
+  }
+}
+
+void WebSocket::OnFrameHeader(Connection& connection) {
+  const WebSocketOpcode opcode = decoder_.opcode();
+  MCU_VLOG(4) << MCU_PSD("WebSocket::OnFrameHeader opcode ")
+              << static_cast<uint8_t>(opcode) << MCU_PSD(", payload_size ")
+              << decoder_.payload_size();
+  if (state_ == State::kOpen && (opcode == WebSocketOpcode::kPing ||
+                                 opcode == WebSocketOpcode::kClose)) {
+    // Respond with a Pong or Close frame with the same payload, which is
+    // streamed back as it arrives, so that it needn't be buffered.
+    WriteWebSocketFrameHeader(connection,
+                              opcode == WebSocketOpcode::kPing
+                                  ? WebSocketOpcode::kPong
+                                  : WebSocketOpcode::kClose,
+                              decoder_.payload_size());
+    echo_payload_ = true;
+  }
+}
+
+void WebSocket::OnPayload(Connection& connection, const uint8_t* data,
+                          size_t size) {
+  if (decoder_.is_control_frame()) {
+    if (echo_payload_) {
+      connection.write(data, size);
+    }
+  } else if (state_ == State::kOpen) {
+    handler_.OnWebSocketData(
+        *this, decoder_.message_opcode(), data, size,
+        decoder_.fin() && decoder_.payload_remaining() == 0);
+  }
+}
+
+bool WebSocket::OnFrameEnd(Connection& connection) {
+  echo_payload_ = false;
+  switch (decoder_.opcode()) {
+    case WebSocketOpcode::kClose:
+      // Either the client started the closing handshake, and we've echoed its
+      // Close frame, or it has responded to ours.
+      CloseConnection(connection);
+      return false;
+
+    case WebSocketOpcode::kContinuation:
+    case WebSocketOpcode::kText:
+    case WebSocketOpcode::kBinary:
+      if (decoder_.payload_size() == 0 && decoder_.fin() &&
+          state_ == State::kOpen) {
+        // There was no payload to carry the end of the message.
+        handler_.OnWebSocketData(*this, decoder_.message_opcode(), nullptr, 0,
+                                 true);
+      }
+      break;
+
+    case WebSocketOpcode::kPing:
+    case WebSocketOpcode::kPong:
+      break;
+  }
+  return true;
+}
+
+void WebSocket::SendQueued(Connection& connection) {
+  if (state_ != State::kOpen || echo_payload_) {
+    // Can't start a frame while part way through another.
+    return;
+  }
+  if (close_requested_) {
+    MCU_VLOG(2) << MCU_PSD("WebSocket sending Close");
+    WriteCloseFrame(connection, WebSocketCloseCode::kNormalClosure);
+    state_ = State::kClosing;
+    last_receive_millis_ = millis();
+    ping_sent_ = true;
+  } else if (outbox_pending_) {
+    WriteWebSocketFrameHeader(connection, outbox_opcode_, outbox_size_);
+    connection.write(outbox_, outbox_size_);
+    outbox_pending_ = false;
+  }
+}
+
+void WebSocket::CheckKeepAlive(Connection& connection) {
+  const mcucore::MillisT elapsed = mcucore::ElapsedMillis(last_receive_millis_);
+  if (state_ == State::kClosing) {
+    if (elapsed >= pong_timeout_millis_) {
+      CloseConnection(connection);
+    }
+  } else if (!ping_sent_) {
+    if (elapsed >= ping_interval_millis_ && !echo_payload_) {
+      WriteWebSocketFrameHeader(connection, WebSocketOpcode::kPing, 0);
+      ping_sent_ = true;
+    }
+  } else if (elapsed >= ping_interval_millis_ + pong_timeout_millis_) {
+    MCU_VLOG(2) << MCU_PSD("WebSocket client is unresponsive");
+    CloseConnection(connection);
+  }
+}
+
+void WebSocket::Fail(Connection& connection, WebSocketCloseCode code) {
+  if (state_ == State::kOpen && !echo_payload_) {
+    WriteCloseFrame(connection, code);
+  }
+  CloseConnection(connection);
+}
+
+void WebSocket::CloseConnection(Connection& connection) {
+  connection.close();
+  OnDisconnect();
+}
+
+uint8_t WebSocketBroadcaster::BroadcastText(
+    const mcucore::StringView& text) const {
+  uint8_t count = 0;
+  for (uint8_t ndx = 0; ndx < num_websockets_; ++ndx) {
+    if (websockets_[ndx]->QueueText(text)) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+uint8_t WebSocketBroadcaster::BroadcastBinary(const uint8_t* data,
+                                              size_t size) const {
+  uint8_t count = 0;
+  for (uint8_t ndx = 0; ndx < num_websockets_; ++ndx) {
+    if (websockets_[ndx]->QueueBinary(data, size)) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+}  // namespace mcunet
@@ -0,0 +1,212 @@
+#ifndef MCUNET_SRC_WEBSOCKET_H_
+#define MCUNET_SRC_WEBSOCKET_H_
+
+// WebSocket provides a server side WebSocket (RFC 6455) endpoint on a
+// connection accepted by an HttpServer, so that a device can push state changes
+// to a client as they happen, with a small frame (2 bytes of framing plus the
+// message), rather than the client polling with a full HTTP request and
+// response.
+//
+// An HttpServer constructed with a WebSocket passes requests to upgrade the
+// connection to the WebSocketHandler, which decides whether to accept them
+// (e.g. based on the path). Once accepted, the connection carries WebSocket
+// frames until it is closed; the handler receives the data messages sent by
+// the client, a piece at a time, and messages to the client are queued with
+// QueueText or QueueBinary and sent the next time PerformIO is called. The
+// WebSocket responds to Pings from the client, and sends Pings of its own when
+// it hasn't heard from the client for a while, closing the connection if the
+// client doesn't respond.
+//
+// Like HttpServer, a WebSocket handles one connection at a time. To push
+// messages to several clients, give each HttpServer instance its own WebSocket,
+// and use a WebSocketBroadcaster to queue a message on all of them.
+//
+// Example:
+//
+//   WebSocket websocket1(websocket_handler), websocket2(websocket_handler);
+//   HttpServer server1(80, http_handler, websocket1);
+//   HttpServer server2(80, http_handler, websocket2);
+//   WebSocket* const kWebSockets[] = {&websocket1, &websocket2};
+//   WebSocketBroadcaster broadcaster(kWebSockets);
+//   ...
+//   broadcaster.BroadcastText(state_json);  // When the state changes.
+//
+// Text messages from the client are passed to the handler without checking
+// that they are valid UTF-8.
+//
+// Author: james.synge@gmail.com
+
+#include <McuCore.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "connection.h"
+#include "http_request.h"
+#include "mcunet_config.h"
+#include "websocket_frame.h"
+
+namespace mcunet {
+
+class WebSocket;
+
+class WebSocketHandler {
+ public:
+#if !MCU_EMBEDDED_TARGET
+  virtual ~WebSocketHandler() = default;
+#endif
+
+  // Called when a client asks to upgrade the connection to a WebSocket. Returns
+  // true to accept; if false is returned, the request is passed to the
+  // HttpRequestHandler instead.
+  virtual bool AcceptWebSocket(const HttpRequest& request) = 0;
+
+  // Called when the WebSocket has been opened (i.e. the upgrade has been
+  // accepted). The handler may queue a message, e.g. the current state.
+  virtual void OnWebSocketOpen(WebSocket& websocket) = 0;
+
+  // Called with each piece of the payload of a data message (i.e. kText or
+  // kBinary) from the client, in order. message_end is true for the last piece
+  // of a message, which may be empty.
+  virtual void OnWebSocketData(WebSocket& websocket,
+                               WebSocketOpcode message_opcode,
+                               const uint8_t* data, size_t size,
+                               bool message_end) = 0;
+
+  // Called when the WebSocket has been closed, for whatever reason.
+  virtual void OnWebSocketClose(WebSocket& websocket) = 0;
+};
+
+class WebSocket {
+ public:
+  static constexpr uint8_t kOutboxSize = MCUNET_WEBSOCKET_OUTBOX_SIZE;
+  static constexpr mcucore::MillisT kPingIntervalMillis =
+      MCUNET_WEBSOCKET_PING_INTERVAL_MILLIS;
+  static constexpr mcucore::MillisT kPongTimeoutMillis =
+      MCUNET_WEBSOCKET_PONG_TIMEOUT_MILLIS;
+
+  explicit WebSocket(WebSocketHandler& handler);
+
+  // Returns true if the connection has been upgraded to a WebSocket, and the
+  // WebSocket hasn't started closing.
+  bool is_open() const { return state_ == State::kOpen; }
+
+  // Returns true if the connection has been upgraded, and hasn't been closed.
+  bool is_connected() const { return state_ != State::kClosed; }
+
+  // Queues a message to be sent to the client the next time PerformIO is
+  // called. Any message already queued, but not yet sent, is replaced, i.e.
+  // only the latest state is sent. Returns false if not open, or if the
+  // message is larger than kOutboxSize.
+  bool QueueText(const mcucore::StringView& text);
+  bool QueueBinary(const uint8_t* data, size_t size);
+
+  // Starts closing the WebSocket: the next time PerformIO is called, a Close
+  // frame is sent, and the connection is closed when the client responds.
+  void Close();
+
+  // Overrides kPingIntervalMillis and kPongTimeoutMillis, e.g. for testing.
+  void set_ping_interval_millis(mcucore::MillisT ping_interval_millis) {
+    ping_interval_millis_ = ping_interval_millis;
+  }
+  void set_pong_timeout_millis(mcucore::MillisT pong_timeout_millis) {
+    pong_timeout_millis_ = pong_timeout_millis;
+  }
+
+  WebSocketHandler& handler() { return handler_; }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // Methods called by HttpServer.
+
+  // If the handler accepts the upgrade request, responds with 101 Switching
+  // Protocols and opens the WebSocket, or responds with 426 Upgrade Required
+  // if the client's version of the protocol isn't supported. Returns false
+  // (without responding) if the handler declines the request.
+  bool Accept(const HttpRequest& request, Connection& connection);
+
+  // Reads and handles the frames available from the connection, then sends any
+  // queued message, and checks whether the client is still responsive.
+  void OnCanRead(Connection& connection);
+
+  // Handles data already read from the connection, i.e. that followed the
+  // upgrade request. Returns false if the connection has been closed.
+  bool ProcessInput(Connection& connection, uint8_t* data, size_t size);
+
+  // Called when the connection has been closed, e.g. by the client.
+  void OnDisconnect();
+
+ private:
+  enum class State : uint8_t {
+    kClosed,
+    kOpen,
+    // We've sent a Close frame, and are waiting for the client's.
+    kClosing,
+  };
+
+  bool QueueMessage(WebSocketOpcode opcode, const uint8_t* data, size_t size);
+
+  // Called for each frame header decoded. Starts the response to a control
+  // frame, i.e. a Pong or Close frame echoing the payload.
+  void OnFrameHeader(Connection& connection);
+
+  // Called for each piece of the payload of a frame.
+  void OnPayload(Connection& connection, const uint8_t* data, size_t size);
+
+  // Called when a frame is complete. Returns false if the connection has been
+  // closed.
+  bool OnFrameEnd(Connection& connection);
+
+  // Sends the queued Close frame or message, if any.
+  void SendQueued(Connection& connection);
+
+  // Sends a Ping if the client has been quiet for ping_interval_millis_, and
+  // closes the connection if it hasn't responded to a Ping or Close frame
+  // within pong_timeout_millis_.
+  void CheckKeepAlive(Connection& connection);
+
+  // Sends a Close frame with the status code, then closes the connection.
+  void Fail(Connection& connection, WebSocketCloseCode code);
+
+  void CloseConnection(Connection& connection);
+
+  WebSocketHandler& handler_;
+  WebSocketFrameDecoder decoder_;
+  mcucore::MillisT last_receive_millis_;
+  mcucore::MillisT ping_interval_millis_;
+  mcucore::MillisT pong_timeout_millis_;
+  State state_;
+  // True while the payload of a control frame is being echoed back.
+  bool echo_payload_;
+  bool ping_sent_;
+  bool close_requested_;
+  bool outbox_pending_;
+  WebSocketOpcode outbox_opcode_;
+  uint8_t outbox_size_;
+  uint8_t outbox_[kOutboxSize];
+};
+
+// Queues the same message on each of a set of WebSockets, i.e. for all of the
+// clients connected to a device.
+class WebSocketBroadcaster {
+ public:
+  template <size_t N>
+  explicit WebSocketBroadcaster(WebSocket* const (&websockets)[N])
+      : websockets_(websockets), num_websockets_(N) {}
+
+  // Queues the message on each open WebSocket. Returns the number of WebSockets
+  // on which it was queued.
+  uint8_t BroadcastText(const mcucore::StringView& text) const;
+  uint8_t BroadcastBinary(const uint8_t* data, size_t size) const;
+
+ private:
+  WebSocket* const* const websockets_;
+  const uint8_t num_websockets_;
+};
+
+// Computes the value of the Sec-WebSocket-Accept header of the response to an
+// upgrade request with the given Sec-WebSocket-Key, i.e. the base64 encoding
+// of the SHA-1 digest of the key and the WebSocket GUID.
+void ComputeWebSocketAccept(const char (&key)[24], char (&accept)[28]);
+
+}  // namespace mcunet
+
+#endif  // MCUNET_SRC_WEBSOCKET_H_
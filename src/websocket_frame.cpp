@@ -0,0 +1,230 @@
+#include "websocket_frame.h"
+
+#include <McuCore.h>
+
+namespace mcunet {
+namespace {
+
+constexpr uint8_t kFinBit = 0x80;
+constexpr uint8_t kReservedBits = 0x70;
+constexpr uint8_t kOpcodeBits = 0x0F;
+constexpr uint8_t kMaskBit = 0x80;
+constexpr uint8_t kLengthBits = 0x7F;
+constexpr uint8_t kLength16 = 126;
+constexpr uint8_t kLength64 = 127;
+
+}  // namespace
+
+void ApplyWebSocketMask(const uint8_t (&mask_key)[4], uint32_t payload_offset,
+                        uint8_t* data, size_t size) {
+  // Rotate the key so that key[0] applies to data[0].
+  uint8_t key[4];
+  for (uint8_t ndx = 0; ndx < 4; ++ndx) {
+    key[ndx] = mask_key[(payload_offset + ndx) & 3];
+  }
+  // memcpy lets the compiler use word loads and stores where the platform
+  // allows unaligned access, without undefined behavior where it doesn't. The
+  // key and the data are both in memory order, so endianness doesn't matter.
+  uint32_t key_word;
+  memcpy(&key_word, key, sizeof key_word);
+  while (size >= sizeof key_word) {
+    uint32_t word;
+    memcpy(&word, data, sizeof word);
+    word ^= key_word;
+    memcpy(data, &word, sizeof word);
+    data += sizeof word;
+    size -= sizeof word;
+  }
+  for (uint8_t ndx = 0; ndx < size; ++ndx) {
+    data[ndx] ^= key[ndx];
+  }
+}
+
+void WriteWebSocketFrameHeader(Print& out, WebSocketOpcode opcode,
+                               uint32_t payload_size, bool fin) {
+  uint8_t header[10];
+  uint8_t header_size = 2;
+  header[0] = (fin ? kFinBit : 0) | static_cast<uint8_t>(opcode);
+  if (payload_size < kLength16) {
+    header[1] = static_cast<uint8_t>(payload_size);
+  } else if (payload_size <= 0xFFFF) {
+    header[1] = kLength16;
+    header[header_size++] = static_cast<uint8_t>(payload_size >> 8);
+    header[header_size++] = static_cast<uint8_t>(payload_size);
+  } else {
+    header[1] = kLength64;
+    for (uint8_t ndx = 0; ndx < 4; ++ndx) {
+      header[header_size++] = 0;
+    }
+    for (int8_t shift = 24; shift >= 0; shift -= 8) {
+      header[header_size++] = static_cast<uint8_t>(payload_size >> shift);
+    }
+  }
+  out.write(header, header_size);
+}
+
+WebSocketFrameDecoder::WebSocketFrameDecoder() { Reset(); }
+
+void WebSocketFrameDecoder::Reset() {
+  payload_size_ = 0;
+  payload_offset_ = 0;
+  state_ = State::kFirstByte;
+  opcode_ = WebSocketOpcode::kContinuation;
+  message_opcode_ = WebSocketOpcode::kText;
+  error_code_ = WebSocketCloseCode::kProtocolError;
+  header_bytes_needed_ = 0;
+  fin_ = false;
+  in_message_ = false;
+}
+
+WebSocketFrameDecoder::Result WebSocketFrameDecoder::Decode(uint8_t* data,
+                                                            size_t size,
+                                                            size_t& consumed) {
+  consumed = 0;
+  if (state_ == State::kError) {
+    return Result::kError;
+  } else if (state_ == State::kPayload) {
+    if (payload_remaining() > 0) {
+      consumed = payload_remaining() < size ? payload_remaining() : size;
+      ApplyWebSocketMask(mask_key_, payload_offset_, data, consumed);
+      payload_offset_ += consumed;
+      return consumed > 0 ? Result::kPayload : Result::kNeedMoreInput;
+    }
+    state_ = State::kFirstByte;
+  }
+  while (consumed < size) {
+    const auto result = DecodeHeaderByte(data[consumed++]);
+    if (result != Result::kNeedMoreInput) {
+      return result;
+    }
+  }
+  return Result::kNeedMoreInput;
+}
+
+WebSocketFrameDecoder::Result WebSocketFrameDecoder::DecodeHeaderByte(
+    const uint8_t b) {
+  switch (state_) {
+    case State::kFirstByte:
+      return DecodeFirstByte(b);
+
+    case State::kSecondByte:
+      return DecodeSecondByte(b);
+
+    case State::kExtendedLength:
+      if (header_bytes_needed_ > 4 && b != 0) {
+        // We can't count beyond 32 bits, and couldn't use that much anyway.
+        return Error(WebSocketCloseCode::kMessageTooBig);
+      }
+      payload_size_ = (payload_size_ << 8) | b;
+      if (--header_bytes_needed_ == 0) {
+        header_bytes_needed_ = sizeof mask_key_;
+        state_ = State::kMaskKey;
+      }
+      return Result::kNeedMoreInput;
+
+    case State::kMaskKey:
+      mask_key_[sizeof mask_key_ - header_bytes_needed_] = b;
+      if (--header_bytes_needed_ == 0) {
+        return EndHeader();
+      }
+      return Result::kNeedMoreInput;
+
+    case State::kPayload:
+    case State::kError:
+      break;
+  }
+  MCU_DCHECK(false) << MCU_PSD("Unexpected state ")
+                    << static_cast<uint8_t>(state_);
+  return Error(WebSocketCloseCode::kProtocolError);
+}
+
+WebSocketFrameDecoder::Result WebSocketFrameDecoder::DecodeFirstByte(
+    const uint8_t b) {
+  if (b & kReservedBits) {
+    // No extensions have been negotiated, so these must be zero.
+    return Error(WebSocketCloseCode::kProtocolError);
+  }
+  fin_ = (b & kFinBit) != 0;
+  opcode_ = static_cast<WebSocketOpcode>(b & kOpcodeBits);
+  switch (opcode_) {
+    case WebSocketOpcode::kContinuation:
+      if (!in_message_) {
+        return Error(WebSocketCloseCode::kProtocolError);
+      }
+      break;
+
+    case WebSocketOpcode::kText:
+    case WebSocketOpcode::kBinary:
+      if (in_message_) {
+        // The previous message hasn't ended.
+        return Error(WebSocketCloseCode::kProtocolError);
+      }
+      break;
+
+    case WebSocketOpcode::kClose:
+    case WebSocketOpcode::kPing:
+    case WebSocketOpcode::kPong:
+      if (!fin_) {
+        // Control frames may not be fragmented.
+        return Error(WebSocketCloseCode::kProtocolError);
+      }
+      break;
+
+    default:
+      return Error(WebSocketCloseCode::kProtocolError);
+  }
+  state_ = State::kSecondByte;
+  return Result::kNeedMoreInput;
+}
+
+WebSocketFrameDecoder::Result WebSocketFrameDecoder::DecodeSecondByte(
+    const uint8_t b) {
+  if (!(b & kMaskBit)) {
+    // All frames sent by a client must be masked.
+    return Error(WebSocketCloseCode::kProtocolError);
+  }
+  const uint8_t length = b & kLengthBits;
+  if (is_control_frame() && length > kMaxWebSocketControlPayloadSize) {
+    return Error(WebSocketCloseCode::kProtocolError);
+  }
+  payload_size_ = 0;
+  if (length == kLength16) {
+    header_bytes_needed_ = 2;
+    state_ = State::kExtendedLength;
+  } else if (length == kLength64) {
+    header_bytes_needed_ = 8;
+    state_ = State::kExtendedLength;
+  } else {
+    payload_size_ = length;
+    header_bytes_needed_ = sizeof mask_key_;
+    state_ = State::kMaskKey;
+  }
+  return Result::kNeedMoreInput;
+}
+
+WebSocketFrameDecoder::Result WebSocketFrameDecoder::EndHeader() {
+  if (opcode_ == WebSocketOpcode::kClose && payload_size_ == 1) {
+    // The payload of a Close frame, if any, starts with a 2 byte status code.
+    return Error(WebSocketCloseCode::kProtocolError);
+  }
+  if (!is_control_frame()) {
+    if (opcode_ != WebSocketOpcode::kContinuation) {
+      message_opcode_ = opcode_;
+    }
+    in_message_ = !fin_;
+  }
+  payload_offset_ = 0;
+  state_ = State::kPayload;
+  return Result::kFrameHeader;
+}
+
+WebSocketFrameDecoder::Result WebSocketFrameDecoder::Error(
+    WebSocketCloseCode error_code) {
+  MCU_VLOG(2) << MCU_PSD("WebSocketFrameDecoder::Error ")
+              << static_cast<uint16_t>(error_code);
+  error_code_ = error_code;
+  state_ = State::kError;
+  return Result::kError;
+}
+
+}  // namespace mcunet
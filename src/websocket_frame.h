@@ -0,0 +1,138 @@
+#ifndef MCUNET_SRC_WEBSOCKET_FRAME_H_
+#define MCUNET_SRC_WEBSOCKET_FRAME_H_
+
+// Support for the framing layer of the WebSocket protocol (RFC 6455), from the
+// perspective of a server: WebSocketFrameDecoder decodes the (masked) frames
+// sent by a client, and WriteWebSocketFrameHeader writes the header of an
+// (unmasked) frame sent to a client.
+//
+// The decoder uses a fixed amount of memory (about 16 bytes), regardless of
+// the size of the frames: it doesn't buffer the payload, but unmasks it in
+// place in the caller's buffer and hands it back a piece at a time, so a
+// payload of any length can be streamed through a small read buffer.
+//
+// Author: james.synge@gmail.com
+
+#include <McuCore.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace mcunet {
+
+enum class WebSocketOpcode : uint8_t {
+  kContinuation = 0x0,
+  kText = 0x1,
+  kBinary = 0x2,
+  kClose = 0x8,
+  kPing = 0x9,
+  kPong = 0xA,
+};
+
+// Status codes sent in the payload of a Close frame.
+enum class WebSocketCloseCode : uint16_t {
+  kNormalClosure = 1000,
+  kGoingAway = 1001,
+  kProtocolError = 1002,
+  kMessageTooBig = 1009,
+};
+
+// The largest payload of a control frame (i.e. Close, Ping or Pong).
+constexpr uint8_t kMaxWebSocketControlPayloadSize = 125;
+
+// XORs data with the masking key, which the client chose for the frame.
+// payload_offset is the offset of data[0] from the start of the frame's
+// payload, which determines which byte of the key applies to it. The bulk of
+// the data is masked a 32-bit word at a time.
+void ApplyWebSocketMask(const uint8_t (&mask_key)[4], uint32_t payload_offset,
+                        uint8_t* data, size_t size);
+
+// Writes the header of an unmasked frame with a payload of payload_size bytes,
+// which the caller must then write. fin is false for all but the last frame of
+// a fragmented message.
+void WriteWebSocketFrameHeader(Print& out, WebSocketOpcode opcode,
+                               uint32_t payload_size, bool fin = true);
+
+class WebSocketFrameDecoder {
+ public:
+  enum class Result : uint8_t {
+    // All of the data has been consumed, without completing a frame header.
+    kNeedMoreInput,
+    // A frame header has been decoded; opcode(), fin() and payload_size()
+    // describe the frame.
+    kFrameHeader,
+    // The first 'consumed' bytes of the data are (unmasked) payload of the
+    // current frame.
+    kPayload,
+    // The client has violated the protocol; error_code() is the status code
+    // with which to close the connection.
+    kError,
+  };
+
+  WebSocketFrameDecoder();
+
+  // Restores the state to that at construction, i.e. expecting the first frame
+  // of a message.
+  void Reset();
+
+  // Decodes frames from data, unmasking the payload in place. Sets consumed to
+  // the number of bytes of data that have been used, and returns the reason
+  // for stopping. After a result of kFrameHeader or kPayload, the frame is
+  // complete if payload_remaining() is zero.
+  Result Decode(uint8_t* data, size_t size, size_t& consumed);
+
+  // The opcode of the current frame.
+  WebSocketOpcode opcode() const { return opcode_; }
+
+  // The opcode (kText or kBinary) of the current data message, i.e. of its
+  // first frame, as later frames of the message are continuation frames.
+  WebSocketOpcode message_opcode() const { return message_opcode_; }
+
+  // Returns true if the current frame is a control frame (Close, Ping or
+  // Pong), which may arrive between the frames of a fragmented message.
+  bool is_control_frame() const {
+    return (static_cast<uint8_t>(opcode_) & 0x8) != 0;
+  }
+
+  // Returns true if the current frame is the last of its message.
+  bool fin() const { return fin_; }
+
+  uint32_t payload_size() const { return payload_size_; }
+  uint32_t payload_remaining() const { return payload_size_ - payload_offset_; }
+
+  WebSocketCloseCode error_code() const { return error_code_; }
+
+ private:
+  enum class State : uint8_t {
+    kFirstByte,
+    kSecondByte,
+    kExtendedLength,
+    kMaskKey,
+    kPayload,
+    kError,
+  };
+
+  // Examines a byte of the frame header. Returns kFrameHeader when the header
+  // is complete, kError if it is invalid, else kNeedMoreInput.
+  Result DecodeHeaderByte(uint8_t b);
+  Result DecodeFirstByte(uint8_t b);
+  Result DecodeSecondByte(uint8_t b);
+  Result EndHeader();
+  Result Error(WebSocketCloseCode error_code);
+
+  uint32_t payload_size_;
+  uint32_t payload_offset_;
+  uint8_t mask_key_[4];
+  State state_;
+  WebSocketOpcode opcode_;
+  WebSocketOpcode message_opcode_;
+  WebSocketCloseCode error_code_;
+  // Number of bytes of the extended length or masking key still to be read.
+  uint8_t header_bytes_needed_;
+  bool fin_;
+  // True if a data message has started but its last frame hasn't arrived.
+  bool in_message_;
+};
+
+}  // namespace mcunet
+
+#endif  // MCUNET_SRC_WEBSOCKET_FRAME_H_
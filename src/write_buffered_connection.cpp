@@ -3,6 +3,13 @@
 #include <McuCore.h>
 
 namespace mcunet {
+namespace {
+
+char HexDigit(uint8_t nibble) {
+  return nibble < 10 ? '0' + nibble : 'A' + (nibble - 10);
+}
+
+}  // namespace
 
 WriteBufferedConnection::WriteBufferedConnection(uint8_t *write_buffer,
                                                  uint8_t write_buffer_limit,
@@ -10,6 +17,8 @@ WriteBufferedConnection::WriteBufferedConnection(uint8_t *write_buffer,
     : write_buffer_(write_buffer),
       write_buffer_limit_(write_buffer_limit),
       write_buffer_size_(0),
+      chunk_start_(0),
+      chunked_(false),
       client_(client) {
   MCU_DCHECK(write_buffer != nullptr);
   MCU_DCHECK(write_buffer_limit > 0);
@@ -25,13 +34,7 @@ size_t WriteBufferedConnection::write(uint8_t b) {
   MCU_VLOG(9) << MCU_PSD("WriteBufferedConnection@") << this
               << MCU_PSD("::write b=") << mcucore::BaseHex << (b + 0);
   MCU_DCHECK_LE(write_buffer_size_, write_buffer_limit_);
-  bool ok_to_write;
-  if (write_buffer_size_ >= write_buffer_limit_) {
-    ok_to_write = FlushInternal();
-  } else {
-    ok_to_write = getWriteError() == 0;
-  }
-  if (ok_to_write) {
+  if (MakeRoom()) {
     write_buffer_[write_buffer_size_++] = b;
     return 1;
   } else {
@@ -49,10 +52,6 @@ size_t WriteBufferedConnection::write(const uint8_t *buf, const size_t size) {
       << mcucore::BaseHex << buf << ' ' << size << ' ' << write_buffer_ << ' '
       << write_buffer_limit_;
 
-  if (getWriteError() != 0) {
-    return 0;
-  }
-
   // I tried adding an optimization here for the case where we'll have to do at
   // least two flush calls here (i.e. if the amount of data in buf, plus the
   // already buffered data, is at least twice the size of the write buffer).
@@ -63,14 +62,12 @@ size_t WriteBufferedConnection::write(const uint8_t *buf, const size_t size) {
   size_t remaining = size;
   while (remaining > 0) {
     MCU_DCHECK_LE(write_buffer_size_, write_buffer_limit_);
-    size_t room = write_buffer_limit_ - write_buffer_size_;
-    if (room == 0) {
-      if (!FlushInternal()) {
-        MCU_VLOG(9) << MCU_PSD("WriteBufferedConnection@") << this
-                    << MCU_PSD("::write: !ok after flush");
-        return 0;
-      }
+    if (!MakeRoom()) {
+      MCU_VLOG(9) << MCU_PSD("WriteBufferedConnection@") << this
+                  << MCU_PSD("::write: !ok after flush");
+      return 0;
     }
+    size_t room = DataLimit() - write_buffer_size_;
     if (room > remaining) {
       room = remaining;
     }
@@ -83,10 +80,14 @@ size_t WriteBufferedConnection::write(const uint8_t *buf, const size_t size) {
 }
 
 int WriteBufferedConnection::availableForWrite() {
-  if (getWriteError() == 0) {
-    return write_buffer_limit_ - write_buffer_size_;
+  if (getWriteError() != 0) {
+    return -1;
+  }
+  int room = DataLimit() - write_buffer_size_;
+  if (chunked_ && chunk_start_ == 0) {
+    room -= kChunkHeaderSize;
   }
-  return -1;
+  return room > 0 ? room : 0;
 }
 
 int WriteBufferedConnection::available() { return client_.available(); }
@@ -108,12 +109,115 @@ void WriteBufferedConnection::flush() {
   FlushInternal();
 }
 
+bool WriteBufferedConnection::StartChunkedCoding() {
+  MCU_DCHECK(!chunked_);
+  if (write_buffer_limit_ <= kChunkHeaderSize + kChunkTrailerSize) {
+    return false;
+  }
+  chunked_ = true;
+  chunk_start_ = 0;
+  return true;
+}
+
+void WriteBufferedConnection::EndChunkedCoding() {
+  MCU_DCHECK(chunked_);
+  EndChunk();
+  chunked_ = false;
+  mcucore::OPrintStream strm(*this);
+  strm << MCU_PSD("0\r\n\r\n");
+}
+
+bool WriteBufferedConnection::TryFlush() {
+  if (getWriteError() != 0) {
+    return false;
+  }
+  EndChunk();
+  if (write_buffer_size_ == 0) {
+    return true;
+  }
+  const int wrote = TryWriteToClient(write_buffer_, write_buffer_size_);
+  MCU_VLOG(9) << MCU_PSD("try flush ") << write_buffer_size_
+              << MCU_PSD(", wrote ") << wrote;
+  if (wrote < 0) {
+    setWriteError(kTryWriteFailed);
+    return false;
+  } else if (wrote == 0) {
+    const auto client_error = client_.getWriteError();
+    if (client_error != 0) {
+      setWriteError(client_error);
+    }
+    return false;
+  }
+  MCU_DCHECK_LE(wrote, write_buffer_size_);
+  write_buffer_size_ -= wrote;
+  if (write_buffer_size_ == 0) {
+    return true;
+  }
+  // Move the unwritten bytes to the front of the buffer so that write can
+  // continue to append.
+  memmove(write_buffer_, write_buffer_ + wrote, write_buffer_size_);
+  return false;
+}
+
+int WriteBufferedConnection::TryWriteToClient(const uint8_t *buf,
+                                              size_t size) {
+  return client_.write(buf, size);
+}
+
+uint8_t WriteBufferedConnection::DataLimit() const {
+  return chunked_ ? write_buffer_limit_ - kChunkTrailerSize
+                  : write_buffer_limit_;
+}
+
+bool WriteBufferedConnection::MakeRoom() {
+  if (getWriteError() != 0) {
+    return false;
+  }
+  if (write_buffer_size_ >= DataLimit() && !FlushInternal()) {
+    return false;
+  }
+  if (chunked_ && chunk_start_ == 0) {
+    // Reserve room for the chunk-size line, and at least one byte of data.
+    if (write_buffer_size_ + kChunkHeaderSize >= DataLimit() &&
+        !FlushInternal()) {
+      return false;
+    }
+    write_buffer_size_ += kChunkHeaderSize;
+    chunk_start_ = write_buffer_size_;
+  }
+  return true;
+}
+
+void WriteBufferedConnection::EndChunk() {
+  if (chunk_start_ == 0) {
+    return;
+  }
+  MCU_DCHECK(chunked_);
+  const uint8_t chunk_size = write_buffer_size_ - chunk_start_;
+  if (chunk_size == 0) {
+    // An empty chunk would mark the end of the body.
+    write_buffer_size_ = chunk_start_ - kChunkHeaderSize;
+  } else {
+    uint8_t* header = write_buffer_ + chunk_start_ - kChunkHeaderSize;
+    header[0] = HexDigit(chunk_size >> 4);
+    header[1] = HexDigit(chunk_size & 0xF);
+    header[2] = '\r';
+    header[3] = '\n';
+    write_buffer_[write_buffer_size_++] = '\r';
+    write_buffer_[write_buffer_size_++] = '\n';
+  }
+  chunk_start_ = 0;
+}
+
 bool WriteBufferedConnection::FlushInternal() {
-  MCU_DCHECK_LT(0, write_buffer_size_);
+  EndChunk();
   MCU_DCHECK_LE(write_buffer_size_, write_buffer_limit_);
 
   if (getWriteError() != 0) {
     return false;
+  } else if (write_buffer_size_ == 0) {
+    // Only the room reserved for the chunk-size line was in use.
+    return true;
   }
 
   // Ethernet5500's send() function is sort of non-blocking. It will write at
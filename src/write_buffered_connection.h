@@ -12,6 +12,12 @@
 // any kind of async SPI... it doesn't seem necessary for Tiny Alpaca Server and
 // would require more buffer management.
 //
+// WriteBufferedConnection also supports the chunked transfer coding of
+// HTTP/1.1 (see StartChunkedCoding), framing the data in the write buffer as a
+// chunk when the buffer is flushed. It reserves room in the buffer for the
+// chunk-size line and the CRLF that follows the data, so each chunk is written
+// to the client with the rest of the buffer, without copying.
+//
 // Author: james.synge@gmail.com
 
 #include <Client.h>
@@ -28,6 +34,10 @@ class WriteBufferedConnection : public Connection {
   // bytes (in FlushInternal).
   static constexpr int kBlockedFlush = 1234;
 
+  // The write error value will be set to kTryWriteFailed if TryWriteToClient
+  // reports an error (in TryFlush).
+  static constexpr int kTryWriteFailed = 1235;
+
   WriteBufferedConnection(uint8_t* write_buffer, uint8_t write_buffer_limit,
                           Client& client);
   // Writes any data accumulated in the write buffer to the underlying client.
@@ -45,12 +55,49 @@ class WriteBufferedConnection : public Connection {
   int peek() override;
   void flush() override;
   uint8_t connected() override;
+  bool StartChunkedCoding() override;
+  void EndChunkedCoding() override;
+
+  // Writes as much of the buffered data as can be written without waiting for
+  // room in the underlying socket. Returns true if the write buffer is then
+  // empty; returns false if data remains buffered or if there is a write
+  // error. Unlike flush(), this allows a listener with lots of data to send
+  // to a slow client to return to the loop (i.e. to let other sockets be
+  // serviced), and to continue on a later call.
+  bool TryFlush();
 
  protected:
   uint8_t write_buffer_size() const { return write_buffer_size_; }
   Client& client() { return client_; }
 
+  // Writes up to size bytes to the client without waiting for room, returning
+  // the number of bytes written (possibly zero), or -1 if there is an error.
+  // Client doesn't provide a non-blocking write, so the default implementation
+  // delegates to client().write(); subclasses that know of a non-blocking
+  // alternative should override this.
+  virtual int TryWriteToClient(const uint8_t* buf, size_t size);
+
  private:
+  // The chunk-size line is written as two hex digits (with a leading zero if
+  // necessary), which suffices because a chunk fits in the write buffer.
+  static constexpr uint8_t kChunkHeaderSize = 4;  // e.g. "0C\r\n"
+  static constexpr uint8_t kChunkTrailerSize = 2;  // "\r\n"
+
+  // Returns the size to which the buffer may be filled with data, which
+  // excludes the room reserved for the CRLF that ends the chunk.
+  uint8_t DataLimit() const;
+
+  // Ensures that there is room in the buffer for at least one byte of data,
+  // flushing if necessary, and in chunked mode reserving room for the
+  // chunk-size line if no chunk has been started. Returns false if there is a
+  // write error.
+  bool MakeRoom();
+
+  // In chunked mode, completes the framing of the chunk that has been started,
+  // if any, or removes the room reserved for its chunk-size line if it is
+  // empty.
+  void EndChunk();
+
   // Flush the (non-empty) buffer to the client. There may or may not be a write
   // error already recorded. Returns true if successful, false if an error is
   // detected while or before writing to client_.
@@ -59,6 +106,10 @@ class WriteBufferedConnection : public Connection {
   uint8_t* const write_buffer_;
   const uint8_t write_buffer_limit_;
   uint8_t write_buffer_size_;
+  // In chunked mode, the offset in write_buffer_ of the data of the chunk that
+  // has been started, else zero.
+  uint8_t chunk_start_;
+  bool chunked_;
   Client& client_;
 };
 